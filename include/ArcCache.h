@@ -1,8 +1,11 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include <list>
 #include <mutex>
+#include <optional>
 #include "CachePolicy.h"
 
 /*  ArcCache_standard.h
@@ -22,21 +25,227 @@ public:
     ~ArcCache() override = default;
 
     void put(Key key, Value value) override {
+        Lock lk(mu_, removals_);
+        putNoLock(std::move(key), std::move(value));
+    }
+
+    bool get(Key key, Value& value) override {
+        Lock lk(mu_, removals_);
+        return getNoLock(key, value);
+    }
+
+    Value get(Key key) override {
+        Value v{};
+        (void)get(key, v);
+        return v;
+    }
+
+    // 已在 T1/T2 中的当场改写并按一次访问处理；不在的（含 ghost 命中）走 put 的完整流程
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Lock lk(mu_, removals_);
+        NodeMap* m = nullptr;
+        typename NodeMap::iterator it;
+        for (auto* mm : {&t1Map_, &t2Map_}) {
+            auto f = mm->find(key);
+            if (f == mm->end()) continue;
+            if (live(f->second)) { m = mm; it = f; }
+            else eraseEntry(*mm, f, RemovalCause::Expired);
+            break;
+        }
+        std::optional<Value> result = fn(m ? &it->second->value : nullptr);
+        if (!result) {
+            if (m) eraseEntry(*m, it, RemovalCause::Explicit);
+            return result;
+        }
+        if (!m) {
+            putNoLock(std::move(key), Value(*result));
+        } else {
+            replaceValue(it->second, Value(*result));
+            if (m == &t1Map_) moveT1toT2(it->second);
+            else moveToT2MRU(it->second);
+        }
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        Lock lk(mu_, removals_);
+        if (capacity_ <= 0) return false;
+        for (auto* m : {&t1Map_, &t2Map_}) {
+            auto it = m->find(key);
+            if (it != m->end() && live(it->second)) return false;
+        }
+        putNoLock(std::move(key), std::move(value));
+        return true;
+    }
+
+    // 与 “get 未命中再 put” 完全等价（ghost 命中照样调整 p），只是在同一次加锁内完成
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        Lock lk(mu_, removals_);
+        if (getNoLock(key, value)) return true;
+        value = factory();
+        putNoLock(std::move(key), Value(value));
+        return false;
+    }
+
+    // 只删真实条目；ghost 只是访问历史，不含数据，保留
+    bool remove(Key key) override {
+        Lock lk(mu_, removals_);
+        for (auto* m : {&t1Map_, &t2Map_}) {
+            auto it = m->find(key);
+            if (it == m->end()) continue;
+            const bool wasLive = live(it->second);
+            eraseEntry(*m, it, wasLive ? RemovalCause::Explicit : RemovalCause::Expired);
+            return wasLive;
+        }
+        return false;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        Lock lk(mu_, removals_);
+        size_t n = 0;
+        for (auto* m : {&t1Map_, &t2Map_}) {
+            for (auto it = m->begin(); it != m->end();) {
+                const bool stale = !live(it->second);
+                if (stale || pred(it->first, it->second->value)) {
+                    if (!stale) ++n;
+                    it = eraseEntry(*m, it, stale ? RemovalCause::Expired : RemovalCause::Explicit);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return n;
+    }
+
+    // O(1)：代数加一，记下旧代条目数。旧代条目不会再被挪动（访问到就删），所以都压在 T1/T2 的 LRU 端；
+    // replace / evictOne / trimTo 腾位置时只要 staleCount_ > 0 就先丢两条链表尾部的旧代条目（不进 ghost，按 Expired 通知），
+    // 不会因为 p 指向另一条链表而把旧代条目留下、反去驱逐新写入的条目
+    void invalidateAll() override {
+        std::lock_guard<std::mutex> lk(mu_);
+        ++generation_;
+        staleCount_ = t1Map_.size() + t2Map_.size();
+    }
+
+    // 驱逐一个真实缓存条目并返回其 key（按 replace 的规则落入 B1/B2），与 LruCache/LfuCache::evictOne 对齐
+    // 有监听器时按 Capacity 通知；有旧代条目时先丢旧代条目（Expired）
+    Key evictOne() {
+        Lock lk(mu_, removals_);
+        if (t1Map_.empty() && t2Map_.empty()) return Key();
+        Key stale;
+        if (dropStaleTail(&stale)) return stale;
+        if (!t1Map_.empty() && ((int)t1Map_.size() > p_ || t2Map_.empty())) {
+            Key k = t1Tail_->prev_.lock()->key;
+            evictT1toB1();
+            return k;
+        }
+        Key k = t2Tail_->prev_.lock()->key;
+        evictT2toB2();
+        return k;
+    }
+
+    // 后台维护用：真实条目超过 high 时一次加锁按 replace 的规则降级到 ghost，降到 low 或降级满 maxBatch 条为止；
+    // ghost 也按 low 裁剪（|T1|+|B1| ≤ low，总数 ≤ 2·low，每次最多 maxBatch 个），
+    // put 路径上就很少再碰到“B1 满了先裁 ghost 再 replace”。返回降级的真实条目数
+    size_t trimTo(size_t high, size_t low, size_t maxBatch) {
+        Lock lk(mu_, removals_);
+        const int lo = static_cast<int>(low);
+        size_t n = 0;
+        if (t1Map_.size() + t2Map_.size() > high) {
+            for (; n < maxBatch && (int)(t1Map_.size() + t2Map_.size()) > lo; ++n) replace(false);
+        }
+        for (size_t g = 0; g < maxBatch && !b1List_.empty() && (int)(t1Map_.size() + b1Map_.size()) > lo; ++g)
+            evictGhostTail(b1List_, b1Map_);
+        for (size_t g = 0; g < maxBatch && !b2List_.empty()
+                           && (int)(t1Map_.size() + t2Map_.size() + b1Map_.size() + b2Map_.size()) > 2 * lo; ++g)
+            evictGhostTail(b2List_, b2Map_);
+        return n;
+    }
+
+    // 缩容：先收紧 p，再按 replace 的规则分批把 T1/T2 多出的条目降级到 ghost，最后裁剪 ghost
+    void setCapacity(size_t capacity) override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            capacity_ = static_cast<int>(capacity);
+            p_ = std::min(p_, capacity_);
+        }
+        for (;;) {
+            Lock lk(mu_, removals_);  //每批降级的通知在本批解锁后投递
+            for (int i = 0; i < kEvictBatch && (int)(t1Map_.size() + t2Map_.size()) > capacity_; ++i) {
+                replace(false);
+            }
+            if ((int)(t1Map_.size() + t2Map_.size()) > capacity_) continue;
+            while ((int)(t1Map_.size() + b1Map_.size()) > capacity_ && !b1List_.empty()) evictGhostTail(b1List_, b1Map_);
+            while ((int)(t1Map_.size() + t2Map_.size() + b1Map_.size() + b2Map_.size()) > 2 * capacity_ && !b2List_.empty())
+                evictGhostTail(b2List_, b2Map_);
+            return;
+        }
+    }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        std::lock_guard<std::mutex> lk(mu_);
+        removals_.setListener(std::move(listener), batchSize);
+    }
+
+    void flushRemovals() override {
+        Lock lk(mu_, removals_, true);
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return t1Map_.size() + t2Map_.size();
+    }
+
+    MemoryUsage memoryUsage() const override {
         std::lock_guard<std::mutex> lk(mu_);
+        const size_t n = t1Map_.size() + t2Map_.size();
+        const size_t ghosts = b1List_.size() + b2List_.size();
+        MemoryUsage m;
+        m.entries  = n;
+        m.index    = hashIndexBytes(t1Map_) + hashIndexBytes(t2Map_) + keyHeapBytes_;
+        m.nodes    = (n + 4) * (sharedNodeBytes<Node>() - sizeof(Value)) + keyHeapBytes_; //+4 为 T1/T2 头尾哨兵
+        m.values   = (n + 4) * sizeof(Value) + valueHeapBytes_;
+        //B1/B2：std::list 节点 + 哈希表，ghost key 各存两份
+        m.metadata = ghosts * listNodeBytes<Key>() + hashIndexBytes(b1Map_) + hashIndexBytes(b2Map_)
+                   + 2 * ghostKeyHeapBytes_;
+        return m;
+    }
+
+private:
+    struct Node {
+        Key key{};
+        Value value{};
+        std::weak_ptr<Node> prev_;
+        std::shared_ptr<Node> next_;
+        Node() = default;
+        Node(const Key& k, const Value& v) : key(k), value(v) {}
+        Node(Key&& k, Value&& v) : key(std::move(k)), value(std::move(v)) {}
+        uint32_t gen = 0;   //写入时的代数
+    };
+    using NodePtr = std::shared_ptr<Node>;
+    using NodeMap = std::unordered_map<Key, NodePtr>;
+    using Lock = NotifyingLock<std::mutex, Key, Value>; //会删除条目的路径都用它：解锁后投递删除通知
+
+    bool live(const NodePtr& n) const { return n->gen == generation_; }
+
+    void putNoLock(Key key, Value value) {
         if (capacity_ <= 0) return;
 
         //hit T1: T1->T2
+        //旧代条目（invalidateAll 之前写入）当作不存在：摘掉后按未命中处理
         auto itT1 = t1Map_.find(key);
+        if (itT1 != t1Map_.end() && !live(itT1->second)) { eraseEntry(t1Map_, itT1, RemovalCause::Expired); itT1 = t1Map_.end(); }
         if (itT1 != t1Map_.end()) {
-            itT1->second->value = std::move(value);
+            replaceValue(itT1->second, std::move(value));
             //move将value以形参的形式存进缓存中，避免不必要的拷贝
             moveT1toT2(itT1->second);
             return;
         }
         //hit T2: only need to refresh
         auto itT2 = t2Map_.find(key);
+        if (itT2 != t2Map_.end() && !live(itT2->second)) { eraseEntry(t2Map_, itT2, RemovalCause::Expired); itT2 = t2Map_.end(); }
         if (itT2 != t2Map_.end()) {
-            itT2->second->value = std::move(value);
+            replaceValue(itT2->second, std::move(value));
             moveToT2MRU(itT2->second);//更新到LRU链表表头
             return;
         }
@@ -48,10 +257,10 @@ public:
                 p_ + std::max(1, (int)b2List_.size() / (int)std::max<size_t>(1, b1List_.size())),
                 capacity_);
             //用｜B2｜/｜B1｜作为步长的权重，更快的向T1偏，min(1,)表示至少+1；
-            replace(key);
-            //replace 的逻辑就是保证 T1+T2<=capacity
+            ghostKeyHeapBytes_ -= heapBytesOf(itB1->first);
             b1List_.erase(itB1->second);
             b1Map_.erase(itB1);
+            replace(false); //先摘掉 ghost 再 replace：replace 可能裁剪 B1，迭代器会失效
             insertToT2(key, std::move(value));
             return;
         }
@@ -59,9 +268,10 @@ public:
         auto itB2 = b2Map_.find(key);
         if (itB2 != b2Map_.end()) {
             p_ = std::max(p_ - std::max(1, (int)b1List_.size() / (int)std::max<size_t>(1, b2List_.size())), 0);
-            replace(key);
+            ghostKeyHeapBytes_ -= heapBytesOf(itB2->first);
             b2List_.erase(itB2->second);
             b2Map_.erase(itB2);
+            replace(true); //先摘掉 ghost 再 replace：replace 可能裁剪 B2，迭代器会失效
             insertToT2(key, std::move(value));
             return;
         }
@@ -70,7 +280,7 @@ public:
         //用 |T1|+|B1| ≤ C 这个“影子额度”来防幽灵无限膨胀，保证反馈窗口大小有界。
             if ((int)t1Map_.size() < capacity_) { //B1更多
                 evictGhostTail(b1List_, b1Map_);
-                replace(key);
+                replace(false);
             } else {                              //T1.size()==capacity
                 evictT1toB1();
             }
@@ -80,20 +290,24 @@ public:
                 evictGhostTail(b2List_, b2Map_);
                 //整体接近 2C 时，通常是长期侧的体量（T2+B2）更大，所以从 B2 开始收缩
             }
+            if ((int)(t1Map_.size() + t2Map_.size()) >= capacity_) {
+                replace(false); //真实缓存已满：必须腾出一个位置，否则 T1+T2 会无限增长
+            }
         }
         //都没有命中则插入T1
         insertToT1(key, std::move(value));
     }
 
-    bool get(Key key, Value& value) override {
-        std::lock_guard<std::mutex> lk(mu_);
+    bool getNoLock(const Key& key, Value& value) {
         auto itT1 = t1Map_.find(key);
+        if (itT1 != t1Map_.end() && !live(itT1->second)) { eraseEntry(t1Map_, itT1, RemovalCause::Expired); return false; }
         if (itT1 != t1Map_.end()) {
             value = itT1->second->value;
             moveT1toT2(itT1->second);
             return true;
         }
         auto itT2 = t2Map_.find(key);
+        if (itT2 != t2Map_.end() && !live(itT2->second)) { eraseEntry(t2Map_, itT2, RemovalCause::Expired); return false; }
         if (itT2 != t2Map_.end()) {
             value = itT2->second->value;
             moveToT2MRU(itT2->second);
@@ -103,40 +317,36 @@ public:
         auto itB1 = b1Map_.find(key);
         if (itB1 != b1Map_.end()) {
             p_ = std::min(p_ + std::max(1, (int)b2List_.size() / (int)std::max<size_t>(1, b1List_.size())), capacity_);
-            replace(key);
+            ghostKeyHeapBytes_ -= heapBytesOf(itB1->first);
             b1List_.erase(itB1->second);
             b1Map_.erase(itB1);
+            replace(false); //先摘掉 ghost 再 replace：replace 可能裁剪 B1，迭代器会失效
             return false;
         }
         auto itB2 = b2Map_.find(key);
         if (itB2 != b2Map_.end()) {
             p_ = std::max(p_ - std::max(1, (int)b1List_.size() / (int)std::max<size_t>(1, b2List_.size())), 0);
-            replace(key);
+            ghostKeyHeapBytes_ -= heapBytesOf(itB2->first);
             b2List_.erase(itB2->second);
             b2Map_.erase(itB2);
+            replace(true); //先摘掉 ghost 再 replace：replace 可能裁剪 B2，迭代器会失效
             return false;
         }
         return false;
     }
 
-    Value get(Key key) override {
-        Value v{};
-        (void)get(key, v);
-        return v;
+    // 彻底删除一个真实条目（不进 ghost）；旧代条目只会从这里离开，staleCount_ 在这里减
+    typename NodeMap::iterator eraseEntry(NodeMap& m, typename NodeMap::iterator it, RemovalCause cause) {
+        NodePtr n = it->second;
+        if (!live(n)) --staleCount_;
+        removeNode(n);
+        keyHeapBytes_ -= heapBytesOf(n->key);
+        valueHeapBytes_ -= heapBytesOf(n->value);
+        auto next = m.erase(it);
+        removals_.push(n->key, std::move(n->value), cause);
+        return next;
     }
 
-private:
-    struct Node {
-        Key key{};
-        Value value{};
-        std::weak_ptr<Node> prev_;
-        std::shared_ptr<Node> next_;
-        Node() = default;
-        Node(const Key& k, const Value& v) : key(k), value(v) {}
-        Node(Key&& k, Value&& v) : key(std::move(k)), value(std::move(v)) {}
-    };
-    using NodePtr = std::shared_ptr<Node>;
-
     void init() { makeDummy(t1Head_, t1Tail_); makeDummy(t2Head_, t2Tail_); }
 
     void makeDummy(NodePtr& head, NodePtr& tail) {
@@ -167,19 +377,42 @@ private:
         insertAfter(head, node);
     }
 
+    //key/value 的堆上字节增量维护，memoryUsage() 无需遍历
+    void replaceValue(const NodePtr& n, Value&& v) {
+        valueHeapBytes_ -= heapBytesOf(n->value);
+        removals_.push(n->key, std::move(n->value), RemovalCause::Replaced);
+        n->value = std::move(v);
+        valueHeapBytes_ += heapBytesOf(n->value);
+    }
+    void accountInsert(const NodePtr& n) {
+        keyHeapBytes_ += heapBytesOf(n->key);
+        valueHeapBytes_ += heapBytesOf(n->value);
+    }
+    //真实条目降级为 ghost：value 释放（有监听器时按 Capacity 交出去），key 转入 ghost 统计
+    void accountDemote(const NodePtr& n) {
+        keyHeapBytes_ -= heapBytesOf(n->key);
+        valueHeapBytes_ -= heapBytesOf(n->value);
+        ghostKeyHeapBytes_ += heapBytesOf(n->key);
+        removals_.push(n->key, std::move(n->value), RemovalCause::Capacity);
+    }
+
     void insertToT1(const Key& key, Value&& v) {
         auto n = std::make_shared<Node>(key, std::move(v));
+        n->gen = generation_;
+        accountInsert(n);
         insertAfter(t1Head_, n);
         t1Map_[key] = n;
     }
 
     void insertToT2(const Key& key, Value&& v) {
         auto n = std::make_shared<Node>(key, std::move(v));
+        n->gen = generation_;
+        accountInsert(n);
         insertAfter(t2Head_, n);
         t2Map_[key] = n;
     }
 
-    void moveT1toT2(const NodePtr& n) {
+    void moveT1toT2(NodePtr n) { //按值传入：n 可能引用 t1Map_ 里的元素，erase 之后引用会悬空
         auto key = n->key;
         removeNode(n);
         t1Map_.erase(key);
@@ -192,8 +425,10 @@ private:
     void evictT1toB1() {
         auto victim = t1Tail_->prev_.lock();
         if (!victim || victim == t1Head_) return;
+        if (!live(victim)) { eraseEntry(t1Map_, t1Map_.find(victim->key), RemovalCause::Expired); return; }
         Key k = victim->key;
         removeNode(victim);
+        accountDemote(victim);
         t1Map_.erase(k);
         b1List_.push_front(k);
         b1Map_[k] = b1List_.begin();
@@ -203,8 +438,10 @@ private:
     void evictT2toB2() {
         auto victim = t2Tail_->prev_.lock();
         if (!victim || victim == t2Head_) return;
+        if (!live(victim)) { eraseEntry(t2Map_, t2Map_.find(victim->key), RemovalCause::Expired); return; }
         Key k = victim->key;
         removeNode(victim);
+        accountDemote(victim);
         t2Map_.erase(k);
         b2List_.push_front(k);
         b2Map_[k] = b2List_.begin();
@@ -214,13 +451,28 @@ private:
     void evictGhostTail(std::list<Key>& L, std::unordered_map<Key, typename std::list<Key>::iterator>& M) {
         if (L.empty()) return;
         Key k = L.back();
+        ghostKeyHeapBytes_ -= heapBytesOf(k);
         L.pop_back();
         M.erase(k);
     }
 
-    void replace(const Key& x) {
+    // 还有旧代条目时丢掉 T1 或 T2 尾部的一个（它们都在 LRU 端），O(1)
+    bool dropStaleTail(Key* key = nullptr) {
+        if (staleCount_ == 0) return false;
+        NodeMap* m = nullptr;
+        NodePtr victim;
+        if (!t1Map_.empty() && !live(victim = t1Tail_->prev_.lock())) m = &t1Map_;
+        else if (!t2Map_.empty() && !live(victim = t2Tail_->prev_.lock())) m = &t2Map_;
+        if (!m) return false;
+        if (key) *key = victim->key;
+        eraseEntry(*m, m->find(victim->key), RemovalCause::Expired);
+        return true;
+    }
+
+    void replace(bool hitB2) { //hitB2：本次访问的 key 来自 B2
+        if (dropStaleTail()) return;    //旧代条目优先腾位置，不动 ghost 也不动 p
         if (!t1Map_.empty() //T1非空则可以赶人
-        && ( (b2Map_.count(x) && (int)t1Map_.size() == p_) //同时满足：x来自B2， T1==p_ 的配额
+        && ( (hitB2 && (int)t1Map_.size() == p_) //同时满足：x来自B2， T1==p_ 的配额
            ||(int)t1Map_.size() > p_)) { //或T1超过了p_的配额；
             evictT1toB1();
         } else {            
@@ -229,14 +481,22 @@ private:
     }
 
 private:
+    static constexpr int kEvictBatch = 64;   //setCapacity 每次持锁最多驱逐的条目数
+
     int capacity_;
     int p_;
-    std::mutex mu_;
+    uint32_t generation_ = 0;
+    size_t staleCount_ = 0;     //T1/T2 中旧代条目的个数
+    mutable std::mutex mu_;
+    RemovalQueue<Key, Value> removals_;  //锁内攒的删除通知
+    size_t keyHeapBytes_ = 0;
+    size_t valueHeapBytes_ = 0;
+    size_t ghostKeyHeapBytes_ = 0;
 
     NodePtr t1Head_, t1Tail_;
     NodePtr t2Head_, t2Tail_;
-    std::unordered_map<Key, NodePtr> t1Map_;
-    std::unordered_map<Key, NodePtr> t2Map_;
+    NodeMap t1Map_;
+    NodeMap t2Map_;
     //t1Map: 最近访问过的真实缓存，LRU队列
     //t2Map: 被二次访问，短期热点，LRU队列
 
@@ -6,6 +6,8 @@
 #include <memory>
 #include <mutex>
 #include <algorithm>
+#include <functional>
+#include <optional>
 #include "CachePolicy.h"
 #include "LruCache.h"
 #include "LfuCache.h"
@@ -15,6 +17,8 @@
 	LRU 照顾“新近使用”，LFU 照顾“常用但不一定近期”的。
 	重点：区分短期 vs 长期热点，LFU 部分能保留长期热门元素
     组合实现
+    删除通知：T1/T2 各装一个内部监听器，把它们的通知转进本缓存的缓冲区（它们只在本缓存的锁内被调用，
+    所以转发也在本缓存的锁内）；T1 晋升到 T2 这类内部搬移不算离开缓存，转发时丢掉或改记为 Replaced。
 */
 
 namespace CacheSystem {
@@ -29,20 +33,155 @@ public:
     //实际的capacity通过p来限制，并不是2*capacity
 
     void put(Key key, Value value) override {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if(capacity_ <= 0) return;
+        Lock lock(mutex_, removals_);
+        putNoLock(key, std::move(value));
+    }
+
+    bool get(Key key, Value& value) override {
+        Lock lock(mutex_, removals_);
+        return getNoLock(key, value);
+    }
 
+    Value get(Key key) override {
         Value v{};
-        if (t1_->get(key,v)) {
-            t1_->remove(key);
-            t2_->put(key,std::move(value));
-            return;
+        (void)get(key, v);
+        return v;
+    }
+
+    // 命中 T1/T2 时当场改写（T1 的条目随之晋升到 T2）；都不在时 fn 看到 nullptr，写入走 put 的完整流程
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Lock lock(mutex_, removals_);
+        Value v{};
+        if (takeFromT1(key, v)) {
+            std::optional<Value> result = fn(&v);
+            if (result) t2_->put(key, *result);
+            removals_.push(key, std::move(v), result ? RemovalCause::Replaced : RemovalCause::Explicit);
+            return result;
+        }
+        bool inT2 = false;
+        std::optional<Value> result = t2_->compute(key, [&](const Value* cur) -> std::optional<Value> {
+            if (!cur) return std::nullopt;
+            inT2 = true;
+            return fn(cur);
+        });
+        if (inT2) return result;
+        result = fn(nullptr);
+        if (result) putNoLock(key, *result);
+        return result;
+    }
+
+    // 以下两个与 “get 未命中再 put” 等价（ghost 命中照样调整 p），只是在同一次加锁内完成
+    bool putIfAbsent(Key key, Value value) override {
+        Lock lock(mutex_, removals_);
+        Value v{};
+        if (capacity_ <= 0 || getNoLock(key, v)) return false;
+        putNoLock(key, std::move(value));
+        return true;
+    }
+
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        Lock lock(mutex_, removals_);
+        if (getNoLock(key, value)) return true;
+        value = factory();
+        putNoLock(key, value);
+        return false;
+    }
+
+    // T1/T2 各自的上限同步收紧；两者合计超出的部分按 ARC 规则降级到 ghost
+    void setCapacity(size_t capacity) override {
+        Lock lock(mutex_, removals_);
+        capacity_ = static_cast<int>(capacity);
+        p_ = std::min(p_, capacity_);
+        t1_->setCapacity(capacity);
+        t2_->setCapacity(capacity);
+        while ((int)(t1_->size() + t2_->size()) > capacity_) {
+            if (!t1_->empty() && ((int)t1_->size() > p_ || t2_->empty())) evictT1toB1();
+            else evictT2toB2();
+        }
+        while ((int)(t1_->size() + b1Map_.size()) > capacity_ && !b1List_.empty()) evictGhostTail(b1List_, b1Map_);
+        while ((int)(t1_->size() + t2_->size() + b1Map_.size() + b2Map_.size()) > 2 * capacity_ && !b2List_.empty())
+            evictGhostTail(b2List_, b2Map_);
+    }
+
+    // 只删 T1/T2 里的真实条目；ghost 是访问历史，保留
+    bool remove(Key key) override {
+        Lock lock(mutex_, removals_);
+        const bool inT1 = t1_->remove(key);
+        const bool inT2 = t2_->remove(key);
+        return inT1 || inT2;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        Lock lock(mutex_, removals_);
+        return t1_->invalidateIf(pred) + t2_->invalidateIf(pred);
+    }
+
+    // T1/T2 各自 O(1) 换代
+    void invalidateAll() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        t1_->invalidateAll();
+        t2_->invalidateAll();
+    }
+
+    MemoryUsage memoryUsage() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MemoryUsage m = t1_->memoryUsage();
+        m += t2_->memoryUsage();
+        m.metadata += (b1List_.size() + b2List_.size()) * listNodeBytes<Key>()
+                    + hashIndexBytes(b1Map_) + hashIndexBytes(b2Map_) + 2 * ghostKeyHeapBytes_;
+        return m;
+    }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        RemovalListener<Key, Value> sink;
+        if (listener) sink = [this](std::vector<RemovalNotification<Key, Value>>& batch) { forwardSubRemovals(batch); };
+        removals_.setListener(std::move(listener), batchSize);
+        t1_->setRemovalListener(sink, 1);
+        t2_->setRemovalListener(sink, 1);
+    }
+
+    void flushRemovals() override {
+        Lock lock(mutex_, removals_, true);
+    }
+
+private:
+    using Lock = NotifyingLock<std::mutex, Key, Value>; //会删除条目的路径都用它：解锁后投递删除通知
+
+    // 内部搬移时 T1 报出的 Explicit 怎么转发：丢掉，或改记为 “被新值覆盖”；顺带回收的旧代条目照常转发
+    enum class SubRemoval : uint8_t { Forward, Drop, AsReplaced };
+
+    // T1/T2 在自己的锁外、本缓存的锁内调用
+    void forwardSubRemovals(std::vector<RemovalNotification<Key, Value>>& batch) {
+        for (auto& n : batch) {
+            RemovalCause cause = n.cause;
+            if (cause == RemovalCause::Explicit && subRemoval_ != SubRemoval::Forward) {
+                if (subRemoval_ == SubRemoval::Drop) continue;
+                cause = RemovalCause::Replaced;
+            }
+            removals_.push(n.key, std::move(n.value), cause);
         }
-        // 命中 T2 -> 更新
-        if (t2_->get(key,v)) {
+    }
+
+    void putNoLock(const Key& key, Value value) {
+        if(capacity_ <= 0) return;
+
+        // 命中 T1 -> 移到 T2（T1 里的旧值算被覆盖）
+        subRemoval_ = SubRemoval::AsReplaced;
+        const bool inT1 = t1_->remove(key);
+        subRemoval_ = SubRemoval::Forward;
+        if (inT1) {
             t2_->put(key,std::move(value));
             return;
         }
+        // 命中 T2 -> 更新：compute 一次查找完成，不存在时不插入
+        bool inT2 = false;
+        t2_->compute(key, [&](const Value* cur) -> std::optional<Value> {
+            if (!cur) return std::nullopt;
+            inT2 = true;
+            return std::move(value);
+        });
+        if (inT2) return;
         // hit B1
         auto itB1 = b1Map_.find(key);
         if(itB1 != b1Map_.end()){
@@ -50,6 +189,7 @@ public:
                                            (int)std::max<size_t>(1, b1List_.size())),
                           capacity_);
             replace(key);
+            ghostKeyHeapBytes_ -= heapBytesOf(itB1->first);
             b1List_.erase(itB1->second);
             b1Map_.erase(itB1);
             t2_->put(key, std::move(value));
@@ -61,6 +201,7 @@ public:
                                            (int)std::max<size_t>(1, b2List_.size())),
                           0);
             replace(key);
+            ghostKeyHeapBytes_ -= heapBytesOf(itB2->first);
             b2List_.erase(itB2->second);
             b2Map_.erase(itB2);
             t2_->put(key, std::move(value));
@@ -81,16 +222,17 @@ public:
             if (total >= 2 * capacity_) {
                 evictGhostTail(b2List_, b2Map_);
             }
+            if ((int)(t1_->size() + t2_->size()) >= capacity_) {
+                replace(key); //真实缓存已满：必须腾出一个位置
+            }
         }
         t1_->put(key, std::move(value));
     }
 
-    bool get(Key key, Value& value) override {
-        std::lock_guard<std::mutex> lock(mutex_);
-        //hit t1
-        if (t1->get(key, value)) {
-            t1_->remove(key);
-            t2->put(key, value);
+    bool getNoLock(const Key& key, Value& value) {
+        //hit t1：取出并从 T1 删除只查一次
+        if (takeFromT1(key, value)) {
+            t2_->put(key, value);
             return true;
         }
         //hit t2
@@ -104,6 +246,7 @@ public:
                                           (int)std::max<size_t>(1, b1List_.size())),
                           capacity_);
             replace(key);
+            ghostKeyHeapBytes_ -= heapBytesOf(itB1->first);
             b1List_.erase(itB1->second);
             b1Map_.erase(itB1);
             return false;
@@ -114,6 +257,7 @@ public:
                                           (int)std::max<size_t>(1, b2List_.size())),
                           0);
             replace(key);
+            ghostKeyHeapBytes_ -= heapBytesOf(itB2->first);
             b2List_.erase(itB2->second);
             b2Map_.erase(itB2);
             return false;
@@ -121,13 +265,19 @@ public:
         return false;
     }
 
-    Value get(Key key) override {
-        Value v{};
-        (void)get(key, v);
-        return v;
+    // T1 命中：取出 value 并从 T1 删除（compute 返回 nullopt 即删除），只查一次
+    // 值被取走搬到 T2 或交给调用方处理，T1 的删除通知丢掉
+    bool takeFromT1(const Key& key, Value& value) {
+        bool hit = false;
+        subRemoval_ = SubRemoval::Drop;
+        t1_->compute(key, [&](const Value* cur) -> std::optional<Value> {
+            if (cur) { value = *cur; hit = true; }
+            return std::nullopt;
+        });
+        subRemoval_ = SubRemoval::Forward;
+        return hit;
     }
 
-private:
     void replace(const Key& x) {
         if (!t1_->empty() &&
             ((b2Map_.count(x) && (int)t1_->size() == p_) ||
@@ -141,6 +291,7 @@ private:
     void evictT1toB1() {
         Key victim = t1_->evictOne();
         if (victim == Key()) return;
+        ghostKeyHeapBytes_ += heapBytesOf(victim);
         b1List_.push_front(victim);
         b1Map_[victim] = b1List_.begin();
     }
@@ -148,6 +299,7 @@ private:
     void evictT2toB2() {
         Key victim = t2_->evictOne();
         if (victim == Key()) return;
+        ghostKeyHeapBytes_ += heapBytesOf(victim);
         b2List_.push_front(victim);
         b2Map_[victim] = b2List_.begin();
     }
@@ -156,6 +308,7 @@ private:
                         std::unordered_map<Key, typename std::list<Key>::iterator>& ghostMap) {
         if (ghostList.empty()) return;
         Key victim = ghostList.back();
+        ghostKeyHeapBytes_ -= heapBytesOf(victim);
         ghostMap.erase(victim);
         ghostList.pop_back();
     }
@@ -164,8 +317,11 @@ private:
 private:
     int capacity_;
     int p_;
-    std::mutex mutex_;
-    
+    mutable std::mutex mutex_;
+    size_t ghostKeyHeapBytes_ = 0;
+    RemovalQueue<Key, Value> removals_;   //锁内攒的删除通知（含 T1/T2 转发来的）
+    SubRemoval subRemoval_ = SubRemoval::Forward;
+
     std::unique_ptr<LruCache<Key,Value>> t1_;
     std::unique_ptr<LfuCache<Key,Value>> t2_;
 
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*  BackingStore.h
+    缓存背后的持久层（数据库、远端 KV……）接口，WriteBackCache 把脏数据（含删除）分批写到这里。
+    MemoryBackingStore 是进程内的实现：一把锁保护的 unordered_map，统计调用次数，
+    可以给每批写入/删除加固定延迟、或让接下来的若干批失败，用来测试和压测写回逻辑。
+*/
+
+namespace CacheSystem {
+
+template<typename Key, typename Value>
+class BackingStore {
+public:
+    virtual ~BackingStore() = default;
+
+    // 一批写入，批内 key 不重复；返回 true 表示整批已持久化，false 表示整批都没写（调用方稍后重试）
+    virtual bool writeBatch(const std::vector<std::pair<Key, Value>>& batch) = 0;
+
+    // 一批删除，批内 key 不重复，不存在的 key 忽略；返回值同 writeBatch
+    virtual bool eraseBatch(const std::vector<Key>& keys) = 0;
+
+    // 读一条；没有返回 false
+    virtual bool load(const Key& key, Value& value) = 0;
+};
+
+struct BackingStoreStats {
+    uint64_t batches       = 0;   //成功的 writeBatch / eraseBatch 次数
+    uint64_t writes        = 0;   //成功写入的条目数
+    uint64_t erases        = 0;   //eraseBatch 里的条目数（含本来就不存在的）
+    uint64_t failedBatches = 0;
+    uint64_t loads         = 0;
+};
+
+template<typename Key, typename Value>
+class MemoryBackingStore : public BackingStore<Key, Value> {
+public:
+    // batchLatency：每次 writeBatch / eraseBatch 额外睡这么久，模拟一次网络往返
+    explicit MemoryBackingStore(std::chrono::microseconds batchLatency = std::chrono::microseconds(0))
+        : batchLatency_(batchLatency) {}
+
+    bool writeBatch(const std::vector<std::pair<Key, Value>>& batch) override {
+        if (batchLatency_.count() > 0) std::this_thread::sleep_for(batchLatency_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failNext_ > 0) {
+            --failNext_;
+            ++stats_.failedBatches;
+            return false;
+        }
+        for (const auto& kv : batch) data_[kv.first] = kv.second;
+        ++stats_.batches;
+        stats_.writes += batch.size();
+        return true;
+    }
+
+    bool eraseBatch(const std::vector<Key>& keys) override {
+        if (batchLatency_.count() > 0) std::this_thread::sleep_for(batchLatency_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failNext_ > 0) {
+            --failNext_;
+            ++stats_.failedBatches;
+            return false;
+        }
+        for (const auto& key : keys) data_.erase(key);
+        ++stats_.batches;
+        stats_.erases += keys.size();
+        return true;
+    }
+
+    bool load(const Key& key, Value& value) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.loads;
+        auto it = data_.find(key);
+        if (it == data_.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    // 接下来的 n 次 writeBatch / eraseBatch 返回失败
+    void failNext(int n) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failNext_ = n;
+    }
+
+    BackingStoreStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return data_.size();
+    }
+
+private:
+    std::chrono::microseconds      batchLatency_;
+    mutable std::mutex             mutex_;
+    std::unordered_map<Key, Value> data_;
+    BackingStoreStats              stats_;
+    int                            failNext_ = 0;
+};
+
+} // namespace CacheSystem
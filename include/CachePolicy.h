@@ -2,6 +2,11 @@
 //避免头文件多次include
 //等价于 #ifndef ... #define ... #endif
 
+#include <functional>
+#include <optional>
+#include "MemoryUsage.h"
+#include "RemovalListener.h"
+
 namespace CacheSystem {
 
 template<typename Key, typename Value>
@@ -12,6 +17,25 @@ public:
     virtual void put(Key key, Value value) = 0; 
     virtual bool get(Key key, Value& value) = 0;
     virtual Value get(Key key) = 0;
+    virtual MemoryUsage memoryUsage() const = 0; //内存明细：索引/节点/value/ghost等元数据
+    virtual void setCapacity(size_t capacity) = 0; //在线调整容量，缩容时逐步驱逐到新上限
+    virtual bool remove(Key key) = 0; //删除一个 key，返回它之前是否在缓存中
+    //删除所有满足 pred 的条目，返回删除个数；分片缓存逐个分片加锁执行
+    virtual size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) = 0;
+    //O(1) 全部失效：代数 +1，旧代条目在被访问时当作未命中并删除，其余的由淘汰逐步回收
+    virtual void invalidateAll() = 0;
+    //以下三个都只加一次锁、只查一次表，取代 “get 未命中再 put” 的两次加锁（中间还会和其他线程竞争）。
+    //回调在锁内执行，不能再访问同一个缓存
+    //读-改-写：fn 拿到当前值（不存在时为 nullptr），返回新值；返回 std::nullopt 表示删除（不存在则不插入）。
+    //返回写入后的值，删除或未插入时为 std::nullopt
+    virtual std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) = 0;
+    virtual bool putIfAbsent(Key key, Value value) = 0; //已存在则不覆盖，返回是否插入
+    //命中时取出 value 返回 true（与 get 相同，算一次访问）；未命中时用 factory() 生成、插入并取出，返回 false
+    virtual bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) = 0;
+    //条目被驱逐/删除/覆盖/回收时通知 listener（带原因）：锁内只入缓冲，攒够 batchSize 条后在锁外整批投递，
+    //见 RemovalListener.h；传空 listener 取消监听
+    virtual void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) = 0;
+    virtual void flushRemovals() = 0; //立即投递缓冲里不足一批的通知，供维护线程定期调用
     //纯虚函数(=0) vs 虚函数(virtual)
     //常见bug：基类析构函数一定要设为 virtual
 };
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+/*  ContentionMutex.h
+    带争用统计的互斥锁，接口与 std::mutex 相同，可直接配合 lock_guard 使用。
+    lock() 先 try_lock：成功就只多一次 relaxed 计数；失败才算一次“争用”，并用 steady_clock 计时等待了多久。
+    所以无争用时几乎零开销，统计到的 contended / waitNs 可以直接用来判断分片是否太少。
+    ContentionSharedMutex 是读写锁版本：共享锁与独占锁的等待合并统计。
+*/
+
+namespace CacheSystem {
+
+struct ContentionStats {
+    uint64_t acquisitions = 0;  // 加锁总次数
+    uint64_t contended    = 0;  // 其中 try_lock 失败、需要等待的次数
+    uint64_t waitNs       = 0;  // 等待总时长
+
+    double contentionRate() const { return acquisitions ? double(contended) / double(acquisitions) : 0.0; }
+    double avgWaitNs() const { return contended ? double(waitNs) / double(contended) : 0.0; }
+    // 摊到每次加锁上的等待：持锁线程被调度走时争用次数不多但每次要等很久，只看争用率会漏掉
+    double waitNsPerAcquisition() const { return acquisitions ? double(waitNs) / double(acquisitions) : 0.0; }
+
+    ContentionStats& operator+=(const ContentionStats& o) {
+        acquisitions += o.acquisitions; contended += o.contended; waitNs += o.waitNs;
+        return *this;
+    }
+};
+
+class ContentionMutex {
+public:
+    void lock() {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        if (mutex_.try_lock()) return;
+        const auto begin = std::chrono::steady_clock::now();
+        mutex_.lock();
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - begin).count();
+        contended_.fetch_add(1, std::memory_order_relaxed);
+        waitNs_.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+    }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+
+    ContentionStats stats() const {
+        ContentionStats s;
+        s.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+        s.contended    = contended_.load(std::memory_order_relaxed);
+        s.waitNs       = waitNs_.load(std::memory_order_relaxed);
+        return s;
+    }
+    void resetStats() {
+        acquisitions_.store(0, std::memory_order_relaxed);
+        contended_.store(0, std::memory_order_relaxed);
+        waitNs_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex            mutex_;
+    std::atomic<uint64_t> acquisitions_{0};
+    std::atomic<uint64_t> contended_{0};
+    std::atomic<uint64_t> waitNs_{0};
+};
+
+class ContentionSharedMutex {
+public:
+    void lock() {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        if (mutex_.try_lock()) return;
+        const auto begin = std::chrono::steady_clock::now();
+        mutex_.lock();
+        recordWait(begin);
+    }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+
+    void lock_shared() {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        if (mutex_.try_lock_shared()) return;
+        const auto begin = std::chrono::steady_clock::now();
+        mutex_.lock_shared();
+        recordWait(begin);
+    }
+    bool try_lock_shared() { return mutex_.try_lock_shared(); }
+    void unlock_shared() { mutex_.unlock_shared(); }
+
+    ContentionStats stats() const {
+        ContentionStats s;
+        s.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+        s.contended    = contended_.load(std::memory_order_relaxed);
+        s.waitNs       = waitNs_.load(std::memory_order_relaxed);
+        return s;
+    }
+    void resetStats() {
+        acquisitions_.store(0, std::memory_order_relaxed);
+        contended_.store(0, std::memory_order_relaxed);
+        waitNs_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    void recordWait(std::chrono::steady_clock::time_point begin) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - begin).count();
+        contended_.fetch_add(1, std::memory_order_relaxed);
+        waitNs_.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+    }
+
+    std::shared_mutex     mutex_;
+    std::atomic<uint64_t> acquisitions_{0};
+    std::atomic<uint64_t> contended_{0};
+    std::atomic<uint64_t> waitNs_{0};
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+
+/*  GdsfCache.h
+    GDSF（GreedyDual-Size-Frequency）：按“重新算一次要花多少”淘汰，而不是只看最近 / 频次。
+    - 每个条目带 miss 代价 cost（比如回源耗时，单位自定，只要一致）和大小 size（与容量同一单位）；
+    - 优先级 H = L + freq × cost / size，淘汰 H 最小的：又便宜、又大、又很少用的先走；
+    - L 是“通胀值”：每淘汰一个条目，L 升到它的 H。新条目和刚被命中的条目都在当前 L 之上起算，
+      很久没被访问的老条目 H 不变，相对地越来越低，这样就不会有条目靠过去的高频次永远赖着不走；
+    - 条目放在按 H 排的小根堆里（节点里记堆下标），命中 / 写入 / 淘汰都是 O(log n)。
+
+    接口里的 put / compute / putIfAbsent / getOrInsert 按构造时的 defaultCost、size 1 计；
+    需要按条目给代价时用带 cost、size 的重载。size 超过总容量的条目不缓存。
+    invalidateAll 只把代数 +1：旧代条目读不到，H 不再变化，随着 L 上涨会排到堆顶被淘汰；写入同一个 key 时就地替换。
+*/
+
+namespace CacheSystem {
+
+template<typename Key, typename Value>
+class GdsfCache : public CachePolicy<Key, Value> {
+public:
+    // capacity：总容量（所有条目 size 之和的上限）；defaultCost：不带代价的接口使用的 miss 代价
+    explicit GdsfCache(int capacity, double defaultCost = 1.0)
+        : capacity_(capacity > 0 ? static_cast<size_t>(capacity) : 0)
+        , defaultCost_(defaultCost) {
+        map_.reserve(capacity_);
+    }
+
+    ~GdsfCache() override = default;
+
+    void put(Key key, Value value) override {
+        put(std::move(key), std::move(value), defaultCost_, 1);
+    }
+
+    // 已存在的 key 更新 value、代价和大小，并算一次访问
+    void put(Key key, Value value, double cost, size_t size) {
+        Lock lk(mu_, removals_);
+        auto it = map_.find(key);
+        if (it != map_.end()) {
+            const uint32_t i = it->second;
+            if (live(i)) {
+                updateNoLock(i, std::move(value), cost, size);
+                return;
+            }
+            eraseNoLock(i, RemovalCause::Expired);
+        }
+        insertNoLock(std::move(key), std::move(value), cost, size);
+    }
+
+    bool get(Key key, Value& value) override {
+        Lock lk(mu_, removals_);
+        const uint32_t i = findLive(key);
+        if (i == kNil) return false;
+        value = nodes_[i].value;
+        touch(i);
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Lock lk(mu_, removals_);
+        const uint32_t i = findLive(key);
+        std::optional<Value> result = fn(i != kNil ? &nodes_[i].value : nullptr);
+        if (i != kNil) {
+            if (!result) {
+                eraseNoLock(i, RemovalCause::Explicit);
+                return result;
+            }
+            replaceValue(i, Value(*result));
+            touch(i);
+        } else if (result) {
+            insertNoLock(std::move(key), Value(*result), defaultCost_, 1);
+        }
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        return putIfAbsent(std::move(key), std::move(value), defaultCost_, 1);
+    }
+
+    bool putIfAbsent(Key key, Value value, double cost, size_t size) {
+        Lock lk(mu_, removals_);
+        if (findLive(key) != kNil) return false;
+        return insertNoLock(std::move(key), std::move(value), cost, size);
+    }
+
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        return getOrInsert(std::move(key), value, factory, defaultCost_, 1);
+    }
+
+    // 未命中时 factory 的代价就是 cost（调用方通常知道这次回源大概多贵）
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory, double cost, size_t size) {
+        Lock lk(mu_, removals_);
+        const uint32_t i = findLive(key);
+        if (i != kNil) {
+            value = nodes_[i].value;
+            touch(i);
+            return true;
+        }
+        value = factory();
+        insertNoLock(std::move(key), Value(value), cost, size);
+        return false;
+    }
+
+    bool remove(Key key) override {
+        Lock lk(mu_, removals_);
+        auto it = map_.find(key);
+        if (it == map_.end()) return false;
+        const uint32_t i = it->second;
+        const bool wasLive = live(i);
+        eraseNoLock(i, wasLive ? RemovalCause::Explicit : RemovalCause::Expired);
+        return wasLive;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        Lock lk(mu_, removals_);
+        std::vector<uint32_t> victims;
+        size_t n = 0;
+        for (const auto& kv : map_) {
+            const Node& node = nodes_[kv.second];
+            if (!live(kv.second)) {
+                victims.push_back(kv.second);
+            } else if (pred(node.key, node.value)) {
+                victims.push_back(kv.second);
+                ++n;
+            }
+        }
+        for (uint32_t i : victims) eraseNoLock(i, live(i) ? RemovalCause::Explicit : RemovalCause::Expired);
+        return n;
+    }
+
+    void invalidateAll() override {
+        std::lock_guard<std::mutex> lk(mu_);
+        ++generation_;
+    }
+
+    MemoryUsage memoryUsage() const override {
+        std::lock_guard<std::mutex> lk(mu_);
+        MemoryUsage m;
+        m.entries  = map_.size();
+        m.index    = hashIndexBytes(map_) + keyHeapBytes_;
+        m.nodes    = nodes_.capacity() * (sizeof(Node) - sizeof(Value))
+                   + free_.capacity() * sizeof(uint32_t) + keyHeapBytes_;
+        m.values   = nodes_.capacity() * sizeof(Value) + valueHeapBytes_;
+        m.metadata = heap_.capacity() * sizeof(uint32_t);
+        return m;
+    }
+
+    // 缩容时分批淘汰，批与批之间释放锁
+    void setCapacity(size_t capacity) override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            capacity_ = capacity;
+        }
+        for (bool done = false; !done;) {
+            Lock lk(mu_, removals_);  //每批淘汰的通知在本批解锁后投递
+            size_t n = 0;
+            for (; n < kEvictBatch && used_ > capacity_; ++n) evictNoLock();
+            done = n < kEvictBatch;
+        }
+    }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        std::lock_guard<std::mutex> lk(mu_);
+        removals_.setListener(std::move(listener), batchSize);
+    }
+
+    void flushRemovals() override {
+        Lock lk(mu_, removals_, true);
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return map_.size();
+    }
+    bool empty() const { return size() == 0; }
+    // 已占用的容量（条目 size 之和）
+    size_t used() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return used_;
+    }
+    size_t capacity() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return capacity_;
+    }
+    // 当前通胀值 L：最近一次淘汰的优先级
+    double inflation() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return inflation_;
+    }
+
+private:
+    using Lock = NotifyingLock<std::mutex, Key, Value>; //会删除条目的路径都用它：解锁后投递删除通知
+
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr size_t kEvictBatch = 64;   //setCapacity 每次持锁最多淘汰的条目数
+
+    struct Node {
+        Key      key{};
+        Value    value{};
+        double   cost = 0;
+        double   priority = 0;   //H = L + freq × cost / size
+        size_t   size = 0;
+        uint32_t freq = 0;
+        uint32_t heapPos = kNil;
+        uint32_t gen = 0;        //写入时的代数
+    };
+
+    bool live(uint32_t i) const { return nodes_[i].gen == generation_; }
+
+    // 找到旧代条目顺手删掉，当作未命中
+    uint32_t findLive(const Key& key) {
+        auto it = map_.find(key);
+        if (it == map_.end()) return kNil;
+        const uint32_t i = it->second;
+        if (live(i)) return i;
+        eraseNoLock(i, RemovalCause::Expired);
+        return kNil;
+    }
+
+    // 一次访问：频次 +1，按当前 L 重算优先级（只会变大，往下沉）
+    void touch(uint32_t i) {
+        Node& n = nodes_[i];
+        if (n.freq < UINT32_MAX) ++n.freq;
+        n.priority = priorityOf(n);
+        siftDown(n.heapPos);
+    }
+
+    double priorityOf(const Node& n) const {
+        return inflation_ + double(n.freq) * n.cost / double(std::max<size_t>(1, n.size));
+    }
+
+    bool insertNoLock(Key&& key, Value&& value, double cost, size_t size) {
+        if (size > capacity_ || capacity_ == 0) return false;
+        while (used_ + size > capacity_) evictNoLock();
+        const uint32_t i = allocNode(std::move(key), std::move(value));
+        Node& n = nodes_[i];
+        n.cost = cost;
+        n.size = size;
+        n.freq = 1;
+        n.priority = priorityOf(n);
+        used_ += size;
+        n.heapPos = static_cast<uint32_t>(heap_.size());
+        heap_.push_back(i);
+        siftUp(n.heapPos);
+        return true;
+    }
+
+    // 覆盖已有条目：大小变大时可能先要淘汰别人；放不下了就整条删掉
+    void updateNoLock(uint32_t i, Value&& value, double cost, size_t size) {
+        if (size > capacity_) {
+            eraseNoLock(i, RemovalCause::Capacity);
+            return;
+        }
+        replaceValue(i, std::move(value));
+        Node& n = nodes_[i];
+        used_ = used_ - n.size + size;
+        n.cost = cost;
+        n.size = size;
+        if (n.freq < UINT32_MAX) ++n.freq;
+        n.priority = priorityOf(n);
+        siftDown(n.heapPos);
+        siftUp(n.heapPos);
+        while (used_ > capacity_) evictNoLock();   //按优先级淘汰，也可能淘汰掉它自己
+    }
+
+    // 淘汰堆顶，L 涨到它的优先级
+    void evictNoLock() {
+        if (heap_.empty()) return;
+        const uint32_t i = heap_[0];
+        const bool wasLive = live(i);
+        if (wasLive) inflation_ = std::max(inflation_, nodes_[i].priority);
+        eraseNoLock(i, wasLive ? RemovalCause::Capacity : RemovalCause::Expired);
+    }
+
+    void eraseNoLock(uint32_t i, RemovalCause cause) {
+        Node& n = nodes_[i];
+        const uint32_t pos = n.heapPos;
+        const uint32_t last = heap_.back();
+        heap_.pop_back();
+        if (last != i) {
+            heap_[pos] = last;
+            nodes_[last].heapPos = pos;
+            siftDown(pos);
+            siftUp(nodes_[last].heapPos);
+        }
+        used_ -= n.size;
+        map_.erase(n.key);
+        keyHeapBytes_ -= heapBytesOf(n.key);
+        valueHeapBytes_ -= heapBytesOf(n.value);
+        removals_.push(n.key, std::move(n.value), cause);
+        n.key = Key{};
+        n.value = Value{};
+        n.heapPos = kNil;
+        free_.push_back(i);
+    }
+
+    // ---- 堆：heap_ 存节点下标，节点里记自己在堆中的位置 ----
+    void swapAt(uint32_t a, uint32_t b) {
+        std::swap(heap_[a], heap_[b]);
+        nodes_[heap_[a]].heapPos = a;
+        nodes_[heap_[b]].heapPos = b;
+    }
+    void siftUp(uint32_t pos) {
+        while (pos > 0) {
+            const uint32_t parent = (pos - 1) / 2;
+            if (nodes_[heap_[parent]].priority <= nodes_[heap_[pos]].priority) break;
+            swapAt(parent, pos);
+            pos = parent;
+        }
+    }
+    void siftDown(uint32_t pos) {
+        const uint32_t n = static_cast<uint32_t>(heap_.size());
+        for (;;) {
+            const uint32_t l = 2 * pos + 1, r = l + 1;
+            uint32_t m = pos;
+            if (l < n && nodes_[heap_[l]].priority < nodes_[heap_[m]].priority) m = l;
+            if (r < n && nodes_[heap_[r]].priority < nodes_[heap_[m]].priority) m = r;
+            if (m == pos) break;
+            swapAt(pos, m);
+            pos = m;
+        }
+    }
+
+    // ---- 节点池 ----
+    uint32_t allocNode(Key&& key, Value&& value) {
+        uint32_t i;
+        if (!free_.empty()) {
+            i = free_.back();
+            free_.pop_back();
+        } else {
+            i = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& n = nodes_[i];
+        n.key = std::move(key);
+        n.value = std::move(value);
+        n.gen = generation_;
+        keyHeapBytes_ += heapBytesOf(n.key);
+        valueHeapBytes_ += heapBytesOf(n.value);
+        map_.emplace(n.key, i);
+        return i;
+    }
+
+    void replaceValue(uint32_t i, Value&& value) {
+        Value& v = nodes_[i].value;
+        valueHeapBytes_ -= heapBytesOf(v);
+        removals_.push(nodes_[i].key, std::move(v), RemovalCause::Replaced);
+        v = std::move(value);
+        valueHeapBytes_ += heapBytesOf(v);
+    }
+
+private:
+    size_t capacity_;
+    size_t used_ = 0;
+    double defaultCost_;
+    double inflation_ = 0;   //L
+
+    std::vector<Node>                    nodes_;   //节点池，下标即节点“指针”
+    std::vector<uint32_t>                free_;    //空闲槽位
+    std::vector<uint32_t>                heap_;    //按优先级的小根堆
+    std::unordered_map<Key, uint32_t>    map_;     //key → 节点下标
+    uint32_t                             generation_ = 0;
+    size_t                               keyHeapBytes_ = 0;
+    size_t                               valueHeapBytes_ = 0;
+    RemovalQueue<Key, Value>             removals_;   //锁内攒的删除通知
+    mutable std::mutex                   mu_;
+};
+
+} // namespace CacheSystem
@@ -2,54 +2,32 @@
 
 #include "CachePolicy.h"
 #include "LfuCache.h"
-#include <vector>
-#include <memory>
-#include <thread>
-#include <cmath>
-#include <functional>
+#include "ShardedCache.h"
 
 namespace CacheSystem {
 
+// 按 key 哈希分片的 LFU：ShardedCache<LfuCache> 套上 CachePolicy 接口，构造参数同 HashLruCache
 template<typename Key, typename Value>
-class HashLfuCache : public CachePolicy<Key, Value> {
+class HashLfuCache : public CachePolicyAdapter<ShardedCache<LfuCache<Key, Value>, Key, Value>> {
+    using Base = CachePolicyAdapter<ShardedCache<LfuCache<Key, Value>, Key, Value>>;
 public:
-    HashLfuCache(size_t totalCapacity, int sliceNum = std::thread::hardware_concurrency())
-        : sliceNum_(sliceNum > 0 ? sliceNum : 1)
-        , capacity_(totalCapacity) {
-        size_t sliceCap = std::ceil(totalCapacity / static_cast<double>(sliceNum_));
-        for (int i = 0; i < sliceNum_; i++) {
-            shards_.emplace_back(std::make_unique<LfuCache<Key, Value>>(sliceCap));
-        }
-    }
-
-    void put(Key key, Value value) override {
-        getShard(key)->put(key, value);
-    }
+    using Base::Base;
 
-    bool get(Key key, Value& value) override {
-        return getShard(key)->get(key, value);
+    void purge() {
+        this->forEachShard([](LfuCache<Key, Value>& shard) { shard.purge(); });
     }
+};
 
-    Value get(Key key) override {
-        return getShard(key)->get(key);
-    }
+// 读缓冲模式的分片 LFU：分片是 BufferedLfuCache，命中只拿分片的共享锁，频次增量攒批应用
+template<typename Key, typename Value>
+class HashBufferedLfuCache : public CachePolicyAdapter<ShardedCache<BufferedLfuCache<Key, Value>, Key, Value>> {
+    using Base = CachePolicyAdapter<ShardedCache<BufferedLfuCache<Key, Value>, Key, Value>>;
+public:
+    using Base::Base;
 
     void purge() {
-        for (auto& shard : shards_) {
-            shard->purge();
-        }
+        this->forEachShard([](BufferedLfuCache<Key, Value>& shard) { shard.purge(); });
     }
-
-private:
-    CachePolicy<Key, Value>* getShard(const Key& key) {
-        size_t idx = std::hash<Key>{}(key) % sliceNum_;
-        return shards_[idx].get();
-    }
-
-private:
-    int sliceNum_;
-    size_t capacity_;
-    std::vector<std::unique_ptr<LfuCache<Key, Value>>> shards_;
 };
 
-} // namespace CacheSystem
\ No newline at end of file
+} // namespace CacheSystem
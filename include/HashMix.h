@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+/*  HashMix.h
+    各缓存共用的 hash 打散函数。std::hash<int> 之类是恒等映射，直接取低位选槽 / 分片 / 条带会严重扎堆，
+    取高位更是全 0，所以凡是按 hash 的某几位做选择的地方都先过一遍 fmix64。
+*/
+
+namespace CacheSystem {
+
+// murmur3 的 64 位 finalizer：每个输入位都会影响所有输出位，是双射（不同输入不会撞到一起）
+inline uint64_t fmix64(uint64_t h) {
+    h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+} // namespace CacheSystem
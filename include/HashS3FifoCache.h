@@ -0,0 +1,17 @@
+#pragma once
+
+#include "CachePolicy.h"
+#include "S3FifoCache.h"
+#include "ShardedCache.h"
+
+namespace CacheSystem {
+
+// 按 key 哈希分片的 S3-FIFO：ShardedCache<S3FifoCache> 套上 CachePolicy 接口，构造参数同 HashLruCache
+template<typename Key, typename Value>
+class HashS3FifoCache : public CachePolicyAdapter<ShardedCache<S3FifoCache<Key, Value>, Key, Value>> {
+    using Base = CachePolicyAdapter<ShardedCache<S3FifoCache<Key, Value>, Key, Value>>;
+public:
+    using Base::Base;
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/*  HotKeyTracker.h
+    热点 key 检测：每个分片一个 Space-Saving 摘要（k 个计数器，内存固定），抽样更新，汇总时按分片合并。
+    - Space-Saving：跟踪中的 key 命中就 +1；没跟踪的 key 顶替计数最小的那个，计数 = 旧最小值 + 1，
+      误差上界记为旧最小值。真实频次 > 总数 / k 的 key 一定在表里，估计值只会偏高、最多偏高 error；
+      计数器放在按计数排的小根堆里，带 key → 堆下标的索引，一次更新 O(log k)；
+    - 抽样：按请求抽（每线程一个 xorshift，1/2^sampleShift），不是按 key 抽——按 key 抽的话热点 key 要么全进要么全不进；
+      报告里的估计次数已乘回 2^sampleShift；
+    - 分片之间 key 不重叠，汇总时直接并起来取前 k；不同实例（如多台机器）的摘要用 SpaceSaving::merge 合并；
+    - 报告同时给出各分片的（抽样）请求数和负载倾斜度（最忙分片 / 平均）；
+    - refreshHotSet 把当前前 k 个 key 发布成一个不可变集合，isHot 只读这个快照（原子加载 shared_ptr），
+      NearCache::setL1Admission 可以用它只把热点 key 复制进每线程 L1。
+*/
+
+namespace CacheSystem {
+
+template<typename Key, typename Hasher = std::hash<Key>>
+class SpaceSaving {
+public:
+    struct Counter {
+        Key      key;
+        uint64_t count;   //估计值（不低于真实值）
+        uint64_t error;   //count - error 是真实值的下界
+    };
+
+    explicit SpaceSaving(size_t capacity = 64) : capacity_(std::max<size_t>(1, capacity)) {}
+
+    void offer(const Key& key, uint64_t weight = 1) {
+        total_ += weight;
+        auto it = pos_.find(key);
+        if (it != pos_.end()) {
+            heap_[it->second].count += weight;
+            siftDown(it->second);
+            return;
+        }
+        if (heap_.size() < capacity_) {
+            heap_.push_back(Counter{key, weight, 0});
+            pos_[key] = heap_.size() - 1;
+            siftUp(heap_.size() - 1);
+            return;
+        }
+        Counter& victim = heap_[0];
+        pos_.erase(victim.key);
+        victim.error = victim.count;
+        victim.count += weight;
+        victim.key = key;
+        pos_[key] = 0;
+        siftDown(0);
+    }
+
+    // 通用合并（可交换、可结合）：一方没跟踪的 key 按那一方的最小计数补（表满时它的真实值可能有这么多）
+    void merge(const SpaceSaving& other) {
+        const uint64_t minSelf  = full() ? minCount() : 0;
+        const uint64_t minOther = other.full() ? other.minCount() : 0;
+        std::unordered_map<Key, Counter, Hasher> combined;
+        for (const auto& c : heap_) combined.emplace(c.key, Counter{c.key, c.count + minOther, c.error + minOther});
+        for (const auto& c : other.heap_) {
+            auto it = combined.find(c.key);
+            if (it != combined.end()) {
+                it->second.count += c.count - minOther;
+                it->second.error += c.error - minOther;
+            } else {
+                combined.emplace(c.key, Counter{c.key, c.count + minSelf, c.error + minSelf});
+            }
+        }
+        std::vector<Counter> all;
+        all.reserve(combined.size());
+        for (auto& kv : combined) all.push_back(std::move(kv.second));
+        const uint64_t total = total_ + other.total_;
+        assignTop(std::move(all));
+        total_ = total;
+    }
+
+    // 按估计值从大到小
+    std::vector<Counter> top(size_t n) const {
+        std::vector<Counter> out(heap_.begin(), heap_.end());
+        std::sort(out.begin(), out.end(), [](const Counter& a, const Counter& b) { return a.count > b.count; });
+        if (out.size() > n) out.resize(n);
+        return out;
+    }
+
+    const std::vector<Counter>& counters() const { return heap_; }
+    uint64_t minCount() const { return heap_.empty() ? 0 : heap_[0].count; }
+    uint64_t total() const { return total_; }
+    bool full() const { return heap_.size() >= capacity_; }
+    size_t capacity() const { return capacity_; }
+
+    void clear() {
+        heap_.clear();
+        pos_.clear();
+        total_ = 0;
+    }
+
+private:
+    void assignTop(std::vector<Counter>&& all) {
+        std::sort(all.begin(), all.end(), [](const Counter& a, const Counter& b) { return a.count > b.count; });
+        if (all.size() > capacity_) all.resize(capacity_);
+        clear();
+        for (auto& c : all) {
+            heap_.push_back(std::move(c));
+            pos_[heap_.back().key] = heap_.size() - 1;
+            siftUp(heap_.size() - 1);
+        }
+    }
+
+    void swapAt(size_t a, size_t b) {
+        std::swap(heap_[a], heap_[b]);
+        pos_[heap_[a].key] = a;
+        pos_[heap_[b].key] = b;
+    }
+    void siftUp(size_t i) {
+        while (i > 0) {
+            const size_t parent = (i - 1) / 2;
+            if (heap_[parent].count <= heap_[i].count) break;
+            swapAt(parent, i);
+            i = parent;
+        }
+    }
+    void siftDown(size_t i) {
+        for (;;) {
+            const size_t l = 2 * i + 1, r = l + 1;
+            size_t m = i;
+            if (l < heap_.size() && heap_[l].count < heap_[m].count) m = l;
+            if (r < heap_.size() && heap_[r].count < heap_[m].count) m = r;
+            if (m == i) break;
+            swapAt(i, m);
+            i = m;
+        }
+    }
+
+    size_t                                  capacity_;
+    std::vector<Counter>                    heap_;    //按 count 的小根堆
+    std::unordered_map<Key, size_t, Hasher> pos_;     //key → 堆下标
+    uint64_t                                total_ = 0;
+};
+
+template<typename Key>
+struct HotKey {
+    Key      key;
+    uint64_t count;   //估计请求数（已乘回抽样倍数）
+    uint64_t error;   //count 最多偏高这么多
+    int      shard;
+};
+
+template<typename Key>
+struct HotKeyReport {
+    std::vector<HotKey<Key>> keys;          //按 count 从大到小
+    std::vector<uint64_t>    shardLoad;     //各分片的估计请求数
+    uint64_t                 requests = 0;  //估计总请求数
+    int                      hottestShard = -1;
+
+    // 最忙分片 / 平均；1 表示均匀
+    double skew() const {
+        if (shardLoad.empty() || requests == 0) return 1.0;
+        const uint64_t mx = *std::max_element(shardLoad.begin(), shardLoad.end());
+        return double(mx) * double(shardLoad.size()) / double(requests);
+    }
+    // 前 n 个 key 占全部请求的比例
+    double share(size_t n) const {
+        uint64_t s = 0;
+        for (size_t i = 0; i < std::min(n, keys.size()); ++i) s += keys[i].count;
+        return requests ? double(s) / double(requests) : 0.0;
+    }
+};
+
+template<typename Key, typename Hasher = std::hash<Key>>
+class HotKeyTracker {
+public:
+    // shards：分片数上限；capacity：每个分片跟踪的 key 数；每 2^sampleShift 个请求抽一个
+    HotKeyTracker(int shards, size_t capacity = 64, int sampleShift = 4)
+        : shardNum_(std::max(1, shards))
+        , slots_(new Slot[shardNum_])
+        , sampleMask_((uint64_t(1) << std::clamp(sampleShift, 0, 30)) - 1)
+        , sampleShift_(std::clamp(sampleShift, 0, 30)) {
+        for (int i = 0; i < shardNum_; ++i) slots_[i].summary = SpaceSaving<Key, Hasher>(capacity);
+    }
+
+    // 每个请求调用；没抽中时只推进一次本线程的随机数
+    void record(int shard, const Key& key) {
+        if ((nextRandom() & sampleMask_) != 0) return;
+        Slot& s = slots_[shard % shardNum_];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.summary.offer(key);
+    }
+
+    // 各分片摘要并起来取前 k（分片之间 key 不重叠，不需要补最小值）
+    HotKeyReport<Key> report(size_t k) const {
+        HotKeyReport<Key> r;
+        r.shardLoad.assign(shardNum_, 0);
+        for (int i = 0; i < shardNum_; ++i) {
+            std::lock_guard<std::mutex> lock(slots_[i].mutex);
+            const auto& summary = slots_[i].summary;
+            r.shardLoad[i] = summary.total() << sampleShift_;
+            r.requests += r.shardLoad[i];
+            for (const auto& c : summary.counters()) {
+                r.keys.push_back(HotKey<Key>{c.key, c.count << sampleShift_, c.error << sampleShift_, i});
+            }
+        }
+        std::sort(r.keys.begin(), r.keys.end(), [](const HotKey<Key>& a, const HotKey<Key>& b) { return a.count > b.count; });
+        if (r.keys.size() > k) r.keys.resize(k);
+        if (r.requests) r.hottestShard = int(std::max_element(r.shardLoad.begin(), r.shardLoad.end()) - r.shardLoad.begin());
+        return r;
+    }
+
+    // 全部分片合并成一份摘要（估计值未乘回抽样倍数），用于和其他实例的摘要再合并
+    SpaceSaving<Key, Hasher> summary() const {
+        SpaceSaving<Key, Hasher> all(slots_[0].summary.capacity());
+        for (int i = 0; i < shardNum_; ++i) {
+            std::lock_guard<std::mutex> lock(slots_[i].mutex);
+            all.merge(slots_[i].summary);
+        }
+        return all;
+    }
+
+    // 发布热点集合：估计请求数至少占 minShare 的前 k 个 key
+    void refreshHotSet(size_t k, double minShare = 0.0) {
+        const HotKeyReport<Key> r = report(k);
+        auto set = std::make_shared<std::unordered_set<Key, Hasher>>();
+        for (const auto& hk : r.keys) {
+            if (r.requests && double(hk.count) >= minShare * double(r.requests)) set->insert(hk.key);
+        }
+        std::atomic_store(&hotSet_, std::shared_ptr<const std::unordered_set<Key, Hasher>>(std::move(set)));
+    }
+
+    bool isHot(const Key& key) const {
+        const auto set = std::atomic_load(&hotSet_);
+        return set && set->count(key) != 0;
+    }
+
+    // 开始新的统计窗口（分片数变了之后各分片负载不再可比，也应调用）
+    void reset() {
+        for (int i = 0; i < shardNum_; ++i) {
+            std::lock_guard<std::mutex> lock(slots_[i].mutex);
+            slots_[i].summary.clear();
+        }
+    }
+
+    int sampleShift() const { return sampleShift_; }
+
+private:
+    struct alignas(64) Slot {
+        mutable std::mutex        mutex;
+        SpaceSaving<Key, Hasher>  summary;
+    };
+
+    static uint64_t nextRandom() {
+        static thread_local uint64_t x = 0x9E3779B97F4A7C15ULL ^ reinterpret_cast<uintptr_t>(&x);
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return x;
+    }
+
+    int                                                   shardNum_;
+    std::unique_ptr<Slot[]>                               slots_;
+    uint64_t                                              sampleMask_;
+    int                                                   sampleShift_;
+    std::shared_ptr<const std::unordered_set<Key, Hasher>> hotSet_;
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "HashMix.h"
+#include "RemovalListener.h"
+
+/*  InlineLayout.h
+    小而平凡可拷贝（trivially copyable）的 key/value 走扁平布局，编译期用 if constexpr 选择：
+    - InlineLayout<Key, Value>::value 为 true 时，策略把 key/value 直接存进一个连续的节点数组，
+      链表用 uint32 下标串起来，索引是开放寻址表，value 用 memcpy 搬运，put/get 都不做任何堆分配；
+    - 其他类型（std::string、SlabValue 句柄等）仍走原来的 shared_ptr 节点 + unordered_map。
+    主要场景 int64 → 小 POD：一个条目就是节点数组里的一段 + 索引里 8 字节，没有控制块、没有 malloc 头。
+    如某个类型虽然满足条件但不想走扁平布局（例如 operator== 很贵），可以把 InlineLayout 特化为 false。
+*/
+
+namespace CacheSystem {
+
+// key 最多 16B、value 最多 64B：再大的话一次 memcpy 不如移动指针划算，节点数组也会把 cache line 撑散
+template<typename Key, typename Value>
+struct InlineLayout : std::integral_constant<bool,
+    std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value &&
+    std::is_default_constructible<Key>::value && std::is_default_constructible<Value>::value &&
+    sizeof(Key) <= 16 && sizeof(Value) <= 64> {};
+
+// 非扁平布局时占位用，不占任何逻辑
+struct FlatDisabled {
+    explicit FlatDisabled(size_t) {}
+};
+
+/*  FlatLruList：扁平 LRU 链表 + 开放寻址索引，不加锁，由外层策略持锁调用。
+    - nodes_：连续的节点数组，prev/next 是下标；被淘汰的节点挂到空闲链上复用；
+    - slots_：2 的幂大小的槽数组，每槽 {节点下标, hash 低 32 位}，线性探测，装载率不超过 1/2；
+      删除用 backward-shift，不留墓碑，探测链不会越跑越长；
+    - invalidateAll 只把代数 +1：旧代节点在 find 时顺手删除，没被访问的都排在 LRU 端，会最先被淘汰。
+    挂上 RemovalQueue 之后，淘汰、删除、回收旧代节点时把 key/value 拷进去（由外层策略在锁外投递）。
+*/
+template<typename Key, typename Value>
+class FlatLruList {
+public:
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    struct Node {
+        Key      key;
+        Value    value;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t gen;   //写入时的代数
+    };
+
+    explicit FlatLruList(size_t capacity) {
+        nodes_.reserve(capacity);
+        rehash(slotsFor(capacity));
+    }
+
+    void attachRemovals(RemovalQueue<Key, Value>* removals) { removals_ = removals; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // 命中返回节点下标，否则 kNil；旧代节点当作未命中并顺手删除
+    uint32_t find(const Key& key) {
+        const uint32_t h = hashOf(key);
+        for (size_t pos = h & mask_;; pos = (pos + 1) & mask_) {
+            const Slot s = slots_[pos];
+            if (s.node == kNil) return kNil;
+            if (s.hash == h && nodes_[s.node].key == key) {
+                if (nodes_[s.node].gen == generation_) return s.node;
+                retire(s.node, RemovalCause::Expired);
+                return kNil;
+            }
+        }
+    }
+
+    const Value& valueAt(uint32_t i) const { return nodes_[i].value; }   //insert 之后失效
+    void copyValue(uint32_t i, Value& out) const { std::memcpy(&out, &nodes_[i].value, sizeof(Value)); }
+    void setValue(uint32_t i, const Value& v) { std::memcpy(&nodes_[i].value, &v, sizeof(Value)); }
+
+    // 挪到 MRU 端（链尾）
+    void touch(uint32_t i) {
+        if (i == tail_) return;
+        unlink(i);
+        linkTail(i);
+    }
+
+    // 调用方保证 key 不存在；插在 MRU 端，返回节点下标
+    uint32_t insert(const Key& key, const Value& value) {
+        if ((size_ + 1) * 2 > slots_.size()) rehash(slots_.size() * 2);
+        uint32_t i;
+        if (free_ != kNil) {
+            i = free_;
+            free_ = nodes_[i].next;
+        } else {
+            i = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& n = nodes_[i];
+        std::memcpy(&n.key, &key, sizeof(Key));
+        std::memcpy(&n.value, &value, sizeof(Value));
+        n.gen = generation_;
+        linkTail(i);
+        placeSlot(hashOf(key), i);
+        ++size_;
+        return i;
+    }
+
+    // 淘汰 LRU 端（链头）并返回其 key；调用方保证非空
+    Key evictOldest() {
+        const uint32_t i = head_;
+        Key k = nodes_[i].key;
+        retire(i, nodes_[i].gen == generation_ ? RemovalCause::Capacity : RemovalCause::Expired);
+        return k;
+    }
+
+    void eraseAt(uint32_t i, RemovalCause cause = RemovalCause::Explicit) { retire(i, cause); }
+
+    bool erase(const Key& key) {
+        const uint32_t i = find(key);
+        if (i == kNil) return false;
+        retire(i, RemovalCause::Explicit);
+        return true;
+    }
+
+    void invalidateAll() { ++generation_; }
+
+    // 删除满足 pred 的当代节点（旧代节点一并回收），返回删除个数
+    template<typename Pred>
+    size_t eraseIf(Pred&& pred) {
+        size_t n = 0;
+        for (uint32_t i = head_; i != kNil;) {
+            const uint32_t next = nodes_[i].next;
+            if (nodes_[i].gen != generation_) {
+                retire(i, RemovalCause::Expired);
+            } else if (pred(nodes_[i].key, nodes_[i].value)) {
+                retire(i, RemovalCause::Explicit);
+                ++n;
+            }
+            i = next;
+        }
+        return n;
+    }
+
+    // 按 LRU → MRU 顺序遍历当代节点
+    template<typename F>
+    void forEachOldestFirst(F&& f) const {
+        for (uint32_t i = head_; i != kNil; i = nodes_[i].next)
+            if (nodes_[i].gen == generation_) f(nodes_[i].key, nodes_[i].value);
+    }
+
+    void clear() {
+        nodes_.clear();
+        std::fill(slots_.begin(), slots_.end(), Slot{});
+        head_ = tail_ = free_ = kNil;
+        size_ = 0;
+    }
+
+    // 按已分配容量计：扁平布局的内存就是这几块连续数组
+    size_t indexBytes() const { return slots_.capacity() * sizeof(Slot); }
+    size_t nodeBytes() const { return nodes_.capacity() * (sizeof(Node) - sizeof(Value)); }
+    size_t valueBytes() const { return nodes_.capacity() * sizeof(Value); }
+
+private:
+    struct Slot {
+        uint32_t node = kNil;
+        uint32_t hash = 0;
+    };
+
+    // murmur3 finalizer：std::hash<int> 是恒等映射，必须先打散
+    static uint32_t hashOf(const Key& key) {
+        return static_cast<uint32_t>(fmix64(std::hash<Key>{}(key)));
+    }
+
+    static size_t slotsFor(size_t entries) {
+        size_t n = 8;
+        while (n < entries * 2) n <<= 1;
+        return n;
+    }
+
+    void linkTail(uint32_t i) {
+        Node& n = nodes_[i];
+        n.prev = tail_;
+        n.next = kNil;
+        if (tail_ != kNil) nodes_[tail_].next = i;
+        else head_ = i;
+        tail_ = i;
+    }
+
+    void unlink(uint32_t i) {
+        Node& n = nodes_[i];
+        if (n.prev != kNil) nodes_[n.prev].next = n.next;
+        else head_ = n.next;
+        if (n.next != kNil) nodes_[n.next].prev = n.prev;
+        else tail_ = n.prev;
+    }
+
+    void placeSlot(uint32_t h, uint32_t i) {
+        size_t pos = h & mask_;
+        while (slots_[pos].node != kNil) pos = (pos + 1) & mask_;
+        slots_[pos] = Slot{i, h};
+    }
+
+    void retire(uint32_t i, RemovalCause cause) {
+        if (removals_) removals_->push(nodes_[i].key, nodes_[i].value, cause);
+        eraseNode(i);
+    }
+
+    void eraseNode(uint32_t i) {
+        const uint32_t h = hashOf(nodes_[i].key);
+        size_t pos = h & mask_;
+        while (slots_[pos].node != i) pos = (pos + 1) & mask_;
+        // backward-shift：把后面仍可前移的槽逐个补进空洞
+        size_t hole = pos;
+        for (size_t j = (pos + 1) & mask_; slots_[j].node != kNil; j = (j + 1) & mask_) {
+            const size_t home = slots_[j].hash & mask_;
+            if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+                slots_[hole] = slots_[j];
+                hole = j;
+            }
+        }
+        slots_[hole] = Slot{};
+        unlink(i);
+        nodes_[i].next = free_;
+        free_ = i;
+        --size_;
+    }
+
+    void rehash(size_t n) {
+        std::vector<Slot> old;
+        old.swap(slots_);
+        slots_.assign(n, Slot{});
+        mask_ = n - 1;
+        for (const Slot& s : old)
+            if (s.node != kNil) placeSlot(s.hash, s.node);
+    }
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<Slot> slots_;
+    size_t   mask_ = 0;
+    size_t   size_ = 0;
+    uint32_t head_ = kNil;   //LRU 端
+    uint32_t tail_ = kNil;   //MRU 端
+    uint32_t free_ = kNil;   //空闲链，借用 next 串起来
+    uint32_t generation_ = 0;
+    RemovalQueue<Key, Value>* removals_ = nullptr;
+};
+
+} // namespace CacheSystem
@@ -2,9 +2,11 @@
 
 #include "CachePolicy.h"
 #include "LfuCache.h"
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <optional>
 
 namespace CacheSystem {
 
@@ -19,13 +21,13 @@ public:
         , curAverageNum_(0) {}
 
     void put(Key key, Value value) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        Lock lock(mutex_, relay_);
         base_->put(key, value);
         addFreqNum();
     }
 
     bool get(Key key, Value& value) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        Lock lock(mutex_, relay_);
         bool hit = base_->get(key, value);
         if (hit) addFreqNum();
         return hit;
@@ -37,14 +39,78 @@ public:
         return value;
     }
 
+    // 改写已有条目或插入新条目都算一次访问，与 put 一致
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Lock lock(mutex_, relay_);
+        std::optional<Value> result = base_->compute(key, fn);
+        if (result) addFreqNum();
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        Lock lock(mutex_, relay_);
+        const bool inserted = base_->putIfAbsent(key, std::move(value));
+        if (inserted) addFreqNum();
+        return inserted;
+    }
+
+    // 命中与插入都算一次访问（与 get 命中、put 一致）
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        Lock lock(mutex_, relay_);
+        const bool hit = base_->getOrInsert(key, value, factory);
+        addFreqNum();
+        return hit;
+    }
+
+    void setCapacity(size_t capacity) override {
+        base_->setCapacity(capacity);
+        relay_.deliver();
+    }
+
+    // 底座的通知在它自己的锁外逐批并入 relay_，本装饰器释放自己的锁之后再投递
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        const bool enabled = static_cast<bool>(listener);
+        relay_.setListener(std::move(listener), batchSize);
+        base_->setRemovalListener(enabled ? relay_.sink() : nullptr, 1);
+    }
+
+    void flushRemovals() override {
+        base_->flushRemovals();
+        relay_.deliver(true);
+    }
+
+    MemoryUsage memoryUsage() const override {
+        return base_->memoryUsage();
+    }
+
+    bool remove(Key key) override {
+        Lock lock(mutex_, relay_);
+        return base_->remove(key);
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        Lock lock(mutex_, relay_);
+        return base_->invalidateIf(pred);
+    }
+
+    // 底层 O(1) 换代；平均频次统计从头开始
+    void invalidateAll() override {
+        Lock lock(mutex_, relay_);
+        base_->invalidateAll();
+        curTotalNum_ = 0;
+        curAverageNum_ = 0;
+    }
+
     void purge() {
-        std::lock_guard<std::mutex> lock(mutex_);
+        Lock lock(mutex_, relay_);
         base_->purge();
         curTotalNum_ = 0;
         curAverageNum_ = 0;
     }
 
 private:
+    using Lock = RelayingLock<std::mutex, Key, Value>;
+
     void addFreqNum() {
         ++curTotalNum_;
         if (curAverageNum_ == 0) {
@@ -73,6 +139,7 @@ private:
     int curTotalNum_;
     int curAverageNum_;
     std::mutex mutex_;
+    RemovalRelay<Key, Value> relay_;
 };
 
 } // namespace CacheSystem
\ No newline at end of file
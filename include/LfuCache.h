@@ -1,19 +1,42 @@
 #pragma once
 
+#include <atomic>
 #include <cmath>
+#include <functional>
+#include <optional>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <thread>
+#include <algorithm>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "CachePolicy.h"
+#include "ContentionMutex.h"
 
+/*  读缓冲模式（bufferedReads = true，或直接用 BufferedLfuCache）：
+    普通 LFU 每次命中都要把节点挪到 freq+1 的链表，get 只能拿独占锁，分片再多也是一把把串行锁。
+    读缓冲模式下 get 只拿共享锁：查表、拷贝 value，然后把节点指针记进本线程所属条带的环形缓冲；
+    频次 +1 推迟到下一次拿独占锁（put / 淘汰 / 维护操作）时批量应用。
+    - 缓冲满了就丢弃这次记录，频次只是近似值；写满缓冲的读线程随后 try_lock 一下，抢到了就顺手排空；
+    - 每个独占临界区开头都先排空缓冲，所以缓冲里的指针一定还活着：
+      记录发生在共享锁内，而节点只会在独占锁内被释放。
+*/
 
 namespace CacheSystem {
 
 template<typename Key, typename Value> class LfuCache;
 
+// 每个线程第一次用到时领一个递增编号，读缓冲按编号分条带，比 hash(thread::id) 分布均匀
+inline size_t readBufferThreadIndex() {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
 template<typename Key, typename Value>
 class FreqList{ 
 //维护一个“相同访问频率”的所有节点（Node）的双向链表
@@ -35,6 +58,15 @@ public:
         tail_->prev_  = head_;
     }
 
+    //逐个断开 next_，避免长链表析构时 shared_ptr 递归爆栈
+    ~FreqList(){
+        NodePtr node = std::move(head_);
+        while (node) {
+            NodePtr next = std::move(node->next_);
+            node = std::move(next);
+        }
+    }
+
     bool isEmpty() const{
         return head_->next_ == tail_;
     }
@@ -74,6 +106,7 @@ public:
         Key key {};
         Value value {};
         int freq {1};
+        uint32_t gen {0};   //写入时的代数
         std::weak_ptr<Node> prev_;
         std::shared_ptr<Node> next_;
         //智能指针默认构造的时候就是空指针
@@ -89,38 +122,56 @@ public:
     //key → NodePtr 映射关系，便于快速定位缓存项的位置、值和访问频率。
 
 public:
-    explicit LfuCache(int capacity);
+    explicit LfuCache(int capacity, bool bufferedReads = false);
     ~LfuCache() override = default;
 
     void put(Key key, Value value) override;
     bool get(Key key, Value& value) override;
     Value get(Key key) override;
     void purge();//clear all
+    bool remove(Key key) override;
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override;
+    void invalidateAll() override; //O(1)；旧代条目在各频率链表里都排在前面，淘汰时优先回收
+    MemoryUsage memoryUsage() const override;
+    void setCapacity(size_t capacity) override; //缩容时分批驱逐，批与批之间释放锁
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override;
+    bool putIfAbsent(Key key, Value value) override; //已存在则不覆盖，返回是否插入
+    //读缓冲模式下命中仍只拿共享锁，未命中才换独占锁再查一次
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override;
+    std::vector<std::pair<Key, Value>> drain(); //按频次从低到高取出全部条目并清空（重新分片时迁移用），不产生删除通知
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override;
+    void flushRemovals() override;
 
     public:
     void decayAllFreqs(int delta) {
-        std::lock_guard<std::mutex> lock(mutex_);          // ← 加锁
+        Lock lock(mutex_, removals_);                      // ← 加锁；回收的旧代条目解锁后通知
+        applyReadBuffersNoLock();
         delta = std::max(1, delta);                        // ← 防止 0 衰减
-        for (auto& kv : nodeMap_) {
-            NodePtr node = kv.second;
+        for (auto it = nodeMap_.begin(); it != nodeMap_.end();) {
+            NodePtr node = it->second;
+            ++it;
             if (!node) continue;
+            if (node->gen != generation_) {                // 旧代条目重新入链会打乱“排在前面”的顺序，直接回收
+                eraseNodeNoLock(node, RemovalCause::Expired);
+                continue;
+            }
 
             removeFromFreqListNoLock(node);
             node->freq = std::max(1, node->freq - delta);
             addToFreqListNoLock(node);
         }
+        staleCount_ = 0;
         updateMinFreqNoLock();
     }
         
-    int size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return static_cast<int>(nodeMap_.size());
-    }
 
-    // 驱逐并返回最少使用的 key
+    // 驱逐并返回最少使用的 key（有监听器时按 Capacity 通知）
     Key evictOne() {
-        std::lock_guard<std::mutex> lock(mutex_);
+        Lock lock(mutex_, removals_);
+        applyReadBuffersNoLock();
         if (nodeMap_.empty()) return Key();
+        Key stale;
+        if (staleCount_ > 0 && evictStaleNoLock(&stale)) return stale;
         auto it = freqListMap_.find(minFreq_);
         if (it == freqListMap_.end() || it->second->isEmpty()) {
             updateMinFreqNoLock();
@@ -130,7 +181,9 @@ public:
         NodePtr victim = it->second->getFirstNode();
         Key k = victim->key;
         it->second->removeNode(victim);
+        accountErase(victim);
         nodeMap_.erase(k);
+        removals_.push(k, std::move(victim->value), RemovalCause::Capacity);
         if (it->second->isEmpty()) {
             freqListMap_.erase(it);
             updateMinFreqNoLock();
@@ -138,21 +191,89 @@ public:
         return k;
     }
 
-    bool empty() const { return nodeMap_.empty(); }
-    size_t size() const { return nodeMap_.size(); }
+    // 后台维护用：条目数超过 high 时一次加锁驱逐（先回收旧代条目），降到 low 或驱逐满 maxBatch 条为止；返回驱逐的条目数
+    size_t trimTo(size_t high, size_t low, size_t maxBatch) {
+        Lock lock(mutex_, removals_);
+        applyReadBuffersNoLock();
+        if (nodeMap_.size() <= high) return 0;
+        size_t n = 0;
+        for (; n < maxBatch && nodeMap_.size() > low; ++n) evictOneNoLock();
+        return n;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t size() const {
+        std::shared_lock<ContentionSharedMutex> lock(mutex_);
+        return nodeMap_.size();
+    }
+
+    bool bufferedReads() const { return readBuffers_ != nullptr; }
+    // 读缓冲满而丢掉的频次增量（累计）
+    uint64_t droppedReads() const {
+        uint64_t n = 0;
+        if (readBuffers_)
+            for (size_t i = 0; i < kReadStripes; ++i) n += readBuffers_[i].dropped.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // 本分片锁的争用统计（加锁次数 / 需等待次数 / 等待总时长）
+    ContentionStats contention() const { return mutex_.stats(); }
+    void resetContention() { mutex_.resetStats(); }
 
 private:
+    using Lock = NotifyingLock<ContentionSharedMutex, Key, Value>; //会删除条目的独占路径都用它：解锁后投递删除通知
+
+    //key/value 的堆上字节增量维护，memoryUsage() 无需遍历
+    void accountInsert(const NodePtr& node) {
+        keyHeapBytes_ += heapBytesOf(node->key);
+        valueHeapBytes_ += heapBytesOf(node->value);
+    }
+    void accountErase(const NodePtr& node) {
+        keyHeapBytes_ -= heapBytesOf(node->key);
+        valueHeapBytes_ -= heapBytesOf(node->value);
+    }
+
+    typename NodeMap::iterator findLiveNoLock(const Key& key); //旧代条目当作不存在并顺手删除
+    void eraseNodeNoLock(NodePtr node, RemovalCause cause);
+    bool evictStaleNoLock(Key* evicted);
+    void insertNewNoLock(Key&& key, Value&& value);   //调用方保证 key 不存在且容量大于 0
+    void assignValueNoLock(const NodePtr& node, Value&& value);
     void promoteNolock(const NodePtr& node);
     void evictOneNoLock();
     void addToFreqListNoLock(const NodePtr& node);
     void removeFromFreqListNoLock(const NodePtr& node);
     void updateMinFreqNoLock();
 
+    // ---- 读缓冲 ----
+    static constexpr size_t   kReadStripes = 8;      //条带数（2 的幂）
+    static constexpr uint32_t kReadBufferSize = 32;  //每条带最多暂存的命中
+
+    // 一个条带独占 cache line；count 可能被并发 fetch_add 冲过 kReadBufferSize，读取时取 min
+    struct alignas(64) ReadBuffer {
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint64_t> dropped{0};
+        Node*                 slots[kReadBufferSize];
+    };
+
+    bool recordReadNoLock(Node* node);   //共享锁内调用，返回 true 表示缓冲已满、该排空了
+    void applyReadBuffersNoLock();       //独占锁内调用：按记录顺序逐个 promote
+    void discardReadBuffersNoLock();     //独占锁内调用：节点要被整体清掉时直接丢弃
+
 private:
-    mutable std::mutex mutex_;
+    static constexpr int kEvictBatch = 64;   //setCapacity 每次持锁最多驱逐的条目数
+
+    mutable ContentionSharedMutex mutex_;  //带争用统计，分片缓存据此调整分片数；读缓冲模式下 get 只拿共享锁
+    std::unique_ptr<ReadBuffer[]> readBuffers_;  //非读缓冲模式为空
     int capacity_;
     int minFreq_;
     NodeMap nodeMap_;
+    uint32_t generation_ = 0;
+    size_t staleCount_ = 0;   //尚未回收的旧代条目数（上界），为 0 时淘汰不用找旧代条目
+    std::vector<int> staleFreqs_;      //可能以旧代条目开头的频率链表，从高到低排，末尾最低（见 evictStaleNoLock）
+    bool staleFreqsReady_ = false;
+    size_t keyHeapBytes_ = 0;
+    size_t valueHeapBytes_ = 0;
+    RemovalQueue<Key, Value> removals_;  //锁内攒的删除通知
     std::unordered_map<int, std::unique_ptr<FreqList<Key, Value>>> freqListMap_;
     //维护一个“访问频率到对应频率链表”的映射
     //访问频率：int
@@ -161,5 +282,12 @@ private:
     
 };
 
+// 读缓冲模式的 LFU：构造参数只有容量，可以直接作为 ShardedCache 的分片策略
+template<typename Key, typename Value>
+class BufferedLfuCache : public LfuCache<Key, Value> {
+public:
+    explicit BufferedLfuCache(int capacity) : LfuCache<Key, Value>(capacity, true) {}
+};
+
 }//namespace
 #include "../src/LfuCache_impl.hpp" 
\ No newline at end of file
@@ -0,0 +1,516 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+
+/*  LirsCache.h
+    LIRS（Low Inter-reference Recency Set）：用“重用距离”而不是“最近一次访问时间”区分冷热。
+    - LIR 块：重用距离小的热数据，占容量的绝大部分（默认 99%），只有在栈 S 里沉底才会被降级；
+    - HIR 块：其余数据。常驻的 HIR 排在队列 Q 里，缓存满了就从 Q 头淘汰；
+    - 栈 S：按最近访问排序，记录 LIR 块、常驻 HIR 块，以及一部分已被淘汰的“非常驻 HIR”（只剩 key）。
+      HIR 块在 S 中再次被访问，说明它的重用距离比栈底的 LIR 块还小 → 升级为 LIR，栈底 LIR 降级为 HIR。
+    循环长度略大于容量时 LRU 命中率接近 0，LIRS 则把大部分块固定为 LIR，命中率接近 容量/循环长度。
+
+    实现要点：
+    - 所有节点放在一个 vector 节点池里，用 32 位下标串成链表，空闲节点走 free list 复用，
+      没有 shared_ptr，也没有每次插入一次 malloc；
+    - 栈剪枝（把栈底的 HIR 块弹掉，直到栈底是 LIR）是摊还 O(1)：每个节点每入栈一次最多被弹出一次；
+    - 非常驻 HIR 额外串成一条 FIFO（复用 Q 的前后指针），超过上限（默认等于容量）就丢弃最老的，元数据有界；
+    - invalidateAll 只把代数 +1。旧代块不会再被访问，所以它们在栈底和 Q 头各占一段前缀：
+      访问到就删，每次 put 再顺手从栈底 / Q 头回收两个，LIR 份额很快让给新数据。
+*/
+
+namespace CacheSystem {
+
+template<typename Key, typename Value>
+class LirsCache : public CachePolicy<Key, Value> {
+public:
+    // hirRatio：常驻 HIR 占容量的比例；nonResidentRatio：非常驻 HIR 元数据上限 / 容量
+    explicit LirsCache(int capacity, double hirRatio = 0.01, double nonResidentRatio = 1.0)
+        : hirRatio_(hirRatio), nonResidentRatio_(nonResidentRatio) {
+        resize(capacity > 0 ? static_cast<size_t>(capacity) : 0);
+        nodes_.reserve(capacity_ + maxNonResident_);
+        map_.reserve(capacity_ + maxNonResident_);
+    }
+
+    ~LirsCache() override = default;
+
+    void put(Key key, Value value) override {
+        Lock lk(mu_, removals_);
+        if (capacity_ == 0) return;
+        const uint32_t i = findResident(key);
+        if (i != kNil) {
+            replaceValue(i, std::move(value));
+            accessResident(i);
+            return;
+        }
+        insertMiss(std::move(key), std::move(value));
+    }
+
+    bool get(Key key, Value& value) override {
+        Lock lk(mu_, removals_);
+        const uint32_t i = findResident(key);
+        if (i == kNil) return false;
+        value = nodes_[i].value;
+        accessResident(i);
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Lock lk(mu_, removals_);
+        const uint32_t i = findResident(key);
+        std::optional<Value> result = fn(i != kNil ? &nodes_[i].value : nullptr);
+        if (i != kNil) {
+            if (!result) {
+                eraseResident(i, RemovalCause::Explicit);
+                return result;
+            }
+            replaceValue(i, Value(*result));
+            accessResident(i);
+        } else if (result && capacity_ > 0) {
+            insertMiss(std::move(key), Value(*result));
+        }
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        Lock lk(mu_, removals_);
+        if (capacity_ == 0 || findResident(key) != kNil) return false;
+        insertMiss(std::move(key), std::move(value));
+        return true;
+    }
+
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        Lock lk(mu_, removals_);
+        const uint32_t i = findResident(key);
+        if (i != kNil) {
+            value = nodes_[i].value;
+            accessResident(i);
+            return true;
+        }
+        value = factory();
+        if (capacity_ > 0) insertMiss(std::move(key), Value(value));
+        return false;
+    }
+
+    // 常驻块直接删除；非常驻 HIR 的历史也一并忘掉
+    bool remove(Key key) override {
+        Lock lk(mu_, removals_);
+        auto it = map_.find(key);
+        if (it == map_.end()) return false;
+        const uint32_t i = it->second;
+        if (nodes_[i].state == State::NonResident) {
+            dropNonResident(i);
+            return false;
+        }
+        const bool wasLive = live(i);
+        eraseResident(i, wasLive ? RemovalCause::Explicit : RemovalCause::Expired);
+        return wasLive;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        Lock lk(mu_, removals_);
+        std::vector<uint32_t> victims;
+        size_t n = 0;
+        for (const auto& kv : map_) {
+            const Node& node = nodes_[kv.second];
+            if (node.state == State::NonResident) continue;
+            if (!live(kv.second)) {
+                victims.push_back(kv.second);
+            } else if (pred(node.key, node.value)) {
+                victims.push_back(kv.second);
+                ++n;
+            }
+        }
+        //eraseResident 只会通过剪枝释放非常驻块，不会碰到 victims 里的其他常驻块
+        for (uint32_t i : victims) eraseResident(i, live(i) ? RemovalCause::Explicit : RemovalCause::Expired);
+        return n;
+    }
+
+    void invalidateAll() override {
+        std::lock_guard<std::mutex> lk(mu_);
+        ++generation_;
+        staleCount_ = residentCount();
+    }
+
+    // 节点池按已分配的槽位计（含空闲槽）；非常驻 HIR 的哈希节点计入 metadata
+    MemoryUsage memoryUsage() const override {
+        std::lock_guard<std::mutex> lk(mu_);
+        using Map = std::unordered_map<Key, uint32_t>;
+        const size_t resident = residentCount();
+        MemoryUsage m;
+        m.entries  = resident;
+        m.index    = map_.bucket_count() * sizeof(void*) + resident * hashNodeBytes<Map>() + keyHeapBytes_;
+        m.nodes    = nodes_.capacity() * (sizeof(Node) - sizeof(Value))
+                   + free_.capacity() * sizeof(uint32_t) + keyHeapBytes_;
+        m.values   = nodes_.capacity() * sizeof(Value) + valueHeapBytes_;
+        m.metadata = nr_.size * hashNodeBytes<Map>();
+        return m;
+    }
+
+    // 缩容时分批淘汰/降级，批与批之间释放锁
+    void setCapacity(size_t capacity) override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            resize(capacity);
+        }
+        for (bool done = false; !done;) {
+            Lock lk(mu_, removals_);  //每批淘汰的通知在本批解锁后投递
+            size_t n = 0;
+            for (; n < kEvictBatch; ++n) {
+                if (residentCount() > capacity_) evictResidentHir();
+                else if (lirCount_ > lirCap_) demoteBottomLir();
+                else break;
+            }
+            trimNonResident();
+            done = n < kEvictBatch;
+        }
+    }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        std::lock_guard<std::mutex> lk(mu_);
+        removals_.setListener(std::move(listener), batchSize);
+    }
+
+    void flushRemovals() override {
+        Lock lk(mu_, removals_, true);
+    }
+
+    // 淘汰 Q 头的常驻 HIR 块，返回其 key（有监听器时按 Capacity 通知）
+    Key evictOne() {
+        Lock lk(mu_, removals_);
+        if (residentCount() == 0) return Key();
+        Key k = evictResidentHir();
+        trimNonResident();
+        return k;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return residentCount();
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return capacity_;
+    }
+
+private:
+    using Lock = NotifyingLock<std::mutex, Key, Value>; //会删除条目的路径都用它：解锁后投递删除通知
+
+    enum class State : uint8_t { Lir, HirResident, NonResident };
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr size_t kEvictBatch = 64;   //setCapacity 每次持锁最多处理的条目数
+    static constexpr int    kReclaimPerPut = 2; //invalidateAll 之后每次 put 顺手回收的旧代块数
+
+    struct Node {
+        Key      key{};
+        Value    value{};
+        uint32_t sPrev = kNil, sNext = kNil;  //栈 S
+        uint32_t qPrev = kNil, qNext = kNil;  //常驻 HIR 在 Q 中；非常驻 HIR 复用这组指针挂在 NR 队列上
+        State    state = State::Lir;
+        bool     inStack = false;
+        uint32_t gen = 0;   //写入时的代数
+    };
+
+    // head = 栈底 / 队首（最旧），tail = 栈顶 / 队尾（最新）
+    struct List {
+        uint32_t head = kNil, tail = kNil;
+        size_t   size = 0;
+    };
+
+    void resize(size_t capacity) {
+        capacity_ = capacity;
+        hirCap_ = capacity_ ? std::max<size_t>(1, static_cast<size_t>(capacity_ * hirRatio_)) : 0;
+        lirCap_ = capacity_ - hirCap_;
+        maxNonResident_ = static_cast<size_t>(capacity_ * nonResidentRatio_);
+    }
+
+    size_t residentCount() const { return lirCount_ + queue_.size; }
+    bool live(uint32_t i) const { return nodes_[i].gen == generation_; }
+
+    // 常驻且当代的块返回下标，否则 kNil；旧代块顺手删除
+    uint32_t findResident(const Key& key) {
+        auto it = map_.find(key);
+        if (it == map_.end() || nodes_[it->second].state == State::NonResident) return kNil;
+        if (live(it->second)) return it->second;
+        eraseResident(it->second, RemovalCause::Expired);
+        return kNil;
+    }
+
+    // 调用方保证 key 不是常驻块（findResident 返回 kNil）且容量大于 0
+    void insertMiss(Key&& key, Value&& value) {
+        reclaimStale(kReclaimPerPut);
+
+        //未命中（含命中非常驻 HIR）：先腾出一个常驻位置。
+        //腾位置时的降级 + 剪枝可能把这个非常驻节点一起弹出栈，所以之后重新查一次
+        while (residentCount() >= capacity_) evictResidentHir();
+
+        auto it = map_.find(key);
+        if (it != map_.end()) {
+            //非常驻 HIR 仍在栈 S 中：重用距离小于栈底 LIR，直接升级为 LIR
+            const uint32_t i = it->second;
+            unlink(nr_, i, &Node::qPrev, &Node::qNext);
+            assignValue(i, std::move(value));
+            nodes_[i].gen = generation_;
+            nodes_[i].state = State::Lir;
+            ++lirCount_;
+            moveToStackTop(i);
+            while (lirCount_ > lirCap_) demoteBottomLir();
+        } else {
+            const uint32_t i = allocNode(std::move(key), std::move(value));
+            pushBack(stack_, i, &Node::sPrev, &Node::sNext);
+            nodes_[i].inStack = true;
+            if (lirCount_ < lirCap_) {
+                nodes_[i].state = State::Lir;   //冷启动阶段：LIR 还没满，新块直接作为 LIR
+                ++lirCount_;
+            } else {
+                nodes_[i].state = State::HirResident;
+                pushBack(queue_, i, &Node::qPrev, &Node::qNext);
+            }
+        }
+        trimNonResident();
+    }
+
+    // 彻底删除一个常驻块（不转成非常驻 HIR）
+    void eraseResident(uint32_t i, RemovalCause cause) {
+        Node& n = nodes_[i];
+        if (!live(i) && staleCount_ > 0) --staleCount_;
+        retireValue(i, cause);
+        if (n.state == State::Lir) {
+            const bool wasBottom = stack_.head == i;
+            unlink(stack_, i, &Node::sPrev, &Node::sNext);
+            --lirCount_;
+            freeNode(i);
+            if (wasBottom) prune();
+        } else {
+            unlink(queue_, i, &Node::qPrev, &Node::qNext);
+            if (n.inStack) unlink(stack_, i, &Node::sPrev, &Node::sNext);
+            freeNode(i);
+        }
+    }
+
+    void dropNonResident(uint32_t i) {
+        unlink(nr_, i, &Node::qPrev, &Node::qNext);
+        if (nodes_[i].inStack) unlink(stack_, i, &Node::sPrev, &Node::sNext);
+        freeNode(i);
+    }
+
+    // 旧代块是栈底 LIR 和 Q 头的前缀：两头都不是旧代，说明已经回收完
+    void reclaimStale(int budget) {
+        for (; budget > 0 && staleCount_ > 0; --budget) {
+            const uint32_t b = stack_.head;
+            const uint32_t q = queue_.head;
+            if (b != kNil && nodes_[b].state == State::Lir && !live(b)) eraseResident(b, RemovalCause::Expired);
+            else if (q != kNil && !live(q)) eraseResident(q, RemovalCause::Expired);
+            else staleCount_ = 0;
+        }
+    }
+
+    // ---- 下标链表 ----
+    void pushBack(List& l, uint32_t i, uint32_t Node::*prev, uint32_t Node::*next) {
+        Node& n = nodes_[i];
+        n.*prev = l.tail;
+        n.*next = kNil;
+        if (l.tail != kNil) nodes_[l.tail].*next = i;
+        else l.head = i;
+        l.tail = i;
+        ++l.size;
+    }
+    void unlink(List& l, uint32_t i, uint32_t Node::*prev, uint32_t Node::*next) {
+        Node& n = nodes_[i];
+        if (n.*prev != kNil) nodes_[n.*prev].*next = n.*next;
+        else l.head = n.*next;
+        if (n.*next != kNil) nodes_[n.*next].*prev = n.*prev;
+        else l.tail = n.*prev;
+        n.*prev = n.*next = kNil;
+        --l.size;
+    }
+
+    void moveToStackTop(uint32_t i) {
+        if (nodes_[i].inStack) unlink(stack_, i, &Node::sPrev, &Node::sNext);
+        pushBack(stack_, i, &Node::sPrev, &Node::sNext);
+        nodes_[i].inStack = true;
+    }
+
+    // ---- LIRS 核心 ----
+    void accessResident(uint32_t i) {
+        Node& n = nodes_[i];
+        if (n.state == State::Lir) {
+            const bool wasBottom = stack_.head == i;
+            moveToStackTop(i);
+            if (wasBottom) prune();
+        } else if (n.inStack) {
+            //HIR 在 S 中被再次访问：升级为 LIR，栈底 LIR 降级补到 Q
+            unlink(queue_, i, &Node::qPrev, &Node::qNext);
+            n.state = State::Lir;
+            ++lirCount_;
+            moveToStackTop(i);
+            while (lirCount_ > lirCap_) demoteBottomLir();
+        } else {
+            //HIR 已不在 S 中：仍是 HIR，重新入栈并移到 Q 尾
+            moveToStackTop(i);
+            unlink(queue_, i, &Node::qPrev, &Node::qNext);
+            pushBack(queue_, i, &Node::qPrev, &Node::qNext);
+        }
+    }
+
+    // 栈底的 LIR 降级为常驻 HIR，移到 Q 尾；返回是否降级了。
+    // 栈底是旧代块时直接回收（Expired）、返回 false：移到 Q 尾会破坏 reclaimStale 依赖的前缀结构。
+    // 先剪枝：LIR 份额为 0（容量极小）时栈底可能暂时不是 LIR
+    bool demoteBottomLir(Key* dropped = nullptr) {
+        if (lirCount_ == 0) return false;
+        prune();
+        const uint32_t b = stack_.head;
+        if (!live(b)) {
+            if (dropped) *dropped = nodes_[b].key;
+            eraseResident(b, RemovalCause::Expired);
+            return false;
+        }
+        unlink(stack_, b, &Node::sPrev, &Node::sNext);
+        nodes_[b].inStack = false;
+        nodes_[b].state = State::HirResident;
+        --lirCount_;
+        pushBack(queue_, b, &Node::qPrev, &Node::qNext);
+        prune();
+        return true;
+    }
+
+    // 栈剪枝：弹出栈底的 HIR 块直到栈底是 LIR；弹出的非常驻块彻底释放
+    void prune() {
+        while (stack_.head != kNil && nodes_[stack_.head].state != State::Lir) {
+            const uint32_t i = stack_.head;
+            unlink(stack_, i, &Node::sPrev, &Node::sNext);
+            nodes_[i].inStack = false;
+            if (nodes_[i].state == State::NonResident) {
+                unlink(nr_, i, &Node::qPrev, &Node::qNext);
+                freeNode(i);
+            }
+        }
+    }
+
+    // 淘汰 Q 头；Q 为空（LIR 占满了全部容量，只在缩容时出现）时先降级一个 LIR，栈底是旧代块就直接算作这次淘汰
+    Key evictResidentHir() {
+        Key stale;
+        if (queue_.size == 0 && !demoteBottomLir(&stale)) return stale;
+        const uint32_t i = queue_.head;
+        unlink(queue_, i, &Node::qPrev, &Node::qNext);
+        Key k = nodes_[i].key;
+        if (!live(i)) {
+            //旧代块没必要留 key 做历史
+            if (staleCount_ > 0) --staleCount_;
+            if (nodes_[i].inStack) unlink(stack_, i, &Node::sPrev, &Node::sNext);
+            retireValue(i, RemovalCause::Expired);
+            freeNode(i);
+        } else if (nodes_[i].inStack) {
+            //还在 S 中：只保留 key，变成非常驻 HIR，以便之后再访问时识别出较小的重用距离
+            retireValue(i, RemovalCause::Capacity);
+            nodes_[i].state = State::NonResident;
+            pushBack(nr_, i, &Node::qPrev, &Node::qNext);
+        } else {
+            retireValue(i, RemovalCause::Capacity);
+            freeNode(i);
+        }
+        return k;
+    }
+
+    // 非常驻 HIR 超出上限时丢弃最老的（它一定不在栈底，栈底总是 LIR）
+    void trimNonResident() {
+        while (nr_.size > maxNonResident_) {
+            const uint32_t i = nr_.head;
+            unlink(nr_, i, &Node::qPrev, &Node::qNext);
+            unlink(stack_, i, &Node::sPrev, &Node::sNext);
+            nodes_[i].inStack = false;
+            freeNode(i);
+        }
+    }
+
+    // ---- 节点池 ----
+    uint32_t allocNode(Key&& key, Value&& value) {
+        uint32_t i;
+        if (!free_.empty()) {
+            i = free_.back();
+            free_.pop_back();
+        } else {
+            i = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& n = nodes_[i];
+        n.key = std::move(key);
+        n.value = std::move(value);
+        n.gen = generation_;
+        keyHeapBytes_ += heapBytesOf(n.key);       //赋值之后再计：移动赋值可能沿用槽位里原有的缓冲区
+        valueHeapBytes_ += heapBytesOf(n.value);
+        map_.emplace(n.key, i);
+        return i;
+    }
+
+    void freeNode(uint32_t i) {
+        Node& n = nodes_[i];
+        map_.erase(n.key);
+        keyHeapBytes_ -= heapBytesOf(n.key);
+        valueHeapBytes_ -= heapBytesOf(n.value);
+        n.key = Key{};
+        n.value = Value{};
+        n.sPrev = n.sNext = n.qPrev = n.qNext = kNil;
+        n.inStack = false;
+        free_.push_back(i);
+    }
+
+    // value 离开缓存：交给删除通知（没有监听器时直接释放），槽位里留一个空值
+    void retireValue(uint32_t i, RemovalCause cause) {
+        Value& v = nodes_[i].value;
+        valueHeapBytes_ -= heapBytesOf(v);
+        removals_.push(nodes_[i].key, std::move(v), cause);
+        v = Value{};
+    }
+
+    void replaceValue(uint32_t i, Value&& value) {
+        retireValue(i, RemovalCause::Replaced);
+        assignValue(i, std::move(value));
+    }
+
+    void assignValue(uint32_t i, Value&& value) {
+        Value& v = nodes_[i].value;
+        valueHeapBytes_ -= heapBytesOf(v);
+        v = std::move(value);
+        valueHeapBytes_ += heapBytesOf(v);
+    }
+
+private:
+    size_t capacity_ = 0;
+    size_t lirCap_ = 0;
+    size_t hirCap_ = 0;
+    size_t maxNonResident_ = 0;
+    double hirRatio_;
+    double nonResidentRatio_;
+
+    std::vector<Node>                    nodes_;   //节点池，下标即节点“指针”
+    std::vector<uint32_t>                free_;    //空闲槽位
+    std::unordered_map<Key, uint32_t>    map_;     //key → 节点下标（含非常驻 HIR）
+    List                                 stack_;   //栈 S
+    List                                 queue_;   //常驻 HIR 队列 Q
+    List                                 nr_;      //非常驻 HIR，FIFO，用于限制元数据
+    size_t                               lirCount_ = 0;
+    uint32_t                             generation_ = 0;
+    size_t                               staleCount_ = 0;   //尚未回收的旧代常驻块数
+    size_t                               keyHeapBytes_ = 0;
+    size_t                               valueHeapBytes_ = 0;
+    RemovalQueue<Key, Value>             removals_;   //锁内攒的删除通知
+    mutable std::mutex                   mu_;
+};
+
+} // namespace CacheSystem
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <utility>
+#include <vector>
 #include "CachePolicy.h"
+#include "ContentionMutex.h"
+#include "InlineLayout.h"
+#include "RemovalListener.h"
 
 
 namespace CacheSystem {
@@ -22,6 +30,7 @@ private:
     Key key_;
     Value value_;
     size_t accessCount_;  //unsigned int
+    uint32_t generation_ = 0; //写入时 LruCache 的代数，invalidateAll 之后旧代节点视为已删除
     //weak_ptr & shared_ptr 智能指针防止循环引用
     std::weak_ptr<LruNode<Key, Value>> prev_;
     std::shared_ptr<LruNode<Key, Value>> next_;
@@ -35,6 +44,11 @@ public:
     , value_(value)
     , accessCount_(1)
     {}
+    LruNode(const Key& key, Value&& value)
+    : key_(key)
+    , value_(std::move(value))
+    , accessCount_(1)
+    {}
 
     //内敛函数定义 inline function definition, 处理单个节点的函数
     //等价于：
@@ -43,6 +57,7 @@ public:
     Key getKey() const { return key_; }
     Value getValue() const { return value_; }
     void setValue(const Value& value) { value_ = value; }
+    void setValue(Value&& value) { value_ = std::move(value); }
     size_t getAccessCount() const { return accessCount_; }
     void incrementAccessCount() { ++accessCount_; }
 };
@@ -56,43 +71,102 @@ public:
     using NodePtr = std::shared_ptr<LruNodeType>; //当前节点的share_ptr智能指针
     using Map = std::unordered_map<Key, NodePtr>; //哈希表
 
+    //key/value 都是小的平凡可拷贝类型时走扁平布局（节点数组 + 开放寻址索引），见 InlineLayout.h
+    static constexpr bool kInline = InlineLayout<Key, Value>::value;
+
     explicit LruCache(int capacity);
-    ~LruCache() override = default;
+    ~LruCache() override; //逐个断开 next_，避免 shared_ptr 链递归析构爆栈
 
     void put(Key key, Value value) override;
     bool get(Key key, Value& value) override;
     Value get(Key key) override; //注意未命中的情况
-    void remove(Key key);
-
-        // 驱逐并返回最久未使用的 key
+    bool remove(Key key) override;
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override;
+    void invalidateAll() override; //O(1)：旧代节点都在 LRU 端，访问时删除或最先被淘汰
+    MemoryUsage memoryUsage() const override;
+    void setCapacity(size_t capacity) override; //缩容时分批驱逐，批与批之间释放锁
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override;
+    bool putIfAbsent(Key key, Value value) override; //已存在则不覆盖，返回是否插入
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override;
+    std::vector<std::pair<Key, Value>> drain(); //按 LRU→MRU 顺序取出全部条目并清空（重新分片时迁移用），不产生删除通知
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override;
+    void flushRemovals() override;
+
+        // 驱逐并返回最久未使用的 key（有监听器时按 Capacity 通知）
     Key evictOne() {
-        std::lock_guard<std::mutex> lock(mutex_);
+        Lock lock(mutex_, removals_);
+        if constexpr (kInline) {
+            return flat_.empty() ? Key() : flat_.evictOldest();
+        }
         if (nodeMap_.empty()) return Key(); 
-        NodePtr victim = dummyHead_->next_;
-        Key k = victim->getKey();
-        removeNode(victim);
-        nodeMap_.erase(k);
+        Key k = dummyHead_->next_->getKey();
+        evictLeastRecent();
         return k;
     }
 
-    bool empty() const { return nodeMap_.empty(); }
-    size_t size() const { return nodeMap_.size(); }
+    // 后台维护用：条目数超过 high 时一次加锁按 LRU 顺序驱逐，降到 low 或驱逐满 maxBatch 条为止；返回驱逐的条目数
+    size_t trimTo(size_t high, size_t low, size_t maxBatch) {
+        Lock lock(mutex_, removals_);
+        if (sizeNoLock() <= high) return 0;
+        size_t n = 0;
+        for (; n < maxBatch && sizeNoLock() > low; ++n) {
+            if constexpr (kInline) flat_.evictOldest();
+            else evictLeastRecent();
+        }
+        return n;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t size() const {
+        std::lock_guard<ContentionMutex> lock(mutex_);
+        return sizeNoLock();
+    }
+
+    // 本分片锁的争用统计（加锁次数 / 需等待次数 / 等待总时长）
+    ContentionStats contention() const { return mutex_.stats(); }
+    void resetContention() { mutex_.resetStats(); }
 
 private:
+    using Lock = NotifyingLock<ContentionMutex, Key, Value>; //会删除条目的路径都用它：解锁后投递删除通知
+
+    size_t sizeNoLock() const {
+        if constexpr (kInline) return flat_.size();
+        return nodeMap_.size();
+    }
+
+    //key/value 的堆上字节（如 std::string）在增删时增量维护，memoryUsage() 无需遍历
+    void accountInsert(const NodePtr& node) {
+        keyHeapBytes_ += heapBytesOf(node->key_);
+        valueHeapBytes_ += heapBytesOf(node->value_);
+    }
+    void accountErase(const NodePtr& node) {
+        keyHeapBytes_ -= heapBytesOf(node->key_);
+        valueHeapBytes_ -= heapBytesOf(node->value_);
+    }
+
+    typename Map::iterator findLive(const Key& key); //旧代节点当作不存在并顺手删除
+    void eraseEntry(typename Map::iterator it, RemovalCause cause);
     void initializeList();
-    void updateExistingNode(NodePtr node, const Value& value);
-    void addNewNode(const Key& key, const Value& value);
+    void updateExistingNode(NodePtr node, Value&& value);
+    void addNewNode(const Key& key, Value&& value);
     void moveToMostRecent(NodePtr node);
     void removeNode(NodePtr node);
     void insertNode(NodePtr node);
     void evictLeastRecent();
 
 private:
+    static constexpr size_t kEvictBatch = 64;   //setCapacity 每次持锁最多驱逐的条目数
+
     size_t          capacity_;
     Map             nodeMap_;
-    std::mutex      mutex_;
+    mutable ContentionMutex mutex_;  //带争用统计，分片缓存据此调整分片数
+    size_t          keyHeapBytes_ = 0;
+    size_t          valueHeapBytes_ = 0;
+    uint32_t        generation_ = 0;
     NodePtr         dummyHead_;
     NodePtr         dummyTail_;
+    std::conditional_t<kInline, FlatLruList<Key, Value>, FlatDisabled> flat_; //扁平布局时只用它，上面的 map/链表保持为空
+    RemovalQueue<Key, Value> removals_;  //锁内攒的删除通知
 };
 
 
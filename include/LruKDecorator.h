@@ -1,8 +1,10 @@
 #pragma  once
 
 #include <unordered_map>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include "LruCache.h"
 #include "CachePolicy.h"
 
@@ -21,7 +23,133 @@ public:
     {}
 
     bool get(Key key, Value& value) override{
+        Lock lock(mutex_, relay_);
+        return getLocked(key, value);
+    }
+
+    Value get(Key key) override{
+        Value value{};
+        (void) get(key, value);
+        return value;
+    }
+
+    void put(Key key, Value value) override{
+        Lock lock(mutex_, relay_);
+        putLocked(key, std::move(value));
+    }
+
+    //当前值先看主缓存，再看暂存区；写回主缓存中的值只改值，暂存区的值照常攒访问次数
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override{
+        Lock lock(mutex_, relay_);
+        bool inBase = false;
+        std::optional<Value> result = base_->compute(key, [&](const Value* cur) -> std::optional<Value> {
+            if (!cur) return std::nullopt;
+            inBase = true;
+            return fn(cur);
+        });
+        if (inBase) return result;
+        auto it = staged_.find(key);
+        result = fn(it != staged_.end() ? &it->second : nullptr);
+        if (!result) {
+            if (it != staged_.end()) {
+                stagedHeapBytes_ -= stagedBytesOf(*it);
+                staged_.erase(it);
+            }
+            return result;
+        }
+        stageLocked(key, Value(*result));
+        return result;
+    }
+
+    //主缓存或暂存区里已有就不覆盖
+    bool putIfAbsent(Key key, Value value) override{
+        Lock lock(mutex_, relay_);
+        Value existing{};
+        if (staged_.count(key) || getLocked(key, existing)) return false;
+        putLocked(key, std::move(value));
+        return true;
+    }
+
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override{
+        Lock lock(mutex_, relay_);
+        if (getLocked(key, value)) return true;
+        value = factory();
+        putLocked(key, Value(value));
+        return false;
+    }
+
+    //只调整主缓存；base_ 自带锁并分批驱逐，这里不持有装饰器的锁
+    void setCapacity(size_t capacity) override{
+        base_->setCapacity(capacity);
+        relay_.deliver();
+    }
+
+    //只通知主缓存里的条目：暂存区的值还没攒够 K 次访问、不算进了缓存，丢弃时不通知。
+    //主缓存的通知在它自己的锁外逐批并入 relay_，本装饰器释放自己的锁之后再投递
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override{
+        const bool enabled = static_cast<bool>(listener);
+        relay_.setListener(std::move(listener), batchSize);
+        base_->setRemovalListener(enabled ? relay_.sink() : nullptr, 1);
+    }
+
+    void flushRemovals() override{
+        base_->flushRemovals();
+        relay_.deliver(true);
+    }
+
+    // 主缓存、暂存区、历史计数一起删：删掉的 key 要重新攒够 K 次访问才能进主缓存
+    bool remove(Key key) override{
+        Lock lock(mutex_, relay_);
+        bool removed = base_->remove(key);
+        auto it = staged_.find(key);
+        if (it != staged_.end()) {
+            stagedHeapBytes_ -= stagedBytesOf(*it);
+            staged_.erase(it);
+            removed = true;
+        }
+        historyList_->remove(key);
+        return removed;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override{
+        Lock lock(mutex_, relay_);
+        size_t n = base_->invalidateIf(pred);
+        for (auto it = staged_.begin(); it != staged_.end();) {
+            if (pred(it->first, it->second)) {
+                stagedHeapBytes_ -= stagedBytesOf(*it);
+                it = staged_.erase(it);
+                ++n;
+            } else {
+                ++it;
+            }
+        }
+        return n;
+    }
+
+    // 主缓存和历史队列 O(1) 换代；暂存区在锁内整体换出，锁外析构
+    void invalidateAll() override{
+        std::unordered_map<Key, Value> retired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            base_->invalidateAll();
+            historyList_->invalidateAll();
+            retired.swap(staged_);
+            stagedHeapBytes_ = 0;
+        }
+    }
+
+    //主缓存之外的开销（history 计数队列、未达 K 次的暂存 value）都记为 metadata
+    MemoryUsage memoryUsage() const override{
         std::lock_guard<std::mutex> lock(mutex_);
+        MemoryUsage m = base_->memoryUsage();
+        m.metadata += historyList_->memoryUsage().total()
+                    + hashIndexBytes(staged_) + stagedHeapBytes_;
+        return m;
+    }
+private:
+    using Lock = RelayingLock<std::mutex, Key, Value>;
+
+    bool getLocked(const Key& key, Value& value){
         //查主缓存
         if(base_->get(key, value)){
             bumpHistoryNoStoreLocked(key);
@@ -33,6 +161,7 @@ public:
         if(historyCount >= static_cast<size_t>(k_)){
             auto it = staged_.find(key);
             if(it != staged_.end()){
+                stagedHeapBytes_ -= stagedBytesOf(*it);
                 Value storedValue = std::move(it->second);
                 staged_.erase(it);
                 historyList_->remove(key);
@@ -44,44 +173,55 @@ public:
         return false;
     }
 
-    Value get(Key key) override{
-        Value value{};
-        (void) get(key, value);
-        return value;
+    void putLocked(const Key& key, Value&& value){
+        //在主缓存：compute 一次查找完成改写，不在时不插入
+        bool inBase = false;
+        base_->compute(key, [&](const Value* cur) -> std::optional<Value> {
+            if (!cur) return std::nullopt;
+            inBase = true;
+            return std::move(value);
+        });
+        if (inBase) return;
+        //不在主缓存
+        stageLocked(key, std::move(value));
     }
 
-    void put(Key key, Value value) override{
-        std::lock_guard<std::mutex> lock(mutex_);
-        //在主缓存
-        Value existing{};
-        if (base_->get(key, existing)) {
-            base_->put(key, std::move(value));
-            return;
-        }
-        //不在主缓存
+    //写入暂存区并记一次访问，攒够 K 次就晋升到主缓存
+    void stageLocked(const Key& key, Value&& value){
         size_t historyCount = bumpHistoryNoStoreLocked(key);
-        staged_[key] = std::move(value);
+        auto ins = staged_.try_emplace(key);
+        if (!ins.second) stagedHeapBytes_ -= stagedBytesOf(*ins.first);
+        ins.first->second = std::move(value);
+        stagedHeapBytes_ += stagedBytesOf(*ins.first);
         //达到阈值
         if (historyCount >= static_cast<size_t>(k_)) {
-            auto it = staged_.find(key);
+            auto it = ins.first;
+            stagedHeapBytes_ -= stagedBytesOf(*it);
             Value v = std::move(it->second);
             staged_.erase(it);
             historyList_->remove(key);
             base_->put(key, std::move(v));
         }
     }
-private:
+
+    static size_t stagedBytesOf(const typename std::unordered_map<Key, Value>::value_type& kv){
+        return heapBytesOf(kv.first) + heapBytesOf(kv.second);
+    }
     size_t bumpHistoryNoStoreLocked(const Key& key){
-        size_t cnt = historyList_->get(key);
-        ++cnt;
-        historyList_->put(key, cnt);
+        size_t cnt = 0;
+        historyList_->compute(key, [&cnt](const size_t* cur) -> std::optional<size_t> {
+            cnt = (cur ? *cur : 0) + 1;
+            return cnt;
+        });
         return cnt;
     }
-    std::mutex                                  mutex_;
+    mutable std::mutex                          mutex_;
     std::unique_ptr<LruCache<Key, Value>>       base_;
     int                                         k_; //访问阈值
     std::unique_ptr<LruCache<Key, size_t>>      historyList_; //历史访问次数队列, save count;
     std::unordered_map<Key, Value>              staged_; //临时map, save value;
+    size_t                                      stagedHeapBytes_ = 0;
+    RemovalRelay<Key, Value>                    relay_;
 };
 
 }//namespace CacheSystem
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+
+/*  MaintenanceExecutor.h
+    后台维护：把淘汰、旧代回收、ghost 裁剪和删除通知的投递从写路径上拿走。
+    - MaintenanceExecutor：一个后台线程，按固定间隔（或被 wake 提前唤醒）依次执行登记的任务；
+      任务返回 true 表示还有活没干完，线程不再等待间隔、马上再跑一轮（每轮之间放开锁，写者不会被长时间挡住）。
+      多个缓存可以共用一个 executor；老化（LfuAgingDecorator 的 halve 之类）等周期性工作也可以作为任务登记进来；
+    - MaintainedCache<Policy>：包装 LruCache / LfuCache / ArcCache（需要 trimTo），三档水位：
+        low  = capacity · lowWater   后台驱逐的目标；
+        capacity                      超过它后台开始驱逐（带滞回：一旦开始就一直降到 low）；
+        hard = capacity · hardLimit  策略实例自己的容量，put 只有在超过它时才在写路径上内联驱逐——这就是背压；
+      所以常见情况下 put 只是一次插入：LRU 的摘尾、LFU 的 updateMinFreqNoLock 扫描、ARC 的 replace 和 ghost 裁剪
+      都在后台按批（一次加锁最多 batch 条）完成；
+    - 写路径只给本线程的计数加一（不碰共享 cache line），每 2^k 次写（不超过 capacity 和 hard 之间余量的 1/4）
+      看一眼条目数，超过 capacity 才唤醒后台线程，其余靠定时轮询；
+    - 条目数会在 capacity 和 hard 之间浮动，内存按 hard 估算；删除通知由后台每轮 flushRemovals 投递一次。
+*/
+
+namespace CacheSystem {
+
+class MaintenanceExecutor {
+public:
+    using Task = std::function<bool()>;   //返回 true：还有活，马上再跑一轮
+
+    explicit MaintenanceExecutor(std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+        : interval_(std::max(std::chrono::milliseconds(1), interval)) {
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    ~MaintenanceExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    MaintenanceExecutor(const MaintenanceExecutor&) = delete;
+    MaintenanceExecutor& operator=(const MaintenanceExecutor&) = delete;
+
+    // 返回任务编号，供 remove 使用
+    uint64_t add(Task task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t id = nextId_++;
+        tasks_.emplace_back(id, std::make_shared<Task>(std::move(task)));
+        return id;
+    }
+
+    // 任务正在执行时等它这一轮结束再返回，之后不会再被调用；不能在任务内部调用
+    void remove(uint64_t id) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(),
+                                    [id](const std::pair<uint64_t, std::shared_ptr<Task>>& t) { return t.first == id; }),
+                     tasks_.end());
+        idleCv_.wait(lock, [&] { return running_ != id; });
+    }
+
+    // 写路径调用：只改一个原子标志，已经有唤醒在排队时不再 notify。
+    // 不拿锁，极少数情况下唤醒会在线程开始等待前丢失，最多晚一个 interval
+    void wake() {
+        if (!wakePending_.exchange(true, std::memory_order_acq_rel)) cv_.notify_one();
+    }
+
+    uint64_t rounds() const { return rounds_.load(std::memory_order_relaxed); }
+
+private:
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            cv_.wait_for(lock, interval_, [this] { return stop_ || wakePending_.load(std::memory_order_acquire); });
+            if (stop_) break;
+            wakePending_.store(false, std::memory_order_release);
+            bool more = false;
+            const auto tasks = tasks_;   //快照：任务执行期间允许 add / remove 其他任务
+            for (const auto& t : tasks) {
+                if (stop_) break;
+                if (std::find_if(tasks_.begin(), tasks_.end(),
+                                 [&](const std::pair<uint64_t, std::shared_ptr<Task>>& c) { return c.first == t.first; }) == tasks_.end())
+                    continue;   //快照之后被 remove 了
+                running_ = t.first;
+                lock.unlock();
+                more = (*t.second)() || more;
+                lock.lock();
+                running_ = 0;
+                idleCv_.notify_all();
+            }
+            rounds_.fetch_add(1, std::memory_order_relaxed);
+            if (more) {
+                wakePending_.store(true, std::memory_order_release);
+                lock.unlock();
+                std::this_thread::yield();   //让出 CPU，写者可以在批与批之间拿到锁
+                lock.lock();
+            }
+        }
+    }
+
+    std::chrono::milliseconds                               interval_;
+    std::mutex                                              mutex_;
+    std::condition_variable                                 cv_, idleCv_;
+    std::vector<std::pair<uint64_t, std::shared_ptr<Task>>> tasks_;
+    uint64_t                                                nextId_ = 1;
+    uint64_t                                                running_ = 0;   //正在执行的任务编号，0 表示没有
+    bool                                                    stop_ = false;
+    std::atomic<bool>                                       wakePending_{false};
+    std::atomic<uint64_t>                                   rounds_{0};
+    std::thread                                             thread_;
+};
+
+struct MaintenanceOptions {
+    double lowWater  = 0.95;   //后台驱逐的目标：capacity · lowWater
+    double hardLimit = 1.10;   //策略实例的容量：超过 capacity · hardLimit 时 put 在写路径上内联驱逐（背压）
+    size_t batch     = 256;    //后台一次加锁最多驱逐的条目数
+};
+
+struct MaintenanceStats {
+    uint64_t runs    = 0;   //维护任务执行次数
+    uint64_t trimmed = 0;   //后台驱逐的条目数
+};
+
+template<typename Policy, typename Key, typename Value>
+class MaintainedCache : public CachePolicy<Key, Value> {
+public:
+    // executor 为空时自己建一个私有的；共享的 executor 须比本对象活得久
+    explicit MaintainedCache(size_t capacity, MaintenanceOptions options = MaintenanceOptions(),
+                             std::shared_ptr<MaintenanceExecutor> executor = nullptr)
+        : options_(options)
+        , executor_(executor ? std::move(executor) : std::make_shared<MaintenanceExecutor>()) {
+        options_.lowWater  = std::min(1.0, std::max(0.0, options_.lowWater));
+        options_.hardLimit = std::max(1.0, options_.hardLimit);
+        options_.batch     = std::max<size_t>(1, options_.batch);
+        setLevels(capacity);
+        policy_.reset(new Policy(static_cast<int>(hard_.load(std::memory_order_relaxed))));
+        taskId_ = executor_->add([this] { return maintain(); });
+    }
+
+    ~MaintainedCache() override {
+        executor_->remove(taskId_);
+    }
+
+    MaintainedCache(const MaintainedCache&) = delete;
+    MaintainedCache& operator=(const MaintainedCache&) = delete;
+
+    void put(Key key, Value value) override {
+        policy_->Policy::put(std::move(key), std::move(value));
+        noteWrite();
+    }
+
+    bool get(Key key, Value& value) override { return policy_->Policy::get(std::move(key), value); }
+
+    Value get(Key key) override { return policy_->Policy::get(std::move(key)); }
+
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        auto result = policy_->Policy::compute(std::move(key), fn);
+        noteWrite();
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        const bool inserted = policy_->Policy::putIfAbsent(std::move(key), std::move(value));
+        if (inserted) noteWrite();
+        return inserted;
+    }
+
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        const bool hit = policy_->Policy::getOrInsert(std::move(key), value, factory);
+        if (!hit) noteWrite();
+        return hit;
+    }
+
+    bool remove(Key key) override { return policy_->Policy::remove(std::move(key)); }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        return policy_->Policy::invalidateIf(pred);
+    }
+
+    // 旧代条目排在淘汰端，后台降水位时最先回收
+    void invalidateAll() override {
+        policy_->Policy::invalidateAll();
+        executor_->wake();
+    }
+
+    // 策略实例的容量跟着 hard 走（缩到 hard 以下的部分由策略自己分批驱逐），其余交给后台降到新的 low
+    void setCapacity(size_t capacity) override {
+        setLevels(capacity);
+        policy_->Policy::setCapacity(hard_.load(std::memory_order_relaxed));
+        executor_->wake();
+    }
+
+    MemoryUsage memoryUsage() const override { return policy_->Policy::memoryUsage(); }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        policy_->Policy::setRemovalListener(std::move(listener), batchSize);
+    }
+
+    void flushRemovals() override { policy_->Policy::flushRemovals(); }
+
+    MaintenanceStats stats() const {
+        MaintenanceStats s;
+        s.runs    = runs_.load(std::memory_order_relaxed);
+        s.trimmed = trimmed_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    size_t capacity() const { return capacity_.load(std::memory_order_relaxed); }
+    size_t hardLimit() const { return hard_.load(std::memory_order_relaxed); }
+    Policy& policy() { return *policy_; }
+    MaintenanceExecutor& executor() { return *executor_; }
+
+private:
+    void setLevels(size_t capacity) {
+        const size_t hard = std::max(capacity, static_cast<size_t>(capacity * options_.hardLimit));
+        const size_t low  = std::min(capacity, static_cast<size_t>(capacity * options_.lowWater));
+        capacity_.store(capacity, std::memory_order_relaxed);
+        hard_.store(hard, std::memory_order_relaxed);
+        low_.store(low, std::memory_order_relaxed);
+        // 检查间隔取不超过余量 1/4 的 2 的幂：余量被写满之前每个写线程都至少看过几次
+        size_t every = 1;
+        while (every * 2 <= std::max<size_t>(1, (hard - capacity) / 4)) every *= 2;
+        checkMask_.store(every - 1, std::memory_order_relaxed);
+    }
+
+    // 写路径：计数是 thread_local 的，没有共享的原子自增，也没有除法；每 checkMask_+1 次写才加一次锁读条目数，
+    // 超过 capacity（高水位）才唤醒后台。计数按线程而不是按实例攒，一个线程交替写多个实例时某个实例可能少检查几次，
+    // 由定时轮询和策略自己的 hard 上限兜底
+    void noteWrite() {
+        thread_local uint64_t writes = 0;
+        if ((++writes & checkMask_.load(std::memory_order_relaxed)) != 0) return;
+        if (policy_->Policy::memoryUsage().entries > capacity_.load(std::memory_order_relaxed)) executor_->wake();
+    }
+
+    // 后台任务：超过 capacity 就开始降，降到 low 为止（滞回）；每轮顺带投递攒着的删除通知。
+    // 驱逐满一批说明可能还没降到 low，返回 true 让 executor 马上再跑一轮
+    bool maintain() {
+        runs_.fetch_add(1, std::memory_order_relaxed);
+        const size_t low  = low_.load(std::memory_order_relaxed);
+        const size_t high = draining_ ? low : capacity_.load(std::memory_order_relaxed);
+        const size_t n = policy_->Policy::trimTo(high, low, options_.batch);
+        trimmed_.fetch_add(n, std::memory_order_relaxed);
+        draining_ = n == options_.batch;
+        policy_->Policy::flushRemovals();
+        return draining_;
+    }
+
+    MaintenanceOptions                   options_;
+    std::shared_ptr<MaintenanceExecutor> executor_;
+    std::unique_ptr<Policy>              policy_;
+    uint64_t                             taskId_ = 0;
+    std::atomic<size_t>                  capacity_{0}, hard_{0}, low_{0};
+    std::atomic<size_t>                  checkMask_{0};   //2^k - 1
+    std::atomic<uint64_t>                runs_{0}, trimmed_{0};
+    bool                                 draining_ = false;    //只在后台线程里读写
+};
+
+} // namespace CacheSystem
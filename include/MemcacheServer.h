@@ -0,0 +1,754 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "CachePolicy.h"
+
+/*  MemcacheServer.h
+    把任意 CachePolicy<std::string, MemcacheValue>（HashLruCache、HashLfuCache、分片 ARC……）用 memcached 文本协议
+    暴露在 TCP 和/或 Unix socket 上，给非 C++ 的服务直接用现成的 memcached 客户端访问。
+    - 协议：get/gets、set/add/replace/append/prepend/cas、delete、incr/decr、touch、flush_all、stats、version、
+      verbosity、quit，支持 noreply 和 exptime（≤30 天为相对秒数，否则为 unix 时间戳；过期条目读到时删除）；
+      二进制协议已被 memcached 自己废弃，不实现；
+    - value 是 shared_ptr<const MemcacheItem>，写入时就把整段响应 "VALUE key flags bytes\r\n<data>\r\n" 拼好存着，
+      get 命中时输出队列只持有这个 shared_ptr，writev 直接从它发出去，不拷贝数据；条目在发送途中被淘汰也不影响；
+    - I/O：多个 reactor 线程，各自一个 epoll（水平触发），监听 socket 加进每个 epoll（EPOLLEXCLUSIVE，
+      一个新连接只唤醒一个 reactor），连接此后一直归接受它的 reactor 处理，没有跨线程交接；
+    - 每个连接一个输入缓冲和一个输出块队列：一次读到的多条命令依次解析执行（pipelining），
+      响应攒在队列里一次 writev 发出；输出积压超过 maxOutputBytes 时暂停读这个连接，发完再继续（背压）；
+    - 缓存回调（compute）在缓存锁内执行，只做拼 value 之类的纯内存操作。
+*/
+
+namespace CacheSystem {
+
+struct MemcacheItem {
+    std::string wire;        //"VALUE <key> <flags> <bytes>\r\n<data>\r\n"
+    size_t      headerLen;   //"VALUE <key> <flags> <bytes>" 的长度（不含 \r\n）
+    uint32_t    flags;
+    int64_t     expiresAt;   //unix 秒，0 表示不过期
+    uint64_t    cas;
+
+    std::string_view data() const {
+        return std::string_view(wire).substr(headerLen + 2, wire.size() - headerLen - 4);
+    }
+    bool expired(int64_t now) const { return expiresAt != 0 && expiresAt <= now; }
+};
+
+using MemcacheValue = std::shared_ptr<const MemcacheItem>;
+
+template<>
+struct HeapBytes<MemcacheValue> {
+    static size_t of(const MemcacheValue& v) {
+        return v ? sharedNodeBytes<MemcacheItem>() + mallocBytes(v->wire.capacity() + 1) : 0;
+    }
+};
+
+struct MemcacheServerOptions {
+    std::string host           = "127.0.0.1";
+    int         port           = 11211;      //0：由系统分配（port() 取实际端口）；-1：不开 TCP
+    std::string unixPath;                    //非空时同时监听这个 Unix socket
+    int         reactors       = 2;
+    size_t      maxItemBytes   = 1 << 20;
+    size_t      maxOutputBytes = 4 << 20;    //单连接输出积压上限，超过暂停读
+};
+
+struct MemcacheServerStats {
+    uint64_t connections = 0;   //当前连接数
+    uint64_t totalConnections = 0;
+    uint64_t cmdGet = 0, getHits = 0, getMisses = 0;
+    uint64_t cmdSet = 0, cmdDelete = 0, cmdOther = 0;
+    uint64_t bytesRead = 0, bytesWritten = 0;
+};
+
+class MemcacheServer {
+public:
+    using Cache = CachePolicy<std::string, MemcacheValue>;
+
+    MemcacheServer(Cache& cache, MemcacheServerOptions options = MemcacheServerOptions())
+        : cache_(cache), options_(std::move(options)) {}
+
+    ~MemcacheServer() { stop(); }
+
+    MemcacheServer(const MemcacheServer&) = delete;
+    MemcacheServer& operator=(const MemcacheServer&) = delete;
+
+    // 监听并启动 reactor 线程；失败返回 false，error() 是对应的 errno
+    bool start() {
+        if (running_) return true;
+        if (options_.port >= 0 && !listenTcp()) return fail();
+        if (!options_.unixPath.empty() && !listenUnix()) return fail();
+        const int n = std::max(1, options_.reactors);
+        for (int i = 0; i < n; ++i) {
+            auto r = std::make_unique<Reactor>();
+            r->epfd = ::epoll_create1(EPOLL_CLOEXEC);
+            r->wakefd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (r->epfd < 0 || r->wakefd < 0) {
+                error_ = errno;
+                reactors_.push_back(std::move(r));
+                return fail();
+            }
+            add(*r, r->wakefd, tag(kWake, r->wakefd), EPOLLIN);
+            for (int fd : listeners_) add(*r, fd, tag(kListen, fd), EPOLLIN | EPOLLEXCLUSIVE);
+            reactors_.push_back(std::move(r));
+        }
+        stopping_.store(false);
+        for (auto& r : reactors_) r->thread = std::thread([this, p = r.get()] { run(*p); });
+        running_ = true;
+        return true;
+    }
+
+    void stop() {
+        if (!running_) return;
+        stopping_.store(true);
+        for (auto& r : reactors_) {
+            const uint64_t one = 1;
+            (void)!::write(r->wakefd, &one, sizeof(one));
+        }
+        for (auto& r : reactors_) r->thread.join();
+        closeAll();
+        running_ = false;
+    }
+
+    int port() const { return port_; }
+    int error() const { return error_; }
+
+    MemcacheServerStats stats() const {
+        MemcacheServerStats s;
+        s.connections      = connections_.load(std::memory_order_relaxed);
+        s.totalConnections = totalConnections_.load(std::memory_order_relaxed);
+        s.cmdGet           = cmdGet_.load(std::memory_order_relaxed);
+        s.getHits          = getHits_.load(std::memory_order_relaxed);
+        s.getMisses        = s.cmdGet - s.getHits;
+        s.cmdSet           = cmdSet_.load(std::memory_order_relaxed);
+        s.cmdDelete        = cmdDelete_.load(std::memory_order_relaxed);
+        s.cmdOther         = cmdOther_.load(std::memory_order_relaxed);
+        s.bytesRead        = bytesRead_.load(std::memory_order_relaxed);
+        s.bytesWritten     = bytesWritten_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    enum Kind : uint32_t { kWake = 1, kListen = 2, kConn = 3 };
+
+    static constexpr size_t kReadChunk = 16 * 1024;
+    static constexpr size_t kReadPerWakeup = 256 * 1024;   //一次唤醒最多读这么多就先处理，给别的连接让路
+    static constexpr size_t kMaxLine = 2048;               //命令行长度上限（memcached 的 key 最长 250）
+    static constexpr size_t kMaxKey = 250;
+    static constexpr int kMaxIov = 64;
+    static constexpr int64_t kRelativeLimit = 60 * 60 * 24 * 30;   //exptime 超过 30 天视为 unix 时间戳
+    static constexpr size_t kAbort = SIZE_MAX;                       //execute 的返回值：丢弃剩余输入，发完响应就关
+
+    // 输出块：小段文本攒在 text 里；命中的条目只持有 item，发送时直接指向 item->wire
+    struct OutChunk {
+        std::string   text;
+        MemcacheValue item;
+        size_t        begin = 0;   //item 模式下在 wire 中的区间
+        size_t        end = 0;
+        size_t        sent = 0;    //已发送的字节（相对区间起点）
+
+        const char* data() const { return (item ? item->wire.data() + begin : text.data()) + sent; }
+        size_t size() const { return (item ? end - begin : text.size()) - sent; }
+    };
+
+    struct Connection {
+        int                  fd = -1;
+        std::string          in;
+        size_t               inPos = 0;        //已解析到的位置
+        size_t               swallow = 0;      //还要丢弃的数据块字节（超长的存储命令，含结尾 \r\n）
+        std::deque<OutChunk> out;
+        size_t               outBytes = 0;
+        std::vector<std::string_view> keys;    //get/gets 的 key 切分缓冲，按连接复用
+        uint32_t             events = 0;       //当前注册的 epoll 事件
+        bool                 paused = false;   //输出积压，暂停读
+        bool                 closing = false;  //发完就关（quit / 对端关闭 / 协议错误）
+    };
+
+    struct Reactor {
+        int                                                  epfd = -1;
+        int                                                  wakefd = -1;
+        std::thread                                          thread;
+        std::unordered_map<int, std::unique_ptr<Connection>> conns;
+    };
+
+    static uint64_t tag(Kind k, int fd) { return (uint64_t(k) << 32) | uint32_t(fd); }
+
+    bool fail() {
+        closeAll();
+        return false;
+    }
+
+    static void add(Reactor& r, int fd, uint64_t data, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = data;
+        ::epoll_ctl(r.epfd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    bool listenTcp() {
+        const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return setError();
+        listeners_.push_back(fd);
+        const int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options_.port));
+        if (::inet_pton(AF_INET, options_.host.c_str(), &addr.sin_addr) != 1) {
+            error_ = EINVAL;
+            return false;
+        }
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+            return setError();
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        return true;
+    }
+
+    bool listenUnix() {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return setError();
+        listeners_.push_back(fd);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (options_.unixPath.size() >= sizeof(addr.sun_path)) {
+            error_ = ENAMETOOLONG;
+            return false;
+        }
+        std::memcpy(addr.sun_path, options_.unixPath.c_str(), options_.unixPath.size() + 1);
+        ::unlink(options_.unixPath.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+            return setError();
+        }
+        unixBound_ = true;
+        return true;
+    }
+
+    bool setError() {
+        error_ = errno;
+        return false;
+    }
+
+    void closeAll() {
+        for (auto& r : reactors_) {
+            for (auto& kv : r->conns) ::close(kv.first);
+            connections_.fetch_sub(r->conns.size(), std::memory_order_relaxed);
+            r->conns.clear();
+            if (r->epfd >= 0) ::close(r->epfd);
+            if (r->wakefd >= 0) ::close(r->wakefd);
+        }
+        reactors_.clear();
+        for (int fd : listeners_) ::close(fd);
+        listeners_.clear();
+        if (unixBound_) ::unlink(options_.unixPath.c_str());
+        unixBound_ = false;
+    }
+
+    // ---- reactor ----
+    void run(Reactor& r) {
+        epoll_event evs[128];
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            const int n = ::epoll_wait(r.epfd, evs, 128, -1);
+            for (int i = 0; i < n; ++i) {
+                const Kind kind = static_cast<Kind>(evs[i].data.u64 >> 32);
+                const int fd = static_cast<int>(evs[i].data.u64 & 0xffffffffu);
+                if (kind == kWake) {
+                    uint64_t v;
+                    (void)!::read(fd, &v, sizeof(v));
+                } else if (kind == kListen) {
+                    acceptOne(r, fd);
+                } else {
+                    auto it = r.conns.find(fd);
+                    if (it == r.conns.end()) continue;
+                    Connection& c = *it->second;
+                    if (evs[i].events & (EPOLLHUP | EPOLLERR)) {
+                        c.closing = true;
+                        c.out.clear();
+                        c.outBytes = 0;
+                    } else {
+                        if (evs[i].events & EPOLLIN) onReadable(c);
+                        if (evs[i].events & EPOLLOUT) flush(c);
+                    }
+                    settle(r, c);
+                }
+            }
+        }
+    }
+
+    // 每次唤醒只接一个：还有排队的连接时水平触发会再唤醒（可能是别的 reactor），连接分得更匀
+    void acceptOne(Reactor& r, int listenFd) {
+        const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;   //EAGAIN：别的 reactor 已经接走了
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   //Unix socket 上会失败，无妨
+        auto c = std::make_unique<Connection>();
+        c->fd = fd;
+        c->events = EPOLLIN;
+        add(r, fd, tag(kConn, fd), EPOLLIN);
+        r.conns.emplace(fd, std::move(c));
+        connections_.fetch_add(1, std::memory_order_relaxed);
+        totalConnections_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void onReadable(Connection& c) {
+        size_t total = 0;
+        while (total < kReadPerWakeup) {
+            const size_t old = c.in.size();
+            c.in.resize(old + kReadChunk);
+            const ssize_t n = ::read(c.fd, &c.in[old], kReadChunk);
+            c.in.resize(old + (n > 0 ? size_t(n) : 0));
+            if (n > 0) {
+                total += size_t(n);
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EINTR)) c.closing = true;   //对端关闭或出错：处理完已读到的再关
+            if (n == 0 || errno != EINTR) break;
+        }
+        bytesRead_.fetch_add(total, std::memory_order_relaxed);
+        process(c);
+    }
+
+    // 处理完后决定：关掉连接，或者按输出积压调整 epoll 关注的事件
+    void settle(Reactor& r, Connection& c) {
+        if (c.paused && c.outBytes == 0) {   //积压发完了，继续解析已经读到的命令
+            c.paused = false;
+            process(c);
+        }
+        if (c.closing && c.out.empty()) {
+            ::epoll_ctl(r.epfd, EPOLL_CTL_DEL, c.fd, nullptr);
+            ::close(c.fd);
+            connections_.fetch_sub(1, std::memory_order_relaxed);
+            r.conns.erase(c.fd);
+            return;
+        }
+        const uint32_t want = (c.paused || c.closing ? 0u : uint32_t(EPOLLIN)) | (c.out.empty() ? 0u : uint32_t(EPOLLOUT));
+        if (want != c.events) {
+            epoll_event ev{};
+            ev.events = want;
+            ev.data.u64 = tag(kConn, c.fd);
+            ::epoll_ctl(r.epfd, EPOLL_CTL_MOD, c.fd, &ev);
+            c.events = want;
+        }
+    }
+
+    // 把输出队列尽量发出去：一次 writev 最多 kMaxIov 块
+    void flush(Connection& c) {
+        while (!c.out.empty()) {
+            iovec iov[kMaxIov];
+            int n = 0;
+            for (auto it = c.out.begin(); it != c.out.end() && n < kMaxIov; ++it, ++n) {
+                iov[n].iov_base = const_cast<char*>(it->data());
+                iov[n].iov_len = it->size();
+            }
+            const ssize_t w = ::writev(c.fd, iov, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN) {
+                    c.closing = true;
+                    c.out.clear();
+                    c.outBytes = 0;
+                }
+                return;
+            }
+            bytesWritten_.fetch_add(size_t(w), std::memory_order_relaxed);
+            c.outBytes -= size_t(w);
+            for (size_t left = size_t(w); left > 0;) {
+                OutChunk& front = c.out.front();
+                const size_t s = std::min(left, front.size());
+                front.sent += s;
+                left -= s;
+                if (front.size() == 0) c.out.pop_front();
+            }
+        }
+    }
+
+    // ---- 输出 ----
+    void reply(Connection& c, std::string_view s) {
+        if (c.out.empty() || c.out.back().item || c.out.back().text.size() > kReadChunk) c.out.emplace_back();
+        c.out.back().text.append(s.data(), s.size());
+        c.outBytes += s.size();
+    }
+
+    void replyItem(Connection& c, const MemcacheValue& item, size_t begin, size_t end) {
+        OutChunk chunk;
+        chunk.item = item;
+        chunk.begin = begin;
+        chunk.end = end;
+        c.out.push_back(std::move(chunk));
+        c.outBytes += end - begin;
+    }
+
+    // ---- 解析：一次处理缓冲里所有完整的命令 ----
+    void process(Connection& c) {
+        while (!c.paused && !(c.closing && c.inPos >= c.in.size())) {
+            if (c.swallow > 0) {   //超长数据块边收边丢，不在缓冲里攒
+                const size_t drop = std::min(c.swallow, c.in.size() - c.inPos);
+                c.inPos += drop;
+                c.swallow -= drop;
+                if (c.swallow > 0) break;
+            }
+            const char* begin = c.in.data() + c.inPos;
+            const size_t avail = c.in.size() - c.inPos;
+            const void* nl = std::memchr(begin, '\n', avail);
+            if (!nl) {
+                if (avail > kMaxLine) {
+                    reply(c, "CLIENT_ERROR line too long\r\n");
+                    c.closing = true;
+                    c.inPos = c.in.size();
+                }
+                break;
+            }
+            const size_t lineLen = static_cast<const char*>(nl) - begin;
+            std::string_view line(begin, lineLen);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            const size_t consumed = execute(c, line, lineLen + 1);
+            if (consumed == 0) break;   //存储命令的数据块还没收全
+            if (consumed == kAbort) {
+                c.closing = true;
+                c.inPos = c.in.size();
+                break;
+            }
+            c.inPos += consumed;
+            if (c.outBytes > options_.maxOutputBytes) c.paused = true;
+        }
+        if (c.inPos == c.in.size()) {
+            c.in.clear();
+            c.inPos = 0;
+        } else if (c.inPos > c.in.size() / 2) {
+            c.in.erase(0, c.inPos);
+            c.inPos = 0;
+        }
+        flush(c);
+    }
+
+    static size_t split(std::string_view line, std::string_view* tokens, size_t max) {
+        size_t n = 0;
+        size_t i = 0;
+        while (i < line.size() && n < max) {
+            while (i < line.size() && line[i] == ' ') ++i;
+            if (i == line.size()) break;
+            const size_t j = std::min(line.find(' ', i), line.size());
+            tokens[n++] = line.substr(i, j - i);
+            i = j;
+        }
+        return n;
+    }
+
+    template<typename T>
+    static bool parseNum(std::string_view s, T& out) {
+        if (s.empty()) return false;
+        auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+        return r.ec == std::errc() && r.ptr == s.data() + s.size();
+    }
+
+    static bool validKey(std::string_view key) {
+        if (key.empty() || key.size() > kMaxKey) return false;
+        for (char ch : key) if (static_cast<unsigned char>(ch) <= ' ' || ch == 0x7f) return false;
+        return true;
+    }
+
+    static int64_t now() { return static_cast<int64_t>(std::time(nullptr)); }
+
+    // memcached 的 exptime：0 不过期；负数立即过期；≤30 天为相对秒数，否则为 unix 时间戳
+    static int64_t expiryOf(int64_t exptime) {
+        if (exptime == 0) return 0;
+        if (exptime < 0) return 1;
+        return exptime <= kRelativeLimit ? now() + exptime : exptime;
+    }
+
+    MemcacheValue makeItem(std::string_view key, uint32_t flags, int64_t expiresAt, std::string_view data) {
+        auto item = std::make_shared<MemcacheItem>();
+        std::string& w = item->wire;
+        w.reserve(key.size() + data.size() + 40);
+        w.append("VALUE ").append(key.data(), key.size()).append(" ");
+        w.append(std::to_string(flags)).append(" ").append(std::to_string(data.size()));
+        item->headerLen = w.size();
+        w.append("\r\n").append(data.data(), data.size()).append("\r\n");
+        item->flags = flags;
+        item->expiresAt = expiresAt;
+        item->cas = nextCas_.fetch_add(1, std::memory_order_relaxed);
+        return item;
+    }
+
+    // 执行一条命令，返回消耗的字节数；0 表示还要等数据，kAbort 表示要断开连接
+    size_t execute(Connection& c, std::string_view line, size_t lineBytes) {
+        std::string_view t[24];
+        const size_t n = split(line, t, 24);
+        if (n == 0) {
+            reply(c, "ERROR\r\n");
+            return lineBytes;
+        }
+        const std::string_view cmd = t[0];
+        if (cmd == "get" || cmd == "gets") {
+            //key 个数只受 kMaxLine 约束，不走上面 24 个的定长切分
+            const size_t rest = size_t(cmd.data() + cmd.size() - line.data());
+            doGet(c, line.substr(rest), cmd == "gets");
+            return lineBytes;
+        }
+        if (cmd == "set" || cmd == "add" || cmd == "replace" || cmd == "append" || cmd == "prepend" || cmd == "cas") {
+            return doStore(c, cmd, t, n, lineBytes);
+        }
+        if (cmd == "delete") {
+            cmdDelete_.fetch_add(1, std::memory_order_relaxed);
+            if (n < 2 || n > 3 || !validKey(t[1])) return badFormat(c, lineBytes);
+            const bool noreply = n == 3 && t[2] == "noreply";
+            bool deleted = false;
+            const int64_t ts = now();
+            cache_.compute(std::string(t[1]), [&](const MemcacheValue* cur) -> std::optional<MemcacheValue> {
+                deleted = cur && *cur && !(*cur)->expired(ts);
+                return std::nullopt;
+            });
+            if (!noreply) reply(c, deleted ? "DELETED\r\n" : "NOT_FOUND\r\n");
+            return lineBytes;
+        }
+        cmdOther_.fetch_add(1, std::memory_order_relaxed);
+        if (cmd == "incr" || cmd == "decr") {
+            uint64_t delta;
+            if (n < 3 || n > 4 || !validKey(t[1]) || !parseNum(t[2], delta)) return badFormat(c, lineBytes);
+            doArith(c, t[1], cmd == "incr", delta, n == 4 && t[3] == "noreply");
+            return lineBytes;
+        }
+        if (cmd == "touch") {
+            int64_t exptime;
+            if (n < 3 || n > 4 || !validKey(t[1]) || !parseNum(t[2], exptime)) return badFormat(c, lineBytes);
+            const bool noreply = n == 4 && t[3] == "noreply";
+            bool touched = false;
+            const int64_t ts = now();
+            cache_.compute(std::string(t[1]), [&](const MemcacheValue* cur) -> std::optional<MemcacheValue> {
+                if (!cur || !*cur || (*cur)->expired(ts)) return std::nullopt;
+                touched = true;
+                auto item = std::make_shared<MemcacheItem>(**cur);
+                item->expiresAt = expiryOf(exptime);
+                return MemcacheValue(std::move(item));
+            });
+            if (!noreply) reply(c, touched ? "TOUCHED\r\n" : "NOT_FOUND\r\n");
+            return lineBytes;
+        }
+        if (cmd == "flush_all") {
+            cache_.invalidateAll();
+            if (!(n >= 2 && t[n - 1] == "noreply")) reply(c, "OK\r\n");
+            return lineBytes;
+        }
+        if (cmd == "stats") {
+            doStats(c);
+            return lineBytes;
+        }
+        if (cmd == "version") {
+            reply(c, "VERSION 1.6.0-cachesystem\r\n");
+            return lineBytes;
+        }
+        if (cmd == "verbosity") {
+            if (!(n >= 2 && t[n - 1] == "noreply")) reply(c, "OK\r\n");
+            return lineBytes;
+        }
+        if (cmd == "quit") return kAbort;   //quit 之后的命令不再处理
+        reply(c, "ERROR\r\n");
+        return lineBytes;
+    }
+
+    size_t badFormat(Connection& c, size_t lineBytes) {
+        reply(c, "CLIENT_ERROR bad command line format\r\n");
+        return lineBytes;
+    }
+
+    void doGet(Connection& c, std::string_view rest, bool withCas) {
+        std::vector<std::string_view>& keys = c.keys;
+        keys.clear();
+        for (size_t i = 0; i < rest.size();) {
+            while (i < rest.size() && rest[i] == ' ') ++i;
+            if (i == rest.size()) break;
+            const size_t j = std::min(rest.find(' ', i), rest.size());
+            keys.push_back(rest.substr(i, j - i));
+            i = j;
+        }
+        //先整体校验：出错时只回 CLIENT_ERROR，不能夹在已排队的 VALUE 后面
+        for (std::string_view k : keys) {
+            if (!validKey(k)) {
+                reply(c, "CLIENT_ERROR bad command line format\r\n");
+                return;
+            }
+        }
+        const int64_t ts = now();
+        for (std::string_view k : keys) {
+            cmdGet_.fetch_add(1, std::memory_order_relaxed);
+            MemcacheValue item;
+            std::string key(k);
+            if (!cache_.get(key, item) || !item) continue;
+            if (item->expired(ts)) {
+                cache_.compute(std::move(key), [&](const MemcacheValue* cur) -> std::optional<MemcacheValue> {
+                    if (cur && *cur && !(*cur)->expired(ts)) return *cur;   //期间被重新写入了，保留
+                    return std::nullopt;
+                });
+                continue;
+            }
+            getHits_.fetch_add(1, std::memory_order_relaxed);
+            if (!withCas) {
+                replyItem(c, item, 0, item->wire.size());
+            } else {
+                replyItem(c, item, 0, item->headerLen);
+                reply(c, " " + std::to_string(item->cas));
+                replyItem(c, item, item->headerLen, item->wire.size());
+            }
+        }
+        reply(c, "END\r\n");
+    }
+
+    // <cmd> <key> <flags> <exptime> <bytes> [cas] [noreply]\r\n<data>\r\n
+    size_t doStore(Connection& c, std::string_view cmd, const std::string_view* t, size_t n, size_t lineBytes) {
+        cmdSet_.fetch_add(1, std::memory_order_relaxed);
+        const bool isCas = cmd == "cas";
+        const size_t fixed = isCas ? 6 : 5;
+        uint32_t flags;
+        int64_t exptime;
+        size_t bytes;
+        uint64_t casIn = 0;
+        if (n < fixed || n > fixed + 1 || !parseNum(t[2], flags) || !parseNum(t[3], exptime) || !parseNum(t[4], bytes)
+            || (isCas && !parseNum(t[5], casIn))) {
+            badFormat(c, lineBytes);
+            return kAbort;   //数据块长度不可信，无法再和客户端对齐
+        }
+        const bool noreply = n == fixed + 1 && t[fixed] == "noreply";
+        if (bytes > SIZE_MAX - 2 - lineBytes) {
+            badFormat(c, lineBytes);
+            return kAbort;
+        }
+        // 只看命令行就拒绝：不等数据块收全，之后到达的数据块直接丢弃
+        if (bytes > options_.maxItemBytes) {
+            if (!noreply) reply(c, "SERVER_ERROR object too large for cache\r\n");
+            c.swallow = bytes + 2;
+            return lineBytes;
+        }
+        if (c.in.size() - c.inPos < lineBytes + bytes + 2) return 0;
+        const char* data = c.in.data() + c.inPos + lineBytes;
+        const size_t total = lineBytes + bytes + 2;
+        if (data[bytes] != '\r' || data[bytes + 1] != '\n') {
+            reply(c, "CLIENT_ERROR bad data chunk\r\n");
+            return kAbort;
+        }
+        if (!validKey(t[1])) return badFormat(c, total);
+        const std::string_view key = t[1];
+        const std::string_view value(data, bytes);
+        const int64_t expiresAt = expiryOf(exptime);
+        if (cmd == "set") {
+            cache_.put(std::string(key), makeItem(key, flags, expiresAt, value));
+            if (!noreply) reply(c, "STORED\r\n");
+            return total;
+        }
+        const int64_t ts = now();
+        const char* result = "NOT_STORED\r\n";
+        cache_.compute(std::string(key), [&](const MemcacheValue* cur) -> std::optional<MemcacheValue> {
+            const bool live = cur && *cur && !(*cur)->expired(ts);
+            if (cmd == "add") {
+                if (live) return *cur;
+            } else if (cmd == "cas") {
+                if (!live) {
+                    result = "NOT_FOUND\r\n";
+                    return std::nullopt;
+                }
+                if ((*cur)->cas != casIn) {
+                    result = "EXISTS\r\n";
+                    return *cur;
+                }
+            } else if (!live) {   //replace / append / prepend 要求已存在
+                return std::nullopt;
+            }
+            result = "STORED\r\n";
+            if (cmd == "append" || cmd == "prepend") {
+                const std::string_view old = (*cur)->data();
+                std::string joined;
+                joined.reserve(old.size() + value.size());
+                if (cmd == "append") joined.append(old).append(value);
+                else joined.append(value).append(old);
+                return makeItem(key, (*cur)->flags, (*cur)->expiresAt, joined);
+            }
+            return makeItem(key, flags, expiresAt, value);
+        });
+        if (!noreply) reply(c, result);
+        return total;
+    }
+
+    void doArith(Connection& c, std::string_view key, bool incr, uint64_t delta, bool noreply) {
+        const int64_t ts = now();
+        std::string out = "NOT_FOUND\r\n";
+        cache_.compute(std::string(key), [&](const MemcacheValue* cur) -> std::optional<MemcacheValue> {
+            if (!cur || !*cur || (*cur)->expired(ts)) return std::nullopt;
+            uint64_t v;
+            if (!parseNum((*cur)->data(), v)) {
+                out = "CLIENT_ERROR cannot increment or decrement non-numeric value\r\n";
+                return *cur;
+            }
+            v = incr ? v + delta : (v > delta ? v - delta : 0);   //incr 按 64 位回绕，decr 到 0 为止
+            const std::string s = std::to_string(v);
+            out = s + "\r\n";
+            return makeItem(key, (*cur)->flags, (*cur)->expiresAt, s);
+        });
+        if (!noreply) reply(c, out);
+    }
+
+    void doStats(Connection& c) {
+        const MemcacheServerStats s = stats();
+        const MemoryUsage m = cache_.memoryUsage();
+        std::string r;
+        auto stat = [&](const char* name, uint64_t v) {
+            r.append("STAT ").append(name).append(" ").append(std::to_string(v)).append("\r\n");
+        };
+        stat("pid", uint64_t(::getpid()));
+        stat("curr_connections", s.connections);
+        stat("total_connections", s.totalConnections);
+        stat("cmd_get", s.cmdGet);
+        stat("get_hits", s.getHits);
+        stat("get_misses", s.getMisses);
+        stat("cmd_set", s.cmdSet);
+        stat("cmd_delete", s.cmdDelete);
+        stat("bytes_read", s.bytesRead);
+        stat("bytes_written", s.bytesWritten);
+        stat("curr_items", m.entries);
+        stat("bytes", m.total());
+        stat("threads", reactors_.size());
+        r.append("END\r\n");
+        reply(c, r);
+    }
+
+private:
+    Cache&                                 cache_;
+    MemcacheServerOptions                  options_;
+    std::vector<int>                       listeners_;
+    std::vector<std::unique_ptr<Reactor>>  reactors_;
+    std::atomic<bool>                      stopping_{false};
+    bool                                   running_ = false;
+    bool                                   unixBound_ = false;
+    int                                    port_ = -1;
+    int                                    error_ = 0;
+    std::atomic<uint64_t>                  nextCas_{1};
+
+    std::atomic<uint64_t> connections_{0}, totalConnections_{0};
+    std::atomic<uint64_t> cmdGet_{0}, getHits_{0}, cmdSet_{0}, cmdDelete_{0}, cmdOther_{0};
+    std::atomic<uint64_t> bytesRead_{0}, bytesWritten_{0};
+};
+
+} // namespace CacheSystem
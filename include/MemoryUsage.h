@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+/*  MemoryUsage.h
+    各策略 memoryUsage() 返回的内存明细，以及估算用的辅助函数。
+    估算口径（以 libstdc++ + glibc malloc 为准）：
+    - 每次堆分配按 malloc 的 chunk 大小计（8B 头 + 16B 对齐，最小 32B）；
+    - make_shared 的节点多一个 16B 控制块（vptr + use/weak 计数）；
+    - unordered_map = 桶数组 + 每元素一个哈希节点（非整数 key 额外缓存 hash 值）。
+    结构大小都由 size()/bucket_count() O(1) 得到；string 之类 key/value 的堆上字节在增删改时增量维护，
+    所以调用 memoryUsage() 不需要遍历缓存。
+*/
+
+namespace CacheSystem {
+
+struct MemoryUsage {
+    size_t entries  = 0;  // 真实缓存条目数
+    size_t index    = 0;  // key → 节点 的哈希索引（桶数组 + 哈希节点 + 其中 key 的堆上数据）
+    size_t nodes    = 0;  // 链表节点、shared_ptr 控制块、哨兵节点（不含 value 本身）
+    size_t values   = 0;  // value 本身及其堆上数据
+    size_t metadata = 0;  // ghost / history / 频率链表 / 暂存区等非条目数据
+
+    size_t total() const { return index + nodes + values + metadata; }
+    double bytesPerEntry() const { return entries ? double(total()) / double(entries) : 0.0; }
+
+    MemoryUsage& operator+=(const MemoryUsage& o) {
+        entries += o.entries; index += o.index; nodes += o.nodes;
+        values += o.values; metadata += o.metadata;
+        return *this;
+    }
+};
+
+// 一次 malloc(n) 实际占用的字节
+constexpr size_t mallocBytes(size_t n) {
+    return n + 8 <= 32 ? 32 : (n + 8 + 15) & ~size_t(15);
+}
+
+// make_shared<T> 的一次分配（对象 + 控制块）
+template<typename T>
+constexpr size_t sharedNodeBytes() { return mallocBytes(sizeof(T) + 16); }
+
+// std::list<T> 的一个节点
+template<typename T>
+constexpr size_t listNodeBytes() { return mallocBytes(2 * sizeof(void*) + sizeof(T)); }
+
+// unordered_map 的一个哈希节点
+template<typename Map>
+constexpr size_t hashNodeBytes() {
+    return mallocBytes(sizeof(void*) + sizeof(typename Map::value_type)
+                       + (std::is_integral<typename Map::key_type>::value ? 0 : sizeof(size_t)));
+}
+
+// unordered_map 的桶数组 + 全部哈希节点（不含 key/value 的堆上数据）
+template<typename Map>
+size_t hashIndexBytes(const Map& m) {
+    return m.bucket_count() * sizeof(void*) + m.size() * hashNodeBytes<Map>();
+}
+
+// 对象在自身 sizeof 之外占用的堆内存；默认 0，可为自定义类型特化
+template<typename T, typename = void>
+struct HeapBytes {
+    static size_t of(const T&) { return 0; }
+};
+
+template<>
+struct HeapBytes<std::string> {
+    static size_t of(const std::string& s) {
+        const char* p = s.data();
+        const char* self = reinterpret_cast<const char*>(&s);
+        if (p >= self && p < self + sizeof(std::string)) return 0; // SSO，数据就在对象内部
+        return mallocBytes(s.capacity() + 1);
+    }
+};
+
+template<typename T>
+size_t heapBytesOf(const T& v) { return HeapBytes<T>::of(v); }
+
+} // namespace CacheSystem
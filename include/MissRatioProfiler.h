@@ -0,0 +1,402 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+#include "HashMix.h"
+
+/*  MissRatioProfiler.h
+    在线估算缺失率曲线（容量 → 缺失率），回答“容量翻倍有没有用”。做法是 SHARDS（空间哈希采样）：
+    - key 的 hash 落在 [0, T) 里（共 2^24 份）才采样，采样率 R = T / 2^24；同一个 key 要么每次都采、要么从不采，
+      所以采样子集上的复用距离按 1/R 放大就是全量上的估计；没采中的访问只多算一次 hash；
+    - LRU：对采样到的访问算栈距离（上次访问之后访问过的不同 key 数）。每个 key 记上次访问的时间戳，
+      树状数组按时间戳标记 “最近一次访问”，距离 = 上次时间戳之后的标记数；时间戳用完时按顺序重新编号。
+      距离 ×1/R 落进直方图，容量 c 的命中数 = 距离 < c 的访问数。一次访问 O(log n)，n 为采样到的 key 数；
+    - 固定样本量（maxSampleKeys > 0）：采到的 key 超过上限时把阈值 T 降到当前最大的采样值，
+      淘汰采样值 ≥ T 的 key，直方图按 R_new / R_old 缩放，内存与访问的 key 总数无关；
+    - 偏差修正（SHARDS_adj）：样本里混进一个极热的 key 会让采样到的访问数远离 总访问数×R，整条曲线随之偏移；
+      按总访问数算出 “应有” 的采样访问数，差值记在距离 0 上（命中），曲线和缩小模拟都做这个修正。
+      总访问数用按线程分条的计数器累加，不会让每次访问都去写同一条 cache line；
+    - 其他策略（LFU / ARC……）没有栈性质，用缩小的模拟（mini-simulation）：对每个要看的容量 c，
+      建一个容量为 c·R 的同策略缓存，只喂采样到的 key，直接数命中率；阈值下调时按新采样率调小容量。
+      c·R 不足几十条时模拟本身就不准，要看的容量越小，采样率要越高。
+      每个模拟点在每次采样到的访问上多一次 get（未命中再加一次 put），点数 × 采样率决定这部分开销。
+    采样路径在一把锁内执行，只占采样率那么多的访问。曲线是启动（或 reset）以来的累计值，
+    负载变化后可以定期 decay() 让旧数据的权重逐步减小。
+    ProfiledCache 把它挂到任意 CachePolicy 上：各操作照常转发，查找类操作顺带把 key 交给 profiler。
+*/
+
+namespace CacheSystem {
+
+struct ShardsOptions {
+    double sampleRate    = 0.01;     //初始采样率
+    size_t maxSampleKeys = 8192;     //采样 key 数上限（超过就下调采样率），0 表示固定采样率
+    size_t maxCapacity   = 1 << 20;  //LRU 曲线覆盖的最大容量（条目数）
+    size_t bins          = 1024;     //LRU 直方图的桶数：分辨率 = maxCapacity / bins
+};
+
+struct MissRatioPoint {
+    size_t capacity  = 0;
+    double missRatio = 1.0;
+};
+
+struct ShardsStats {
+    double   sampleRate  = 0;    //当前采样率
+    uint64_t sampledRefs = 0;    //采样到的访问次数
+    size_t   sampledKeys = 0;    //当前跟踪的 key 数
+};
+
+template<typename Key, typename Hasher = std::hash<Key>>
+class ShardsProfiler {
+public:
+    // 缩小模拟用的缓存：value 只是个占位
+    using MakeSimulation = std::function<std::unique_ptr<CachePolicy<Key, bool>>(int capacity)>;
+
+    explicit ShardsProfiler(ShardsOptions options = ShardsOptions())
+        : options_(options)
+        , threshold_(static_cast<uint32_t>(std::clamp(options.sampleRate, 1.0 / kModulus, 1.0) * kModulus))
+        , binWidth_(std::max<size_t>(1, (options.maxCapacity + std::max<size_t>(1, options.bins) - 1) / std::max<size_t>(1, options.bins)))
+        , hist_(std::max<size_t>(1, options.bins), 0.0) {
+        resetTimestamps(kMinTimestamps);
+    }
+
+    // 每次查找调用；没采中时只算一次 hash、加一次本线程的计数
+    void access(const Key& key) {
+        refs_[refSlot()].value.fetch_add(1, std::memory_order_relaxed);
+        const uint32_t v = sampleValue(key);
+        if (v >= threshold_.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (v >= threshold_.load(std::memory_order_relaxed)) return;
+        recordNoLock(key, v);
+    }
+
+    // 对 capacities 里的每个容量跑一份缩小模拟，之后可用 simulatedCurve(name) 取曲线
+    void addSimulation(const std::string& name, MakeSimulation make, std::vector<size_t> capacities) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Simulation sim;
+        sim.make = std::move(make);
+        for (size_t c : capacities) {
+            MiniCache m;
+            m.capacity = c;
+            m.cache = sim.make(scaledCapacity(c));
+            sim.caches.push_back(std::move(m));
+        }
+        sims_[name] = std::move(sim);
+    }
+
+    // LRU 缺失率曲线：距离 < c 的访问命中，首次访问和超出 maxCapacity 的距离都算缺失
+    std::vector<MissRatioPoint> lruCurve(const std::vector<size_t>& capacities) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<MissRatioPoint> out;
+        const double measured = totalNoLock();
+        const double adjust = adjustmentNoLock(measured);
+        const double total = measured + adjust;
+        for (size_t c : capacities) {
+            const double hits = hitsBelowNoLock(c) + adjust;
+            out.push_back(MissRatioPoint{c, total > 0 ? std::clamp(1.0 - hits / total, 0.0, 1.0) : 1.0});
+        }
+        return out;
+    }
+
+    // 默认取 points 个等距容量
+    std::vector<MissRatioPoint> lruCurve(size_t points = 16) const {
+        std::vector<size_t> capacities;
+        for (size_t i = 1; i <= points; ++i) capacities.push_back(options_.maxCapacity * i / points);
+        return lruCurve(capacities);
+    }
+
+    std::vector<MissRatioPoint> simulatedCurve(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<MissRatioPoint> out;
+        auto it = sims_.find(name);
+        if (it == sims_.end()) return out;
+        for (const auto& m : it->second.caches) {
+            const double adjust = adjustmentNoLock(m.refs);
+            const double refs = m.refs + adjust;
+            out.push_back(MissRatioPoint{m.capacity, refs > 0 ? std::clamp(1.0 - (m.hits + adjust) / refs, 0.0, 1.0) : 1.0});
+        }
+        return out;
+    }
+
+    // 已有统计乘以 factor（0..1），让曲线偏向最近的访问；采样的 key 和模拟缓存的内容保留
+    void decay(double factor) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scaleNoLock(factor);
+        const uint64_t n = totalRefs();
+        decayedRefs_ = (decayedRefs_ + double(n - refsMark_)) * factor;
+        refsMark_ = n;
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        scaleNoLock(0.0);
+        decayedRefs_ = 0;
+        refsMark_ = totalRefs();
+        last_.clear();
+        byValue_.clear();
+        resetTimestamps(kMinTimestamps);
+        for (auto& kv : sims_) {
+            for (auto& m : kv.second.caches) m.cache = kv.second.make(scaledCapacity(m.capacity));
+        }
+    }
+
+    ShardsStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ShardsStats s;
+        s.sampleRate  = rateNoLock();
+        s.sampledRefs = sampledRefs_;
+        s.sampledKeys = last_.size();
+        return s;
+    }
+
+private:
+    static constexpr uint32_t kModulus       = 1u << 24;
+    static constexpr size_t   kMinTimestamps = 1024;
+
+    static constexpr size_t   kRefSlots      = 16;
+
+    struct alignas(64) RefSlot {
+        std::atomic<uint64_t> value{0};
+    };
+
+    struct Sampled {
+        uint64_t stamp;
+        uint32_t value;
+    };
+
+    struct MiniCache {
+        size_t                                   capacity = 0;
+        std::unique_ptr<CachePolicy<Key, bool>>  cache;
+        double                                   hits = 0;
+        double                                   refs = 0;
+    };
+
+    struct Simulation {
+        MakeSimulation         make;
+        std::vector<MiniCache> caches;
+    };
+
+    static uint32_t sampleValue(const Key& key) {
+        return static_cast<uint32_t>(fmix64(Hasher{}(key)) >> 40);   //高 24 位
+    }
+
+    static size_t refSlot() {
+        static thread_local const size_t slot = std::hash<std::thread::id>{}(std::this_thread::get_id()) % kRefSlots;
+        return slot;
+    }
+    uint64_t totalRefs() const {
+        uint64_t n = 0;
+        for (const auto& r : refs_) n += r.value.load(std::memory_order_relaxed);
+        return n;
+    }
+    // 应有的采样访问数（总访问数 × 当前采样率）减去实际记下的；加到距离 0 上
+    double adjustmentNoLock(double measured) const {
+        const double refs = decayedRefs_ + double(totalRefs() - refsMark_);
+        return refs * rateNoLock() - measured;
+    }
+
+    double rateNoLock() const { return double(threshold_.load(std::memory_order_relaxed)) / kModulus; }
+    int scaledCapacity(size_t capacity) const {
+        return std::max(1, static_cast<int>(std::lround(double(capacity) * rateNoLock())));
+    }
+
+    void recordNoLock(const Key& key, uint32_t v) {
+        ++sampledRefs_;
+        for (auto& kv : sims_) {
+            for (auto& m : kv.second.caches) {
+                bool dummy = false;
+                m.refs += 1;
+                if (m.cache->get(key, dummy)) m.hits += 1;
+                else m.cache->put(key, true);
+            }
+        }
+
+        if (clock_ + 1 >= tree_.size()) compactTimestamps();
+        const uint64_t now = ++clock_;
+        auto it = last_.find(key);
+        if (it == last_.end()) {
+            cold_ += 1;
+            last_.emplace(key, Sampled{now, v});
+            byValue_.emplace(v, key);
+            add(now, 1);
+            if (options_.maxSampleKeys > 0 && last_.size() > options_.maxSampleKeys) lowerThresholdNoLock();
+            return;
+        }
+        const uint64_t prev = it->second.stamp;
+        const uint64_t distance = prefix(now - 1) - prefix(prev);   //prev 之后访问过的不同 key
+        add(prev, -1);
+        add(now, 1);
+        it->second.stamp = now;
+        const double scaled = double(distance) / rateNoLock();
+        const size_t bin = static_cast<size_t>(scaled / double(binWidth_));
+        if (bin < hist_.size()) hist_[bin] += 1;
+        else overflow_ += 1;
+    }
+
+    // 采样值最大的那些 key 退出样本，阈值降到它们的采样值，已有统计按新旧采样率之比缩放
+    void lowerThresholdNoLock() {
+        const double oldRate = rateNoLock();
+        const uint32_t top = byValue_.rbegin()->first;
+        auto range = byValue_.equal_range(top);
+        for (auto it = range.first; it != range.second; ++it) {
+            auto s = last_.find(it->second);
+            add(s->second.stamp, -1);
+            last_.erase(s);
+            //模拟缓存里也删掉，否则 LFU 这类不按时间老化的策略会一直留着它们占位
+            for (auto& kv : sims_) {
+                for (auto& m : kv.second.caches) m.cache->remove(it->second);
+            }
+        }
+        byValue_.erase(range.first, range.second);
+        threshold_.store(top, std::memory_order_relaxed);
+        scaleNoLock(rateNoLock() / oldRate);
+        for (auto& kv : sims_) {
+            for (auto& m : kv.second.caches) m.cache->setCapacity(scaledCapacity(m.capacity));
+        }
+    }
+
+    void scaleNoLock(double factor) {
+        for (auto& h : hist_) h *= factor;
+        overflow_ *= factor;
+        cold_ *= factor;
+        for (auto& kv : sims_) {
+            for (auto& m : kv.second.caches) {
+                m.hits *= factor;
+                m.refs *= factor;
+            }
+        }
+    }
+
+    double totalNoLock() const {
+        double total = cold_ + overflow_;
+        for (double h : hist_) total += h;
+        return total;
+    }
+
+    // 距离 < capacity 的访问数；capacity 落在桶中间时按桶内均匀分布折算
+    double hitsBelowNoLock(size_t capacity) const {
+        double hits = 0;
+        for (size_t b = 0; b < hist_.size(); ++b) {
+            const size_t lo = b * binWidth_;
+            if (lo >= capacity) break;
+            const size_t hi = lo + binWidth_;
+            hits += hi <= capacity ? hist_[b] : hist_[b] * double(capacity - lo) / double(binWidth_);
+        }
+        return hits;
+    }
+
+    // 树状数组：下标是时间戳（从 1 开始），值为 1 表示某个 key 的最近一次访问发生在这一刻
+    void add(uint64_t i, int delta) {
+        for (; i < tree_.size(); i += i & (~i + 1)) tree_[i] += delta;
+    }
+    int64_t prefix(uint64_t i) const {
+        int64_t s = 0;
+        for (; i > 0; i -= i & (~i + 1)) s += tree_[i];
+        return s;
+    }
+
+    void resetTimestamps(size_t size) {
+        tree_.assign(size, 0);
+        clock_ = 0;
+    }
+
+    // 时间戳用完：按先后顺序重新编号成 1..n，树的大小取 n 的 4 倍，摊还 O(log n)
+    void compactTimestamps() {
+        std::vector<std::pair<uint64_t, Sampled*>> order;
+        order.reserve(last_.size());
+        for (auto& kv : last_) order.emplace_back(kv.second.stamp, &kv.second);
+        std::sort(order.begin(), order.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        resetTimestamps(std::max(kMinTimestamps, 4 * order.size() + 2));
+        for (auto& o : order) {
+            o.second->stamp = ++clock_;
+            add(clock_, 1);
+        }
+    }
+
+    ShardsOptions                     options_;
+    std::atomic<uint32_t>             threshold_;   //采样值 < threshold_ 才采样；只在锁内下调
+    size_t                            binWidth_;
+    mutable std::mutex                mutex_;
+
+    std::unordered_map<Key, Sampled, Hasher> last_;      //采样 key → 上次访问时间戳
+    std::multimap<uint32_t, Key>             byValue_;   //按采样值排序，下调阈值时从最大的删
+    std::vector<int64_t>                     tree_;
+    uint64_t                                 clock_ = 0;
+
+    std::vector<double> hist_;          //放大后的栈距离直方图，每桶 binWidth_ 个容量单位
+    double              overflow_ = 0;  //距离 ≥ maxCapacity
+    double              cold_ = 0;      //首次访问
+    uint64_t            sampledRefs_ = 0;
+
+    RefSlot             refs_[kRefSlots];     //总访问数（含没采中的），按线程分条
+    double              decayedRefs_ = 0;     //上次 decay 时衰减后的总访问数
+    uint64_t            refsMark_ = 0;        //上次 decay / reset 时的 totalRefs()
+
+    std::map<std::string, Simulation> sims_;
+};
+
+// 挂上 profiler 的缓存：各操作照常转发，查找（get / compute / putIfAbsent / getOrInsert）记一次访问。
+// put 不记：未命中后的回填紧跟在那次 get 后面，再记一次就成了距离 0 的命中，曲线会整体偏乐观
+template<typename Key, typename Value, typename Hasher = std::hash<Key>>
+class ProfiledCache : public CachePolicy<Key, Value> {
+public:
+    ProfiledCache(std::unique_ptr<CachePolicy<Key, Value>> cache, ShardsOptions options = ShardsOptions())
+        : cache_(std::move(cache)), profiler_(options) {}
+
+    void put(Key key, Value value) override {
+        cache_->put(std::move(key), std::move(value));
+    }
+    bool get(Key key, Value& value) override {
+        profiler_.access(key);
+        return cache_->get(std::move(key), value);
+    }
+    Value get(Key key) override {
+        profiler_.access(key);
+        return cache_->get(std::move(key));
+    }
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        profiler_.access(key);
+        return cache_->compute(std::move(key), fn);
+    }
+    bool putIfAbsent(Key key, Value value) override {
+        profiler_.access(key);
+        return cache_->putIfAbsent(std::move(key), std::move(value));
+    }
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        profiler_.access(key);
+        return cache_->getOrInsert(std::move(key), value, factory);
+    }
+    bool remove(Key key) override { return cache_->remove(std::move(key)); }
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        return cache_->invalidateIf(pred);
+    }
+    void invalidateAll() override { cache_->invalidateAll(); }
+    void setCapacity(size_t capacity) override { cache_->setCapacity(capacity); }
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        cache_->setRemovalListener(std::move(listener), batchSize);
+    }
+    void flushRemovals() override { cache_->flushRemovals(); }
+    MemoryUsage memoryUsage() const override { return cache_->memoryUsage(); }
+
+    ShardsProfiler<Key, Hasher>& profiler() { return profiler_; }
+    CachePolicy<Key, Value>& backing() { return *cache_; }
+
+private:
+    std::unique_ptr<CachePolicy<Key, Value>> cache_;
+    ShardsProfiler<Key, Hasher>              profiler_;
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "HashMix.h"
+#include "MemoryUsage.h"
+#include "RemovalListener.h"
+
+/*  NearCache.h
+    NearCache<Cache>：给任意分片缓存（ShardedCache、HashLruCache……）前面加一层每线程私有的 L1。
+    - L1 是直接映射数组（默认 512 槽），每槽带一个引用位：槽里的 key 被命中过，就先清掉引用位放它一马，
+      不会被一次性的冷 key 立刻挤掉（每槽一个单元素的 CLOCK）；
+    - 失效靠版本号：key 按 hash 落到 1024 个版本条带之一，put / remove / invalidate 写完后端再把条带版本 +1；
+      L1 条目记着填充时读到的版本，命中时版本对不上就当没命中，回后端重读。
+      读者先读版本、再读后端，所以就算和 put 并发，拿到的旧值也一定带着旧版本号，不会在 put 返回后继续被当作命中。
+    L1 命中只读本线程的槽和一个版本条带（只有写这个条带时才会变），最热的那几百个 key 不会碰任何被写的共享 cache line。
+    L1 准入（setL1Admission）：默认后端命中的 key 都填进 L1；设了过滤器就只填过滤器放行的 key，
+    比如只复制热点 key（ShardedCache::enableHotKeyTracking + HotKeyTracker::isHot），让一个爆热的 key 不再压在单个分片上，
+    而其余的 key 不去挤占 L1。
+    代价：L1 里的条目可能已经被后端淘汰，仍会命中（值是对的，只是比后端多留一会儿）；
+          同一条带的其他 key 被写时会误伤失效，条带足够多时可以忽略；
+          L1 归实例所有，线程退出后它那份 L1 要等实例析构才释放；
+          线程这边只记 实例 id → L1 的小表，实例析构后对应的项在下次清理时删掉，不会随创建过的实例数无限增长。
+*/
+
+namespace CacheSystem {
+
+struct NearCacheStats {
+    uint64_t l1Hits   = 0;
+    uint64_t l1Misses = 0;   //回到后端的次数（后端命中与否都算）
+    size_t   threads  = 0;   //已分配 L1 的线程数
+
+    double l1HitRatio() const {
+        const uint64_t n = l1Hits + l1Misses;
+        return n ? double(l1Hits) / double(n) : 0.0;
+    }
+};
+
+template<typename Cache, size_t L1Slots = 512,
+         typename Hasher = std::hash<typename Cache::key_type>>
+class NearCache {
+    static_assert((L1Slots & (L1Slots - 1)) == 0, "L1Slots 必须是 2 的幂");
+public:
+    using key_type    = typename Cache::key_type;
+    using mapped_type = typename Cache::mapped_type;
+    using Key   = key_type;
+    using Value = mapped_type;
+
+    static constexpr size_t kVersionStripes = 1024;
+
+    // 参数原样转给后端缓存的构造函数
+    template<typename... Args>
+    explicit NearCache(Args&&... args)
+        : cache_(std::forward<Args>(args)...)
+        , id_(nextId().fetch_add(1, std::memory_order_relaxed)) {}
+
+    NearCache(const NearCache&) = delete;
+    NearCache& operator=(const NearCache&) = delete;
+
+    void put(Key key, Value value) {
+        const uint64_t h = fmix64(Hasher{}(key));
+        cache_.put(std::move(key), std::move(value));
+        bump(h);   //必须在写完后端之后：读到新版本的读者一定能读到新值
+    }
+
+    bool get(const Key& key, Value& value) {
+        const uint64_t h = fmix64(Hasher{}(key));
+        L1& l1 = localL1();
+        Entry& e = l1.slots[h & (L1Slots - 1)];
+        const uint64_t version = stripe(h).load(std::memory_order_acquire);
+        if (hitL1(l1, e, key, version, value)) return true;
+        if (!cache_.get(key, value)) return false;
+        fillL1(e, key, value, version);
+        return true;
+    }
+
+    Value get(const Key& key) {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    // 写操作都是先写后端、再把条带版本 +1
+    std::optional<Value> compute(const Key& key, const std::function<std::optional<Value>(const Value*)>& fn) {
+        const uint64_t h = fmix64(Hasher{}(key));
+        std::optional<Value> result = cache_.compute(key, fn);
+        bump(h);
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) {
+        const uint64_t h = fmix64(Hasher{}(key));
+        const bool inserted = cache_.putIfAbsent(std::move(key), std::move(value));
+        if (inserted) bump(h);
+        return inserted;
+    }
+
+    // L1 命中直接返回；后端命中时像 get 一样填 L1，插入时像 put 一样失效其他线程的 L1
+    bool getOrInsert(const Key& key, Value& value, const std::function<Value()>& factory) {
+        const uint64_t h = fmix64(Hasher{}(key));
+        L1& l1 = localL1();
+        Entry& e = l1.slots[h & (L1Slots - 1)];
+        const uint64_t version = stripe(h).load(std::memory_order_acquire);
+        if (hitL1(l1, e, key, version, value)) return true;
+        if (cache_.getOrInsert(key, value, factory)) {
+            fillL1(e, key, value, version);
+            return true;
+        }
+        bump(h);
+        return false;
+    }
+
+    bool remove(const Key& key) {
+        const uint64_t h = fmix64(Hasher{}(key));
+        const bool removed = cache_.remove(key);
+        bump(h);
+        return removed;
+    }
+
+    // L1 里可能留着后端已经淘汰的条目，后端的谓词扫描看不到它们，只能整体失效 L1
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) {
+        const size_t n = cache_.invalidateIf(pred);
+        invalidateL1();
+        return n;
+    }
+
+    void invalidateAll() {
+        cache_.invalidateAll();
+        invalidateL1();
+    }
+
+    // 后端被直接改过（绕过 NearCache）时，只让各线程 L1 失效，不动后端
+    void invalidate(const Key& key) { bump(fmix64(Hasher{}(key))); }
+    void invalidateL1() {
+        for (auto& s : versions_) s.value.fetch_add(1, std::memory_order_release);
+    }
+
+    // 后端 + 版本条带 + 各线程 L1；L1 里的条目是后端的副本，不计入 entries
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m = cache_.memoryUsage();
+        std::lock_guard<std::mutex> lock(registryMutex_);
+        m.metadata += sizeof(versions_) + l1s_.size() * mallocBytes(sizeof(L1));
+        return m;
+    }
+
+    void setCapacity(size_t capacity) { cache_.setCapacity(capacity); }
+
+    // 只在还没有线程访问时设置；nullptr 表示全部准入。只影响之后的填充，已在 L1 里的条目照常命中直到被替换
+    void setL1Admission(std::function<bool(const Key&)> admit) { admission_ = std::move(admit); }
+
+    // 通知只来自后端：L1 是后端的副本，被挤出或失效都不算离开缓存
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) { cache_.setRemovalListener(std::move(listener), batchSize); }
+    void flushRemovals() { cache_.flushRemovals(); }
+
+    NearCacheStats stats() const {
+        NearCacheStats s;
+        std::lock_guard<std::mutex> lock(registryMutex_);
+        for (const auto& l1 : l1s_) {
+            s.l1Hits   += l1->hits.load(std::memory_order_relaxed);
+            s.l1Misses += l1->misses.load(std::memory_order_relaxed);
+        }
+        s.threads = l1s_.size();
+        return s;
+    }
+
+    // 后端（reshard / autoTune / tuningReport 等直接调它）
+    Cache& backing() { return cache_; }
+    const Cache& backing() const { return cache_; }
+
+private:
+    struct Entry {
+        Key      key{};
+        Value    value{};
+        uint64_t version = 0;
+        bool     valid = false;
+        bool     referenced = false;
+    };
+
+    // 每线程一份，只有所属线程读写槽；计数器用 relaxed 原子，stats() 才能安全地跨线程读
+    struct alignas(64) L1 {
+        Entry                 slots[L1Slots];
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+    };
+
+    // 每个版本条带独占一条 cache line：写一个条带不会让其他条带的读者失效
+    struct alignas(64) Version {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static std::atomic<uint64_t>& nextId() {
+        static std::atomic<uint64_t> id{1};
+        return id;
+    }
+
+    // hash 先经 fmix64 打散（std::hash<int> 是恒等映射）：低位选 L1 槽，高位选版本条带
+    std::atomic<uint64_t>& stripe(uint64_t h) { return versions_[(h >> 32) & (kVersionStripes - 1)].value; }
+    void bump(uint64_t h) { stripe(h).fetch_add(1, std::memory_order_release); }
+
+    bool hitL1(L1& l1, Entry& e, const Key& key, uint64_t version, Value& value) {
+        if (e.valid && e.version == version && e.key == key) {
+            e.referenced = true;
+            value = e.value;
+            count(l1.hits);
+            return true;
+        }
+        count(l1.misses);
+        return false;
+    }
+
+    // version 必须是读后端之前读到的那个
+    void fillL1(Entry& e, const Key& key, const Value& value, uint64_t version) const {
+        if (admission_ && !admission_(key)) return;
+        if (e.valid && !(e.key == key) && e.referenced) {
+            e.referenced = false;   //常驻的 key 最近被命中过，这次不替换
+        } else {
+            e.key = key;
+            e.value = value;
+            e.version = version;
+            e.valid = true;
+        }
+    }
+
+    // 只有所属线程写，不需要原子读改写
+    static void count(std::atomic<uint64_t>& c) {
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // 快路径：本线程上一次用的就是这个实例；交替使用多个实例时走 findOrCreateL1 的哈希表，也是 O(1)
+    L1& localL1() {
+        thread_local uint64_t lastId = 0;
+        thread_local L1* last = nullptr;
+        if (lastId != id_) {
+            last = &findOrCreateL1();
+            lastId = id_;
+        }
+        return *last;
+    }
+
+    // 线程表：实例 id → 本线程在该实例里的 L1。id 全局唯一不复用，已析构实例留下的悬空指针永远不会被匹配到；
+    // 每项带实例的存活标记（weak_ptr），表长到上次清理后的两倍时把已析构实例的项清掉，
+    // 表的大小跟着本线程用过的存活实例数走，清理均摊到每次插入是 O(1)
+    struct OwnedL1 {
+        std::weak_ptr<void> alive;
+        L1*                 l1;
+    };
+
+    L1& findOrCreateL1() {
+        thread_local std::unordered_map<uint64_t, OwnedL1> owned;
+        thread_local size_t sweepAt = 8;
+        auto it = owned.find(id_);
+        if (it != owned.end()) return *it->second.l1;
+        if (owned.size() >= sweepAt) {
+            for (auto i = owned.begin(); i != owned.end();)
+                i = i->second.alive.expired() ? owned.erase(i) : std::next(i);
+            sweepAt = std::max<size_t>(8, 2 * owned.size());
+        }
+        L1* l1;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            l1s_.push_back(std::make_unique<L1>());
+            l1 = l1s_.back().get();
+        }
+        owned.emplace(id_, OwnedL1{alive_, l1});
+        return *l1;
+    }
+
+private:
+    Cache                            cache_;
+    const uint64_t                   id_;
+    Version                          versions_[kVersionStripes];
+    mutable std::mutex               registryMutex_;   //保护 l1s_
+    std::vector<std::unique_ptr<L1>> l1s_;             //L1 归实例所有，随实例释放
+    std::function<bool(const Key&)>  admission_;       //L1 准入过滤器，空表示全部准入
+    std::shared_ptr<void>            alive_ = std::make_shared<char>(0);   //存活标记：析构后各线程表里的 weak_ptr 过期
+};
+
+} // namespace CacheSystem
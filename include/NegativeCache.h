@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+#include "HashMix.h"
+
+/*  NegativeCache.h
+    负缓存：记住“后端确认没有”的 key，重复查找不存在的 key 时不再回源。
+    - 过滤器：布谷鸟过滤器（每个 key 只存 32 位指纹，每桶 4 个槽，候选两个桶），每个 key 约 4.4 字节；
+      和布隆过滤器不同，它能删掉单个 key —— 写入真实 value 时必须能清掉对应的“不存在”记录；
+    - 误判方向：没被标记过的 key 指纹撞上已标记的，会被误报为“不存在”，这是答错而不只是多回源，
+      所以指纹取 32 位，概率约 8 / 2^32 × 2 代（16 位时约 2.4e-4，实测每几万次查找就错一次）；
+      清除时删掉的是同桶同指纹的一个槽，如果删到的是别的 key，只会让那个 key 多回源一次，不会出错；
+    - 时间衰减：两代过滤器轮换。新标记写入当前代，每过 ttl/2 轮换一次，老的一代整体丢弃，
+      所以一条标记存活 ttl/2 ~ ttl；当前代塞满（踢出次数超限）时提前轮换。查找只读两代，
+      轮换到期但还没有写者来轮换时，按时间直接跳过已过期的代；
+    - 竞态：回源返回“不存在”到写入标记之间，别的线程可能已经写入了这个 key。getOrLoad 回源前记下清除计数，
+      期间有过任何清除就不再写标记（宁可多回源一次），不会留下盖住真实 value 的旧标记。
+    NegativeCache 包在任意 CachePolicy 外面：先查缓存，未命中再查过滤器；所有写入路径都会清掉对应标记，
+    invalidateAll 连过滤器一起清空（后端可能已经变了）。
+*/
+
+namespace CacheSystem {
+
+template<typename Key, typename Hasher = std::hash<Key>>
+class DecayingCuckooFilter {
+public:
+    // expectedKeys：一代过滤器预计要装的 key 数；ttl：一条标记最长存活时间
+    DecayingCuckooFilter(size_t expectedKeys, std::chrono::milliseconds ttl)
+        : half_(std::max<std::chrono::milliseconds>(std::chrono::milliseconds(1), ttl / 2))
+        , rotatedAt_(Clock::now()) {
+        size_t buckets = 1;
+        while (buckets * kSlots * 9 / 10 < std::max<size_t>(1, expectedKeys)) buckets <<= 1;
+        mask_ = buckets - 1;
+        for (auto& t : tables_) t.assign(buckets * kSlots, 0);
+    }
+
+    bool contains(const Key& key) const {
+        const Probe p = probe(key);
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        const auto age = Clock::now() - rotatedAt_;
+        if (age >= 2 * half_) return false;                         //两代都过期了
+        if (find(tables_[cur_], p) != kNone) return true;
+        return age < half_ && find(tables_[cur_ ^ 1], p) != kNone;  //上一代在下一次轮换时过期
+    }
+
+    // 返回 false 表示已经在里面
+    bool insert(const Key& key) {
+        const Probe p = probe(key);
+        std::unique_lock<std::shared_mutex> lk(mu_);
+        rotateIfDue();
+        if (find(tables_[cur_], p) != kNone) return false;
+        if (place(tables_[cur_], p)) return true;
+        rotate();                                                   //当前代满了，提前轮换
+        place(tables_[cur_], p);
+        return true;
+    }
+
+    // 两代里都删一次；返回是否删到了
+    bool erase(const Key& key) {
+        const Probe p = probe(key);
+        std::unique_lock<std::shared_mutex> lk(mu_);
+        bool erased = false;
+        for (auto& t : tables_) {
+            const size_t slot = find(t, p);
+            if (slot != kNone) {
+                t[slot] = 0;
+                erased = true;
+            }
+        }
+        return erased;
+    }
+
+    void clear() {
+        std::unique_lock<std::shared_mutex> lk(mu_);
+        for (auto& t : tables_) std::fill(t.begin(), t.end(), 0);
+        rotatedAt_ = Clock::now();
+    }
+
+    size_t bytes() const { return 2 * (mask_ + 1) * kSlots * sizeof(uint32_t); }
+    uint64_t rotations() const { return rotations_.load(std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kSlots = 4;          //每桶槽数
+    static constexpr int kMaxKicks = 500;
+    static constexpr size_t kNone = SIZE_MAX;
+
+    struct Probe {
+        uint32_t fp;   //非 0，0 表示空槽
+        size_t   b1, b2;
+    };
+
+    // 第二个桶 = 第一个桶 ^ hash(指纹)，只凭指纹和当前桶就能算出另一个桶，踢出时不需要原 key
+    size_t alt(size_t b, uint32_t fp) const { return (b ^ fmix64(fp)) & mask_; }
+
+    Probe probe(const Key& key) const {
+        const uint64_t h = fmix64(static_cast<uint64_t>(Hasher{}(key)));
+        Probe p;
+        p.fp = static_cast<uint32_t>(h >> 32);
+        if (p.fp == 0) p.fp = 1;
+        p.b1 = h & mask_;
+        p.b2 = alt(p.b1, p.fp);
+        return p;
+    }
+
+    size_t find(const std::vector<uint32_t>& t, const Probe& p) const {
+        for (size_t b : {p.b1, p.b2}) {
+            for (size_t s = b * kSlots; s < (b + 1) * kSlots; ++s) {
+                if (t[s] == p.fp) return s;
+            }
+        }
+        return kNone;
+    }
+
+    bool tryBucket(std::vector<uint32_t>& t, size_t b, uint32_t fp) {
+        for (size_t s = b * kSlots; s < (b + 1) * kSlots; ++s) {
+            if (t[s] == 0) {
+                t[s] = fp;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 两个桶都满时随机踢出一个指纹，让它搬去它的另一个桶；踢出次数超限返回 false（最后被踢的指纹丢掉）
+    bool place(std::vector<uint32_t>& t, const Probe& p) {
+        if (tryBucket(t, p.b1, p.fp) || tryBucket(t, p.b2, p.fp)) return true;
+        size_t b = (kick_ & 1) ? p.b1 : p.b2;
+        uint32_t fp = p.fp;
+        for (int n = 0; n < kMaxKicks; ++n) {
+            kick_ = kick_ * 6364136223846793005ULL + 1442695040888963407ULL;
+            const size_t s = b * kSlots + (kick_ >> 62);
+            std::swap(fp, t[s]);
+            b = alt(b, fp);
+            if (tryBucket(t, b, fp)) return true;
+        }
+        return false;
+    }
+
+    void rotateIfDue() {
+        const auto age = Clock::now() - rotatedAt_;
+        if (age >= 2 * half_) {
+            for (auto& t : tables_) std::fill(t.begin(), t.end(), 0);
+            rotatedAt_ = Clock::now();
+            rotations_.fetch_add(1, std::memory_order_relaxed);
+        } else if (age >= half_) {
+            rotate();
+        }
+    }
+
+    // 上一代整体丢弃，当前代变成上一代
+    void rotate() {
+        cur_ ^= 1;
+        std::fill(tables_[cur_].begin(), tables_[cur_].end(), 0);
+        rotatedAt_ = Clock::now();
+        rotations_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::chrono::milliseconds  half_;
+    size_t                     mask_ = 0;
+    std::vector<uint32_t>      tables_[2];   //两代，每代 (mask_+1) 桶 × kSlots 个指纹
+    int                        cur_ = 0;
+    Clock::time_point          rotatedAt_;
+    uint64_t                   kick_ = 0x853c49e6748fea9bULL;
+    std::atomic<uint64_t>      rotations_{0};
+    mutable std::shared_mutex  mu_;
+};
+
+struct NegativeCacheOptions {
+    size_t                    expectedKeys = 1 << 16;                    //一代过滤器的容量
+    std::chrono::milliseconds ttl          = std::chrono::seconds(30);  //“不存在”标记最长存活时间
+};
+
+struct NegativeCacheStats {
+    uint64_t negativeHits = 0;   //由过滤器直接答“不存在”、没有回源的查找
+    uint64_t loads        = 0;   //回源次数
+    uint64_t absentLoads  = 0;   //回源结果为不存在的次数
+    uint64_t marked       = 0;   //新写入的标记
+    uint64_t cleared      = 0;   //写入真实 value 时删掉的标记
+    uint64_t rotations    = 0;
+    size_t   filterBytes  = 0;
+};
+
+template<typename Key, typename Value, typename Hasher = std::hash<Key>>
+class NegativeCache : public CachePolicy<Key, Value> {
+public:
+    enum class Lookup { Hit, Absent, Miss };   //命中 / 已知不存在 / 不知道（需要回源）
+
+    NegativeCache(std::unique_ptr<CachePolicy<Key, Value>> cache, NegativeCacheOptions options = NegativeCacheOptions())
+        : cache_(std::move(cache)), filter_(options.expectedKeys, options.ttl) {}
+
+    Lookup lookup(const Key& key, Value& value) {
+        if (cache_->get(key, value)) return Lookup::Hit;
+        if (!filter_.contains(key)) return Lookup::Miss;
+        negativeHits_.fetch_add(1, std::memory_order_relaxed);
+        return Lookup::Absent;
+    }
+
+    // 读穿透：命中返回 true；已知不存在直接返回 false；否则回源，loader 返回 nullopt 表示后端没有，记下标记
+    bool getOrLoad(const Key& key, Value& value, const std::function<std::optional<Value>()>& loader) {
+        const Lookup r = lookup(key, value);
+        if (r != Lookup::Miss) return r == Lookup::Hit;
+        const uint64_t clears = clears_.load(std::memory_order_acquire);
+        loads_.fetch_add(1, std::memory_order_relaxed);
+        std::optional<Value> loaded = loader();
+        if (!loaded) {
+            absentLoads_.fetch_add(1, std::memory_order_relaxed);
+            markAbsentIfUnchanged(key, clears);
+            return false;
+        }
+        value = *loaded;
+        cache_->putIfAbsent(key, std::move(*loaded));
+        return true;
+    }
+
+    // 调用方自己确认了后端没有这个 key（比如删除了它）
+    void markAbsent(const Key& key) {
+        cache_->remove(key);
+        if (filter_.insert(key)) marked_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool isKnownAbsent(const Key& key) const { return filter_.contains(key); }
+
+    // ---- CachePolicy：写入路径先写缓存再清标记，任何时刻缓存命中都优先于标记 ----
+    void put(Key key, Value value) override {
+        cache_->put(key, std::move(value));
+        clearAbsent(key);
+    }
+    bool get(Key key, Value& value) override { return cache_->get(std::move(key), value); }
+    Value get(Key key) override { return cache_->get(std::move(key)); }
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        std::optional<Value> result = cache_->compute(key, fn);
+        if (result) clearAbsent(key);
+        return result;
+    }
+    bool putIfAbsent(Key key, Value value) override {
+        const bool inserted = cache_->putIfAbsent(key, std::move(value));
+        if (inserted) clearAbsent(key);
+        return inserted;
+    }
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        const bool hit = cache_->getOrInsert(key, value, factory);
+        if (!hit) clearAbsent(key);
+        return hit;
+    }
+    // 只是让缓存里的 value 失效，不代表后端没有，不写标记
+    bool remove(Key key) override { return cache_->remove(std::move(key)); }
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        return cache_->invalidateIf(pred);
+    }
+    void invalidateAll() override {
+        cache_->invalidateAll();
+        clears_.fetch_add(1, std::memory_order_acq_rel);
+        filter_.clear();
+    }
+    void setCapacity(size_t capacity) override { cache_->setCapacity(capacity); }
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        cache_->setRemovalListener(std::move(listener), batchSize);
+    }
+    void flushRemovals() override { cache_->flushRemovals(); }
+    MemoryUsage memoryUsage() const override {
+        MemoryUsage m = cache_->memoryUsage();
+        m.metadata += filter_.bytes();
+        return m;
+    }
+
+    NegativeCacheStats stats() const {
+        NegativeCacheStats s;
+        s.negativeHits = negativeHits_.load(std::memory_order_relaxed);
+        s.loads        = loads_.load(std::memory_order_relaxed);
+        s.absentLoads  = absentLoads_.load(std::memory_order_relaxed);
+        s.marked       = marked_.load(std::memory_order_relaxed);
+        s.cleared      = cleared_.load(std::memory_order_relaxed);
+        s.rotations    = filter_.rotations();
+        s.filterBytes  = filter_.bytes();
+        return s;
+    }
+
+    CachePolicy<Key, Value>& backing() { return *cache_; }
+
+private:
+    void clearAbsent(const Key& key) {
+        clears_.fetch_add(1, std::memory_order_acq_rel);
+        if (filter_.erase(key)) cleared_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 回源期间没有过任何清除才写标记；写完再查一次，清除恰好夹在中间时撤掉自己写的标记
+    void markAbsentIfUnchanged(const Key& key, uint64_t clears) {
+        if (clears_.load(std::memory_order_acquire) != clears) return;
+        if (!filter_.insert(key)) return;
+        marked_.fetch_add(1, std::memory_order_relaxed);
+        if (clears_.load(std::memory_order_acquire) != clears) filter_.erase(key);
+    }
+
+    std::unique_ptr<CachePolicy<Key, Value>> cache_;
+    DecayingCuckooFilter<Key, Hasher>        filter_;
+    std::atomic<uint64_t>                    clears_{0};   //每次清除 +1，用来发现回源期间的并发写入
+    std::atomic<uint64_t>                    negativeHits_{0};
+    std::atomic<uint64_t>                    loads_{0};
+    std::atomic<uint64_t>                    absentLoads_{0};
+    std::atomic<uint64_t>                    marked_{0};
+    std::atomic<uint64_t>                    cleared_{0};
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*  RemovalListener.h
+    条目离开缓存时的通知：被驱逐、被删除、被覆盖的 key/value 连同原因一起交给监听器，
+    用来释放外部资源或回写脏数据。
+    - 策略在自己的锁内只把 key/value move 进本策略（分片缓存即本分片）的缓冲区，不调用监听器；
+    - 写操作释放锁之后，缓冲区攒够 batchSize 条就整批取走并在锁外投递（NotifyingLock 负责这个顺序）；
+    - batchSize > 1 时不足一批的通知留在缓冲区里，由维护线程定期调用 flushRemovals() 投递。
+    没有设置监听器时 push 只多一次判空，value 也不会被 move 走。
+    组合型缓存（装饰器、SetAssocCache）自己的锁里放不下或不该放缓冲区，用 RemovalRelay：
+    内层/锁内产生的通知先并入 relay（一把只保护缓冲区的叶子锁），外层释放自己的锁之后再投递。
+    监听器可能被多个线程同时调用（各自投递自己取走的那一批），需要自己保证线程安全；
+    它在锁外执行，可以访问缓存本身，但不应抛异常（投递发生在析构函数里）。
+*/
+
+namespace CacheSystem {
+
+enum class RemovalCause : uint8_t {
+    Capacity,   // 容量不足被驱逐（含 setCapacity 缩容）
+    Expired,    // 所属代已失效：invalidateAll 之后被惰性回收的旧代条目
+    Explicit,   // remove / invalidateIf / compute 返回 nullopt
+    Replaced,   // 被 put / compute 写入的新值覆盖，通知里是旧值
+};
+
+inline const char* toString(RemovalCause cause) {
+    switch (cause) {
+        case RemovalCause::Capacity: return "capacity";
+        case RemovalCause::Expired:  return "expired";
+        case RemovalCause::Explicit: return "explicit";
+        case RemovalCause::Replaced: return "replaced";
+    }
+    return "unknown";
+}
+
+template<typename Key, typename Value>
+struct RemovalNotification {
+    Key          key;
+    Value        value;
+    RemovalCause cause;
+};
+
+// 一次收到一批；批内按离开缓存的先后顺序排列，批与批之间不保证顺序
+template<typename Key, typename Value>
+using RemovalListener = std::function<void(std::vector<RemovalNotification<Key, Value>>& batch)>;
+
+template<typename Key, typename Value>
+class RemovalQueue {
+public:
+    using Notification = RemovalNotification<Key, Value>;
+    using Listener     = RemovalListener<Key, Value>;
+
+    // 锁内取走的一批，连同当时的监听器一起带到锁外
+    struct Batch {
+        std::shared_ptr<const Listener> listener;
+        std::vector<Notification>       items;
+    };
+
+    // 以下在所属策略的锁内调用
+    void setListener(Listener listener, size_t batchSize) {
+        listener_ = listener ? std::make_shared<const Listener>(std::move(listener)) : nullptr;
+        batchSize_ = batchSize ? batchSize : 1;
+        if (!listener_) pending_.clear();
+    }
+    bool enabled() const { return listener_ != nullptr; }
+    size_t size() const { return pending_.size(); }
+
+    void push(const Key& key, Value&& value, RemovalCause cause) {
+        if (!listener_) return;
+        pending_.push_back(Notification{key, std::move(value), cause});
+    }
+    void push(const Key& key, const Value& value, RemovalCause cause) {
+        if (!listener_) return;
+        pending_.push_back(Notification{key, value, cause});
+    }
+
+    // 攒够一批才取走；force 时有多少取多少（flushRemovals）
+    void take(Batch& out, bool force = false) {
+        if (pending_.empty() || (!force && pending_.size() < batchSize_)) return;
+        out.listener = listener_;
+        out.items.swap(pending_);
+    }
+
+    // 锁外调用
+    static void deliver(Batch& batch) {
+        if (batch.listener && !batch.items.empty()) (*batch.listener)(batch.items);
+    }
+
+private:
+    std::shared_ptr<const Listener> listener_;
+    std::vector<Notification>       pending_;
+    size_t                          batchSize_ = 1;
+};
+
+// 替代写路径上的 lock_guard：析构时先在锁内取走攒够的一批，解锁之后再投递
+template<typename Mutex, typename Key, typename Value>
+class NotifyingLock {
+public:
+    NotifyingLock(Mutex& mutex, RemovalQueue<Key, Value>& queue, bool force = false)
+        : mutex_(mutex), queue_(queue), force_(force) { mutex_.lock(); }
+    ~NotifyingLock() {
+        typename RemovalQueue<Key, Value>::Batch batch;
+        queue_.take(batch, force_);
+        mutex_.unlock();
+        RemovalQueue<Key, Value>::deliver(batch);
+    }
+    NotifyingLock(const NotifyingLock&) = delete;
+    NotifyingLock& operator=(const NotifyingLock&) = delete;
+
+private:
+    Mutex&                    mutex_;
+    RemovalQueue<Key, Value>& queue_;
+    bool                      force_;
+};
+
+// 带独立叶子锁的通知缓冲：持有它的锁时不会再去拿别的锁，也不调用监听器，所以任何锁内都可以往里并
+template<typename Key, typename Value>
+class RemovalRelay {
+public:
+    using Notification = RemovalNotification<Key, Value>;
+
+    void setListener(RemovalListener<Key, Value> listener, size_t batchSize) {
+        std::lock_guard<std::mutex> lk(mu_);
+        enabled_.store(static_cast<bool>(listener), std::memory_order_relaxed);
+        queue_.setListener(std::move(listener), batchSize);
+        pending_.store(queue_.size(), std::memory_order_relaxed);
+    }
+    // 没有监听器时调用方可以连 value 都不必准备
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void push(const Key& key, Value&& value, RemovalCause cause) {
+        std::lock_guard<std::mutex> lk(mu_);
+        queue_.push(key, std::move(value), cause);
+        pending_.store(queue_.size(), std::memory_order_relaxed);
+    }
+    void append(std::vector<Notification>& items) {
+        std::lock_guard<std::mutex> lk(mu_);
+        for (auto& n : items) queue_.push(n.key, std::move(n.value), n.cause);
+        pending_.store(queue_.size(), std::memory_order_relaxed);
+    }
+
+    // 给内层缓存装的监听器：内层在它自己的锁外调用，这里只并入缓冲
+    RemovalListener<Key, Value> sink() {
+        return [this](std::vector<Notification>& batch) { append(batch); };
+    }
+
+    // 调用方不持有任何缓存锁；force 时不足一批也投递。缓冲为空时不拿锁，读路径上每次调用也不贵
+    void deliver(bool force = false) {
+        if (!enabled() || pending_.load(std::memory_order_relaxed) == 0) return;
+        typename RemovalQueue<Key, Value>::Batch batch;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            queue_.take(batch, force);
+            pending_.store(queue_.size(), std::memory_order_relaxed);
+        }
+        RemovalQueue<Key, Value>::deliver(batch);
+    }
+
+private:
+    std::mutex               mu_;
+    std::atomic<bool>        enabled_{false};
+    std::atomic<size_t>      pending_{0};
+    RemovalQueue<Key, Value> queue_;
+};
+
+// 装饰器写路径上替代 lock_guard：解锁之后投递 relay 里攒够的一批
+template<typename Mutex, typename Key, typename Value>
+class RelayingLock {
+public:
+    RelayingLock(Mutex& mutex, RemovalRelay<Key, Value>& relay) : mutex_(mutex), relay_(relay) { mutex_.lock(); }
+    ~RelayingLock() {
+        mutex_.unlock();
+        relay_.deliver();
+    }
+    RelayingLock(const RelayingLock&) = delete;
+    RelayingLock& operator=(const RelayingLock&) = delete;
+
+private:
+    Mutex&                    mutex_;
+    RemovalRelay<Key, Value>& relay_;
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,450 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+#include "ContentionMutex.h"
+
+/*  S3FifoCache.h
+    S3-FIFO：只用 FIFO 队列做淘汰，命中时不移动任何节点。
+    - 小队列 S（默认 10% 容量）：新 key 先进 S，过滤只访问一次的“一次性”数据；
+    - 主队列 M（其余 90%）：S 出队时被访问过的 key 晋升到 M；M 出队时访问过的 key 频次减一后重新入队（类似 CLOCK）；
+    - ghost 队列 G：从 S 直接淘汰的 key 只留 key，再次写入时直接进 M。
+    每个条目只有一个 2bit 的访问频次（0~3 饱和），命中就是一次饱和自增，链表只有队头出、队尾进两种操作。
+
+    并发：索引用读写锁保护。get 只拿共享锁，查表、拷贝 value、频次用 relaxed 原子自增，多个读者互不阻塞；
+    只有 put / 淘汰才拿独占锁。频次已饱和时不再写，热点 key 的 cache line 不会在核间来回弹。
+
+    删除：队列只能从队头出，删掉的节点就地标成 Dead 墓碑留在队列里，出队时再回收槽位；
+    墓碑攒到容量的一半左右就把两条队列整体压实一次。invalidateAll 只把代数 +1，旧代条目读不到，
+    仍占着容量按 FIFO 顺序被淘汰（不进 ghost），写入同一个 key 时就地替换。
+*/
+
+namespace CacheSystem {
+
+template<typename Key, typename Value>
+class S3FifoCache : public CachePolicy<Key, Value> {
+public:
+    explicit S3FifoCache(int capacity, double smallRatio = 0.1)
+        : smallRatio_(smallRatio) {
+        resize(capacity > 0 ? static_cast<size_t>(capacity) : 0);
+        map_.reserve(capacity_);
+    }
+
+    ~S3FifoCache() override = default;
+
+    void put(Key key, Value value) override {
+        Lock lk(mu_, removals_);
+        if (capacity_ == 0) return;
+        auto it = map_.find(key);
+        if (it != map_.end()) {
+            Node& n = pool_[it->second];
+            if (live(n)) {
+                assignValue(n, std::move(value));
+                bump(n);
+                return;
+            }
+            killNoLock(it->second, RemovalCause::Expired);
+        }
+        insertNoLock(std::move(key), std::move(value));
+    }
+
+    bool get(Key key, Value& value) override {
+        std::shared_lock<ContentionSharedMutex> lk(mu_);
+        auto it = map_.find(key);
+        if (it == map_.end()) return false;
+        Node& n = pool_[it->second];
+        if (!live(n)) return false;   //共享锁下不能删，留给写者或淘汰回收
+        value = n.value;
+        bump(n);
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Lock lk(mu_, removals_);
+        auto it = map_.find(key);
+        if (it != map_.end() && !live(pool_[it->second])) {
+            killNoLock(it->second, RemovalCause::Expired);
+            it = map_.end();
+        }
+        std::optional<Value> result = fn(it != map_.end() ? &pool_[it->second].value : nullptr);
+        if (it != map_.end()) {
+            if (!result) {
+                killNoLock(it->second, RemovalCause::Explicit);
+                return result;
+            }
+            Node& n = pool_[it->second];
+            assignValue(n, Value(*result));
+            bump(n);
+        } else if (result && capacity_ > 0) {
+            insertNoLock(std::move(key), Value(*result));
+        }
+        return result;
+    }
+
+    // 已存在则不覆盖，返回是否插入
+    bool putIfAbsent(Key key, Value value) override {
+        Lock lk(mu_, removals_);
+        if (capacity_ == 0) return false;
+        auto it = map_.find(key);
+        if (it != map_.end()) {
+            if (live(pool_[it->second])) return false;
+            killNoLock(it->second, RemovalCause::Expired);
+        }
+        insertNoLock(std::move(key), std::move(value));
+        return true;
+    }
+
+    // 命中与 get 一样只拿共享锁；未命中才换独占锁，再查一次防止期间被别的线程插入
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        if (get(key, value)) return true;
+        Lock lk(mu_, removals_);
+        auto it = map_.find(key);
+        if (it != map_.end()) {
+            Node& n = pool_[it->second];
+            if (live(n)) {
+                value = n.value;
+                bump(n);
+                return true;
+            }
+            killNoLock(it->second, RemovalCause::Expired);
+        }
+        value = factory();
+        if (capacity_ > 0) insertNoLock(std::move(key), Value(value));
+        return false;
+    }
+
+    bool remove(Key key) override {
+        Lock lk(mu_, removals_);
+        auto it = map_.find(key);
+        if (it == map_.end()) return false;
+        const bool wasLive = live(pool_[it->second]);
+        killNoLock(it->second, wasLive ? RemovalCause::Explicit : RemovalCause::Expired);
+        return wasLive;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        Lock lk(mu_, removals_);
+        std::vector<uint32_t> victims;
+        size_t n = 0;
+        for (const auto& kv : map_) {
+            const Node& node = pool_[kv.second];
+            if (!live(node)) {
+                victims.push_back(kv.second);
+            } else if (pred(node.key, node.value)) {
+                victims.push_back(kv.second);
+                ++n;
+            }
+        }
+        for (uint32_t i : victims) killNoLock(i, live(pool_[i]) ? RemovalCause::Explicit : RemovalCause::Expired);
+        return n;
+    }
+
+    void invalidateAll() override {
+        std::lock_guard<ContentionSharedMutex> lk(mu_);
+        ++generation_;
+    }
+
+    // 按 S、M 的出队顺序取出全部条目并清空（重新分片时迁移用）；ghost 一并清掉，不产生删除通知
+    std::vector<std::pair<Key, Value>> drain() {
+        std::lock_guard<ContentionSharedMutex> lk(mu_);
+        std::vector<std::pair<Key, Value>> out;
+        out.reserve(map_.size());
+        for (auto* q : {&small_, &main_}) {
+            for (uint32_t i : *q) {
+                Node& n = pool_[i];
+                if (n.queue != Queue::Dead && live(n)) out.emplace_back(std::move(n.key), std::move(n.value));
+            }
+            q->clear();
+        }
+        deadCount_ = 0;
+        pool_.clear();
+        free_.clear();
+        map_.clear();
+        ghost_.clear();
+        ghostMap_.clear();
+        keyHeapBytes_ = valueHeapBytes_ = ghostKeyHeapBytes_ = 0;
+        return out;
+    }
+
+    // 缩容时分批淘汰，批与批之间释放锁
+    void setCapacity(size_t capacity) override {
+        {
+            std::lock_guard<ContentionSharedMutex> lk(mu_);
+            resize(capacity);
+        }
+        for (bool done = false; !done;) {
+            Lock lk(mu_, removals_);  //每批驱逐的通知在本批解锁后投递
+            size_t n = 0;
+            for (; n < kEvictBatch && map_.size() > capacity_; ++n) evictNoLock();
+            trimGhostNoLock();
+            done = n < kEvictBatch;
+        }
+    }
+
+    MemoryUsage memoryUsage() const override {
+        std::shared_lock<ContentionSharedMutex> lk(mu_);
+        MemoryUsage m;
+        m.entries  = map_.size();
+        m.index    = hashIndexBytes(map_) + keyHeapBytes_;
+        m.nodes    = pool_.size() * (sizeof(Node) - sizeof(Value))
+                   + (small_.size() + main_.size() + free_.capacity()) * sizeof(uint32_t)
+                   + keyHeapBytes_;
+        m.values   = pool_.size() * sizeof(Value) + valueHeapBytes_;
+        m.metadata = hashIndexBytes(ghostMap_) + ghost_.size() * sizeof(typename GhostQueue::value_type)
+                   + 2 * ghostKeyHeapBytes_;
+        return m;
+    }
+
+    size_t size() const {
+        std::shared_lock<ContentionSharedMutex> lk(mu_);
+        return map_.size();
+    }
+    bool empty() const { return size() == 0; }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        std::lock_guard<ContentionSharedMutex> lk(mu_);
+        removals_.setListener(std::move(listener), batchSize);
+    }
+
+    void flushRemovals() override {
+        Lock lk(mu_, removals_, true);
+    }
+
+    ContentionStats contention() const { return mu_.stats(); }
+    void resetContention() { mu_.resetStats(); }
+
+private:
+    using Lock = NotifyingLock<ContentionSharedMutex, Key, Value>; //会删除条目的独占路径都用它：解锁后投递删除通知
+
+    static constexpr uint8_t kMaxFreq = 3;      //2bit 频次
+    static constexpr size_t kEvictBatch = 64;   //setCapacity 每次持锁最多驱逐的条目数
+    static constexpr size_t kCompactSlack = 64;  //墓碑超过 容量/2 + 该值 时压实队列
+
+    enum class Queue : uint8_t { Free, Small, Main, Dead };   //Dead：已删除，仍留在队列里等出队
+
+    struct Node {
+        Key                  key{};
+        Value                value{};
+        std::atomic<uint8_t> freq{0};
+        Queue                queue = Queue::Free;
+        uint32_t             gen = 0;   //写入时的代数
+    };
+
+    // ghost 只记 key 和入队序号；同一个 key 重复入队时旧记录按序号识别为过期
+    using GhostQueue = std::deque<std::pair<Key, uint64_t>>;
+
+    void resize(size_t capacity) {
+        capacity_ = capacity;
+        smallCap_ = capacity_ ? std::max<size_t>(1, static_cast<size_t>(capacity_ * smallRatio_)) : 0;
+        ghostCap_ = capacity_ - smallCap_;
+    }
+
+    // 共享锁下调用：并发读者的自增可能丢一次，频次只是近似值，无伤大雅
+    static void bump(Node& n) {
+        const uint8_t f = n.freq.load(std::memory_order_relaxed);
+        if (f < kMaxFreq) n.freq.store(static_cast<uint8_t>(f + 1), std::memory_order_relaxed);
+    }
+
+    void insertNoLock(Key&& key, Value&& value) {
+        while (map_.size() >= capacity_) evictNoLock();
+        auto g = ghostMap_.find(key);
+        const bool ghostHit = g != ghostMap_.end();
+        if (ghostHit) {
+            ghostKeyHeapBytes_ -= heapBytesOf(g->first);
+            ghostMap_.erase(g);   //队列里的旧记录留着，出队时按序号跳过
+        }
+        const uint32_t i = allocNode(std::move(key), std::move(value));
+        Node& n = pool_[i];
+        n.queue = ghostHit ? Queue::Main : Queue::Small;
+        (ghostHit ? main_ : small_).push_back(i);
+        map_.emplace(n.key, i);
+    }
+
+    bool live(const Node& n) const { return n.gen == generation_; }
+
+    // 从索引中删除，节点变成墓碑留在原队列里
+    void killNoLock(uint32_t i, RemovalCause cause) {
+        Node& n = pool_[i];
+        map_.erase(n.key);
+        keyHeapBytes_ -= heapBytesOf(n.key);
+        valueHeapBytes_ -= heapBytesOf(n.value);
+        removals_.push(n.key, std::move(n.value), cause);
+        n.key = Key{};
+        n.value = Value{};
+        n.queue = Queue::Dead;
+        if (++deadCount_ > capacity_ / 2 + kCompactSlack) compactNoLock();
+    }
+
+    void releaseDead(uint32_t i) {
+        pool_[i].queue = Queue::Free;
+        free_.push_back(i);
+        --deadCount_;
+    }
+
+    // 把两条队列里的墓碑一次清掉，顺序不变
+    void compactNoLock() {
+        for (auto* q : {&small_, &main_}) {
+            q->erase(std::remove_if(q->begin(), q->end(), [this](uint32_t i) {
+                if (pool_[i].queue != Queue::Dead) return false;
+                releaseDead(i);
+                return true;
+            }), q->end());
+        }
+    }
+
+    void evictNoLock() {
+        if (small_.size() >= smallCap_ || main_.empty()) evictSmallNoLock();
+        else evictMainNoLock();
+    }
+
+    // S 出队：访问过的晋升到 M（M 满了先从 M 淘汰一个），没访问过的淘汰并记入 ghost；直到真正淘汰掉一个为止
+    void evictSmallNoLock() {
+        while (!small_.empty()) {
+            const uint32_t i = small_.front();
+            small_.pop_front();
+            Node& n = pool_[i];
+            if (n.queue == Queue::Dead) {
+                releaseDead(i);
+            } else if (!live(n)) {
+                freeNode(i, RemovalCause::Expired);   //旧代条目直接丢，不进 ghost
+                return;
+            } else if (n.freq.load(std::memory_order_relaxed) > 0) {
+                n.freq.store(0, std::memory_order_relaxed);
+                n.queue = Queue::Main;
+                main_.push_back(i);
+                if (main_.size() > capacity_ - smallCap_) {
+                    evictMainNoLock();
+                    return;
+                }
+            } else {
+                pushGhostNoLock(n.key);
+                freeNode(i, RemovalCause::Capacity);
+                return;
+            }
+        }
+        evictMainNoLock();
+    }
+
+    // M 出队：频次大于 0 的减一后重新入队，直到遇到频次为 0 的淘汰掉
+    void evictMainNoLock() {
+        while (!main_.empty()) {
+            const uint32_t i = main_.front();
+            main_.pop_front();
+            Node& n = pool_[i];
+            if (n.queue == Queue::Dead) {
+                releaseDead(i);
+                continue;
+            }
+            const uint8_t f = n.freq.load(std::memory_order_relaxed);
+            if (f > 0 && live(n)) {
+                n.freq.store(static_cast<uint8_t>(f - 1), std::memory_order_relaxed);
+                main_.push_back(i);
+            } else {
+                freeNode(i, live(n) ? RemovalCause::Capacity : RemovalCause::Expired);
+                return;
+            }
+        }
+    }
+
+    void pushGhostNoLock(const Key& key) {
+        if (ghostCap_ == 0) return;
+        const uint64_t seq = ++ghostSeq_;
+        auto ins = ghostMap_.insert_or_assign(key, seq);
+        if (ins.second) ghostKeyHeapBytes_ += heapBytesOf(key);
+        ghost_.emplace_back(key, seq);
+        trimGhostNoLock();
+    }
+
+    void trimGhostNoLock() {
+        while (ghostMap_.size() > ghostCap_ || ghost_.size() > 2 * ghostCap_) {
+            if (ghost_.empty()) break;
+            auto& front = ghost_.front();
+            auto g = ghostMap_.find(front.first);
+            if (g != ghostMap_.end() && g->second == front.second) {
+                ghostKeyHeapBytes_ -= heapBytesOf(g->first);
+                ghostMap_.erase(g);
+            }
+            ghost_.pop_front();
+        }
+    }
+
+    // ---- 节点池：deque 扩容不搬动已有元素，读者拿着共享锁访问的节点地址始终有效 ----
+    uint32_t allocNode(Key&& key, Value&& value) {
+        uint32_t i;
+        if (!free_.empty()) {
+            i = free_.back();
+            free_.pop_back();
+        } else {
+            i = static_cast<uint32_t>(pool_.size());
+            pool_.emplace_back();
+        }
+        Node& n = pool_[i];
+        n.key = std::move(key);
+        n.value = std::move(value);
+        n.freq.store(0, std::memory_order_relaxed);
+        n.gen = generation_;
+        keyHeapBytes_ += heapBytesOf(n.key);
+        valueHeapBytes_ += heapBytesOf(n.value);
+        return i;
+    }
+
+    void freeNode(uint32_t i, RemovalCause cause) {
+        Node& n = pool_[i];
+        map_.erase(n.key);
+        keyHeapBytes_ -= heapBytesOf(n.key);
+        valueHeapBytes_ -= heapBytesOf(n.value);
+        removals_.push(n.key, std::move(n.value), cause);
+        n.key = Key{};
+        n.value = Value{};
+        n.queue = Queue::Free;
+        free_.push_back(i);
+    }
+
+    void assignValue(Node& n, Value&& value) {
+        valueHeapBytes_ -= heapBytesOf(n.value);
+        removals_.push(n.key, std::move(n.value), RemovalCause::Replaced);
+        n.value = std::move(value);
+        valueHeapBytes_ += heapBytesOf(n.value);
+    }
+
+private:
+    size_t capacity_ = 0;
+    size_t smallCap_ = 0;
+    size_t ghostCap_ = 0;
+    double smallRatio_;
+
+    std::deque<Node>                     pool_;
+    std::vector<uint32_t>                free_;
+    std::unordered_map<Key, uint32_t>    map_;
+    std::deque<uint32_t>                 small_;   //S，队头最旧
+    std::deque<uint32_t>                 main_;    //M，队头最旧
+    GhostQueue                           ghost_;   //G
+    std::unordered_map<Key, uint64_t>    ghostMap_;
+    uint64_t                             ghostSeq_ = 0;
+    uint32_t                             generation_ = 0;
+    size_t                               deadCount_ = 0;   //队列里的墓碑数
+
+    size_t keyHeapBytes_ = 0;
+    size_t valueHeapBytes_ = 0;
+    size_t ghostKeyHeapBytes_ = 0;
+    RemovalQueue<Key, Value> removals_;  //锁内攒的删除通知
+    mutable ContentionSharedMutex mu_;
+};
+
+} // namespace CacheSystem
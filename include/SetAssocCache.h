@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "CachePolicy.h"
+#include "HashMix.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*  SetAssocCache.h
+    N 路组相联（8 / 16 way）缓存，类似 CPU cache 的组织方式：
+    - key 经过 hash 后只能落在某一个 set 中，每个 set 有 Ways 个槽位；
+    - 每个 set 的元数据（8bit 指纹 tags、每路的 LRU 排名 ranks、set 自旋锁）恰好放在一条 64B cache line 里；
+    - 查找时用一条 SSE2 指令把 16 个指纹一次比完，只有指纹相同的槽才去比较真正的 key；
+    - set 内部是精确 LRU：ranks 始终是 0..Ways-1 的一个排列，0 为 MRU，Ways-1 为 LRU。
+    没有链表和 shared_ptr，命中路径上不存在指针追逐；代价是只在 set 内部淘汰（与分片类似的近似）。
+    没有 SSE2 的平台走标量循环。
+    invalidateAll 只把全局代数 +1；每个 set 记着自己上次同步的代数，下次加锁访问时发现落后就整组清空，
+    所以 size() 在这些 set 被访问到之前会偏大。
+    删除通知：set 元数据正好占满一条 cache line，放不下缓冲区。set 锁内只把离开的条目记到本次调用的局部缓冲，
+    释放 set 锁之后再并入共享队列（另一把锁，只在有监听器且确实有条目离开时才拿），攒够一批在锁外投递。
+*/
+
+namespace CacheSystem {
+
+template<typename Key, typename Value, size_t Ways = 16>
+class SetAssocCache : public CachePolicy<Key, Value> {
+    static_assert(Ways == 8 || Ways == 16, "SetAssocCache supports 8-way or 16-way sets");
+
+public:
+    explicit SetAssocCache(int capacity)
+        : numSets_(capacity > 0 ? (static_cast<size_t>(capacity) + Ways - 1) / Ways : 0)
+        , sets_(numSets_ ? new SetMeta[numSets_] : nullptr)
+        , keys_(numSets_ ? new Key[numSets_ * Ways] : nullptr)
+        , values_(numSets_ ? new Value[numSets_ * Ways] : nullptr)
+        , waysLimit_(Ways) {}
+
+    ~SetAssocCache() override = default;
+
+    void put(Key key, Value value) override {
+        if (numSets_ == 0) return;
+        const uint64_t h = fmix64(std::hash<Key>{}(key));
+        const uint8_t tag = tagOf(h);
+        const size_t s = setOf(h);
+        SetMeta& set = sets_[s];
+        Notices out(*this);
+        SetLock lock(set);
+        syncGeneration(set, s, out);
+
+        const size_t way = findWay(set, s, tag, key);
+        if (way != Ways) {
+            retireValue(s * Ways + way, out, RemovalCause::Replaced);
+            assignValue(s * Ways + way, std::move(value));
+            touch(set, way);
+            return;
+        }
+        insertNoLock(set, s, tag, std::move(key), std::move(value), out);
+    }
+
+    bool get(Key key, Value& value) override {
+        if (numSets_ == 0) return false;
+        const uint64_t h = fmix64(std::hash<Key>{}(key));
+        const uint8_t tag = tagOf(h);
+        const size_t s = setOf(h);
+        SetMeta& set = sets_[s];
+        Notices out(*this);
+        SetLock lock(set);
+        syncGeneration(set, s, out);
+
+        const size_t way = findWay(set, s, tag, key);
+        if (way == Ways) return false;
+        value = values_[s * Ways + way];
+        touch(set, way);
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value v{};
+        (void)get(key, v);
+        return v;
+    }
+
+    // compute / getOrInsert 的回调在 set 自旋锁内执行，应当很便宜；昂贵的加载请在锁外算好再 putIfAbsent
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        if (numSets_ == 0) return fn(nullptr);
+        const uint64_t h = fmix64(std::hash<Key>{}(key));
+        const uint8_t tag = tagOf(h);
+        const size_t s = setOf(h);
+        SetMeta& set = sets_[s];
+        Notices out(*this);
+        SetLock lock(set);
+        syncGeneration(set, s, out);
+
+        const size_t way = findWay(set, s, tag, key);
+        std::optional<Value> result = fn(way != Ways ? &values_[s * Ways + way] : nullptr);
+        if (way != Ways) {
+            if (!result) {
+                clearWay(set, s, way, out, RemovalCause::Explicit);
+                return result;
+            }
+            retireValue(s * Ways + way, out, RemovalCause::Replaced);
+            assignValue(s * Ways + way, Value(*result));
+            touch(set, way);
+        } else if (result) {
+            insertNoLock(set, s, tag, std::move(key), Value(*result), out);
+        }
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        if (numSets_ == 0) return false;
+        const uint64_t h = fmix64(std::hash<Key>{}(key));
+        const uint8_t tag = tagOf(h);
+        const size_t s = setOf(h);
+        SetMeta& set = sets_[s];
+        Notices out(*this);
+        SetLock lock(set);
+        syncGeneration(set, s, out);
+        if (findWay(set, s, tag, key) != Ways) return false;
+        return insertNoLock(set, s, tag, std::move(key), std::move(value), out);
+    }
+
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        if (numSets_ == 0) {
+            value = factory();
+            return false;
+        }
+        const uint64_t h = fmix64(std::hash<Key>{}(key));
+        const uint8_t tag = tagOf(h);
+        const size_t s = setOf(h);
+        SetMeta& set = sets_[s];
+        Notices out(*this);
+        SetLock lock(set);
+        syncGeneration(set, s, out);
+
+        const size_t way = findWay(set, s, tag, key);
+        if (way != Ways) {
+            value = values_[s * Ways + way];
+            touch(set, way);
+            return true;
+        }
+        value = factory();
+        insertNoLock(set, s, tag, std::move(key), Value(value), out);
+        return false;
+    }
+
+    bool remove(Key key) override {
+        if (numSets_ == 0) return false;
+        const uint64_t h = fmix64(std::hash<Key>{}(key));
+        const size_t s = setOf(h);
+        SetMeta& set = sets_[s];
+        Notices out(*this);
+        SetLock lock(set);
+        syncGeneration(set, s, out);
+        const size_t way = findWay(set, s, tagOf(h), key);
+        if (way == Ways) return false;
+        clearWay(set, s, way, out, RemovalCause::Explicit);
+        return true;
+    }
+
+    // 逐个 set 加锁扫描，不会有全局停顿
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        size_t n = 0;
+        Notices out(*this);
+        for (size_t s = 0; s < numSets_; ++s) {
+            SetMeta& set = sets_[s];
+            SetLock lock(set);
+            syncGeneration(set, s, out);
+            for (size_t way = 0; way < Ways; ++way) {
+                if (set.tags[way] != 0 && pred(keys_[s * Ways + way], values_[s * Ways + way])) {
+                    clearWay(set, s, way, out, RemovalCause::Explicit);
+                    ++n;
+                }
+            }
+        }
+        return n;
+    }
+
+    void invalidateAll() override { generation_.fetch_add(1, std::memory_order_release); }
+
+    // 槽位数组是构造时一次性分配的，与条目数无关；只有 key/value 的堆上数据需要增量维护
+    MemoryUsage memoryUsage() const override {
+        MemoryUsage m;
+        const size_t slots = numSets_ * Ways;
+        m.entries = size();
+        m.index   = numSets_ * sizeof(SetMeta) + slots * sizeof(Key) + keyHeapBytes_.load(std::memory_order_relaxed);
+        m.values  = slots * sizeof(Value) + valueHeapBytes_.load(std::memory_order_relaxed);
+        return m;
+    }
+
+    // set 数在构造时确定，这里通过限制每个 set 可用的路数来调整容量（上限为构造时的 set 数 × Ways）
+    // 缩容逐个 set 加锁驱逐，不会有全局停顿
+    void setCapacity(size_t capacity) override {
+        if (numSets_ == 0) return;
+        const size_t limit = std::min(Ways, (capacity + numSets_ - 1) / numSets_);
+        waysLimit_.store(limit, std::memory_order_relaxed);
+        for (size_t s = 0; s < numSets_; ++s) {
+            SetMeta& set = sets_[s];
+            Notices out(*this);   //每个 set 驱逐完就投递
+            SetLock lock(set);
+            syncGeneration(set, s, out);
+            while (Ways - popcount(matchMask(set, 0)) > limit)
+                clearWay(set, s, lruOccupiedWay(set), out, RemovalCause::Capacity);
+        }
+    }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        removals_.setListener(std::move(listener), batchSize);
+    }
+
+    void flushRemovals() override { removals_.deliver(true); }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return numSets_ * waysLimit_.load(std::memory_order_relaxed); }
+    size_t setCount() const { return numSets_; }
+
+private:
+    // 一个 set 的全部元数据，正好一条 cache line
+    struct alignas(64) SetMeta {
+        uint8_t tags[16];   // 指纹，0 表示空槽；8-way 只用前 8 个
+        uint8_t ranks[16];  // LRU 排名，0 = MRU
+        std::atomic<uint8_t> lock{0};
+        uint32_t gen = 0;   // 上次同步到的全局代数
+
+        SetMeta() {
+            for (int i = 0; i < 16; ++i) { tags[i] = 0; ranks[i] = static_cast<uint8_t>(i); }
+        }
+    };
+    static_assert(sizeof(SetMeta) == 64, "set metadata must fit in one cache line");
+
+    // 一次调用里离开缓存的条目：set 锁内记下，析构时（要在 SetLock 之前构造，set 锁已释放）并入共享队列
+    class Notices {
+    public:
+        explicit Notices(SetAssocCache& cache) : cache_(cache), enabled_(cache.removals_.enabled()) {}
+        ~Notices() {
+            if (items_.empty()) return;
+            cache_.removals_.append(items_);
+            cache_.removals_.deliver();
+        }
+        Notices(const Notices&) = delete;
+        Notices& operator=(const Notices&) = delete;
+
+        bool enabled() const { return enabled_; }
+        void push(const Key& key, Value&& value, RemovalCause cause) {
+            items_.push_back(RemovalNotification<Key, Value>{key, std::move(value), cause});
+        }
+    private:
+        SetAssocCache&                               cache_;
+        bool                                         enabled_;
+        std::vector<RemovalNotification<Key, Value>> items_;
+    };
+
+    // set 级自旋锁：临界区只有十几条指令，自旋比 std::mutex 陷入内核便宜得多
+    class SetLock {
+    public:
+        explicit SetLock(SetMeta& set) : set_(set) {
+            for (int spins = 0; set_.lock.exchange(1, std::memory_order_acquire); ++spins) {
+                while (set_.lock.load(std::memory_order_relaxed)) {
+                    if (++spins > 64) { std::this_thread::yield(); spins = 0; }
+                }
+            }
+        }
+        ~SetLock() { set_.lock.store(0, std::memory_order_release); }
+        SetLock(const SetLock&) = delete;
+        SetLock& operator=(const SetLock&) = delete;
+    private:
+        SetMeta& set_;
+    };
+
+    static uint8_t tagOf(uint64_t h) {
+        uint8_t t = static_cast<uint8_t>(h);
+        return t ? t : 1;   // 0 留给空槽
+    }
+    // 高 32 位做 set 下标（乘法取高位，set 数不必是 2 的幂），低 8 位做指纹，两者互不相关
+    size_t setOf(uint64_t h) const {
+        return static_cast<size_t>(((h >> 32) * static_cast<uint64_t>(numSets_)) >> 32);
+    }
+    static size_t ctz(uint32_t m) { return static_cast<size_t>(__builtin_ctz(m)); }
+    static size_t popcount(uint32_t m) { return static_cast<size_t>(__builtin_popcount(m)); }
+
+    // 返回 tags 中等于 tag 的槽位掩码（bit i 对应 way i）
+    static uint32_t matchMask(const SetMeta& set, uint8_t tag) {
+#if defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi8(static_cast<char>(tag));
+        const __m128i tags = _mm_load_si128(reinterpret_cast<const __m128i*>(set.tags));
+        uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(tags, needle)));
+        return Ways == 16 ? m : (m & 0xffu);
+#else
+        uint32_t m = 0;
+        for (size_t i = 0; i < Ways; ++i) m |= static_cast<uint32_t>(set.tags[i] == tag) << i;
+        return m;
+#endif
+    }
+
+    // 把 way 提到 MRU：排名比它靠前的全部 +1，它自己置 0
+    static void touch(SetMeta& set, size_t way) {
+        const uint8_t r = set.ranks[way];
+#if defined(__SSE2__)
+        __m128i ranks = _mm_load_si128(reinterpret_cast<const __m128i*>(set.ranks));
+        __m128i lt = _mm_cmplt_epi8(ranks, _mm_set1_epi8(static_cast<char>(r)));
+        ranks = _mm_sub_epi8(ranks, lt);   // lt 为 0xFF(-1) 的位置 +1
+        _mm_store_si128(reinterpret_cast<__m128i*>(set.ranks), ranks);
+#else
+        for (size_t i = 0; i < Ways; ++i) set.ranks[i] += static_cast<uint8_t>(set.ranks[i] < r);
+#endif
+        set.ranks[way] = 0;
+    }
+
+    // 只有 string 这类有堆上数据的类型才会真正走到计数器；int/POD 时 heapBytesOf 恒为 0，整段被编译器消掉
+    // 赋值之后再量：短 string 移动赋值给已有堆缓冲区的槽位时，会沿用槽位原来的缓冲区
+    void assignKey(size_t slot, Key&& key) {
+        const size_t before = heapBytesOf(keys_[slot]);
+        keys_[slot] = std::move(key);
+        const size_t after = heapBytesOf(keys_[slot]);
+        if (after != before) keyHeapBytes_.fetch_add(after - before, std::memory_order_relaxed);
+    }
+    void assignValue(size_t slot, Value&& value) {
+        const size_t before = heapBytesOf(values_[slot]);
+        values_[slot] = std::move(value);
+        const size_t after = heapBytesOf(values_[slot]);
+        if (after != before) valueHeapBytes_.fetch_add(after - before, std::memory_order_relaxed);
+    }
+
+    // 持 set 锁调用：返回 key 所在的路，不在则返回 Ways
+    size_t findWay(const SetMeta& set, size_t s, uint8_t tag, const Key& key) const {
+        for (uint32_t m = matchMask(set, tag); m; m &= m - 1) {
+            const size_t way = ctz(m);
+            if (keys_[s * Ways + way] == key) return way;
+        }
+        return Ways;
+    }
+
+    // value 离开缓存：有监听器时 move 进通知，槽位里留一个空值
+    void retireValue(size_t slot, Notices& out, RemovalCause cause) {
+        if (!out.enabled()) return;
+        const size_t before = heapBytesOf(values_[slot]);
+        if (before) valueHeapBytes_.fetch_sub(before, std::memory_order_relaxed);
+        out.push(keys_[slot], std::move(values_[slot]), cause);
+        values_[slot] = Value{};
+    }
+
+    // 持 set 锁调用，key 不在 set 中：有空槽且没超出路数上限就用空槽，否则顶掉 set 内的 LRU；上限为 0 时不插入
+    bool insertNoLock(SetMeta& set, size_t s, uint8_t tag, Key&& key, Value&& value, Notices& out) {
+        const size_t limit = waysLimit_.load(std::memory_order_relaxed);
+        if (limit == 0) return false;
+        size_t way;
+        uint32_t empty = matchMask(set, 0);
+        if (empty && Ways - popcount(empty) < limit) {
+            way = ctz(empty);
+            size_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            way = lruOccupiedWay(set);
+            retireValue(s * Ways + way, out, RemovalCause::Capacity);
+        }
+        set.tags[way] = tag;
+        assignKey(s * Ways + way, std::move(key));
+        assignValue(s * Ways + way, std::move(value));
+        touch(set, way);
+        return true;
+    }
+
+    void clearWay(SetMeta& set, size_t s, size_t way, Notices& out, RemovalCause cause) {
+        set.tags[way] = 0;
+        retireValue(s * Ways + way, out, cause);
+        assignKey(s * Ways + way, Key{});
+        assignValue(s * Ways + way, Value{});
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 持 set 锁调用：set 落后于全局代数说明中间发生过 invalidateAll，整组清空
+    void syncGeneration(SetMeta& set, size_t s, Notices& out) {
+        const uint32_t g = generation_.load(std::memory_order_acquire);
+        if (set.gen == g) return;
+        for (size_t way = 0; way < Ways; ++way)
+            if (set.tags[way] != 0) clearWay(set, s, way, out, RemovalCause::Expired);
+        set.gen = g;
+    }
+
+    // 已占用的槽中排名最靠后的那个；set 满时就是 rank == Ways-1 的槽
+    static size_t lruOccupiedWay(const SetMeta& set) {
+        size_t victim = 0;
+        int best = -1;
+        for (size_t i = 0; i < Ways; ++i) {
+            if (set.tags[i] != 0 && set.ranks[i] > best) { best = set.ranks[i]; victim = i; }
+        }
+        return victim;
+    }
+
+private:
+    size_t                     numSets_;
+    std::unique_ptr<SetMeta[]> sets_;
+    std::unique_ptr<Key[]>     keys_;
+    std::unique_ptr<Value[]>   values_;
+    std::atomic<size_t>        size_{0};
+    std::atomic<size_t>        waysLimit_;   // 每个 set 最多使用的路数，setCapacity 调整
+    std::atomic<size_t>        keyHeapBytes_{0};
+    std::atomic<size_t>        valueHeapBytes_{0};
+    std::atomic<uint32_t>      generation_{0};
+    RemovalRelay<Key, Value>   removals_;   // 自带叶子锁，只在 set 锁释放之后并入
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,613 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+#include "ContentionMutex.h"
+#include "HashMix.h"
+#include "HotKeyTracker.h"
+#include "LruCache.h"
+
+/*  ShardedCache.h
+    通用的哈希分片前端：ShardedCache<Policy, Key, Value, Hasher>。
+    - 分片按值存放在一块连续、按 64B 对齐的数组里：没有每个分片单独的堆分配，也没有 unique_ptr 间接寻址，
+      相邻分片的锁不会落在同一条 cache line 上（避免伪共享）；
+    - 调用分片时写成 slot.cache.Policy::get(...)，限定名调用不走虚函数表，可以被内联；
+    - ShardedCache 本身不继承 CachePolicy。需要运行时多态时再套一层 CachePolicyAdapter（HashLruCache 等就是这样做的）。
+
+    支持两种在线调整：
+    1. setCapacity(total)：按“公平拆分”重新分配每个分片的容量，分片各自分批驱逐；
+    2. reshard(n)：在线改变分片数。新路由立即生效，旧分片逐个迁移：
+       - 迁移期间 get 先查新分片，未命中且旧分片尚未迁移完时再查旧分片；
+       - put 只写新分片（写入期间恰好切换路由时再按新路由补写）；迁移方用 putIfAbsent 回填，不会覆盖迁移期间写入的新值；
+       - 任何时刻只锁住一个分片，没有全局停顿；代价是迁移中的条目可能短暂 miss。
+    分片数组按 maxSliceNum 一次性构造好（多出来的分片容量为 0），重新分片时不会搬动，读路径无需加锁。
+
+    分片数的自动调优（tuningReport / recommendSliceNum / autoTune / startAutoTune）：
+    - 锁争用：分片策略的锁是 ContentionMutex，统计 try_lock 失败次数和等待时长；
+    - 分片带来的命中率损失：按 hash 抽样 1/64 的 key，喂给一个容量同样缩小 64 倍、不分片的影子缓存，
+      比较“同一批 key 在真实分片缓存中的命中率”和“在全局影子缓存中的命中率”，差值就是分片造成的损失；
+      影子缓存挂在一把全局锁上，默认不建，enableTuningStats / autoTune / startAutoTune 时才打开；
+      关闭时每个请求只多一次原子读，tuningReport 只有锁争用数据；
+    - 争用率高（或摊到每次加锁的等待时间长）就加倍分片；争用很低而命中率损失明显（或每片太小）就减半。
+    统计按窗口计：每次 autoTune 之后清零。
+
+    删除：remove 按路由删；迁移中旧分片里的同一个 key 会被迁移方回填，所以迁移期间要等迁移做完再按新路由删一次。
+    invalidateIf / invalidateAll 和 reshard 互斥，逐个分片执行，一次只锁一个分片。
+
+    热点 key（enableHotKeyTracking / hotKeys）：默认关闭；打开后每个请求按 1/2^sampleShift 抽样，
+    记进所在分片的 Space-Saving 摘要（HotKeyTracker.h），报告前 k 个 key、估计次数和各分片负载倾斜。
+    关闭时每个请求只多一次原子读。reshard 之后各分片负载不再可比，统计从头开始。
+
+    删除通知：监听器装到每个分片（含暂未启用的分片）上，各分片用自己的缓冲区，在释放分片锁之后分批投递；
+    持有 reshardMutex_ 时（reshard、setCapacity、迁移期间的慢路径）产生的批次推迟到释放 reshardMutex_ 之后投递，
+    监听器照样可以回调缓存；
+    reshard 把条目从旧分片搬到新分片不算离开缓存，不通知。影子缓存只存 bool，不装监听器。
+
+    Policy 需要提供：Policy(int capacity) / get / put / setCapacity / memoryUsage；
+    remove / invalidateIf / invalidateAll / compute / getOrInsert / setRemovalListener / flushRemovals 只在调用时才需要；reshard 还需要 putIfAbsent / drain；contention / resetContention 可选（没有则视为无争用数据）。
+    影子缓存默认是同一策略、value 换成 bool；策略模板参数不是 <Key, Value> 形式时退回 LruCache<Key, bool>。
+*/
+
+namespace CacheSystem {
+
+// 单个分片的运行状况
+struct ShardStats {
+    ContentionStats lock;
+    size_t          entries  = 0;
+    size_t          capacity = 0;
+};
+
+// 一个统计窗口内的调优依据与建议
+struct ShardTuningReport {
+    int             sliceNum = 0;
+    ContentionStats lock;                  // 所有活跃分片累加
+    uint64_t        sampledGets = 0;       // 被抽样的 get 次数
+    double          shardedHitRatio = 0;   // 抽样 key 在真实（分片）缓存中的命中率
+    double          globalHitRatio  = 0;   // 同一批 key 在不分片影子缓存中的命中率
+    double          hitRatioLoss    = 0;   // global - sharded，分片造成的命中率损失
+    int             recommendedSliceNum = 0;
+};
+
+// Policy<Key, Value> → Policy<Key, bool>
+template<typename Policy, typename Key>
+struct ShadowPolicy { using type = LruCache<Key, bool>; };
+template<template<typename, typename> class P, typename Key, typename Value>
+struct ShadowPolicy<P<Key, Value>, Key> { using type = P<Key, bool>; };
+
+template<typename Policy, typename = void>
+struct HasContention : std::false_type {};
+template<typename Policy>
+struct HasContention<Policy, std::void_t<decltype(std::declval<const Policy&>().contention())>> : std::true_type {};
+
+template<typename Policy, typename Key, typename Value, typename Hasher = std::hash<Key>>
+class ShardedCache {
+public:
+    using key_type    = Key;
+    using mapped_type = Value;
+    using policy_type = Policy;
+    using Shadow      = typename ShadowPolicy<Policy, Key>::type;
+
+    // 调优阈值
+    static constexpr int      kSampleShift       = 6;       // 抽样 1/64
+    static constexpr uint64_t kMinAcquisitions   = 20000;   // 窗口内加锁次数太少不做判断
+    static constexpr uint64_t kMinSampledGets    = 2000;
+    static constexpr double   kGrowContention    = 0.05;    // 超过 5% 的加锁需要等待 → 加倍
+    static constexpr double   kGrowWaitNs        = 500;     // 或平均每次加锁多等 500ns → 加倍
+    static constexpr double   kShrinkContention  = 0.005;   // 争用率低于 0.5%、
+    static constexpr double   kShrinkWaitNs      = 50;      // 且平均每次加锁等待不到 50ns 才考虑减少分片
+    static constexpr double   kMaxHitRatioLoss   = 0.01;    // 命中率损失超过 1 个百分点 → 减半
+    static constexpr size_t   kMinShardCapacity  = 64;      // 每片少于 64 条时 LRU 近似太粗 → 减半
+    static constexpr int      kMaxShardsPerCore  = 4;       // 分片数超过核数的 4 倍后，再加分片基本不再降低争用
+
+    // maxSliceNum：在线 reshard 能扩到的分片上限，0 表示取 max(4*sliceNum, 64)
+    explicit ShardedCache(size_t totalCapacity, int sliceNum = std::thread::hardware_concurrency(),
+                          int maxSliceNum = 0)
+        : capacity_(totalCapacity)
+        , sliceNum_(sliceNum > 0 ? sliceNum : 1) {
+        const int n = sliceNum_.load();
+        maxSliceNum_ = std::max(n, maxSliceNum > 0 ? maxSliceNum : std::max(4 * n, 64));
+        slots_ = static_cast<Slot*>(::operator new(sizeof(Slot) * maxSliceNum_, std::align_val_t(alignof(Slot))));
+        for (int i = 0; i < maxSliceNum_; ++i) {
+            new (&slots_[i]) Slot(static_cast<int>(i < n ? shardCapacity(i, n) : 0));
+        }
+    }
+
+    ~ShardedCache() {
+        stopAutoTune();
+        for (int i = 0; i < maxSliceNum_; ++i) slots_[i].~Slot();
+        ::operator delete(slots_, std::align_val_t(alignof(Slot)));
+    }
+
+    ShardedCache(const ShardedCache&) = delete;
+    ShardedCache& operator=(const ShardedCache&) = delete;
+
+    void put(Key key, Value value) {
+        const size_t h = Hasher{}(key);
+        trackHot(h, key);
+        if (Shadow* s = shadowFor(h)) {
+            std::lock_guard<std::mutex> lock(shadowMutex_);
+            s->put(key, true);
+        }
+        const int n = sliceNum_.load();
+        slots_[h % n].cache.Policy::put(key, std::move(value));
+        rehome(h, key, n);
+    }
+
+    bool get(const Key& key, Value& value) {
+        const size_t h = Hasher{}(key);
+        trackHot(h, key);
+        Shadow* s = shadowFor(h);
+        if (!s) return lookup(h, key, value);
+        const bool hit = lookup(h, key, value);
+        std::lock_guard<std::mutex> lock(shadowMutex_);
+        bool dummy = false;
+        ++sampledGets_;
+        sampledHits_ += hit;
+        shadowHits_  += s->get(key, dummy);
+        return hit;
+    }
+
+    Value get(const Key& key) {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    // 以下三个在分片内只加一次锁、只查一次表。
+    // compute 是读-改-写，不能作用在已经被迁移方取空的旧分片上：先在目标分片登记 inflight 再确认路由没变，
+    // reshard 取空每个旧分片前等它的 inflight 归零；路由正在切换时改走慢路径，等迁移做完再按新路由执行
+    std::optional<Value> compute(const Key& key, const std::function<std::optional<Value>(const Value*)>& fn) {
+        const size_t h = Hasher{}(key);
+        trackHot(h, key);
+        const int n = sliceNum_.load();
+        {
+            Slot& slot = slots_[h % n];
+            InflightGuard guard(slot.inflight);
+            if (oldSliceNum_.load() == 0 && sliceNum_.load() == n) return slot.cache.Policy::compute(key, fn);
+        }
+        ReshardLock lock(*this);
+        return slots_[h % sliceNum_.load()].cache.Policy::compute(key, fn);
+    }
+
+    bool putIfAbsent(Key key, Value value) {
+        const size_t h = Hasher{}(key);
+        trackHot(h, key);
+        if (Shadow* s = shadowFor(h)) {
+            std::lock_guard<std::mutex> lock(shadowMutex_);
+            s->putIfAbsent(key, true);
+        }
+        return routed(key, [&](Policy& shard) { return shard.Policy::putIfAbsent(key, std::move(value)); });
+    }
+
+    bool getOrInsert(const Key& key, Value& value, const std::function<Value()>& factory) {
+        const size_t h = Hasher{}(key);
+        trackHot(h, key);
+        const bool hit = routed(key, [&](Policy& shard) { return shard.Policy::getOrInsert(key, value, factory); });
+        if (Shadow* s = shadowFor(h)) {
+            std::lock_guard<std::mutex> lock(shadowMutex_);
+            bool dummy = false;
+            ++sampledGets_;
+            sampledHits_ += hit;
+            shadowHits_  += s->getOrInsert(key, dummy, [] { return true; });
+        }
+        return hit;
+    }
+
+    bool remove(const Key& key) {
+        const size_t h = Hasher{}(key);
+        if (Shadow* s = shadowFor(h)) {
+            std::lock_guard<std::mutex> lock(shadowMutex_);
+            s->remove(key);
+        }
+        const int n = sliceNum_.load();
+        bool removed = slots_[h % n].cache.Policy::remove(key);
+        if (oldSliceNum_.load() == 0 && sliceNum_.load() == n) return removed;
+        ReshardLock lock(*this);
+        removed |= slots_[h % sliceNum_.load()].cache.Policy::remove(key);
+        return removed;
+    }
+
+    // 影子缓存只存 bool，谓词无从判断，抽样统计在这之后会略偏乐观，直到影子缓存自然淘汰
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) {
+        ReshardLock lock(*this);
+        size_t n = 0;
+        for (int i = 0; i < maxSliceNum_; ++i) n += slots_[i].cache.Policy::invalidateIf(pred);
+        return n;
+    }
+
+    void invalidateAll() {
+        ReshardLock lock(*this);
+        for (int i = 0; i < maxSliceNum_; ++i) slots_[i].cache.Policy::invalidateAll();
+        if (!shadowOwner_) return;
+        std::lock_guard<std::mutex> shadowLock(shadowMutex_);
+        shadowOwner_->invalidateAll();
+    }
+
+    // 分片拿到的是包装过的监听器：持有 reshardMutex_ 的线程（reshard / setCapacity / 迁移中的慢路径）上产生的批次
+    // 先暂存，释放 reshardMutex_ 之后再投递，监听器回调缓存时不会在这把锁上自锁
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) {
+        ReshardLock lock(*this);
+        RemovalListener<Key, Value> wrapped;
+        if (listener) {
+            auto user = std::make_shared<const RemovalListener<Key, Value>>(std::move(listener));
+            wrapped = [this, user](std::vector<RemovalNotification<Key, Value>>& batch) {
+                if (reshardOwner_.load(std::memory_order_relaxed) != std::this_thread::get_id()) {
+                    (*user)(batch);
+                    return;
+                }
+                deferred_.emplace_back();   //当前线程持有 reshardMutex_，deferred_ 归它独占
+                deferred_.back().listener = user;
+                deferred_.back().items.swap(batch);
+            };
+        }
+        for (int i = 0; i < maxSliceNum_; ++i) slots_[i].cache.Policy::setRemovalListener(wrapped, batchSize);
+    }
+
+    // 各分片不足一批的通知也投递出去；由维护线程定期调用
+    void flushRemovals() {
+        for (int i = 0; i < maxSliceNum_; ++i) slots_[i].cache.Policy::flushRemovals();
+    }
+
+    // 各分片明细累加，外加分片数组本身
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        for (int i = 0; i < maxSliceNum_; ++i) m += slots_[i].cache.Policy::memoryUsage();
+        m.metadata += maxSliceNum_ * sizeof(Slot);
+        return m;
+    }
+
+    // 逐个分片调整容量；每个分片内部分批驱逐
+    void setCapacity(size_t capacity) {
+        ReshardLock lock(*this);
+        capacity_ = capacity;
+        const int n = sliceNum_.load();
+        for (int i = 0; i < n; ++i) slots_[i].cache.Policy::setCapacity(shardCapacity(i, n));
+        if (!shadowOwner_) return;
+        std::lock_guard<std::mutex> shadowLock(shadowMutex_);
+        shadowOwner_->setCapacity(shadowCapacity());
+    }
+
+    // 在线调整分片数（不超过 maxSliceNum）；返回实际生效的分片数
+    int reshard(int newSliceNum) {
+        ReshardLock lock(*this);
+        newSliceNum = std::max(1, std::min(newSliceNum, maxSliceNum_));
+        const int old = sliceNum_.load();
+        if (newSliceNum == old) return old;
+
+        //1) 准备新分片：已有分片先放宽到新旧两者较大值，迁移完再收紧
+        for (int i = 0; i < newSliceNum; ++i) {
+            const size_t cap = shardCapacity(i, newSliceNum);
+            slots_[i].cache.Policy::setCapacity(i < old ? std::max(cap, shardCapacity(i, old)) : cap);
+        }
+        for (int i = 0; i < old; ++i) slots_[i].migrated.store(false);
+        oldSliceNum_.store(old);
+        sliceNum_.store(newSliceNum);   //从此刻起新请求按新路由
+
+        //2) 逐个迁移旧分片：一次只锁一个分片取出全部条目，再按新路由回填；
+        //   取空之前等按旧路由进来的 compute 做完
+        for (int i = 0; i < old; ++i) {
+            while (slots_[i].inflight.load() != 0) std::this_thread::yield();
+            auto entries = slots_[i].cache.drain();
+            for (auto& kv : entries) {
+                const size_t idx = Hasher{}(kv.first) % newSliceNum;
+                slots_[idx].cache.putIfAbsent(std::move(kv.first), std::move(kv.second));
+            }
+            slots_[i].migrated.store(true);
+        }
+
+        //3) 收尾：收紧容量；缩减分片数时多出来的分片容量置 0，可供以后再扩
+        for (int i = 0; i < std::max(old, newSliceNum); ++i) {
+            slots_[i].cache.Policy::setCapacity(i < newSliceNum ? shardCapacity(i, newSliceNum) : 0);
+        }
+        oldSliceNum_.store(0);
+        if (auto* t = hotKeys_.load(std::memory_order_acquire)) t->reset();
+        return newSliceNum;
+    }
+
+    std::vector<ShardStats> shardStats() const {
+        const int n = sliceNum_.load();
+        std::vector<ShardStats> out(n);
+        for (int i = 0; i < n; ++i) {
+            out[i].lock     = contentionOf(slots_[i].cache);
+            out[i].entries  = slots_[i].cache.Policy::memoryUsage().entries;
+            out[i].capacity = shardCapacity(i, n);
+        }
+        return out;
+    }
+
+    // 打开抽样影子缓存（命中率损失的统计来源）；只能打开一次。autoTune / startAutoTune 会自动打开
+    void enableTuningStats() {
+        ReshardLock lock(*this);
+        if (shadowOwner_) return;
+        shadowOwner_ = std::make_unique<Shadow>(static_cast<int>(shadowCapacity()));
+        shadow_.store(shadowOwner_.get(), std::memory_order_release);
+    }
+
+    // 当前窗口的统计与建议分片数；没打开 enableTuningStats 时只有锁争用数据
+    ShardTuningReport tuningReport() const {
+        ShardTuningReport r;
+        r.sliceNum = sliceNum_.load();
+        for (int i = 0; i < r.sliceNum; ++i) r.lock += contentionOf(slots_[i].cache);
+        {
+            std::lock_guard<std::mutex> lock(shadowMutex_);
+            r.sampledGets = sampledGets_;
+            if (sampledGets_) {
+                r.shardedHitRatio = double(sampledHits_) / double(sampledGets_);
+                r.globalHitRatio  = double(shadowHits_) / double(sampledGets_);
+                r.hitRatioLoss    = r.globalHitRatio - r.shardedHitRatio;
+            }
+        }
+        r.recommendedSliceNum = recommend(r);
+        return r;
+    }
+
+    int recommendSliceNum() const { return tuningReport().recommendedSliceNum; }
+
+    // 按建议重新分片（如有必要），然后开始新的统计窗口；返回调整后的分片数
+    int autoTune() {
+        enableTuningStats();
+        const int rec = recommendSliceNum();
+        const int n = rec != sliceNum_.load() ? reshard(rec) : rec;
+        resetTuningStats();
+        return n;
+    }
+
+    void resetTuningStats() {
+        if constexpr (HasContention<Policy>::value) {
+            for (int i = 0; i < maxSliceNum_; ++i) slots_[i].cache.resetContention();
+        }
+        std::lock_guard<std::mutex> lock(shadowMutex_);
+        sampledGets_ = sampledHits_ = shadowHits_ = 0;
+    }
+
+    // 后台线程每隔 interval 调用一次 autoTune；重复调用会先停掉旧线程
+    void startAutoTune(std::chrono::milliseconds interval) {
+        stopAutoTune();
+        enableTuningStats();
+        std::lock_guard<std::mutex> lock(tunerMutex_);
+        tunerStop_ = false;
+        tuner_ = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lk(tunerMutex_);
+            while (!tunerCv_.wait_for(lk, interval, [this] { return tunerStop_; })) {
+                lk.unlock();
+                autoTune();
+                lk.lock();
+            }
+        });
+    }
+
+    void stopAutoTune() {
+        {
+            std::lock_guard<std::mutex> lock(tunerMutex_);
+            tunerStop_ = true;
+        }
+        tunerCv_.notify_all();
+        if (tuner_.joinable()) tuner_.join();
+    }
+
+    // 打开热点统计：每个分片跟踪 capacity 个 key，每 2^sampleShift 个请求抽一个；只能打开一次，重复调用不改参数
+    void enableHotKeyTracking(size_t capacity = 64, int sampleShift = 4) {
+        ReshardLock lock(*this);
+        if (hotKeysOwner_) return;
+        hotKeysOwner_ = std::make_unique<HotKeyTracker<Key, Hasher>>(maxSliceNum_, capacity, sampleShift);
+        hotKeys_.store(hotKeysOwner_.get(), std::memory_order_release);
+    }
+
+    // 当前窗口的前 k 个热点 key 与各分片负载；没打开时为空
+    HotKeyReport<Key> hotKeys(size_t k = 16) const {
+        if (auto* t = hotKeys_.load(std::memory_order_acquire)) {
+            HotKeyReport<Key> r = t->report(k);
+            r.shardLoad.resize(sliceNum_.load());   //只看活跃分片
+            return r;
+        }
+        return HotKeyReport<Key>{};
+    }
+
+    // refreshHotSet / isHot / reset / summary 直接调它；没打开时为 nullptr
+    HotKeyTracker<Key, Hasher>* hotKeyTracker() { return hotKeys_.load(std::memory_order_acquire); }
+
+    // 依次访问每个分片（含当前未启用的），如 HashLfuCache::purge
+    template<typename Fn>
+    void forEachShard(Fn&& fn) {
+        for (int i = 0; i < maxSliceNum_; ++i) fn(slots_[i].cache);
+    }
+
+    int sliceNum() const { return sliceNum_.load(); }
+    int maxSliceNum() const { return maxSliceNum_; }
+    size_t capacity() const { return capacity_; }
+
+    // key 落在哪个分片；配合 ShardedSlabArena 使用：value 直接在所属分片的 arena 中构造
+    size_t shardIndex(const Key& key) const {
+        return Hasher{}(key) % static_cast<size_t>(sliceNum_.load());
+    }
+
+private:
+    // 一个分片独占整数条 cache line
+    struct alignas(64) Slot {
+        explicit Slot(int capacity) : cache(capacity) {}
+        Policy            cache;
+        std::atomic<bool> migrated{true};   //reshard 时：作为旧分片是否已迁移完
+        std::atomic<int>  inflight{0};      //正按当前路由在本分片上执行的 compute 数
+    };
+
+    // 替代 reshardMutex_ 上的 lock_guard：持锁期间本线程产生的删除通知攒在 deferred_ 里，解锁之后再投递
+    class ReshardLock {
+    public:
+        explicit ReshardLock(ShardedCache& c) : c_(c) {
+            c_.reshardMutex_.lock();
+            c_.reshardOwner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        }
+        ~ReshardLock() {
+            std::vector<typename RemovalQueue<Key, Value>::Batch> batches;
+            batches.swap(c_.deferred_);
+            c_.reshardOwner_.store(std::thread::id(), std::memory_order_relaxed);
+            c_.reshardMutex_.unlock();
+            for (auto& b : batches) RemovalQueue<Key, Value>::deliver(b);
+        }
+        ReshardLock(const ReshardLock&) = delete;
+        ReshardLock& operator=(const ReshardLock&) = delete;
+
+    private:
+        ShardedCache& c_;
+    };
+
+    struct InflightGuard {
+        explicit InflightGuard(std::atomic<int>& c) : c_(c) { c_.fetch_add(1); }
+        ~InflightGuard() { c_.fetch_sub(1); }
+        std::atomic<int>& c_;
+    };
+
+    bool lookup(size_t h, const Key& key, Value& value) {
+        const int n = sliceNum_.load();
+        const size_t idx = h % n;
+        if (slots_[idx].cache.Policy::get(key, value)) return true;
+        const int old = oldSliceNum_.load();
+        if (old == 0) return false;
+        const size_t oldIdx = h % old;
+        if (oldIdx == idx || slots_[oldIdx].migrated.load()) return false;
+        return slots_[oldIdx].cache.Policy::get(key, value);
+    }
+
+    //写入期间 reshard 切换了路由：这次写入可能落在已迁移完的旧分片里而读不到，
+    //从旧分片读回来再按新路由补写一次（读不到说明已被迁移方带走）；
+    //overwrite 为 false 时（putIfAbsent / getOrInsert 插入的值）不覆盖迁移过去的值
+    void rehome(size_t h, const Key& key, int n, bool overwrite = true) {
+        const int now = sliceNum_.load();
+        if (now == n) return;
+        Value v{};
+        if (!slots_[h % n].cache.Policy::get(key, v)) return;
+        if (overwrite) slots_[h % now].cache.Policy::put(key, std::move(v));
+        else slots_[h % now].cache.Policy::putIfAbsent(key, std::move(v));
+    }
+
+    //迁移中：等迁移做完再按新路由执行，旧分片里的值不会被忽略
+    template<typename Op>
+    auto routed(const Key& key, Op&& op) {
+        const size_t h = Hasher{}(key);
+        const int n = sliceNum_.load();
+        if (oldSliceNum_.load() != 0) {
+            ReshardLock lock(*this);
+            return op(slots_[h % sliceNum_.load()].cache);
+        }
+        auto r = op(slots_[h % n].cache);
+        rehome(h, key, n, false);
+        return r;
+    }
+
+    void trackHot(size_t h, const Key& key) {
+        if (auto* t = hotKeys_.load(std::memory_order_acquire)) t->record(static_cast<int>(h % sliceNum_.load()), key);
+    }
+
+    static ContentionStats contentionOf(const Policy& p) {
+        if constexpr (HasContention<Policy>::value) return p.contention();
+        else return ContentionStats{};
+    }
+
+    // 影子缓存没打开、或这个 key 没被抽中时返回 nullptr
+    Shadow* shadowFor(size_t h) const {
+        Shadow* s = shadow_.load(std::memory_order_acquire);
+        return s && sampled(h) ? s : nullptr;
+    }
+
+    // 抽样必须用与分片下标无关的位：std::hash<int> 是恒等映射，先用 murmur3 finalizer 打散
+    static bool sampled(size_t h) {
+        const uint64_t x = fmix64(h);
+        return (x & ((uint64_t(1) << kSampleShift) - 1)) == 0;
+    }
+    size_t shadowCapacity() const { return std::max<size_t>(1, capacity_ >> kSampleShift); }
+
+    int recommend(const ShardTuningReport& r) const {
+        const int n = r.sliceNum;
+        if (r.lock.acquisitions < kMinAcquisitions) return n;
+        const double rate = r.lock.contentionRate();
+        const double wait = r.lock.waitNsPerAcquisition();
+        if (rate > kGrowContention || wait > kGrowWaitNs) {
+            const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+            return std::max(n, std::min({n * 2, maxSliceNum_, kMaxShardsPerCore * cores}));
+        }
+        if (n > 1 && rate < kShrinkContention && wait < kShrinkWaitNs) {
+            const bool lossy = r.sampledGets >= kMinSampledGets && r.hitRatioLoss > kMaxHitRatioLoss;
+            const bool tiny  = capacity_ / static_cast<size_t>(n) < kMinShardCapacity;
+            if (lossy || tiny) return n / 2;
+        }
+        return n;
+    }
+
+    // 公平拆分：前 r 片分配 base+1，其余 base；总和 == capacity_
+    size_t shardCapacity(int idx, int n) const {
+        const size_t base = capacity_ / static_cast<size_t>(n);
+        const size_t rem  = capacity_ % static_cast<size_t>(n);
+        return base + (static_cast<size_t>(idx) < rem ? 1u : 0u);
+    }
+
+    int                                    maxSliceNum_ = 0;
+    Slot*                                  slots_ = nullptr; //连续、64B 对齐的分片数组
+    size_t                                 capacity_;
+    std::atomic<int>                       sliceNum_;
+    std::atomic<int>                       oldSliceNum_{0}; //迁移中的旧分片数，0 表示没有迁移
+    std::mutex                             reshardMutex_;   //串行化 reshard / setCapacity / 批量失效
+    std::atomic<std::thread::id>           reshardOwner_{}; //持有 reshardMutex_ 的线程（经 ReshardLock）
+    std::vector<typename RemovalQueue<Key, Value>::Batch> deferred_;   //持锁期间攒下的通知，受 reshardMutex_ 保护
+
+    std::unique_ptr<Shadow>                shadowOwner_;    //不分片的抽样影子缓存，enableTuningStats 之后才有
+    std::atomic<Shadow*>                   shadow_{nullptr}; //请求路径只读这个指针
+    mutable std::mutex                     shadowMutex_;    //保护影子缓存与下面的计数
+    uint64_t                               sampledGets_ = 0;
+    uint64_t                               sampledHits_ = 0;
+    uint64_t                               shadowHits_  = 0;
+
+    std::unique_ptr<HotKeyTracker<Key, Hasher>> hotKeysOwner_;
+    std::atomic<HotKeyTracker<Key, Hasher>*>    hotKeys_{nullptr};  //读路径只读这个指针
+
+    std::thread                            tuner_;
+    std::mutex                             tunerMutex_;
+    std::condition_variable                tunerCv_;
+    bool                                   tunerStop_ = false;
+};
+
+// 把任意“长得像缓存”的类型（如 ShardedCache）包装成 CachePolicy，需要运行时多态时才用
+template<typename Impl>
+class CachePolicyAdapter : public Impl,
+                           public CachePolicy<typename Impl::key_type, typename Impl::mapped_type> {
+    using Key   = typename Impl::key_type;
+    using Value = typename Impl::mapped_type;
+public:
+    using Impl::Impl;
+
+    void put(Key key, Value value) override { Impl::put(std::move(key), std::move(value)); }
+    bool get(Key key, Value& value) override { return Impl::get(key, value); }
+    Value get(Key key) override { return Impl::get(key); }
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        return Impl::compute(key, fn);
+    }
+    bool putIfAbsent(Key key, Value value) override { return Impl::putIfAbsent(std::move(key), std::move(value)); }
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        return Impl::getOrInsert(key, value, factory);
+    }
+    bool remove(Key key) override { return Impl::remove(key); }
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        return Impl::invalidateIf(pred);
+    }
+    void invalidateAll() override { Impl::invalidateAll(); }
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        Impl::setRemovalListener(std::move(listener), batchSize);
+    }
+    void flushRemovals() override { Impl::flushRemovals(); }
+    MemoryUsage memoryUsage() const override { return Impl::memoryUsage(); }
+    void setCapacity(size_t capacity) override { Impl::setCapacity(capacity); }
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,615 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CachePolicy.h"
+#include "HashMix.h"
+
+/*  SharedMemoryCache.h
+    多进程共享的分片 LRU：索引、节点、value 全部放在一段共享内存里，同一台机器上的多个 worker 进程共用一份缓存，
+    不再每个进程各缓存一遍。
+    - 段内只有偏移量没有指针（各进程把段映射到不同地址）：段头记录几何参数，每个分片头记录自己的节点数组、
+      槽数组相对段首的偏移，链表和索引都用 32 位下标；
+    - 每个分片和 FlatLruList 一样：节点数组 + 开放寻址槽数组（线性探测，backward-shift 删除）+ 下标串起的 LRU 链表。
+      空间在创建时一次分配好，不扩容；槽里存 节点下标+1，全 0 的内存就是一张空表，ftruncate 出来的段不用逐个初始化；
+    - 每个分片一把进程间共享的 robust 互斥锁。持锁进程崩溃后，下一个加锁的进程拿到 EOWNERDEAD：
+      分片可能改到一半，直接清空这个分片再标记锁恢复一致（丢一个分片的缓存，不会读到坏数据），记入 recoveries；
+    - key/value 必须平凡可拷贝（直接 memcpy 进段里）；hash 用 std::hash 再打散，各进程必须是同一份程序（同一个 hash）；
+    - 两种段：匿名段（MAP_SHARED|MAP_ANONYMOUS）在构造之后 fork 出来的子进程里共享；具名段（shm_open）
+      由第一个打开的进程创建并初始化，之后打开的进程等它初始化完成、核对几何参数后直接挂上去。
+      打不开或几何参数不一致时 valid() 为 false，error() 是对应的 errno，缓存表现为容量 0；
+    - 删除通知只发给本进程的监听器，且只包含本进程的操作引起的删除；命中 / 未命中 / 淘汰计数在段内，是所有进程的合计；
+    - 容量按分片在创建时固定上限，setCapacity 只能在这个上限以内调整。
+*/
+
+namespace CacheSystem {
+
+struct SharedCacheStats {
+    uint64_t hits       = 0;
+    uint64_t misses     = 0;
+    uint64_t evictions  = 0;
+    uint64_t recoveries = 0;   //持锁进程崩溃后清空重建的分片次数
+};
+
+template<typename Key, typename Value, typename Hasher = std::hash<Key>>
+class SharedMemoryCache : public CachePolicy<Key, Value> {
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "SharedMemoryCache 的 key/value 必须平凡可拷贝");
+public:
+    // 匿名段：构造之后 fork 的子进程共享同一份缓存
+    explicit SharedMemoryCache(int capacity, int shards = 8) {
+        init(capacity, shards);
+        void* p = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            error_ = errno;
+            return;
+        }
+        base_ = static_cast<char*>(p);
+        format();
+        attachLocal();
+    }
+
+    // 具名段（如 "/app-cache"）：不存在则创建，已存在则挂上去；几何参数必须与创建者一致
+    SharedMemoryCache(const std::string& name, int capacity, int shards = 8) {
+        init(capacity, shards);
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        const bool creator = fd >= 0;
+        if (!creator && errno == EEXIST) fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0) {
+            error_ = errno;
+            return;
+        }
+        if (creator && ::ftruncate(fd, static_cast<off_t>(bytes_)) != 0) {
+            error_ = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return;
+        }
+        if (!creator && !waitForSize(fd)) {
+            ::close(fd);
+            return;
+        }
+        void* p = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);   //映射建立后不再需要 fd
+        if (p == MAP_FAILED) {
+            error_ = errno;
+            return;
+        }
+        base_ = static_cast<char*>(p);
+        if (creator) {
+            format();
+        } else if (!waitForReady()) {
+            ::munmap(base_, bytes_);
+            base_ = nullptr;
+            return;
+        }
+        attachLocal();
+    }
+
+    ~SharedMemoryCache() override {
+        if (base_) ::munmap(base_, bytes_);
+    }
+
+    SharedMemoryCache(const SharedMemoryCache&) = delete;
+    SharedMemoryCache& operator=(const SharedMemoryCache&) = delete;
+
+    // 删除具名段；已挂上的进程不受影响，全部退出后内存才释放
+    static bool unlink(const std::string& name) { return ::shm_unlink(name.c_str()) == 0; }
+
+    bool valid() const { return base_ != nullptr; }
+    int error() const { return error_; }
+
+    void put(Key key, Value value) override {
+        if (!base_) return;
+        const uint64_t h = hashOf(key);
+        Local& l = local(h);
+        Lock lk(l.mutex, l.removals);
+        ShardHeader& s = *l.shard;
+        const uint32_t i = find(l, key, static_cast<uint32_t>(h));
+        if (i != kNil) {
+            Node& n = nodes(s)[i];
+            l.removals.push(n.key, Value(n.value), RemovalCause::Replaced);
+            std::memcpy(&n.value, &value, sizeof(Value));
+            touch(s, i);
+            return;
+        }
+        insert(l, key, value, static_cast<uint32_t>(h));
+    }
+
+    bool get(Key key, Value& value) override {
+        if (!base_) return false;
+        const uint64_t h = hashOf(key);
+        Local& l = local(h);
+        Lock lk(l.mutex, l.removals);
+        ShardHeader& s = *l.shard;
+        const uint32_t i = find(l, key, static_cast<uint32_t>(h));
+        if (i == kNil) {
+            ++s.misses;
+            return false;
+        }
+        std::memcpy(&value, &nodes(s)[i].value, sizeof(Value));
+        touch(s, i);
+        ++s.hits;
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        if (!base_) return fn(nullptr);
+        const uint64_t h = hashOf(key);
+        Local& l = local(h);
+        Lock lk(l.mutex, l.removals);
+        ShardHeader& s = *l.shard;
+        const uint32_t i = find(l, key, static_cast<uint32_t>(h));
+        std::optional<Value> result = fn(i != kNil ? &nodes(s)[i].value : nullptr);
+        if (i != kNil) {
+            if (!result) {
+                retire(l, i, RemovalCause::Explicit);
+                return result;
+            }
+            Node& n = nodes(s)[i];
+            l.removals.push(n.key, Value(n.value), RemovalCause::Replaced);
+            std::memcpy(&n.value, &*result, sizeof(Value));
+            touch(s, i);
+        } else if (result) {
+            insert(l, key, *result, static_cast<uint32_t>(h));
+        }
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        if (!base_) return false;
+        const uint64_t h = hashOf(key);
+        Local& l = local(h);
+        Lock lk(l.mutex, l.removals);
+        if (find(l, key, static_cast<uint32_t>(h)) != kNil) return false;
+        return insert(l, key, value, static_cast<uint32_t>(h));
+    }
+
+    // factory 在分片锁内执行：同一时刻别的进程也在等这个分片
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        if (!base_) {
+            value = factory();
+            return false;
+        }
+        const uint64_t h = hashOf(key);
+        Local& l = local(h);
+        Lock lk(l.mutex, l.removals);
+        ShardHeader& s = *l.shard;
+        const uint32_t i = find(l, key, static_cast<uint32_t>(h));
+        if (i != kNil) {
+            std::memcpy(&value, &nodes(s)[i].value, sizeof(Value));
+            touch(s, i);
+            ++s.hits;
+            return true;
+        }
+        ++s.misses;
+        value = factory();
+        insert(l, key, value, static_cast<uint32_t>(h));
+        return false;
+    }
+
+    bool remove(Key key) override {
+        if (!base_) return false;
+        const uint64_t h = hashOf(key);
+        Local& l = local(h);
+        Lock lk(l.mutex, l.removals);
+        const uint32_t i = find(l, key, static_cast<uint32_t>(h));
+        if (i == kNil) return false;
+        retire(l, i, RemovalCause::Explicit);
+        return true;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        size_t n = 0;
+        for (int k = 0; k < shardNum_ && base_; ++k) {
+            Local& l = locals_[k];
+            Lock lk(l.mutex, l.removals);
+            ShardHeader& s = *l.shard;
+            for (uint32_t i = s.head; i != kNil;) {
+                Node& node = nodes(s)[i];
+                const uint32_t next = node.next;
+                if (node.gen != s.generation) {
+                    retire(l, i, RemovalCause::Expired);
+                } else if (pred(node.key, node.value)) {
+                    retire(l, i, RemovalCause::Explicit);
+                    ++n;
+                }
+                i = next;
+            }
+        }
+        return n;
+    }
+
+    // 每个分片代数 +1，对所有进程生效；旧代节点在被访问时删除，其余的排在 LRU 端先被淘汰
+    void invalidateAll() override {
+        for (int k = 0; k < shardNum_ && base_; ++k) {
+            Local& l = locals_[k];
+            Lock lk(l.mutex, l.removals);
+            ++l.shard->generation;
+        }
+    }
+
+    // 只能在创建时的上限以内调整；缩容的分片当场淘汰到新上限
+    void setCapacity(size_t capacity) override {
+        for (int k = 0; k < shardNum_ && base_; ++k) {
+            Local& l = locals_[k];
+            Lock lk(l.mutex, l.removals);
+            ShardHeader& s = *l.shard;
+            s.capacity = static_cast<uint32_t>(std::min<size_t>(shardCapOf(capacity, k), shardCap_));
+            while (s.size > s.capacity) evictOldest(l);
+        }
+    }
+
+    // 整段共享内存，所有进程共用一份
+    MemoryUsage memoryUsage() const override {
+        MemoryUsage m;
+        if (!base_) return m;
+        for (int k = 0; k < shardNum_; ++k) {
+            Local& l = locals_[k];
+            std::lock_guard<ShardMutex> lk(l.mutex);
+            m.entries += l.shard->size;
+        }
+        const size_t nodeCount = size_t(shardNum_) * shardCap_;
+        m.index    = size_t(shardNum_) * shardSlots_ * sizeof(Slot);
+        m.nodes    = nodeCount * (sizeof(Node) - sizeof(Value));
+        m.values   = nodeCount * sizeof(Value);
+        m.metadata = bytes_ - m.index - m.nodes - m.values;
+        return m;
+    }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        for (int k = 0; k < shardNum_ && base_; ++k) {
+            std::lock_guard<ShardMutex> lk(locals_[k].mutex);
+            locals_[k].removals.setListener(listener, batchSize);
+        }
+    }
+
+    void flushRemovals() override {
+        for (int k = 0; k < shardNum_ && base_; ++k) {
+            Lock lk(locals_[k].mutex, locals_[k].removals, true);
+        }
+    }
+
+    size_t size() const { return base_ ? memoryUsage().entries : 0; }
+    bool empty() const { return size() == 0; }
+    size_t segmentBytes() const { return bytes_; }
+
+    // 段内计数，所有进程的合计
+    SharedCacheStats stats() const {
+        SharedCacheStats st;
+        for (int k = 0; k < shardNum_ && base_; ++k) {
+            Local& l = locals_[k];
+            std::lock_guard<ShardMutex> lk(l.mutex);
+            st.hits       += l.shard->hits;
+            st.misses     += l.shard->misses;
+            st.evictions  += l.shard->evictions;
+            st.recoveries += l.shard->recoveries;
+        }
+        return st;
+    }
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr uint64_t kMagic = 0x53484d4341434845ULL;   //"SHMCACHE"
+    static constexpr uint32_t kVersion = 1;
+
+    // ---- 段内布局：段头 | 分片头 × shards | 每个分片的节点数组 | 每个分片的槽数组 ----
+    struct SegmentHeader {
+        uint64_t              magic;
+        uint32_t              version;
+        uint32_t              keySize;
+        uint32_t              valueSize;
+        uint32_t              shards;
+        uint32_t              shardCapacity;   //每个分片的节点数上限
+        uint32_t              shardSlots;      //每个分片的槽数（2 的幂）
+        uint64_t              bytes;
+        std::atomic<uint32_t> ready;           //创建者初始化完成后置 1
+    };
+
+    struct alignas(64) ShardHeader {
+        pthread_mutex_t mutex;
+        uint64_t        nodesOffset;   //相对段首
+        uint64_t        slotsOffset;
+        uint32_t        head;          //LRU 端
+        uint32_t        tail;          //MRU 端
+        uint32_t        free;          //空闲链，借用 next 串起来
+        uint32_t        used;          //节点数组里用过的前缀长度，之后的节点从未分配过
+        uint32_t        size;
+        uint32_t        capacity;      //当前容量（不超过 shardCapacity）
+        uint32_t        generation;
+        uint64_t        hits, misses, evictions, recoveries;
+    };
+
+    struct Node {
+        Key      key;
+        Value    value;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t gen;   //写入时的代数
+        uint32_t hash;
+    };
+
+    struct Slot {
+        uint32_t node;   //节点下标 + 1，0 表示空槽
+        uint32_t hash;
+    };
+
+    // 进程内的分片锁包装：加锁时处理持锁进程崩溃（EOWNERDEAD）
+    class ShardMutex {
+    public:
+        void bind(ShardHeader* shard, SharedMemoryCache* owner) {
+            shard_ = shard;
+            owner_ = owner;
+        }
+        void lock() {
+            const int rc = ::pthread_mutex_lock(&shard_->mutex);
+            if (rc == EOWNERDEAD) {
+                owner_->resetShard(*shard_);
+                ++shard_->recoveries;
+                ::pthread_mutex_consistent(&shard_->mutex);
+            }
+        }
+        void unlock() { ::pthread_mutex_unlock(&shard_->mutex); }
+
+    private:
+        ShardHeader*       shard_ = nullptr;
+        SharedMemoryCache* owner_ = nullptr;
+    };
+
+    using Lock = NotifyingLock<ShardMutex, Key, Value>; //解锁后投递本进程的删除通知
+
+    struct Local {
+        ShardHeader*             shard = nullptr;
+        Node*                    nodes = nullptr;
+        Slot*                    slots = nullptr;
+        mutable ShardMutex       mutex;
+        RemovalQueue<Key, Value> removals;   //本进程锁内攒的删除通知
+    };
+
+    static uint64_t hashOf(const Key& key) {
+        return fmix64(static_cast<uint64_t>(Hasher{}(key)));
+    }
+
+    static size_t alignUp(size_t n) { return (n + 63) & ~size_t(63); }
+
+    size_t shardCapOf(size_t capacity, int k) const {
+        return capacity / shardNum_ + (size_t(k) < capacity % shardNum_ ? 1 : 0);
+    }
+
+    // 计算几何参数和段大小
+    void init(int capacity, int shards) {
+        shardNum_ = std::max(1, shards);
+        const size_t cap = capacity > 0 ? static_cast<size_t>(capacity) : 0;
+        shardCap_ = static_cast<uint32_t>((cap + shardNum_ - 1) / shardNum_);
+        shardSlots_ = 8;
+        while (shardSlots_ < size_t(shardCap_) * 2) shardSlots_ <<= 1;
+        initialCap_ = cap;
+        nodesAt_ = alignUp(sizeof(SegmentHeader)) + size_t(shardNum_) * sizeof(ShardHeader);
+        slotsAt_ = alignUp(nodesAt_ + size_t(shardNum_) * shardCap_ * sizeof(Node));
+        bytes_ = alignUp(slotsAt_ + size_t(shardNum_) * shardSlots_ * sizeof(Slot));
+    }
+
+    SegmentHeader& header() const { return *reinterpret_cast<SegmentHeader*>(base_); }
+    ShardHeader& shardAt(int k) const {
+        return reinterpret_cast<ShardHeader*>(base_ + alignUp(sizeof(SegmentHeader)))[k];
+    }
+    Node* nodes(const ShardHeader& s) const { return reinterpret_cast<Node*>(base_ + s.nodesOffset); }
+
+    // 创建者初始化：段已经是全 0，只需写段头、分片头和锁
+    void format() {
+        SegmentHeader& h = header();
+        h.magic = kMagic;
+        h.version = kVersion;
+        h.keySize = sizeof(Key);
+        h.valueSize = sizeof(Value);
+        h.shards = static_cast<uint32_t>(shardNum_);
+        h.shardCapacity = shardCap_;
+        h.shardSlots = static_cast<uint32_t>(shardSlots_);
+        h.bytes = bytes_;
+        pthread_mutexattr_t attr;
+        ::pthread_mutexattr_init(&attr);
+        ::pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        ::pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        for (int k = 0; k < shardNum_; ++k) {
+            ShardHeader& s = shardAt(k);
+            ::pthread_mutex_init(&s.mutex, &attr);
+            s.nodesOffset = nodesAt_ + size_t(k) * shardCap_ * sizeof(Node);
+            s.slotsOffset = slotsAt_ + size_t(k) * shardSlots_ * sizeof(Slot);
+            s.capacity = static_cast<uint32_t>(shardCapOf(initialCap_, k));
+            resetShard(s);
+        }
+        ::pthread_mutexattr_destroy(&attr);
+        h.ready.store(1, std::memory_order_release);
+    }
+
+    // 等创建者 ftruncate 完成
+    bool waitForSize(int fd) {
+        for (int tries = 0; tries < kOpenRetries; ++tries) {
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                error_ = errno;
+                return false;
+            }
+            if (st.st_size != 0) {
+                if (static_cast<size_t>(st.st_size) == bytes_) return true;
+                error_ = EINVAL;   //几何参数和创建者不一致
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        error_ = ETIMEDOUT;
+        return false;
+    }
+
+    // 等创建者初始化完成，再核对几何参数
+    bool waitForReady() {
+        SegmentHeader& h = header();
+        for (int tries = 0; h.ready.load(std::memory_order_acquire) == 0; ++tries) {
+            if (tries >= kOpenRetries) {
+                error_ = ETIMEDOUT;
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (h.magic != kMagic || h.version != kVersion || h.keySize != sizeof(Key) || h.valueSize != sizeof(Value)
+            || h.shards != uint32_t(shardNum_) || h.shardCapacity != shardCap_ || h.shardSlots != shardSlots_) {
+            error_ = EINVAL;
+            return false;
+        }
+        return true;
+    }
+
+    void attachLocal() {
+        locals_.reset(new Local[shardNum_]);
+        for (int k = 0; k < shardNum_; ++k) {
+            ShardHeader& s = shardAt(k);
+            locals_[k].shard = &s;
+            locals_[k].nodes = nodes(s);
+            locals_[k].slots = reinterpret_cast<Slot*>(base_ + s.slotsOffset);
+            locals_[k].mutex.bind(&s, this);
+        }
+    }
+
+    Local& local(uint64_t h) const { return locals_[(h >> 32) % uint64_t(shardNum_)]; }
+
+    // 清空一个分片（创建时，或持锁进程崩溃后）：链表、计数归零，槽数组清 0
+    void resetShard(ShardHeader& s) {
+        s.head = s.tail = s.free = kNil;
+        s.used = 0;
+        s.size = 0;
+        std::memset(base_ + s.slotsOffset, 0, shardSlots_ * sizeof(Slot));
+    }
+
+    // 命中返回节点下标，否则 kNil；旧代节点当作未命中并顺手删除
+    uint32_t find(Local& l, const Key& key, uint32_t h) {
+        const size_t mask = shardSlots_ - 1;
+        for (size_t pos = h & mask;; pos = (pos + 1) & mask) {
+            const Slot s = l.slots[pos];
+            if (s.node == 0) return kNil;
+            const uint32_t i = s.node - 1;
+            if (s.hash == h && std::memcmp(&l.nodes[i].key, &key, sizeof(Key)) == 0) {
+                if (l.nodes[i].gen == l.shard->generation) return i;
+                retire(l, i, RemovalCause::Expired);
+                return kNil;
+            }
+        }
+    }
+
+    // 调用方保证 key 不存在；插在 MRU 端
+    bool insert(Local& l, const Key& key, const Value& value, uint32_t h) {
+        ShardHeader& s = *l.shard;
+        if (s.capacity == 0) return false;
+        while (s.size >= s.capacity) evictOldest(l);
+        uint32_t i;
+        if (s.free != kNil) {
+            i = s.free;
+            s.free = l.nodes[i].next;
+        } else {
+            i = s.used++;
+        }
+        Node& n = l.nodes[i];
+        std::memcpy(&n.key, &key, sizeof(Key));
+        std::memcpy(&n.value, &value, sizeof(Value));
+        n.gen = s.generation;
+        n.hash = h;
+        linkTail(s, i);
+        const size_t mask = shardSlots_ - 1;
+        size_t pos = h & mask;
+        while (l.slots[pos].node != 0) pos = (pos + 1) & mask;
+        l.slots[pos] = Slot{i + 1, h};
+        ++s.size;
+        return true;
+    }
+
+    void evictOldest(Local& l) {
+        ShardHeader& s = *l.shard;
+        const uint32_t i = s.head;
+        const bool live = l.nodes[i].gen == s.generation;
+        if (live) ++s.evictions;
+        retire(l, i, live ? RemovalCause::Capacity : RemovalCause::Expired);
+    }
+
+    void retire(Local& l, uint32_t i, RemovalCause cause) {
+        ShardHeader& s = *l.shard;
+        Node& n = l.nodes[i];
+        l.removals.push(n.key, Value(n.value), cause);
+        const size_t mask = shardSlots_ - 1;
+        size_t pos = n.hash & mask;
+        while (l.slots[pos].node != i + 1) pos = (pos + 1) & mask;
+        // backward-shift：把后面仍可前移的槽逐个补进空洞
+        size_t hole = pos;
+        for (size_t j = (pos + 1) & mask; l.slots[j].node != 0; j = (j + 1) & mask) {
+            const size_t home = l.slots[j].hash & mask;
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                l.slots[hole] = l.slots[j];
+                hole = j;
+            }
+        }
+        l.slots[hole] = Slot{0, 0};
+        unlink(s, i);
+        n.next = s.free;
+        s.free = i;
+        --s.size;
+    }
+
+    void touch(ShardHeader& s, uint32_t i) {
+        if (i == s.tail) return;
+        unlink(s, i);
+        linkTail(s, i);
+    }
+
+    void linkTail(ShardHeader& s, uint32_t i) {
+        Node* ns = nodes(s);
+        ns[i].prev = s.tail;
+        ns[i].next = kNil;
+        if (s.tail != kNil) ns[s.tail].next = i;
+        else s.head = i;
+        s.tail = i;
+    }
+
+    void unlink(ShardHeader& s, uint32_t i) {
+        Node* ns = nodes(s);
+        if (ns[i].prev != kNil) ns[ns[i].prev].next = ns[i].next;
+        else s.head = ns[i].next;
+        if (ns[i].next != kNil) ns[ns[i].next].prev = ns[i].prev;
+        else s.tail = ns[i].prev;
+    }
+
+    static constexpr int kOpenRetries = 2000;   //挂载具名段时最多等创建者约 2s
+
+    char*                    base_ = nullptr;
+    size_t                   bytes_ = 0;
+    int                      error_ = 0;
+    int                      shardNum_ = 1;
+    uint32_t                 shardCap_ = 0;
+    size_t                   shardSlots_ = 8;
+    size_t                   initialCap_ = 0;
+    size_t                   nodesAt_ = 0;     //节点区相对段首的偏移
+    size_t                   slotsAt_ = 0;     //槽区相对段首的偏移
+    std::unique_ptr<Local[]> locals_;          //进程内：每个分片的指针缓存、锁包装、删除通知缓冲
+};
+
+} // namespace CacheSystem
@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MemoryUsage.h"
+
+/*  SlabArena.h
+    memcached 风格的 slab 分配器：
+    - 把内存按固定大小的页（默认 1MB）向系统申请，每一页只属于一个 size class；
+    - 每个 size class 把页切成等长 chunk（chunk 大小按 growthFactor 递增），空闲 chunk 串成单链表；
+    - value 存放在 chunk 里，缓存节点只持有一个 SlabValue 句柄。
+    长时间 put/evict 之后，value 的内存不再经过全局 allocator，碎片被限制在 class 内部，RSS 可预测。
+*/
+
+namespace CacheSystem {
+
+// 单个 slab class 的占用情况
+struct SlabClassStats {
+    size_t chunkSize = 0;       // 该 class 每个 chunk 的字节数
+    size_t pages = 0;           // 当前分配给该 class 的页数
+    size_t emptyPages = 0;      // 其中完全空闲、可以回收的页数
+    size_t totalChunks = 0;
+    size_t usedChunks = 0;
+    size_t requestedBytes = 0;  // chunk 中实际存放的字节数（与 usedChunks*chunkSize 之差即 class 内部浪费）
+
+    double occupancy() const { return totalChunks ? double(usedChunks) / double(totalChunks) : 0.0; }
+};
+
+class SlabArena {
+public:
+    static constexpr uint32_t kNoClass   = 0xffffffffu; // 空句柄
+    static constexpr uint32_t kHeapClass = 0xfffffffeu; // 超过页大小或超过内存上限，退回到堆上
+
+    struct Handle {
+        void*    ptr = nullptr;
+        uint32_t cls = kNoClass;
+        uint32_t len = 0;
+    };
+
+    // pageSize 会被向上取整到 2 的幂，这样 chunk 地址 & ~(pageSize-1) 就是所在页的页头
+    // memLimit == 0 表示不限制页数
+    explicit SlabArena(size_t pageSize = 1u << 20, double growthFactor = 1.25,
+                       size_t minChunk = 48, size_t memLimit = 0)
+        : pageSize_(roundUpPow2(std::max<size_t>(pageSize, 4096)))
+        , maxPages_(memLimit ? std::max<size_t>(1, memLimit / pageSize_) : 0) {
+        growthFactor = std::max(1.05, growthFactor);
+        size_t chunk = alignUp(std::max<size_t>(minChunk, sizeof(void*)));
+        const size_t usable = pageSize_ - kPageHeader;
+        while (chunk <= usable / 2) {
+            classes_.push_back(ClassState{chunk});
+            size_t next = alignUp(static_cast<size_t>(chunk * growthFactor));
+            chunk = std::max(next, chunk + kAlign);
+        }
+        classes_.push_back(ClassState{usable}); // 最后一个 class：一页一个 chunk
+    }
+
+    ~SlabArena() {
+        for (void* p : pages_) std::free(p);
+    }
+
+    SlabArena(const SlabArena&) = delete;
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    // len 超过 uint32 表示范围（4GiB）时无法记进句柄，返回空句柄（ptr 为空、cls 为 kNoClass），不分配任何内存
+    Handle allocate(size_t len) {
+        Handle h;
+        if (len > UINT32_MAX) return h;
+        h.len = static_cast<uint32_t>(len);
+        size_t cls = classOf(len);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cls == kHeapClass || (classes_[cls].freeList == nullptr && !growClassNoLock(cls))) {
+            h.ptr = std::malloc(std::max<size_t>(len, 1));
+            h.cls = kHeapClass;
+            heapBytes_ += len;
+            return h;
+        }
+        ClassState& c = classes_[cls];
+        FreeChunk* chunk = c.freeList;
+        c.freeList = chunk->next;
+        PageHeader* page = pageOf(chunk);
+        if (page->used++ == 0) --c.emptyPages;
+        ++c.usedChunks;
+        c.requestedBytes += len;
+        h.ptr = chunk;
+        h.cls = static_cast<uint32_t>(cls);
+        return h;
+    }
+
+    void deallocate(const Handle& h) {
+        if (h.cls == kNoClass) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (h.cls == kHeapClass) {
+            heapBytes_ -= h.len;
+            std::free(h.ptr);
+            return;
+        }
+        ClassState& c = classes_[h.cls];
+        auto* chunk = static_cast<FreeChunk*>(h.ptr);
+        chunk->next = c.freeList;
+        c.freeList = chunk;
+        if (--pageOf(chunk)->used == 0) ++c.emptyPages;
+        --c.usedChunks;
+        c.requestedBytes -= h.len;
+    }
+
+    // 长度 len 落在哪个 class；放不进一页的返回 kHeapClass
+    size_t classOf(size_t len) const {
+        auto it = std::lower_bound(classes_.begin(), classes_.end(), len,
+                                   [](const ClassState& c, size_t n) { return c.chunkSize < n; });
+        return it == classes_.end() ? kHeapClass : static_cast<size_t>(it - classes_.begin());
+    }
+
+    size_t chunkSize(size_t cls) const { return cls < classes_.size() ? classes_[cls].chunkSize : 0; }
+    size_t numClasses() const { return classes_.size(); }
+    size_t pageSize() const { return pageSize_; }
+
+    size_t emptyPages(size_t cls) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cls < classes_.size() ? classes_[cls].emptyPages : 0;
+    }
+
+    std::vector<SlabClassStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<SlabClassStats> out;
+        out.reserve(classes_.size());
+        for (const auto& c : classes_) {
+            SlabClassStats s;
+            s.chunkSize = c.chunkSize;
+            s.pages = c.pages;
+            s.emptyPages = c.emptyPages;
+            s.totalChunks = c.pages * chunksPerPage(c.chunkSize);
+            s.usedChunks = c.usedChunks;
+            s.requestedBytes = c.requestedBytes;
+            out.push_back(s);
+        }
+        return out;
+    }
+
+    // 向系统申请的总字节数（slab 页 + 堆退路）
+    size_t residentBytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pages_.size() * pageSize_ + heapBytes_;
+    }
+
+    // 把 cls 中完全空闲的页摘下来放回公共页池，供其他 class 复用（memcached 的 slab rebalance）
+    // 需要重建该 class 的空闲链表，代价 O(空闲 chunk 数)，只应在维护路径上调用
+    size_t releaseEmptyPages(size_t cls) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cls >= classes_.size() || classes_[cls].emptyPages == 0) return 0;
+        ClassState& c = classes_[cls];
+        FreeChunk* kept = nullptr;
+        for (FreeChunk* p = c.freeList; p != nullptr;) {
+            FreeChunk* next = p->next;
+            if (pageOf(p)->used != 0) { p->next = kept; kept = p; }
+            p = next;
+        }
+        c.freeList = kept;
+        size_t released = 0;
+        for (void* page : pages_) {
+            auto* hdr = static_cast<PageHeader*>(page);
+            if (hdr->cls == cls && hdr->used == 0) {
+                hdr->cls = kNoClass;
+                freePages_.push_back(page);
+                ++released;
+            }
+        }
+        c.pages -= released;
+        c.emptyPages = 0;
+        return released;
+    }
+
+    // 把公共页池中的页真正还给系统
+    size_t shrink() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t n = freePages_.size();
+        for (void* page : freePages_) {
+            pages_.erase(std::find(pages_.begin(), pages_.end(), page));
+            std::free(page);
+        }
+        freePages_.clear();
+        return n;
+    }
+
+private:
+    struct FreeChunk { FreeChunk* next; };
+    struct PageHeader { uint32_t cls; uint32_t used; };
+    struct ClassState {
+        size_t     chunkSize;
+        size_t     pages = 0;
+        size_t     emptyPages = 0;
+        size_t     usedChunks = 0;
+        size_t     requestedBytes = 0;
+        FreeChunk* freeList = nullptr;
+    };
+
+    static constexpr size_t kAlign = 8;
+    static constexpr size_t kPageHeader = 16;
+
+    static size_t alignUp(size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+    static size_t roundUpPow2(size_t n) { size_t p = 1; while (p < n) p <<= 1; return p; }
+
+    size_t chunksPerPage(size_t chunk) const { return (pageSize_ - kPageHeader) / chunk; }
+
+    PageHeader* pageOf(void* chunk) const {
+        return reinterpret_cast<PageHeader*>(reinterpret_cast<uintptr_t>(chunk) & ~(uintptr_t(pageSize_) - 1));
+    }
+
+    // 给 cls 再挂一页：优先用公共页池，其次向系统申请（受 maxPages_ 限制）
+    bool growClassNoLock(size_t cls) {
+        void* page = nullptr;
+        if (!freePages_.empty()) {
+            page = freePages_.back();
+            freePages_.pop_back();
+        } else {
+            if (maxPages_ && pages_.size() >= maxPages_) return false;
+            page = std::aligned_alloc(pageSize_, pageSize_);
+            if (!page) return false;
+            pages_.push_back(page);
+        }
+        auto* hdr = static_cast<PageHeader*>(page);
+        hdr->cls = static_cast<uint32_t>(cls);
+        hdr->used = 0;
+        ClassState& c = classes_[cls];
+        char* base = static_cast<char*>(page) + kPageHeader;
+        for (size_t i = chunksPerPage(c.chunkSize); i-- > 0;) {
+            auto* chunk = reinterpret_cast<FreeChunk*>(base + i * c.chunkSize);
+            chunk->next = c.freeList;
+            c.freeList = chunk;
+        }
+        ++c.pages;
+        ++c.emptyPages;
+        return true;
+    }
+
+    const size_t            pageSize_;
+    const size_t            maxPages_;
+    std::vector<ClassState> classes_;
+    std::vector<void*>      pages_;      // 所有向系统申请过的页
+    std::vector<void*>      freePages_;  // 已从 class 摘下、可复用的页
+    size_t                  heapBytes_ = 0;
+    mutable std::mutex      mutex_;
+};
+
+// 分片缓存的每个 shard 配一个 arena，arena 锁和 shard 锁一样不跨 shard 竞争
+class ShardedSlabArena {
+public:
+    explicit ShardedSlabArena(size_t shards, size_t pageSize = 1u << 20, double growthFactor = 1.25,
+                              size_t minChunk = 48, size_t memLimitPerShard = 0) {
+        arenas_.reserve(std::max<size_t>(1, shards));
+        for (size_t i = 0; i < std::max<size_t>(1, shards); ++i)
+            arenas_.emplace_back(std::make_unique<SlabArena>(pageSize, growthFactor, minChunk, memLimitPerShard));
+    }
+
+    SlabArena& shard(size_t idx) { return *arenas_[idx % arenas_.size()]; }
+    size_t shardCount() const { return arenas_.size(); }
+
+    // 所有 shard 使用同一套 class 参数，按 class 累加即可
+    std::vector<SlabClassStats> stats() const {
+        std::vector<SlabClassStats> total;
+        for (const auto& a : arenas_) {
+            auto s = a->stats();
+            if (total.empty()) { total = std::move(s); continue; }
+            for (size_t i = 0; i < s.size(); ++i) {
+                total[i].pages += s[i].pages;
+                total[i].emptyPages += s[i].emptyPages;
+                total[i].totalChunks += s[i].totalChunks;
+                total[i].usedChunks += s[i].usedChunks;
+                total[i].requestedBytes += s[i].requestedBytes;
+            }
+        }
+        return total;
+    }
+
+    size_t residentBytes() const {
+        size_t n = 0;
+        for (const auto& a : arenas_) n += a->residentBytes();
+        return n;
+    }
+
+private:
+    std::vector<std::unique_ptr<SlabArena>> arenas_;
+};
+
+// value <-> 字节序列 的编解码；支持 std::string 与 trivially copyable 类型，其他类型可自行特化
+template<typename T, typename = void>
+struct SlabCodec;
+
+template<>
+struct SlabCodec<std::string> {
+    static size_t size(const std::string& v) { return v.size(); }
+    static void store(void* dst, const std::string& v) { if (!v.empty()) std::memcpy(dst, v.data(), v.size()); }
+    static std::string load(const void* src, size_t len) { return std::string(static_cast<const char*>(src), len); }
+};
+
+template<typename T>
+struct SlabCodec<T, std::enable_if_t<std::is_trivially_copyable<T>::value>> {
+    static size_t size(const T&) { return sizeof(T); }
+    static void store(void* dst, const T& v) { std::memcpy(dst, &v, sizeof(T)); }
+    static T load(const void* src, size_t) { T v; std::memcpy(&v, src, sizeof(T)); return v; }
+};
+
+// 缓存节点里真正存放的 value 句柄：24 字节，指向 arena 中的 chunk
+// 拷贝赋值时若目标已有同 class 的 chunk 则直接 memcpy 复用，get() 反复写同一个 out 不会再分配
+template<typename T>
+class SlabValue {
+public:
+    using Codec = SlabCodec<T>;
+
+    SlabValue() = default;
+
+    SlabValue(SlabArena& arena, const T& value) : arena_(&arena) {
+        size_t len = Codec::size(value);
+        h_ = arena.allocate(len);
+        if (h_.ptr) Codec::store(h_.ptr, value);   // 超长被拒绝时留作空值
+    }
+
+    SlabValue(const SlabValue& other) : arena_(other.arena_) { copyBytesFrom(other); }
+
+    SlabValue(SlabValue&& other) noexcept : arena_(other.arena_), h_(other.h_) {
+        other.h_ = SlabArena::Handle{};
+    }
+
+    SlabValue& operator=(const SlabValue& other) {
+        if (this == &other) return *this;
+        if (other.empty()) { reset(); arena_ = other.arena_; return *this; }
+        if (arena_ == other.arena_ && h_.cls != SlabArena::kNoClass && h_.cls != SlabArena::kHeapClass
+            && arena_->classOf(other.h_.len) == h_.cls) {
+            std::memcpy(h_.ptr, other.h_.ptr, other.h_.len);
+            h_.len = other.h_.len;
+            return *this;
+        }
+        reset();
+        arena_ = other.arena_;
+        copyBytesFrom(other);
+        return *this;
+    }
+
+    SlabValue& operator=(SlabValue&& other) noexcept {
+        if (this != &other) {
+            reset();
+            arena_ = other.arena_;
+            h_ = other.h_;
+            other.h_ = SlabArena::Handle{};
+        }
+        return *this;
+    }
+
+    ~SlabValue() { reset(); }
+
+    T load() const { return empty() ? T{} : Codec::load(h_.ptr, h_.len); }
+    bool empty() const { return h_.cls == SlabArena::kNoClass; }
+    size_t bytes() const { return h_.len; }
+    size_t slabClass() const { return h_.cls; }
+    SlabArena* arena() const { return arena_; }
+
+    void reset() {
+        if (arena_ && !empty()) arena_->deallocate(h_);
+        h_ = SlabArena::Handle{};
+    }
+
+private:
+    void copyBytesFrom(const SlabValue& other) {
+        if (other.empty() || !arena_) return;
+        h_ = arena_->allocate(other.h_.len);
+        std::memcpy(h_.ptr, other.h_.ptr, other.h_.len);
+    }
+
+    SlabArena*        arena_ = nullptr;
+    SlabArena::Handle h_;
+};
+
+// 节点里的 SlabValue 占用的是 arena 中的一个 chunk（堆退路时按 malloc 计）
+template<typename T>
+struct HeapBytes<SlabValue<T>> {
+    static size_t of(const SlabValue<T>& v) {
+        if (v.empty()) return 0;
+        if (v.slabClass() == SlabArena::kHeapClass) return mallocBytes(v.bytes());
+        return v.arena()->chunkSize(v.slabClass());
+    }
+};
+
+// 只驱逐 value 落在 cls 里的条目，直到 cls 出现一个完全空闲的页，然后把它还给公共页池；
+// cls 里的条目驱逐完了还没空出整页就停下，其他 class 的条目一概不动。
+// 借用 invalidateIf 遍历，顺序跟着各策略的 invalidateIf 走（LruCache 从最久未用的一端开始），删除原因是 Explicit；
+// 锁顺序是先缓存锁、再 arena 锁，与条目析构时 deallocate 的顺序一致。
+// 挂了删除监听器时 chunk 要等通知投递后才真正归还，可能会多驱逐一些，但不超过 maxEvictions
+// 返回实际驱逐的条目数
+template<typename Cache>
+size_t evictForSlabClass(Cache& cache, SlabArena& arena, size_t cls, size_t maxEvictions) {
+    size_t evicted = 0;
+    if (arena.emptyPages(cls) == 0 && maxEvictions > 0) {
+        cache.invalidateIf([&](const auto&, const auto& v) {
+            if (v.slabClass() != cls || evicted >= maxEvictions || arena.emptyPages(cls) > 0) return false;
+            ++evicted;
+            return true;
+        });
+    }
+    arena.releaseEmptyPages(cls);
+    return evicted;
+}
+
+} // namespace CacheSystem
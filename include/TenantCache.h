@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "CachePolicy.h"
+
+/*  TenantCache.h
+    多租户分区：每个租户（命名空间 / key 前缀）一个独立的策略实例（LruCache / LfuCache / ArcCache，
+    各自决定租户内部的淘汰顺序），外面按配额统一分配总容量，一个租户的大扫描挤不掉别人的热数据。
+    - 配额：每个租户有保底 min 和上限 max（Σmin ≤ 总容量）。策略实例的容量就设成 max，到了 max 只能淘汰自己的；
+    - 借用：总量没满时任何租户都可以长到自己的 max，别的租户闲着的保底份额也能借；
+    - 归还：总量满了以后插入新 key，淘汰“超出保底最多”的租户的末位条目（租户自己的淘汰顺序）：
+        超出量按插入后的自己和当前的别人比，比自己多才去挤别人，否则淘汰自己的；
+        于是没到保底的租户总能从借用者手里拿回份额，都过了保底的租户之间按超出量拉平；
+        没有保底的租户（min = 0）只能挤借用者，挤不到就不缓存；
+    - 计数：每个租户的条目数由挂在它策略上的删除监听器（每条都立即投递）维护，所以策略自己的淘汰、
+      旧代回收、remove 都会即时反映在计数里；用户的监听器在这之后转发；
+    - 开销：命中和覆盖已有 key 只进租户自己的锁；插入新 key 另外拿一把全局的记账锁，锁内先再查一次 key（被别的线程抢先插入就按覆盖处理），
+      再“检查额度 + 腾位置 + 插入”，不和别的插入交错，确定要插入才会淘汰。每次插入最多淘汰一条；挑淘汰对象扫一遍租户计数，与条目数无关，O(租户数)；
+    - key → 租户由构造时给的函数决定，返回值超出范围的都归到最后一个租户。
+*/
+
+namespace CacheSystem {
+
+struct TenantQuota {
+    std::string name;
+    size_t      min = 0;   //保底：总量满了也不会被别的租户挤到这个数以下
+    size_t      max = 0;   //上限：最多占这么多条目
+};
+
+struct TenantStats {
+    std::string name;
+    size_t      min = 0, max = 0;
+    size_t      size = 0;
+    uint64_t    hits = 0, misses = 0;
+    uint64_t    inserts = 0;     //新插入的 key
+    uint64_t    evictions = 0;   //因容量被淘汰的条目（含被别的租户收回的）
+    uint64_t    reclaimed = 0;   //其中是给别的租户腾位置而被挤掉的
+};
+
+template<typename Policy, typename Key, typename Value>
+class TenantCache : public CachePolicy<Key, Value> {
+public:
+    using Router = std::function<int(const Key&)>;
+
+    TenantCache(size_t capacity, const std::vector<TenantQuota>& quotas, Router tenantOf)
+        : capacity_(capacity), tenantOf_(std::move(tenantOf)) {
+        const size_t n = std::max<size_t>(1, quotas.size());
+        tenants_.reset(new Tenant[n]);
+        tenantNum_ = static_cast<int>(n);
+        for (int i = 0; i < tenantNum_; ++i) {
+            Tenant& t = tenants_[i];
+            t.quota = i < int(quotas.size()) ? quotas[i] : TenantQuota{"default", 0, capacity};
+            t.quota.max = std::min(std::max(t.quota.max, t.quota.min), capacity);
+            t.policy.reset(new Policy(static_cast<int>(t.quota.max)));
+            t.policy->Policy::setRemovalListener(counter(i), 1);
+        }
+    }
+
+    void put(Key key, Value value) override {
+        Tenant& t = tenantFor(key);
+        // 先当作覆盖：已存在就地替换；不存在时 compute 什么也不插入
+        auto overwrite = [&](const Value*) { return std::optional<Value>(value); };
+        if (updateIfPresent(t, key, overwrite)) return;
+        std::lock_guard<std::mutex> lk(mu_);
+        if (updateIfPresent(t, key, overwrite)) return;   //别的线程抢先插入了同一个 key：按覆盖处理
+        if (makeRoom(t)) insertNoRoom(t, std::move(key), std::move(value));
+    }
+
+    bool get(Key key, Value& value) override {
+        Tenant& t = tenantFor(key);
+        const bool hit = t.policy->Policy::get(key, value);
+        (hit ? t.hits : t.misses).fetch_add(1, std::memory_order_relaxed);
+        return hit;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    // 已存在的 key 在租户锁内一次完成；不存在时先算出结果，再按配额插入。
+    // 两步之间别的线程插入了同一个 key 时，在记账锁内对它的值重新调用 fn（所以 fn 可能被调用两次）
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Tenant& t = tenantFor(key);
+        std::optional<Value> result;
+        if (updateIfPresent(t, key, fn, &result)) return result;
+        result = fn(nullptr);
+        if (!result) return result;
+        std::lock_guard<std::mutex> lk(mu_);
+        std::optional<Value> raced;
+        if (updateIfPresent(t, key, fn, &raced)) return raced;
+        if (makeRoom(t)) insertNoRoom(t, std::move(key), Value(*result));
+        return result;
+    }
+
+    bool putIfAbsent(Key key, Value value) override {
+        Tenant& t = tenantFor(key);
+        Value probe{};
+        if (t.policy->Policy::get(key, probe)) return false;
+        std::lock_guard<std::mutex> lk(mu_);
+        if (t.policy->Policy::get(key, probe)) return false;
+        return makeRoom(t) && insertNoRoom(t, std::move(key), std::move(value));
+    }
+
+    // factory 在锁外执行，不会拖住别的租户的插入；期间别的线程插入了同一个 key 时以对方的值为准，按命中返回
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        if (get(key, value)) return true;
+        Value fresh = factory();
+        Tenant& t = tenantFor(key);
+        std::lock_guard<std::mutex> lk(mu_);
+        if (t.policy->Policy::get(key, value)) return true;
+        value = std::move(fresh);
+        if (makeRoom(t)) insertNoRoom(t, std::move(key), Value(value));
+        return false;
+    }
+
+    bool remove(Key key) override {
+        return tenantFor(key).policy->Policy::remove(key);
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        size_t n = 0;
+        for (int i = 0; i < tenantNum_; ++i) n += tenants_[i].policy->Policy::invalidateIf(pred);
+        return n;
+    }
+
+    // 旧代条目仍占着计数，直到各租户的策略把它们回收（访问到或排到末位时）
+    void invalidateAll() override {
+        for (int i = 0; i < tenantNum_; ++i) tenants_[i].policy->Policy::invalidateAll();
+    }
+
+    // 总容量缩小时每次从超出保底最多的租户淘汰一条，直到降到新容量
+    void setCapacity(size_t capacity) override {
+        std::lock_guard<std::mutex> lk(mu_);
+        capacity_ = capacity;
+        while (total_.load(std::memory_order_relaxed) > capacity_) {
+            const int victim = mostOver(-1, std::numeric_limits<long long>::min());
+            if (victim < 0) break;
+            tenants_[victim].policy->Policy::evictOne();
+        }
+    }
+
+    // 调整一个租户的配额；上限变小时当场淘汰到新上限
+    void setQuota(int tenant, size_t min, size_t max) {
+        if (tenant < 0 || tenant >= tenantNum_) return;
+        std::lock_guard<std::mutex> lk(mu_);
+        Tenant& t = tenants_[tenant];
+        t.quota.min = min;
+        t.quota.max = std::min(std::max(max, min), capacity_);
+        t.policy->Policy::setCapacity(t.quota.max);
+    }
+
+    MemoryUsage memoryUsage() const override {
+        MemoryUsage m;
+        for (int i = 0; i < tenantNum_; ++i) m += tenants_[i].policy->Policy::memoryUsage();
+        return m;
+    }
+
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        (void)batchSize;   //计数要求内部逐条投递，用户监听器随之逐批收到
+        std::atomic_store(&userListener_, listener
+            ? std::make_shared<const RemovalListener<Key, Value>>(std::move(listener))
+            : std::shared_ptr<const RemovalListener<Key, Value>>());
+    }
+
+    void flushRemovals() override {
+        for (int i = 0; i < tenantNum_; ++i) tenants_[i].policy->Policy::flushRemovals();
+    }
+
+    std::vector<TenantStats> stats() const {
+        std::vector<TenantStats> out(tenantNum_);
+        for (int i = 0; i < tenantNum_; ++i) {
+            const Tenant& t = tenants_[i];
+            TenantStats& s = out[i];
+            s.name      = t.quota.name;
+            s.min       = t.quota.min;
+            s.max       = t.quota.max;
+            s.size      = t.count.load(std::memory_order_relaxed);
+            s.hits      = t.hits.load(std::memory_order_relaxed);
+            s.misses    = t.misses.load(std::memory_order_relaxed);
+            s.inserts   = t.inserts.load(std::memory_order_relaxed);
+            s.evictions = t.evictions.load(std::memory_order_relaxed);
+            s.reclaimed = t.reclaimed.load(std::memory_order_relaxed);
+        }
+        return out;
+    }
+
+    size_t size() const { return total_.load(std::memory_order_relaxed); }
+    int tenantCount() const { return tenantNum_; }
+    Policy& tenant(int i) { return *tenants_[i].policy; }
+
+private:
+    struct alignas(64) Tenant {
+        TenantQuota             quota;
+        std::unique_ptr<Policy> policy;
+        std::atomic<size_t>     count{0};
+        std::atomic<uint64_t>   hits{0}, misses{0}, inserts{0}, evictions{0}, reclaimed{0};
+    };
+
+    Tenant& tenantFor(const Key& key) {
+        const int i = tenantOf_(key);
+        return tenants_[(i >= 0 && i < tenantNum_) ? i : tenantNum_ - 1];
+    }
+
+    // 挂在租户策略上的监听器：条目离开（覆盖除外）就减计数，再转给用户的监听器
+    RemovalListener<Key, Value> counter(int i) {
+        return [this, i](std::vector<RemovalNotification<Key, Value>>& batch) {
+            Tenant& t = tenants_[i];
+            size_t gone = 0, evicted = 0;
+            for (const auto& n : batch) {
+                if (n.cause == RemovalCause::Replaced) continue;
+                ++gone;
+                if (n.cause == RemovalCause::Capacity) ++evicted;
+            }
+            t.count.fetch_sub(gone, std::memory_order_relaxed);
+            total_.fetch_sub(gone, std::memory_order_relaxed);
+            t.evictions.fetch_add(evicted, std::memory_order_relaxed);
+            if (auto user = std::atomic_load(&userListener_)) (*user)(batch);
+        };
+    }
+
+    // 租户锁内：key 已存在时按 fn 改写（返回 nullopt 则删除），返回它是否存在；不存在时什么也不做。
+    // 新 key 只在记账锁内插入，所以记账锁内查到不存在，直到 insertNoRoom 之前都不会有别人插入它，makeRoom 不会白淘汰
+    template<typename Fn>
+    bool updateIfPresent(Tenant& t, const Key& key, const Fn& fn, std::optional<Value>* result = nullptr) {
+        bool existed = false;
+        std::optional<Value> r = t.policy->Policy::compute(key, [&](const Value* cur) -> std::optional<Value> {
+            if (!cur) return std::nullopt;
+            existed = true;
+            return fn(cur);
+        });
+        if (result) *result = std::move(r);
+        return existed;
+    }
+
+    // 记账锁内：为租户 t 的一个新 key 腾位置，返回能否插入
+    bool makeRoom(Tenant& t) {
+        const size_t count = t.count.load(std::memory_order_relaxed);
+        if (count >= t.quota.max) return t.quota.max > 0;                      //策略插入时自己淘汰末位
+        if (total_.load(std::memory_order_relaxed) < capacity_) return true;   //还有空闲容量，直接借
+        const int self = int(&t - tenants_.get());
+        // 空租户只能挤借用者；否则比插入后自己的超出量还多的才值得挤
+        const long long floor = count == 0 ? 0 : excess(t) + 1;
+        const int victim = mostOver(self, floor);
+        if (victim >= 0) {
+            tenants_[victim].reclaimed.fetch_add(1, std::memory_order_relaxed);
+            tenants_[victim].policy->Policy::evictOne();
+            return true;
+        }
+        if (count == 0) return false;   //没有借用者可挤，自己又没有可淘汰的：不缓存
+        t.policy->Policy::evictOne();
+        return true;
+    }
+
+    static long long excess(const Tenant& t) {
+        return static_cast<long long>(t.count.load(std::memory_order_relaxed)) - static_cast<long long>(t.quota.min);
+    }
+
+    // 超出保底最多、且严格大于 floor 的非空租户（skip 除外），没有返回 -1
+    int mostOver(int skip, long long floor) const {
+        int best = -1;
+        for (int j = 0; j < tenantNum_; ++j) {
+            const Tenant& c = tenants_[j];
+            if (j == skip || c.count.load(std::memory_order_relaxed) == 0) continue;
+            const long long e = excess(c);
+            if (e > floor) { floor = e; best = j; }
+        }
+        return best;
+    }
+
+    // 记账锁内插入：监听器在插入返回前已经把可能的自我淘汰减掉了
+    bool insertNoRoom(Tenant& t, Key&& key, Value&& value) {
+        if (!t.policy->Policy::putIfAbsent(std::move(key), std::move(value))) return false;
+        t.count.fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        t.inserts.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t                                                 capacity_;
+    Router                                                 tenantOf_;
+    std::unique_ptr<Tenant[]>                              tenants_;
+    int                                                    tenantNum_ = 1;
+    std::atomic<size_t>                                    total_{0};   //各租户条目数之和
+    std::shared_ptr<const RemovalListener<Key, Value>>     userListener_;
+    std::mutex                                             mu_;         //记账锁：插入新 key 的路径
+};
+
+} // namespace CacheSystem
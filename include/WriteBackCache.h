@@ -0,0 +1,479 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "BackingStore.h"
+#include "CachePolicy.h"
+#include "HashMix.h"
+
+/*  WriteBackCache.h
+    写回模式：put / compute 只写缓存并把条目记为脏，由后台刷写线程分批写到 BackingStore。
+    - 同一个 key 在写回之前被写多次，只保留最后的值（合并），后端只收到一次写；
+    - 脏表按 key 分条带，每条带一把锁，和所包装的缓存一起在条带锁内更新，所以同一个 key 的缓存值与脏值一致；
+    - 刷写线程在三种情况下工作：脏条目数达到 maxDirty、最老的脏条目超过 maxAge、脏条目被缓存驱逐；
+    - 脏表在写回成功之前一直保留着值：缓存（LruCache / LfuCache 等任意策略）驱逐脏条目时，
+      值仍在脏表里，get 未命中缓存会读到它；驱逐通知（RemovalListener）把它标成急需写回并唤醒刷写线程，
+      写成功后才从脏表里删掉。写回期间又被写过的条目（版本号变了）继续留在脏表里；
+    - writeBatch 失败时整批留在脏表里，下一轮重试；
+    - remove / invalidateIf / invalidateAll 只丢掉缓存里的副本：还没写回的值先同步写回，再删；
+    - compute 返回 nullopt 才是真的删除：脏表里记一个墓碑并立即同步写回（BackingStore::eraseBatch），
+      失败就和普通脏条目一样留着重试；墓碑还在时 get 读不到，compute / putIfAbsent 也不再回后端读旧值；
+    - 析构时停掉刷写线程并尽力写回一次，写不进去的就丢了；需要知道结果的调用方先 close()，它返回写回失败的 key。
+    读：get 只查缓存和脏表，未命中时是否回后端由调用方决定（getOrInsert 的 factory，插入的值不记脏）；
+    compute / putIfAbsent 是读-改-写，缓存和脏表都没有时以后端为准（在条带锁内 load 一次），
+    否则计数器这类值在被写回、驱逐之后会从头算起。
+    锁顺序：flushMutex_（串行化对后端的写，保证同一个 key 的写回按版本先后到达）→ 条带锁 → 所包装缓存的锁。
+    所包装缓存的删除通知先并入 relay_，释放条带锁之后才处理，处理时再拿条带锁。
+*/
+
+namespace CacheSystem {
+
+struct WriteBackOptions {
+    size_t                    maxDirty  = 4096;                       //脏条目数达到它就唤醒刷写线程写回全部脏条目
+    std::chrono::milliseconds maxAge    = std::chrono::milliseconds(100); //脏条目最多停留这么久
+    size_t                    batchSize = 256;                        //每次 writeBatch 最多这么多条
+    int                       stripes   = 16;                         //脏表条带数
+};
+
+struct WriteBackStats {
+    uint64_t writes         = 0;   //put / compute / putIfAbsent 写入次数（含 compute 的删除）
+    uint64_t coalesced      = 0;   //落在尚未写回的脏条目上、被合并掉的写
+    uint64_t flushed        = 0;   //写到后端的条目数（含删除）
+    uint64_t batches        = 0;   //成功的 writeBatch / eraseBatch 次数
+    uint64_t failedBatches  = 0;
+    uint64_t dirtyEvictions = 0;   //被缓存驱逐时仍是脏的条目
+    size_t   dirty          = 0;   //当前脏条目数
+
+    // 后端写入量降到原来的几分之一
+    double writeReduction() const { return flushed ? double(writes) / double(flushed) : 0.0; }
+};
+
+template<typename Key, typename Value>
+class WriteBackCache : public CachePolicy<Key, Value> {
+public:
+    // store 须比本对象活得久；构造时启动刷写线程，析构时停掉并尽力写回全部脏条目（失败不报告，见 close）
+    WriteBackCache(std::unique_ptr<CachePolicy<Key, Value>> cache, BackingStore<Key, Value>& store,
+                   WriteBackOptions options = WriteBackOptions())
+        : options_(options)
+        , store_(store)
+        , stripeNum_(static_cast<size_t>(std::max(1, options.stripes)))
+        , stripes_(new Stripe[stripeNum_])
+        , cache_(std::move(cache)) {
+        options_.batchSize = std::max<size_t>(1, options_.batchSize);
+        relay_.setListener([this](std::vector<RemovalNotification<Key, Value>>& batch) { onCacheRemoval(batch); }, 1);
+        cache_->setRemovalListener(relay_.sink(), 1);
+        flusher_ = std::thread([this] { flusherLoop(); });
+    }
+
+    ~WriteBackCache() override {
+        stopFlusher();
+        flush();
+    }
+
+    WriteBackCache(const WriteBackCache&) = delete;
+    WriteBackCache& operator=(const WriteBackCache&) = delete;
+
+    void put(Key key, Value value) override {
+        Stripe& st = stripeOf(key);
+        {
+            Lock lock(st.mutex, relay_);
+            cache_->put(key, value);
+            markDirtyNoLock(st, key, std::move(value));
+        }
+        maybeWakeOnSize();
+    }
+
+    // 缓存未命中时再看脏表：被驱逐、还没写回的值仍然有效
+    bool get(Key key, Value& value) override {
+        const bool hit = cache_->get(key, value);
+        relay_.deliver();
+        if (hit) return true;
+        Stripe& st = stripeOf(key);
+        std::lock_guard<std::mutex> lock(st.mutex);
+        auto it = st.dirty.find(key);
+        if (it == st.dirty.end() || it->second.erased) return false;
+        value = it->second.value;
+        return true;
+    }
+
+    Value get(Key key) override {
+        Value value{};
+        (void)get(key, value);
+        return value;
+    }
+
+    // 当前值依次看缓存、脏表、后端；写入的结果记脏，返回 nullopt 时记墓碑、同步从后端删除
+    std::optional<Value> compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn) override {
+        Stripe& st = stripeOf(key);
+        std::optional<Value> result;
+        bool erase = false;
+        {
+            Lock lock(st.mutex, relay_);
+            auto it = st.dirty.find(key);
+            const bool tombstone = it != st.dirty.end() && it->second.erased;
+            const Value* pending = it != st.dirty.end() && !tombstone ? &it->second.value : nullptr;
+            bool found = false;
+            result = cache_->compute(key, [&](const Value* cur) -> std::optional<Value> {
+                if (!cur) cur = pending;
+                if (!cur) return std::nullopt;   //都不在缓存里：不插入，下面回后端
+                found = true;
+                return fn(cur);
+            });
+            if (!found) {
+                Value stored{};
+                found = !tombstone && store_.load(key, stored);   //删除还没写到后端时，后端里的是旧值
+                result = fn(found ? &stored : nullptr);
+                if (result) cache_->put(key, *result);
+            }
+            if (result) markDirtyNoLock(st, key, Value(*result));
+            else if (found) {
+                markDirtyNoLock(st, key, Value{}, true);
+                erase = true;
+            }
+        }
+        if (result) maybeWakeOnSize();
+        if (erase) flushKey(key);
+        return result;
+    }
+
+    // 缓存、脏表、后端都没有（或脏表里是墓碑）才写入；后端已有时顺带把它放进缓存
+    bool putIfAbsent(Key key, Value value) override {
+        Stripe& st = stripeOf(key);
+        {
+            Lock lock(st.mutex, relay_);
+            auto it = st.dirty.find(key);
+            if (it != st.dirty.end() && !it->second.erased) return false;
+            const bool tombstone = it != st.dirty.end();
+            Value existing{};
+            if (cache_->get(key, existing)) return false;
+            if (!tombstone && store_.load(key, existing)) {
+                cache_->put(key, std::move(existing));
+                return false;
+            }
+            cache_->put(key, value);
+            markDirtyNoLock(st, key, std::move(value));
+        }
+        maybeWakeOnSize();
+        return true;
+    }
+
+    // factory 通常是从后端读：插入的值是干净的，不记脏。
+    // 有墓碑时 factory 读到的可能是还没删掉的旧值，只返回、不进缓存
+    bool getOrInsert(Key key, Value& value, const std::function<Value()>& factory) override {
+        Stripe& st = stripeOf(key);
+        Lock lock(st.mutex, relay_);
+        auto it = st.dirty.find(key);
+        if (it != st.dirty.end() && it->second.erased) {
+            value = factory();
+            return false;
+        }
+        if (it != st.dirty.end()) {
+            value = it->second.value;
+            return true;
+        }
+        return cache_->getOrInsert(key, value, factory);
+    }
+
+    void setCapacity(size_t capacity) override {
+        cache_->setCapacity(capacity);
+        relay_.deliver();
+    }
+
+    // 监听器收到的是所包装缓存的通知（脏条目被驱逐时，通知发出后值仍在脏表里等待写回）
+    void setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize) override {
+        userRelay_.setListener(std::move(listener), batchSize);
+    }
+
+    void flushRemovals() override {
+        cache_->flushRemovals();
+        relay_.deliver(true);
+        userRelay_.deliver(true);
+    }
+
+    // 缓存里的副本删掉；还没写回的值先同步写回（写回失败则留在脏表里，之后仍能读到）
+    bool remove(Key key) override {
+        Stripe& st = stripeOf(key);
+        bool removed = false;
+        bool pending = false;
+        bool live = false;
+        {
+            Lock lock(st.mutex, relay_);
+            removed = cache_->remove(key);
+            auto it = st.dirty.find(key);
+            pending = it != st.dirty.end();
+            live = pending && !it->second.erased;
+        }
+        if (pending) flushKey(key);
+        return removed || live;
+    }
+
+    size_t invalidateIf(const std::function<bool(const Key&, const Value&)>& pred) override {
+        flushMatching([&](const Key& key, const Dirty& d) { return !d.erased && pred(key, d.value); });
+        const size_t n = cache_->invalidateIf(pred);
+        relay_.deliver();
+        return n;
+    }
+
+    void invalidateAll() override {
+        flush();
+        cache_->invalidateAll();
+    }
+
+    // 所包装的缓存 + 脏表（脏表里的值是缓存值的副本，记为 metadata）
+    MemoryUsage memoryUsage() const override {
+        MemoryUsage m = cache_->memoryUsage();
+        for (size_t i = 0; i < stripeNum_; ++i) {
+            std::lock_guard<std::mutex> lock(stripes_[i].mutex);
+            m.metadata += hashIndexBytes(stripes_[i].dirty) + stripes_[i].heapBytes;
+        }
+        m.metadata += stripeNum_ * sizeof(Stripe);
+        return m;
+    }
+
+    // 同步写回全部脏条目（含墓碑）；返回时除写失败的以外，之前的写都已到达后端。
+    // 返回写失败的 key：它们留在脏表里，可以再调 flush 重试
+    std::vector<Key> flush() {
+        return flushMatching([](const Key&, const Dirty&) { return true; });
+    }
+
+    // 停掉刷写线程，再同步写回全部脏条目，返回写失败的 key（同 flush）。
+    // 之后的写不再自动写回，要调用方自己 flush；析构时不再报告失败，需要结果的在析构前调它
+    std::vector<Key> close() {
+        stopFlusher();
+        return flush();
+    }
+
+    WriteBackStats stats() const {
+        WriteBackStats s;
+        s.writes         = writes_.load(std::memory_order_relaxed);
+        s.coalesced      = coalesced_.load(std::memory_order_relaxed);
+        s.flushed        = flushed_.load(std::memory_order_relaxed);
+        s.batches        = batches_.load(std::memory_order_relaxed);
+        s.failedBatches  = failedBatches_.load(std::memory_order_relaxed);
+        s.dirtyEvictions = dirtyEvictions_.load(std::memory_order_relaxed);
+        s.dirty          = dirtyCount_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    CachePolicy<Key, Value>& backing() { return *cache_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Lock  = RelayingLock<std::mutex, Key, Value>;
+
+    struct Dirty {
+        Value             value;
+        uint64_t          version = 0;   //每次写 +1；写回完成时版本没变才能删
+        Clock::time_point since;         //变脏（或上次写回后再次变脏）的时间
+        bool              evicted = false;
+        bool              erased  = false; //墓碑：写回时从后端删除，value 无意义
+    };
+
+    struct alignas(64) Stripe {
+        mutable std::mutex              mutex;
+        std::unordered_map<Key, Dirty>  dirty;
+        size_t                          heapBytes = 0;
+    };
+
+    // 正在写回的一条：值的快照 + 快照时的版本
+    struct Pending {
+        size_t   stripe;
+        Key      key;
+        Value    value;
+        uint64_t version;
+        bool     erased;
+    };
+
+    size_t stripeIndex(const Key& key) const { return fmix64(std::hash<Key>{}(key)) % stripeNum_; }
+    Stripe& stripeOf(const Key& key) { return stripes_[stripeIndex(key)]; }
+
+    void markDirtyNoLock(Stripe& st, const Key& key, Value&& value, bool erased = false) {
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        auto ins = st.dirty.try_emplace(key);
+        Dirty& d = ins.first->second;
+        if (ins.second) {
+            d.since = Clock::now();
+            st.heapBytes += heapBytesOf(key);
+            dirtyCount_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            st.heapBytes -= heapBytesOf(d.value);
+        }
+        d.value = std::move(value);
+        d.evicted = false;
+        d.erased = erased;
+        ++d.version;
+        st.heapBytes += heapBytesOf(d.value);
+    }
+
+    void eraseDirtyNoLock(Stripe& st, typename std::unordered_map<Key, Dirty>::iterator it) {
+        st.heapBytes -= heapBytesOf(it->first) + heapBytesOf(it->second.value);
+        st.dirty.erase(it);
+        dirtyCount_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 所包装缓存的通知：被驱逐（或旧代被回收）的脏条目标成急需写回；之后原样转给用户的监听器
+    void onCacheRemoval(std::vector<RemovalNotification<Key, Value>>& batch) {
+        bool urgent = false;
+        for (const auto& n : batch) {
+            if (n.cause != RemovalCause::Capacity && n.cause != RemovalCause::Expired) continue;
+            Stripe& st = stripeOf(n.key);
+            std::lock_guard<std::mutex> lock(st.mutex);
+            auto it = st.dirty.find(n.key);
+            if (it == st.dirty.end() || it->second.evicted) continue;
+            it->second.evicted = true;
+            dirtyEvictions_.fetch_add(1, std::memory_order_relaxed);
+            urgent = true;
+        }
+        if (urgent) wakeFlusher();
+        if (userRelay_.enabled()) {
+            userRelay_.append(batch);
+            userRelay_.deliver();
+        }
+    }
+
+    void maybeWakeOnSize() {
+        if (dirtyCount_.load(std::memory_order_relaxed) >= options_.maxDirty) wakeFlusher();
+    }
+
+    void wakeFlusher() {
+        if (wakePending_.exchange(true, std::memory_order_acq_rel)) return;
+        {
+            std::lock_guard<std::mutex> lock(flusherMutex_);
+        }
+        flusherCv_.notify_one();
+    }
+
+    // 醒来（被唤醒或每 maxAge/2）写回：被驱逐的、超龄的；脏条目太多时全部写回
+    void stopFlusher() {
+        {
+            std::lock_guard<std::mutex> lock(flusherMutex_);
+            flusherStop_ = true;
+        }
+        flusherCv_.notify_all();
+        if (flusher_.joinable()) flusher_.join();
+    }
+
+    void flusherLoop() {
+        const auto tick = std::max(std::chrono::milliseconds(1), options_.maxAge / 2);
+        std::unique_lock<std::mutex> lk(flusherMutex_);
+        while (!flusherStop_) {
+            flusherCv_.wait_for(lk, tick, [this] { return flusherStop_ || wakePending_.load(std::memory_order_acquire); });
+            if (flusherStop_) break;
+            wakePending_.store(false, std::memory_order_release);
+            lk.unlock();
+            const bool all = dirtyCount_.load(std::memory_order_relaxed) >= options_.maxDirty;
+            const Clock::time_point due = Clock::now() - options_.maxAge;
+            flushMatching([&](const Key&, const Dirty& d) { return all || d.evicted || d.since <= due; });
+            lk.lock();
+        }
+    }
+
+    // 同步写回一个 key（remove / compute 删除之前）
+    void flushKey(const Key& key) {
+        std::lock_guard<std::mutex> flushLock(flushMutex_);
+        const size_t s = stripeIndex(key);
+        std::vector<Pending> pending;
+        {
+            std::lock_guard<std::mutex> lock(stripes_[s].mutex);
+            auto it = stripes_[s].dirty.find(key);
+            if (it == stripes_[s].dirty.end()) return;
+            pending.push_back(Pending{s, key, it->second.value, it->second.version, it->second.erased});
+        }
+        writeBack(pending);
+    }
+
+    // 逐条带在条带锁内拍下满足条件的脏条目的快照，锁外分批写，写完再逐条核对版本；返回写失败的 key
+    template<typename Pred>
+    std::vector<Key> flushMatching(Pred&& pred) {
+        std::lock_guard<std::mutex> flushLock(flushMutex_);
+        std::vector<Pending> pending;
+        for (size_t s = 0; s < stripeNum_; ++s) {
+            std::lock_guard<std::mutex> lock(stripes_[s].mutex);
+            for (const auto& kv : stripes_[s].dirty) {
+                if (pred(kv.first, kv.second)) {
+                    pending.push_back(Pending{s, kv.first, kv.second.value, kv.second.version, kv.second.erased});
+                }
+            }
+        }
+        std::vector<Key> failed;
+        for (size_t i = writeBack(pending); i < pending.size(); ++i) failed.push_back(std::move(pending[i].key));
+        return failed;
+    }
+
+    // 持有 flushMutex_；每批拆成写和删两次调用，都成功才算这批写回了（重试时重复写/删无害）。
+    // 某批失败就停下，剩下的留到下一轮；返回写回成功的条数（pending 的前缀）
+    size_t writeBack(std::vector<Pending>& pending) {
+        std::vector<std::pair<Key, Value>> batch;
+        std::vector<Key> erased;
+        for (size_t begin = 0; begin < pending.size(); begin += options_.batchSize) {
+            const size_t end = std::min(pending.size(), begin + options_.batchSize);
+            batch.clear();
+            erased.clear();
+            for (size_t i = begin; i < end; ++i) {
+                if (pending[i].erased) erased.push_back(pending[i].key);
+                else batch.emplace_back(pending[i].key, std::move(pending[i].value));
+            }
+            if ((!batch.empty() && !store_.writeBatch(batch)) || (!erased.empty() && !store_.eraseBatch(erased))) {
+                failedBatches_.fetch_add(1, std::memory_order_relaxed);
+                return begin;
+            }
+            batches_.fetch_add(!batch.empty() + !erased.empty(), std::memory_order_relaxed);
+            flushed_.fetch_add(end - begin, std::memory_order_relaxed);
+            confirm(pending, begin, end);
+        }
+        return pending.size();
+    }
+
+    // 版本没变的删掉；写回期间又被写过的留着，从现在起重新计龄
+    void confirm(const std::vector<Pending>& pending, size_t begin, size_t end) {
+        const Clock::time_point now = Clock::now();
+        size_t i = begin;
+        while (i < end) {
+            const size_t s = pending[i].stripe;
+            std::lock_guard<std::mutex> lock(stripes_[s].mutex);
+            for (; i < end && pending[i].stripe == s; ++i) {
+                auto it = stripes_[s].dirty.find(pending[i].key);
+                if (it == stripes_[s].dirty.end()) continue;
+                if (it->second.version == pending[i].version) eraseDirtyNoLock(stripes_[s], it);
+                else it->second.since = now;
+            }
+        }
+    }
+
+    WriteBackOptions                         options_;
+    BackingStore<Key, Value>&                store_;
+    size_t                                   stripeNum_;
+    std::unique_ptr<Stripe[]>                stripes_;
+    RemovalRelay<Key, Value>                 relay_;       //所包装缓存的通知，释放条带锁之后处理
+    RemovalRelay<Key, Value>                 userRelay_;   //转给用户监听器的通知
+    std::unique_ptr<CachePolicy<Key, Value>> cache_;
+    std::mutex                               flushMutex_;
+
+    std::atomic<size_t>   dirtyCount_{0};
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> flushed_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> failedBatches_{0};
+    std::atomic<uint64_t> dirtyEvictions_{0};
+
+    std::thread             flusher_;
+    std::mutex              flusherMutex_;
+    std::condition_variable flusherCv_;
+    bool                    flusherStop_ = false;
+    std::atomic<bool>       wakePending_{false};
+};
+
+} // namespace CacheSystem
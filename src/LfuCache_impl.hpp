@@ -6,38 +6,50 @@
 namespace CacheSystem {
 
 template<typename Key, typename Value>
-LfuCache<Key, Value>::LfuCache(int capacity)
+LfuCache<Key, Value>::LfuCache(int capacity, bool bufferedReads)
     : capacity_(capacity)
-    , minFreq_(1) {}
+    , minFreq_(1) {
+    if (bufferedReads) readBuffers_.reset(new ReadBuffer[kReadStripes]);
+}
 
 template<typename Key, typename Value>
 void LfuCache<Key, Value>::put(Key key, Value value){
-    if(capacity_<= 0)  return;
-    
-    std::lock_guard<std::mutex> lock(mutex_);
+    Lock lock(mutex_, removals_);
+    if(capacity_<= 0)  return; //capacity_ 可被 setCapacity 修改，必须在锁内读取
+    applyReadBuffersNoLock();  //先把攒下的命中记上，再决定淘汰谁
     //锁的粒度较大，全局锁
     //每次put/get都会上锁整个cache
     //nodeMap_ 与 freqListMap_ 是共享资源，没有分片设计
 
-    auto it = nodeMap_.find(key);
+    auto it = findLiveNoLock(key);
     if(it!=nodeMap_.end()){ //find it
-        it->second->value = value;
+        assignValueNoLock(it->second, std::move(value));
         promoteNolock(it->second);
         return;
     }
-    if(static_cast<int>(nodeMap_.size()) >= capacity_){
-        evictOneNoLock();
-    }
-    NodePtr node = std::make_shared<Node>(std::move(key), std::move(value));
-    nodeMap_[node->key] = node;
-    addToFreqListNoLock(node); // 放到 freq=1 的链表
-    minFreq_ = 1;
+    insertNewNoLock(std::move(key), std::move(value));
 }
 
 template<typename Key, typename Value>
 bool LfuCache<Key, Value>::get(Key key, Value& value){
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
+    if(readBuffers_){
+        bool full = false;
+        {
+            std::shared_lock<ContentionSharedMutex> lock(mutex_);
+            auto it = nodeMap_.find(key);
+            if(it==nodeMap_.end() || it->second->gen != generation_)  return false; //共享锁下不能删，旧代条目留给淘汰
+            value = it->second->value;
+            full = recordReadNoLock(it->second.get());
+        }
+        //缓冲写满了：能立刻拿到独占锁就顺手排空，拿不到说明有写者，它进来时会排空
+        if(full){
+            std::unique_lock<ContentionSharedMutex> lock(mutex_, std::try_to_lock);
+            if(lock.owns_lock()) applyReadBuffersNoLock();
+        }
+        return true;
+    }
+    Lock lock(mutex_, removals_);
+    auto it = findLiveNoLock(key);
     if(it==nodeMap_.end())  return false;
     value = it->second->value;
     promoteNolock(it->second); // 访问一次，频次+1
@@ -53,13 +65,191 @@ Value LfuCache<Key, Value>::get(Key key){
 
 template<typename Key, typename Value>
 void LfuCache<Key, Value>::purge(){
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ContentionSharedMutex> lock(mutex_);
+    discardReadBuffersNoLock();
     nodeMap_.clear();
     freqListMap_.clear();
+    keyHeapBytes_ = 0;
+    valueHeapBytes_ = 0;
+    staleCount_ = 0;
     minFreq_=1;
     //minFreq_=std::numeric_limits<int>::max();
 }
 
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::setCapacity(size_t capacity){
+    {
+        std::lock_guard<ContentionSharedMutex> lock(mutex_);
+        capacity_ = static_cast<int>(capacity);
+    }
+    for(;;){
+        Lock lock(mutex_, removals_);  //每批驱逐的通知在本批解锁后投递
+        applyReadBuffersNoLock();
+        for(int i=0; i<kEvictBatch && static_cast<int>(nodeMap_.size())>capacity_; ++i){
+            evictOneNoLock();
+        }
+        if(static_cast<int>(nodeMap_.size())<=capacity_) return;
+    }
+}
+
+template<typename Key, typename Value>
+bool LfuCache<Key, Value>::putIfAbsent(Key key, Value value){
+    Lock lock(mutex_, removals_);
+    if(capacity_<=0) return false;
+    applyReadBuffersNoLock();
+    if(findLiveNoLock(key) != nodeMap_.end()) return false;
+    insertNewNoLock(std::move(key), std::move(value));
+    return true;
+}
+
+template<typename Key, typename Value>
+std::optional<Value> LfuCache<Key, Value>::compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn){
+    Lock lock(mutex_, removals_);
+    applyReadBuffersNoLock();
+    auto it = findLiveNoLock(key);
+    std::optional<Value> result = fn(it != nodeMap_.end() ? &it->second->value : nullptr);
+    if(it != nodeMap_.end()){
+        if(!result){
+            eraseNodeNoLock(it->second, RemovalCause::Explicit);
+            return result;
+        }
+        assignValueNoLock(it->second, Value(*result));
+        promoteNolock(it->second);
+    }else if(result && capacity_ > 0){
+        insertNewNoLock(std::move(key), Value(*result));
+    }
+    return result;
+}
+
+template<typename Key, typename Value>
+bool LfuCache<Key, Value>::getOrInsert(Key key, Value& value, const std::function<Value()>& factory){
+    if(readBuffers_ && get(key, value)) return true;
+    Lock lock(mutex_, removals_);
+    applyReadBuffersNoLock();
+    auto it = findLiveNoLock(key);
+    if(it != nodeMap_.end()){
+        value = it->second->value;
+        promoteNolock(it->second);
+        return true;
+    }
+    value = factory();
+    if(capacity_ > 0) insertNewNoLock(std::move(key), Value(value));
+    return false;
+}
+
+template<typename Key, typename Value>
+std::vector<std::pair<Key, Value>> LfuCache<Key, Value>::drain(){
+    std::lock_guard<ContentionSharedMutex> lock(mutex_);
+    applyReadBuffersNoLock();  //频次先记上，迁移顺序才准
+    std::vector<std::pair<Key, Value>> out;
+    out.reserve(nodeMap_.size());
+    std::vector<int> freqs;
+    for(auto& kv : freqListMap_) freqs.push_back(kv.first);
+    std::sort(freqs.begin(), freqs.end());
+    //低频在前：迁移方按顺序插入时，高频条目最后进入、最不容易被挤掉
+    for(int f : freqs){
+        auto& list = freqListMap_[f];
+        NodePtr cur = list->getFirstNode();
+        while(cur && cur != list->tail_){
+            NodePtr next = cur->next_;
+            cur->next_ = nullptr;
+            if(cur->gen == generation_) out.emplace_back(std::move(cur->key), std::move(cur->value));
+            cur = next;
+        }
+        list->head_->next_ = list->tail_;
+    }
+    nodeMap_.clear();
+    freqListMap_.clear();
+    keyHeapBytes_ = 0;
+    valueHeapBytes_ = 0;
+    staleCount_ = 0;
+    minFreq_ = 1;
+    return out;
+}
+
+template<typename Key, typename Value>
+bool LfuCache<Key, Value>::remove(Key key){
+    Lock lock(mutex_, removals_);
+    applyReadBuffersNoLock();
+    auto it = findLiveNoLock(key);
+    if(it == nodeMap_.end()) return false;
+    eraseNodeNoLock(it->second, RemovalCause::Explicit);
+    return true;
+}
+
+template<typename Key, typename Value>
+size_t LfuCache<Key, Value>::invalidateIf(const std::function<bool(const Key&, const Value&)>& pred){
+    Lock lock(mutex_, removals_);
+    applyReadBuffersNoLock();
+    size_t n = 0;
+    for(auto it = nodeMap_.begin(); it != nodeMap_.end();){
+        NodePtr node = it->second;
+        ++it;   //eraseNodeNoLock 会删掉当前元素
+        const bool stale = node->gen != generation_;
+        if(stale || pred(node->key, node->value)){
+            eraseNodeNoLock(node, stale ? RemovalCause::Expired : RemovalCause::Explicit);
+            if(!stale) ++n;
+        }
+    }
+    return n;
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::invalidateAll(){
+    std::lock_guard<ContentionSharedMutex> lock(mutex_);
+    applyReadBuffersNoLock();   //缓冲里的指针必须在下一次删除节点之前用掉
+    ++generation_;
+    staleCount_ = nodeMap_.size();
+    staleFreqsReady_ = false;   //游标留到第一次回收旧代条目时再建，这里保持 O(1)
+}
+
+template<typename Key, typename Value>
+MemoryUsage LfuCache<Key, Value>::memoryUsage() const{
+    std::shared_lock<ContentionSharedMutex> lock(mutex_);
+    MemoryUsage m;
+    m.entries  = nodeMap_.size();
+    m.index    = hashIndexBytes(nodeMap_) + keyHeapBytes_;
+    m.nodes    = nodeMap_.size() * (sharedNodeBytes<Node>() - sizeof(Value)) + keyHeapBytes_;
+    m.values   = nodeMap_.size() * sizeof(Value) + valueHeapBytes_;
+    //每个非空频率一条 FreqList：freq→list 的哈希表 + FreqList 对象 + 两个哨兵节点
+    m.metadata = hashIndexBytes(freqListMap_)
+               + freqListMap_.size() * (mallocBytes(sizeof(FreqList<Key, Value>)) + 2 * sharedNodeBytes<Node>());
+    if(readBuffers_) m.metadata += mallocBytes(kReadStripes * sizeof(ReadBuffer));
+    return m;
+}
+
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize){
+    std::lock_guard<ContentionSharedMutex> lock(mutex_);
+    removals_.setListener(std::move(listener), batchSize);
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::flushRemovals(){
+    Lock lock(mutex_, removals_, true);
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::insertNewNoLock(Key&& key, Value&& value){
+    if(static_cast<int>(nodeMap_.size()) >= capacity_){
+        evictOneNoLock();
+    }
+    NodePtr node = std::make_shared<Node>(std::move(key), std::move(value));
+    node->gen = generation_;
+    nodeMap_[node->key] = node;
+    accountInsert(node);
+    addToFreqListNoLock(node); // 放到 freq=1 的链表
+    minFreq_ = 1;
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::assignValueNoLock(const NodePtr& node, Value&& value){
+    valueHeapBytes_ -= heapBytesOf(node->value);
+    removals_.push(node->key, std::move(node->value), RemovalCause::Replaced);
+    node->value = std::move(value);
+    valueHeapBytes_ += heapBytesOf(node->value);
+}
 
 template<typename Key, typename Value>
 void LfuCache<Key, Value>::promoteNolock(const NodePtr& node){
@@ -77,8 +267,56 @@ void LfuCache<Key, Value>::promoteNolock(const NodePtr& node){
     }
 }
 
+template<typename Key, typename Value>
+typename LfuCache<Key, Value>::NodeMap::iterator LfuCache<Key, Value>::findLiveNoLock(const Key& key){
+    auto it = nodeMap_.find(key);
+    if(it != nodeMap_.end() && it->second->gen != generation_){
+        eraseNodeNoLock(it->second, RemovalCause::Expired);
+        return nodeMap_.end();
+    }
+    return it;
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::eraseNodeNoLock(NodePtr node, RemovalCause cause){ //按值持有：调用方传进来的可能是 map 里的那份
+    if(node->gen != generation_ && staleCount_ > 0) --staleCount_;
+    removeFromFreqListNoLock(node);
+    accountErase(node);
+    nodeMap_.erase(node->key);
+    removals_.push(node->key, std::move(node->value), cause);
+}
+
+//旧代条目从不重新入链，所以在每条频率链表里都是一段前缀：看各链表的第一个节点即可。
+//invalidateAll 之后第一次用到时把当时的频率记成游标（从低到高），之后只看游标末尾那条链表：
+//链表没了或者头上已是新代条目就弹出，它以后不会再出现旧代条目（新建的链表里也不会有）。
+//每次弹出对应一条链表、每次回收对应一个旧代条目，均摊 O(1)，不再每次淘汰都把 freqListMap_ 扫一遍
+template<typename Key, typename Value>
+bool LfuCache<Key, Value>::evictStaleNoLock(Key* evicted){
+    if(!staleFreqsReady_){
+        staleFreqs_.clear();
+        for(auto& kv : freqListMap_) staleFreqs_.push_back(kv.first);
+        std::sort(staleFreqs_.begin(), staleFreqs_.end(), std::greater<int>());
+        staleFreqsReady_ = true;
+    }
+    while(!staleFreqs_.empty()){
+        auto it = freqListMap_.find(staleFreqs_.back());
+        if(it != freqListMap_.end()){
+            NodePtr first = it->second->getFirstNode();
+            if(first != it->second->tail_ && first->gen != generation_){
+                if(evicted) *evicted = first->key;
+                eraseNodeNoLock(first, RemovalCause::Expired);   //可能删掉这条链表，下次 find 不到时弹出
+                return true;
+            }
+        }
+        staleFreqs_.pop_back();
+    }
+    staleCount_ = 0;
+    return false;
+}
+
 template<typename Key, typename Value>
 void LfuCache<Key, Value>::evictOneNoLock(){
+    if(staleCount_ > 0 && evictStaleNoLock(nullptr)) return;
     auto itList = freqListMap_.find(minFreq_);
     if(itList == freqListMap_.end() || itList->second->isEmpty()){
         updateMinFreqNoLock();
@@ -88,7 +326,9 @@ void LfuCache<Key, Value>::evictOneNoLock(){
 
     NodePtr victim = itList->second->getFirstNode();
     itList->second->removeNode(victim);
+    accountErase(victim);
     nodeMap_.erase(victim->key);
+    removals_.push(victim->key, std::move(victim->value), RemovalCause::Capacity);
 
     if(itList->second->isEmpty()){
         freqListMap_.erase(itList);
@@ -135,4 +375,40 @@ void LfuCache<Key, Value>::updateMinFreqNoLock() {
     minFreq_ = best;
 }
 
-}
\ No newline at end of file
+template<typename Key, typename Value>
+bool LfuCache<Key, Value>::recordReadNoLock(Node* node){
+    ReadBuffer& buf = readBuffers_[readBufferThreadIndex() & (kReadStripes - 1)];
+    //先读一次再 fetch_add：满了之后的读者只读不写，不会把 cache line 抢来抢去
+    if(buf.count.load(std::memory_order_relaxed) < kReadBufferSize){
+        const uint32_t slot = buf.count.fetch_add(1, std::memory_order_relaxed);
+        if(slot < kReadBufferSize){
+            buf.slots[slot] = node;  //槽位已被本线程独占；排空在独占锁内，由锁建立先后关系
+            return slot + 1 == kReadBufferSize;
+        }
+    }
+    buf.dropped.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::applyReadBuffersNoLock(){
+    if(!readBuffers_) return;
+    for(size_t s=0; s<kReadStripes; ++s){
+        ReadBuffer& buf = readBuffers_[s];
+        const uint32_t n = std::min(buf.count.load(std::memory_order_relaxed), kReadBufferSize);
+        for(uint32_t i=0; i<n; ++i){
+            //节点只在独占锁内释放，而每个独占临界区开头都会先排空，所以这里的指针都还有效
+            auto it = nodeMap_.find(buf.slots[i]->key);
+            if(it != nodeMap_.end()) promoteNolock(it->second);
+        }
+        buf.count.store(0, std::memory_order_relaxed);
+    }
+}
+
+template<typename Key, typename Value>
+void LfuCache<Key, Value>::discardReadBuffersNoLock(){
+    if(!readBuffers_) return;
+    for(size_t s=0; s<kReadStripes; ++s) readBuffers_[s].count.store(0, std::memory_order_relaxed);
+}
+
+}
@@ -6,31 +6,61 @@ namespace CacheSystem{
 
 template<typename Key, typename Value>
 LruCache<Key, Value>::LruCache(int capacity)
-    :   capacity_(capacity){
-        initializeList();
+    :   capacity_(capacity)
+    ,   flat_(capacity > 0 ? static_cast<size_t>(capacity) : 0){
+        if constexpr (!kInline) initializeList(); //扁平布局不需要哨兵节点
+        else flat_.attachRemovals(&removals_);
     }
 
+template<typename Key, typename Value>
+LruCache<Key, Value>::~LruCache(){
+    //默认析构时 head 释放 next，next 又释放它的 next……十万个节点就是十万层递归
+    NodePtr node = std::move(dummyHead_);
+    while(node){
+        NodePtr next = std::move(node->next_);
+        node = std::move(next);
+    }
+}
+
 //add or update cache
 template<typename Key, typename Value>
 void LruCache<Key, Value>::put(Key key, Value value){
-    if(capacity_<=0)    return;
-
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
+    Lock lock(mutex_, removals_);
+    if(capacity_<=0)    return; //capacity_ 可被 setCapacity 修改，必须在锁内读取
+    if constexpr (kInline) {
+        const uint32_t i = flat_.find(key);
+        if (i != flat_.kNil) {
+            removals_.push(key, flat_.valueAt(i), RemovalCause::Replaced);
+            flat_.setValue(i, value);
+            flat_.touch(i);
+            return;
+        }
+        if (flat_.size() >= capacity_) flat_.evictOldest();
+        flat_.insert(key, value);
+        return;
+    }
+    auto it = findLive(key);
     if (it != nodeMap_.end()) {
-        updateExistingNode(it->second, value);
+        updateExistingNode(it->second, std::move(value));
         return;
     }
-    addNewNode(key, value);
+    addNewNode(key, std::move(value));
 }
 
 template<typename Key, typename Value>
 bool LruCache<Key, Value>::get(Key key, Value& value){
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
+    Lock lock(mutex_, removals_);   //旧代节点会在这里被回收
+    if constexpr (kInline) {
+        const uint32_t i = flat_.find(key);
+        if (i == flat_.kNil) return false;
+        flat_.touch(i);
+        flat_.copyValue(i, value);
+        return true;
+    }
+    auto it = findLive(key);
     if(it!=nodeMap_.end()){
         moveToMostRecent(it->second);
-        value = it->second->getValue();
+        value = it->second->value_; //直接拷贝赋值，避免 getValue() 多一次临时拷贝
         return true;
     }
     return false;
@@ -44,16 +74,224 @@ Value LruCache<Key, Value> ::get(Key key){
 }
 
 template<typename Key, typename Value>
-void LruCache<Key, Value> ::remove(Key key){
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = nodeMap_.find(key);
-    if(it!=nodeMap_.end()){
-        removeNode(it->second);
-        nodeMap_.erase(it);
+bool LruCache<Key, Value> ::remove(Key key){
+    Lock lock(mutex_, removals_);
+    if constexpr (kInline) {
+        return flat_.erase(key);
+    }
+    auto it = findLive(key);
+    if(it==nodeMap_.end()) return false;
+    eraseEntry(it, RemovalCause::Explicit);
+    return true;
+}
+
+template<typename Key, typename Value>
+size_t LruCache<Key, Value>::invalidateIf(const std::function<bool(const Key&, const Value&)>& pred){
+    Lock lock(mutex_, removals_);
+    if constexpr (kInline) {
+        return flat_.eraseIf(pred);
+    }
+    size_t n = 0;
+    NodePtr cur = dummyHead_->next_;
+    while(cur && cur != dummyTail_){
+        NodePtr next = cur->next_;
+        const bool stale = cur->generation_ != generation_;
+        if(stale || pred(cur->key_, cur->value_)){
+            eraseEntry(nodeMap_.find(cur->key_), stale ? RemovalCause::Expired : RemovalCause::Explicit);
+            if(!stale) ++n;
+        }
+        cur = next;
+    }
+    return n;
+}
+
+template<typename Key, typename Value>
+void LruCache<Key, Value>::invalidateAll(){
+    std::lock_guard<ContentionMutex> lock(mutex_);
+    if constexpr (kInline) {
+        flat_.invalidateAll();
+        return;
+    }
+    ++generation_;
+}
+
+template<typename Key, typename Value>
+MemoryUsage LruCache<Key, Value>::memoryUsage() const{
+    std::lock_guard<ContentionMutex> lock(mutex_);
+    MemoryUsage m;
+    if constexpr (kInline) {
+        //没有哨兵、控制块和 malloc 头，只有节点数组和索引槽
+        m.entries = flat_.size();
+        m.index   = flat_.indexBytes();
+        m.nodes   = flat_.nodeBytes();
+        m.values  = flat_.valueBytes();
+        return m;
+    }
+    m.entries = nodeMap_.size();
+    m.index   = hashIndexBytes(nodeMap_) + keyHeapBytes_;    //map 里存了一份 key
+    m.nodes   = (nodeMap_.size() + 2) * (sharedNodeBytes<LruNodeType>() - sizeof(Value))
+              + keyHeapBytes_;                               //节点里又存了一份 key；+2 为头尾哨兵
+    m.values  = (nodeMap_.size() + 2) * sizeof(Value) + valueHeapBytes_;
+    return m;
+}
+
+template<typename Key, typename Value>
+void LruCache<Key, Value>::setCapacity(size_t capacity){
+    {
+        std::lock_guard<ContentionMutex> lock(mutex_);
+        capacity_ = capacity;
+    }
+    //一次性驱逐到新容量可能要持锁很久，这里每批只驱逐 kEvictBatch 个；
+    //批间其他线程的 put 也会在 addNewNode 中各驱逐一个，所以 size 不会反弹
+    for(;;){
+        Lock lock(mutex_, removals_);  //每批驱逐的通知在本批解锁后投递
+        if constexpr (kInline) {
+            for(size_t i=0; i<kEvictBatch && flat_.size()>capacity_; ++i){
+                flat_.evictOldest();
+            }
+            if(flat_.size()<=capacity_) return;
+        } else {
+            for(size_t i=0; i<kEvictBatch && nodeMap_.size()>capacity_; ++i){
+                evictLeastRecent();
+            }
+            if(nodeMap_.size()<=capacity_) return;
+        }
+    }
+}
+
+template<typename Key, typename Value>
+std::optional<Value> LruCache<Key, Value>::compute(Key key, const std::function<std::optional<Value>(const Value*)>& fn){
+    Lock lock(mutex_, removals_);
+    if constexpr (kInline) {
+        const uint32_t i = flat_.find(key);
+        std::optional<Value> result = fn(i != flat_.kNil ? &flat_.valueAt(i) : nullptr);
+        if (i != flat_.kNil) {
+            if (!result) {
+                flat_.eraseAt(i);
+                return result;
+            }
+            removals_.push(key, flat_.valueAt(i), RemovalCause::Replaced);
+            flat_.setValue(i, *result);
+            flat_.touch(i);
+        } else if (result && capacity_ > 0) {
+            if (flat_.size() >= capacity_) flat_.evictOldest();
+            flat_.insert(key, *result);
+        }
+        return result;
     }
+    auto it = findLive(key);
+    std::optional<Value> result = fn(it != nodeMap_.end() ? &it->second->value_ : nullptr);
+    if (it != nodeMap_.end()) {
+        if (!result) {
+            eraseEntry(it, RemovalCause::Explicit);
+            return result;
+        }
+        updateExistingNode(it->second, Value(*result));
+    } else if (result && capacity_ > 0) {
+        addNewNode(key, Value(*result));
+    }
+    return result;
+}
+
+template<typename Key, typename Value>
+bool LruCache<Key, Value>::putIfAbsent(Key key, Value value){
+    Lock lock(mutex_, removals_);
+    if constexpr (kInline) {
+        if(capacity_<=0 || flat_.find(key) != flat_.kNil) return false;
+        if(flat_.size() >= capacity_) flat_.evictOldest();
+        flat_.insert(key, value);
+        return true;
+    }
+    if(capacity_<=0 || findLive(key) != nodeMap_.end()) return false;
+    addNewNode(key, std::move(value));
+    return true;
+}
+
+template<typename Key, typename Value>
+bool LruCache<Key, Value>::getOrInsert(Key key, Value& value, const std::function<Value()>& factory){
+    Lock lock(mutex_, removals_);
+    if constexpr (kInline) {
+        const uint32_t i = flat_.find(key);
+        if (i != flat_.kNil) {
+            flat_.touch(i);
+            flat_.copyValue(i, value);
+            return true;
+        }
+        value = factory();
+        if (capacity_ <= 0) return false;
+        if (flat_.size() >= capacity_) flat_.evictOldest();
+        flat_.insert(key, value);
+        return false;
+    }
+    auto it = findLive(key);
+    if (it != nodeMap_.end()) {
+        moveToMostRecent(it->second);
+        value = it->second->value_;
+        return true;
+    }
+    value = factory();
+    if (capacity_ > 0) addNewNode(key, Value(value));
+    return false;
+}
+
+template<typename Key, typename Value>
+std::vector<std::pair<Key, Value>> LruCache<Key, Value>::drain(){
+    std::lock_guard<ContentionMutex> lock(mutex_);
+    std::vector<std::pair<Key, Value>> out;
+    if constexpr (kInline) {
+        out.reserve(flat_.size());
+        flat_.forEachOldestFirst([&](const Key& k, const Value& v){ out.emplace_back(k, v); });
+        flat_.clear();
+        return out;
+    }
+    out.reserve(nodeMap_.size());
+    //逐个断开 next_：整条 shared_ptr 链一次性析构会递归很深
+    NodePtr cur = dummyHead_->next_;
+    while(cur && cur != dummyTail_){
+        NodePtr next = cur->next_;
+        cur->next_ = nullptr;
+        if(cur->generation_ == generation_) out.emplace_back(std::move(cur->key_), std::move(cur->value_));
+        cur = next;
+    }
+    nodeMap_.clear();
+    initializeList();
+    keyHeapBytes_ = 0;
+    valueHeapBytes_ = 0;
+    return out;
+}
+
+template<typename Key, typename Value>
+void LruCache<Key, Value>::setRemovalListener(RemovalListener<Key, Value> listener, size_t batchSize){
+    std::lock_guard<ContentionMutex> lock(mutex_);
+    removals_.setListener(std::move(listener), batchSize);
+}
+
+template<typename Key, typename Value>
+void LruCache<Key, Value>::flushRemovals(){
+    Lock lock(mutex_, removals_, true);
 }
 
 //private 
+template<typename Key, typename Value>
+typename LruCache<Key, Value>::Map::iterator LruCache<Key, Value>::findLive(const Key& key){
+    auto it = nodeMap_.find(key);
+    if(it != nodeMap_.end() && it->second->generation_ != generation_){
+        eraseEntry(it, RemovalCause::Expired);
+        return nodeMap_.end();
+    }
+    return it;
+}
+
+//摘链、扣减字节数、发通知（value 直接 move 走，节点随后就释放了）、删索引
+template<typename Key, typename Value>
+void LruCache<Key, Value>::eraseEntry(typename Map::iterator it, RemovalCause cause){
+    NodePtr node = it->second;
+    removeNode(node);
+    accountErase(node);
+    nodeMap_.erase(it);
+    removals_.push(node->key_, std::move(node->value_), cause);
+}
+
 template<typename Key, typename Value>
 void LruCache<Key, Value> ::initializeList(){
     dummyHead_ = std::make_shared<LruNodeType>(Key(),Value());
@@ -63,20 +301,26 @@ void LruCache<Key, Value> ::initializeList(){
 }
 
 template<typename Key, typename Value>
-void LruCache<Key, Value>::updateExistingNode(NodePtr node, const Value& value){
-    node->setValue(value);
+void LruCache<Key, Value>::updateExistingNode(NodePtr node, Value&& value){
+    valueHeapBytes_ -= heapBytesOf(node->value_);
+    removals_.push(node->key_, std::move(node->value_), RemovalCause::Replaced);
+    node->setValue(std::move(value));
+    valueHeapBytes_ += heapBytesOf(node->value_);
     moveToMostRecent(node);
 }
 
 //if full, rm the last one, add at the tail
 template<typename Key, typename Value>
-void LruCache<Key, Value>::addNewNode(const Key& key, const Value& value){
+void LruCache<Key, Value>::addNewNode(const Key& key, Value&& value){
     if (nodeMap_.size() >= capacity_) {
         evictLeastRecent();//expel the least recent visits
     }
-    NodePtr newNode = std::make_shared<LruNodeType>(key, value);
+    NodePtr newNode = std::make_shared<LruNodeType>(key, std::move(value));
+    newNode->generation_ = generation_;
+    //value 直接 move 进节点：对 SlabValue 这类句柄只是转移所有权，不会重新分配
     //std::shared_ptr<LruNodeType> newNode(new LruNodeType(key, value));
     insertNode(newNode);
+    accountInsert(newNode);
     nodeMap_[key] = newNode;
 }
 
@@ -109,8 +353,8 @@ void LruCache<Key, Value>::insertNode(NodePtr node) {
 template<typename Key, typename Value>
 void LruCache<Key, Value>::evictLeastRecent() {
     NodePtr leastRecent = dummyHead_->next_;
-    removeNode(leastRecent);
-    nodeMap_.erase(leastRecent->getKey());
+    eraseEntry(nodeMap_.find(leastRecent->key_),
+               leastRecent->generation_ == generation_ ? RemovalCause::Capacity : RemovalCause::Expired);
 }
 
 }
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*  PerfCounters.h
+    基准用的硬件 / 软件计数器（只给 test/main.cpp 用），基于 perf_event_open：
+    - 每个线程在自己里面构造一份，只统计本线程（pid = 0, cpu = -1），start/stop 之间的增量用 read() 取出，
+      各线程的 PerfCounts 相加后除以操作数得到每次操作的 cycles / instructions / LLC miss / 分支预测失败 / 上下文切换；
+    - 每个事件单独打开（不组成 group），某个事件打不开只影响它自己：先试包含内核态，被 perf_event_paranoid 拒绝再退到只统计用户态，
+      仍然打不开（虚拟机里常见的 ENOENT、容器里的 EACCES）就标记为不可用，报告里显示 n/a；
+    - task-clock 是软件事件，几乎总能打开：硬件计数器都不可用时至少还有每次操作的 CPU 时间；
+    - 计数器数量超过硬件 PMU 时内核会分时复用，读数按 time_enabled / time_running 折算；
+    - 环境变量 CACHE_BENCH_PERF=0 时完全不打开，计数全部不可用。
+*/
+
+namespace PerfCounters {
+
+enum Event { Cycles, Instructions, LlcMisses, BranchMisses, ContextSwitches, TaskClockNs, kEventNum };
+
+inline const char* eventName(int e) {
+    static const char* names[kEventNum] = {"cycles", "instr", "LLC-miss", "br-miss", "ctx-sw", "task-ns"};
+    return names[e];
+}
+
+struct PerfCounts {
+    uint64_t value[kEventNum] = {};
+    bool     available[kEventNum] = {};
+
+    PerfCounts& operator+=(const PerfCounts& o) {
+        for (int e = 0; e < kEventNum; ++e) {
+            value[e] += o.value[e];
+            available[e] = available[e] || o.available[e];
+        }
+        return *this;
+    }
+    bool any() const {
+        for (int e = 0; e < kEventNum; ++e) if (available[e]) return true;
+        return false;
+    }
+    bool hardware() const { return available[Cycles] || available[Instructions]; }
+    double perOp(int e, uint64_t ops) const { return ops ? double(value[e]) / ops : 0.0; }
+};
+
+inline bool enabled() {
+    const char* env = ::getenv("CACHE_BENCH_PERF");
+    return !(env && std::strcmp(env, "0") == 0);
+}
+
+class ThreadCounters {
+public:
+    ThreadCounters() {
+        if (!enabled()) return;
+        static const uint32_t types[kEventNum] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                  PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE};
+        static const uint64_t configs[kEventNum] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                                                    PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_TASK_CLOCK};
+        for (int e = 0; e < kEventNum; ++e) fds_[e] = open(types[e], configs[e]);
+    }
+    ~ThreadCounters() {
+        for (int fd : fds_) if (fd >= 0) ::close(fd);
+    }
+    ThreadCounters(const ThreadCounters&) = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+    void start() {
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    void stop() {
+        for (int fd : fds_) if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    // stop 之后调用：按复用比例折算；读失败的事件记为不可用
+    PerfCounts read() const {
+        PerfCounts c;
+        for (int e = 0; e < kEventNum; ++e) {
+            if (fds_[e] < 0) continue;
+            uint64_t buf[3] = {};   // value, time_enabled, time_running
+            if (::read(fds_[e], buf, sizeof(buf)) != ssize_t(sizeof(buf))) continue;
+            c.available[e] = true;
+            c.value[e] = (buf[2] && buf[2] < buf[1]) ? uint64_t(double(buf[0]) * buf[1] / buf[2]) : buf[0];
+        }
+        return c;
+    }
+
+private:
+    static int open(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size        = sizeof(attr);
+        attr.type        = type;
+        attr.config      = config;
+        attr.disabled    = 1;
+        attr.exclude_hv  = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+            attr.exclude_kernel = 1;
+            fd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        return fd;
+    }
+
+    int fds_[kEventNum] = {-1, -1, -1, -1, -1, -1};
+};
+
+} // namespace PerfCounters
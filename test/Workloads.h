@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../include/CachePolicy.h"
+#include "../include/HashMix.h"
+
+/*  Workloads.h
+    基准用的负载生成器（只给 test/main.cpp 用）：key 都是 [0, n) 里的 uint64_t 编号，由调用方转成自己的 Key。
+    - ZipfGenerator：第 r 名（0 起）的概率 ∝ 1/(r+1)^θ，θ > 0 任意（含 θ = 1 和 θ > 1）。
+      用 rejection-inversion（Hörmann & Derflinger）：不预计算 zeta，构造 O(1)，每次抽样期望 O(1)，n 可以到 2^62；
+    - ScrambledZipf：同样的频次分布，但名次经过 [0, n) 上的一个双射打散，热点不再挤在编号最小的一段
+      （对按 key 取模分片、组相联分组的缓存，这才接近真实流量）；
+    - LatestGenerator：YCSB 的 latest，越新插入的 key 越热；insert() 推进最新编号；
+    - DriftingZipf：热点随时间平移，每 period 次抽样整体挪 step 个编号，模拟热点漂移；
+    - ValueSizeGenerator：value 大小，固定 / 均匀 / 按 key 确定的截断对数正态（同一个 key 每次大小一样）；
+    - YcsbWorkload：YCSB A–F 的操作配比（读 / 更新 / 插入 / 短扫描 / 读改写）和各自的 key 分布；
+    - run_concurrent_hitrate：多线程按同一分布并发访问同一个缓存，统计命中率和字节命中率，
+      用来看分片（每个分片各自淘汰）和并发交错对命中率的影响。
+*/
+
+namespace Workloads {
+
+using CacheSystem::fmix64;
+
+class ZipfGenerator {
+public:
+    ZipfGenerator(uint64_t n, double theta, uint64_t seed = 1)
+        : n_(std::max<uint64_t>(1, n)), theta_(theta), rng_(seed) {
+        hX1_ = hIntegral(1.5) - 1.0;
+        hN_  = hIntegral(double(n_) + 0.5);
+        s_   = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    // 返回名次 [0, n)，0 最热
+    uint64_t next() {
+        for (;;) {
+            const double u = hN_ + uniform_(rng_) * (hX1_ - hN_);
+            const double x = hIntegralInverse(u);
+            uint64_t k = static_cast<uint64_t>(x + 0.5);
+            if (k < 1) k = 1;
+            else if (k > n_) k = n_;
+            if (double(k) - x <= s_ || u >= hIntegral(double(k) + 0.5) - h(double(k))) return k - 1;
+        }
+    }
+    uint64_t operator()() { return next(); }
+
+    uint64_t n() const { return n_; }
+    double theta() const { return theta_; }
+
+private:
+    // h(x) = x^-θ，H(x) 是它的一个原函数，θ = 1 时取 log x（helper 在 0 附近取极限）
+    double h(double x) const { return std::exp(-theta_ * std::log(x)); }
+    double hIntegral(double x) const {
+        const double lx = std::log(x);
+        return expm1OverX((1.0 - theta_) * lx) * lx;
+    }
+    double hIntegralInverse(double x) const {
+        double t = x * (1.0 - theta_);
+        if (t < -1.0) t = -1.0;   //数值误差保护
+        return std::exp(log1pOverX(t) * x);
+    }
+    static double expm1OverX(double x) { return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5; }
+    static double log1pOverX(double x) { return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * 0.5; }
+
+    uint64_t n_;
+    double   theta_;
+    double   hX1_ = 0, hN_ = 0, s_ = 0;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+};
+
+// [0, n) 上的双射：在 2 的幂范围内做可逆的乘奇数 / 右移异或，落在 n 之外就再走一步（平均不到 2 步）
+class KeyScrambler {
+public:
+    explicit KeyScrambler(uint64_t n, uint64_t seed = 0x9e3779b97f4a7c15ULL) : n_(std::max<uint64_t>(1, n)) {
+        bits_ = 1;
+        while (bits_ < 64 && (uint64_t(1) << bits_) < n_) ++bits_;
+        mask_ = bits_ >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits_) - 1;
+        mul_  = fmix64(seed) | 1;
+    }
+    uint64_t operator()(uint64_t x) const {
+        do {
+            x = (x * mul_) & mask_;
+            x ^= x >> ((bits_ + 1) / 2);
+            x = (x * 0x9e3779b97f4a7c15ULL) & mask_;
+            x ^= x >> ((bits_ + 2) / 3);
+        } while (x >= n_);
+        return x;
+    }
+
+private:
+    uint64_t n_, mask_ = 0, mul_ = 1;
+    int      bits_ = 1;
+};
+
+class ScrambledZipf {
+public:
+    ScrambledZipf(uint64_t n, double theta, uint64_t seed = 1) : zipf_(n, theta, seed), scramble_(n) {}
+    uint64_t next() { return scramble_(zipf_.next()); }
+    uint64_t operator()() { return next(); }
+
+private:
+    ZipfGenerator zipf_;
+    KeyScrambler  scramble_;
+};
+
+// 最新插入的 key（编号 latest - 1）最热；编号小于 0 的部分截断到 0
+class LatestGenerator {
+public:
+    LatestGenerator(uint64_t initialKeys, double theta, uint64_t seed = 1)
+        : latest_(std::max<uint64_t>(1, initialKeys)), zipf_(latest_, theta, seed) {}
+    uint64_t next() {
+        const uint64_t r = zipf_.next();
+        return r < latest_ ? latest_ - 1 - r : 0;
+    }
+    uint64_t operator()() { return next(); }
+    uint64_t insert() { return latest_++; }   //返回新 key 的编号
+    uint64_t latest() const { return latest_; }
+
+private:
+    uint64_t      latest_;
+    ZipfGenerator zipf_;
+};
+
+// 热点平移：第 i 次抽样的 key = (scramble(rank) + (i / period) * step) mod n
+class DriftingZipf {
+public:
+    DriftingZipf(uint64_t n, double theta, uint64_t period, uint64_t step, uint64_t seed = 1)
+        : zipf_(n, theta, seed), n_(std::max<uint64_t>(1, n)),
+          period_(std::max<uint64_t>(1, period)), step_(step % n_) {}
+    uint64_t next() {
+        if (++count_ % period_ == 0) offset_ = (offset_ + step_) % n_;
+        return (zipf_.next() + offset_) % n_;
+    }
+    uint64_t operator()() { return next(); }
+
+private:
+    ScrambledZipf zipf_;
+    uint64_t      n_, period_, step_;
+    uint64_t      count_ = 0, offset_ = 0;
+};
+
+// value 大小：Fixed 恒为 mean；Uniform 在 [min, max]；LogNormal 由 key 哈希确定（同一个 key 大小固定），截断到 [min, max]
+class ValueSizeGenerator {
+public:
+    enum class Shape { Fixed, Uniform, LogNormal };
+
+    static ValueSizeGenerator fixed(uint32_t bytes) { return ValueSizeGenerator(Shape::Fixed, bytes, bytes, bytes, 0); }
+    static ValueSizeGenerator uniform(uint32_t min, uint32_t max) { return ValueSizeGenerator(Shape::Uniform, min, max, (min + max) / 2, 0); }
+    // median 是中位数，sigma 是 ln(size) 的标准差（1.0 左右时最大和最小差几个数量级）
+    static ValueSizeGenerator logNormal(uint32_t median, double sigma, uint32_t min, uint32_t max) {
+        return ValueSizeGenerator(Shape::LogNormal, min, max, median, sigma);
+    }
+
+    uint32_t sizeOf(uint64_t key) const {
+        switch (shape_) {
+        case Shape::Fixed:   return mean_;
+        case Shape::Uniform: return min_ + uint32_t(fmix64(key ^ 0x5bd1e995) % (uint64_t(max_) - min_ + 1));
+        default: {
+            // 两个由 key 决定的均匀数做 Box-Muller
+            const double u1 = (double(fmix64(key * 2 + 1) >> 11) + 0.5) / 9007199254740992.0;
+            const double u2 =  double(fmix64(key * 2 + 2) >> 11) / 9007199254740992.0;
+            const double z  = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+            const double s  = double(mean_) * std::exp(sigma_ * z);
+            return uint32_t(std::min<double>(max_, std::max<double>(min_, s)));
+        }
+        }
+    }
+
+private:
+    ValueSizeGenerator(Shape shape, uint32_t min, uint32_t max, uint32_t mean, double sigma)
+        : shape_(shape), min_(std::min(min, max)), max_(std::max(min, max)), mean_(mean), sigma_(sigma) {}
+
+    Shape    shape_;
+    uint32_t min_, max_, mean_;
+    double   sigma_;
+};
+
+// =============== YCSB A–F ===============
+enum class OpType { Read, Update, Insert, Scan, ReadModifyWrite };
+
+struct WorkloadOp {
+    OpType   type;
+    uint64_t key;
+    uint32_t scanLen;     //Scan 时连续读的 key 数
+    uint32_t valueBytes;  //写入 / 读到的 value 大小
+};
+
+enum class Ycsb { A, B, C, D, E, F };
+
+// A 50% 读 50% 更新；B 95/5；C 只读；D 95% 读最新 + 5% 插入；E 95% 短扫描 + 5% 插入；F 50% 读 50% 读改写。
+// A/B/C/E/F 的 key 用 ScrambledZipf（YCSB 的 zipfian 默认就是打散的），D 用 LatestGenerator
+class YcsbWorkload {
+public:
+    YcsbWorkload(Ycsb kind, uint64_t records, double theta, ValueSizeGenerator sizes, uint64_t seed = 1,
+                 uint32_t maxScanLen = 100)
+        : kind_(kind), zipf_(records, theta, seed), latest_(records, theta, seed),
+          sizes_(sizes), rng_(seed ^ 0xabcdef), maxScanLen_(std::max<uint32_t>(1, maxScanLen)) {}
+
+    WorkloadOp next() {
+        const uint32_t r = rng_() % 100;
+        WorkloadOp op{OpType::Read, 0, 1, 0};
+        switch (kind_) {
+        case Ycsb::A: op.type = r < 50 ? OpType::Read : OpType::Update; break;
+        case Ycsb::B: op.type = r < 95 ? OpType::Read : OpType::Update; break;
+        case Ycsb::C: op.type = OpType::Read; break;
+        case Ycsb::D: op.type = r < 95 ? OpType::Read : OpType::Insert; break;
+        case Ycsb::E: op.type = r < 95 ? OpType::Scan : OpType::Insert; break;
+        case Ycsb::F: op.type = r < 50 ? OpType::Read : OpType::ReadModifyWrite; break;
+        }
+        if (op.type == OpType::Insert) op.key = latest_.insert();
+        else if (kind_ == Ycsb::D)     op.key = latest_.next();
+        else                           op.key = zipf_.next();
+        if (op.type == OpType::Scan) op.scanLen = 1 + uint32_t(rng_() % maxScanLen_);
+        op.valueBytes = sizes_.sizeOf(op.key);
+        return op;
+    }
+
+    static const char* name(Ycsb kind) {
+        static const char* names[] = {"YCSB-A", "YCSB-B", "YCSB-C", "YCSB-D", "YCSB-E", "YCSB-F"};
+        return names[int(kind)];
+    }
+
+private:
+    Ycsb               kind_;
+    ScrambledZipf      zipf_;
+    LatestGenerator    latest_;
+    ValueSizeGenerator sizes_;
+    std::mt19937_64    rng_;
+    uint32_t           maxScanLen_;
+};
+
+// =============== 多线程命中率：每个线程一个同分布、不同种子的生成器，并发访问同一个缓存 ===============
+struct ConcurrentHitRate {
+    uint64_t gets = 0, hits = 0;
+    uint64_t bytesRequested = 0, bytesHit = 0;
+    double hitRate() const { return gets ? 100.0 * hits / gets : 0.0; }
+    double byteHitRate() const { return bytesRequested ? 100.0 * bytesHit / bytesRequested : 0.0; }
+};
+
+// makeGen(threadIndex) 返回一个 uint64_t() 生成器；未命中按 cache-aside 回填。
+// 前 warmPerThread 次不计入统计；sizeOf 给出每个 key 的字节数，用于字节命中率
+template<class Key, class Value, class MakeGen, class ToKey>
+ConcurrentHitRate run_concurrent_hitrate(CacheSystem::CachePolicy<Key, Value>& cache, MakeGen makeGen, ToKey toKey, int threads,
+                                         size_t opsPerThread, size_t warmPerThread,
+                                         const ValueSizeGenerator& sizes = ValueSizeGenerator::fixed(1)) {
+    std::atomic<uint64_t> gets{0}, hits{0}, bytesReq{0}, bytesHit{0};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([&, t] {
+            auto gen = makeGen(t);
+            uint64_t g = 0, h = 0, br = 0, bh = 0;
+            for (size_t i = 0; i < warmPerThread + opsPerThread; ++i) {
+                const uint64_t id = gen();
+                const Key key = toKey(id);
+                Value out{};
+                const bool hit = cache.get(key, out);
+                if (!hit) cache.put(key, out);
+                if (i < warmPerThread) continue;
+                const uint32_t bytes = sizes.sizeOf(id);
+                ++g; br += bytes;
+                if (hit) { ++h; bh += bytes; }
+            }
+            gets += g; hits += h; bytesReq += br; bytesHit += bh;
+        });
+    }
+    for (auto& th : ts) th.join();
+    return {gets.load(), hits.load(), bytesReq.load(), bytesHit.load()};
+}
+
+} // namespace Workloads
@@ -1,10 +1,25 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "../include/CachePolicy.h"
 //lru
 #include "../include/LruCache.h"
 #include "../include/LruKDecorator.h"
 #include "../include/HashLruCache.h"
+#include "../include/NearCache.h"
 //lfu
 #include "../include/LfuCache.h"
 #include "../include/LfuAgingDecorator.h"
@@ -12,6 +27,38 @@
 //arc
 #include "../include/ArcCache.h"
 #include "../include/ArcHybridCache.h"
+//lirs
+#include "../include/LirsCache.h"
+//s3-fifo
+#include "../include/S3FifoCache.h"
+#include "../include/HashS3FifoCache.h"
+//set-associative
+#include "../include/SetAssocCache.h"
+//slab
+#include "../include/SlabArena.h"
+//write-back
+#include "../include/WriteBackCache.h"
+//miss-ratio curve
+#include "../include/MissRatioProfiler.h"
+//cost-aware
+#include "../include/GdsfCache.h"
+//negative cache
+#include "../include/NegativeCache.h"
+//multi-process
+#include "../include/SharedMemoryCache.h"
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+//memcached server
+#include "../include/MemcacheServer.h"
+#include <sys/un.h>
+
+#include "../include/TenantCache.h"
+
+#include "../include/MaintenanceExecutor.h"
+
+#include "Workloads.h"
+#include "PerfCounters.h"
 
 using Key = int;
 using Val = int;
@@ -59,6 +106,18 @@ std::vector<Op> gen_bursty(size_t ops, int phases, int universe, int window=200,
     }
     return v;
 }
+// Zipf 分布（名次打散），线上流量大多接近 θ = 0.99
+std::vector<Op> gen_zipf(size_t ops, uint64_t universe, double theta, int p_put=20, unsigned seed=11){
+    Workloads::ScrambledZipf zipf(universe, theta, seed);
+    std::mt19937 g(seed);
+    std::vector<Op> v; v.reserve(ops);
+    for (size_t i=0;i<ops;++i){
+        Key k = (Key)zipf();
+        bool isPut = int(g()%100) < p_put;
+        v.push_back({isPut, k, (Val)k});
+    }
+    return v;
+}
 
 // =============== 单实例命中率跑法（预热 + 回放同一序列） ===============
 struct HitStats { size_t req=0, hit=0; };
@@ -93,6 +152,8 @@ void run_all_hitrate(){
     auto ops_hot  = gen_hotspot(200000, /*hot*/200, /*cold*/8000, 70, 30, 123);
     auto ops_scan = gen_scan   (200000, /*loop*/10000, 30, 10, 20, 321);
     auto ops_bst  = gen_bursty (200000, /*phases*/5, /*U*/20000, 300, 20, 777);
+    auto ops_loop = gen_scan   (200000, /*loop*/CAP * 3 / 2, 10, 5, 20, 654); // 循环长度略大于容量：LRU 的最坏情况
+    auto ops_zipf = gen_zipf   (200000, /*U*/100000, 0.99, 20, 99);
 
     std::vector<Key> warm_keys(1000); std::iota(warm_keys.begin(), warm_keys.end(), 0);
 
@@ -101,9 +162,16 @@ void run_all_hitrate(){
         {"LRU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(CAP)); }},
         {"LRU-K(K=2)", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruKDecorator<Key,Val>(CAP, /*history*/ 100000, /*K*/2)); }},
         {"LFU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LfuCache<Key,Val>(CAP)); }},
-        {"LFU-Aging",  [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LfuAgingDecorator<Key,Val>(CAP, /*maxAvg*/ 5000)); }},
+        {"LFU(buf)",   [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::BufferedLfuCache<Key,Val>(CAP)); }},
+        {"LFU-Aging",  [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::AgingLfuCache<Key,Val>(CAP, /*maxAvg*/ 5000)); }},
         {"ARC",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcCache<Key,Val>(CAP)); }},
-        {"ARC-Hybrid", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcHybridCache<Key,Val>(CAP, /*threshold*/2)); }},
+        {"ARC-Hybrid", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcHybridCache<Key,Val>(CAP)); }},
+        {"LIRS",       [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LirsCache<Key,Val>(CAP)); }},
+        {"S3-FIFO",    [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::S3FifoCache<Key,Val>(CAP)); }},
+        {"SetAssoc-8", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,8>(CAP)); }},
+        {"SetAssoc-16",[=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,16>(CAP)); }},
+        {"Hash LRU(4)",[=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLruCache<Key,Val>(CAP, 4)); }},
+        {"Hash S3F(4)",[=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashS3FifoCache<Key,Val>(CAP, 4)); }},
     };
 
     auto run_block = [&](const std::string& title, const std::vector<Op>& ops){
@@ -119,31 +187,17 @@ void run_all_hitrate(){
 
     run_block("热点访问（80/20 近似）", ops_hot);
     run_block("循环扫描",             ops_scan);
+    run_block("小循环（1.5 倍容量）",  ops_loop);
     run_block("阶段性热点突变",       ops_bst);
+    run_block("Zipf θ=0.99",          ops_zipf);
 }
 
-// =============== 通用 Hash 分片装饰器（用于 QPS/延迟基准，任意算法都能分片） ===============
-template<typename KeyT, typename ValT>
-class ShardedCache : public CacheSystem::CachePolicy<KeyT, ValT> {
-public:
-    using Factory = std::function<std::unique_ptr<CacheSystem::CachePolicy<KeyT,ValT>>(size_t shardCap, int shardIdx)>;
-    ShardedCache(size_t totalCap, int shards, Factory f)
-        : shards_(std::max(1, shards)) {
-        size_t per = (totalCap + shards_ - 1) / shards_;
-        caches_.reserve(shards_);
-        for (int i=0;i<shards_; ++i) caches_.push_back(f(per, i));
-    }
-    void put(KeyT k, ValT v) override { caches_[idx(k)]->put(k, v); }
-    bool get(KeyT k, ValT& v) override { return caches_[idx(k)]->get(k, v); }
-    ValT get(KeyT k) override { ValT v{}; (void)get(k, v); return v; }
-private:
-    size_t idx(const KeyT& k) const { return std::hash<KeyT>{}(k) % shards_; }
-    int shards_;
-    std::vector<std::unique_ptr<CacheSystem::CachePolicy<KeyT,ValT>>> caches_;
-};
+// =============== 通用 Hash 分片（任意算法都能分片）：CacheSystem::ShardedCache 套上 CachePolicy 接口 ===============
+template<class Policy>
+using Sharded = CacheSystem::CachePolicyAdapter<CacheSystem::ShardedCache<Policy, Key, Val>>;
 
 // =============== 多线程延迟/QPS 基准（固定时间窗口） ===============
-struct LatQps { double avg_us=0; double qps=0; double hit_rate=0; };
+struct LatQps { double avg_us=0; double qps=0; double hit_rate=0; uint64_t ops=0; PerfCounters::PerfCounts perf; };
 template<class MakeCache, class Gen>
 LatQps run_qps(MakeCache make, Gen gen, int threads, std::chrono::seconds duration,
                std::chrono::microseconds hitCost = std::chrono::microseconds(2),
@@ -153,15 +207,18 @@ LatQps run_qps(MakeCache make, Gen gen, int threads, std::chrono::seconds durati
     std::atomic<bool> stop{false};
     std::atomic<uint64_t> ops{0}, hits{0};
     std::atomic<uint64_t> total_ns{0};
+    std::mutex perfMutex;
+    PerfCounters::PerfCounts perf;             // 各线程计数器之和（不可用的事件保持 n/a）
 
     auto worker = [&](){
         Val out{};
         auto g = gen(); // 每线程一份生成器（避免锁）
+        PerfCounters::ThreadCounters counters;   // 只统计本线程；模拟的 hit/miss 代价不是真实执行，不计入
+        counters.start();
         while (!stop.load(std::memory_order_relaxed)){
             auto begin = std::chrono::high_resolution_clock::now();
             Key k = g();
-            bool ok = cache->get(k, out);
-            if (!ok) cache->put(k, k);
+            bool ok = cache->getOrInsert(k, out, [k]{ return (Val)k; }); // 一次加锁完成“未命中则回填”
             auto end = std::chrono::high_resolution_clock::now();
             auto service = ok ? hitCost : missCost;
             auto elapsed = (end - begin) + service;
@@ -170,6 +227,9 @@ LatQps run_qps(MakeCache make, Gen gen, int threads, std::chrono::seconds durati
             total_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
                                std::memory_order_relaxed);
         }
+        counters.stop();
+        std::lock_guard<std::mutex> lk(perfMutex);
+        perf += counters.read();
     };
 
     std::vector<std::thread> ts;
@@ -183,9 +243,24 @@ LatQps run_qps(MakeCache make, Gen gen, int threads, std::chrono::seconds durati
     r.qps = nops / double(duration.count());
     r.hit_rate = nops ? (100.0 * nhit / nops) : 0.0;
     r.avg_us = nops ? (nns / 1000.0 / nops) : 0.0;
+    r.ops = nops;
+    r.perf = perf;
     return r;
 }
 
+// 每次操作的计数器读数；打不开的事件显示 n/a，一个都没有时什么也不打印
+void print_perf(const PerfCounters::PerfCounts& perf, uint64_t ops){
+    if (!perf.any()) return;
+    std::cout << std::fixed << std::setprecision(1);
+    for (int e = 0; e < PerfCounters::kEventNum; ++e) {
+        std::cout << " " << PerfCounters::eventName(e) << "/op=";
+        if (perf.available[e]) std::cout << std::setprecision(e == PerfCounters::ContextSwitches ? 4 : 1) << perf.perOp(e, ops);
+        else std::cout << "n/a";
+    }
+    if (perf.available[PerfCounters::Cycles] && perf.available[PerfCounters::Instructions] && perf.value[PerfCounters::Cycles])
+        std::cout << " IPC=" << std::setprecision(2) << double(perf.value[PerfCounters::Instructions]) / perf.value[PerfCounters::Cycles];
+}
+
 // 简单生成器：热点 80/20（用于 QPS）
 auto make_hot_keygen(size_t universe=100000, double hot_ratio=0.2, double p_hot=0.8, unsigned seed=2025){
     return [=]() mutable {
@@ -214,29 +289,1367 @@ void run_all_qps(){
     items.push_back({"Hash LFU",
         [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLfuCache<Key,Val>(TOTAL_CAP, SHARDS)); }});
 
+    // 读缓冲 LFU：命中只拿共享锁，频次增量攒批在写时应用
+    items.push_back({"Hash LFU(buf)",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashBufferedLfuCache<Key,Val>(TOTAL_CAP, SHARDS)); }});
+
+    // 分片 LRU 前加每线程 L1：热点 key 命中不碰分片锁
+    items.push_back({"Near Hash LRU",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::CachePolicyAdapter<
+                 CacheSystem::NearCache<CacheSystem::ShardedCache<CacheSystem::LruCache<Key,Val>, Key, Val>>>(TOTAL_CAP, SHARDS)); }});
+
+    // 单实例对照：全局一把锁的 LRU vs 每个 set 一把自旋锁的组相联
+    items.push_back({"LRU",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(TOTAL_CAP)); }});
+    items.push_back({"SetAssoc16",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,16>(TOTAL_CAP)); }});
+    items.push_back({"ARC",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcCache<Key,Val>(TOTAL_CAP)); }});
+    // S3-FIFO 命中只拿共享锁：单实例也能多线程并发读
+    items.push_back({"S3-FIFO",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::S3FifoCache<Key,Val>(TOTAL_CAP)); }});
+    items.push_back({"Hash S3FIFO",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashS3FifoCache<Key,Val>(TOTAL_CAP, SHARDS)); }});
+
     // 2) 任意算法的通用分片（示例：ARC）
     items.push_back({"Shard ARC",
-        [=]{
-            using C = ShardedCache<Key,Val>;
-            return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(
-                new C(TOTAL_CAP, SHARDS,
-                      [](size_t cap, int idx){
-                          (void)idx;
-                          return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcCache<Key,Val>((int)cap));
-                      })
-            );
-        }});
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new Sharded<CacheSystem::ArcCache<Key,Val>>(TOTAL_CAP, SHARDS)); }});
+
+    items.push_back({"Shard LIRS",
+        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new Sharded<CacheSystem::LirsCache<Key,Val>>(TOTAL_CAP, SHARDS)); }});
 
     std::cout << "\n=== 并发 QPS / 延迟（热点负载, " << T << " 线程, " << SHARDS << " 分片）===\n";
     for (auto& it : items){
         auto r = run_qps(it.make, keygen, T, std::chrono::seconds(10));
-        std::cout << std::left << std::setw(10) << it.name
+        std::cout << std::left << std::setw(14) << it.name
                   << "  hit=" << std::fixed << std::setprecision(2) << r.hit_rate << "% "
                   << " avg=" << r.avg_us << "us "
-                  << " QPS=" << r.qps << "\n";
+                  << " QPS=" << r.qps;
+        print_perf(r.perf, r.ops);
+        std::cout << "\n";
+    }
+}
+
+// =============== 单线程查找开销：全命中循环，ns/lookup（不含模拟的 miss 代价） ===============
+void run_lookup_latency(){
+    const int CAP = 65536;
+    const size_t LOOKUPS = 5000000;
+    std::vector<Key> keys(LOOKUPS);
+    std::mt19937 g(99);
+    for (auto& k : keys) k = (Key)(g() % (CAP / 2));   // 工作集是容量的一半，保证全部命中
+
+    struct Item { std::string name; std::function<std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>()> make; };
+    std::vector<Item> items = {
+        {"LRU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(CAP)); }},
+        {"Hash LRU",   [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLruCache<Key,Val>(CAP, 8)); }},
+        {"SetAssoc-8", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,8>(CAP)); }},
+        {"SetAssoc-16",[=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,16>(CAP)); }},
+    };
+
+    std::cout << "\n=== 单线程查找开销（" << LOOKUPS << " 次命中查找）===\n";
+    for (auto& it : items){
+        auto cache = it.make();
+        for (Key k = 0; k < CAP / 2; ++k) cache->put(k, k);
+        Val out{}; size_t hit = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (auto k : keys) hit += cache->get(k, out);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << std::left << std::setw(12) << it.name
+                  << " " << std::fixed << std::setprecision(1) << double(ns) / LOOKUPS << " ns/lookup"
+                  << "  hit=" << std::setprecision(2) << 100.0 * hit / LOOKUPS << "%\n";
+    }
+
+    // 不经过 CachePolicy 虚接口：分片按值存放，调用静态分派、可内联
+    CacheSystem::ShardedCache<CacheSystem::LruCache<Key,Val>, Key, Val> direct(CAP, 8);
+    for (Key k = 0; k < CAP / 2; ++k) direct.put(k, k);
+    Val out{}; size_t hit = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (auto k : keys) hit += direct.get(k, out);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << std::left << std::setw(12) << "Sharded LRU" << " " << std::fixed << std::setprecision(1)
+              << double(ns) / LOOKUPS << " ns/lookup  hit=" << std::setprecision(2) << 100.0 * hit / LOOKUPS << "% (static)\n";
+}
+
+// =============== 扁平布局：int64 → 小 POD 走 memcpy + 节点数组，对照同样字节但拷贝非平凡的 value ===============
+struct PodVal { int64_t a, b; int32_t c, d; };          // 24B，trivially copyable → 扁平布局
+struct BoxedVal {                                       // 同样的字节，但自定义了拷贝 → 仍走 shared_ptr 节点
+    PodVal v{};
+    BoxedVal() = default;
+    BoxedVal(const BoxedVal& o) : v(o.v) {}
+    BoxedVal& operator=(const BoxedVal& o) { v = o.v; return *this; }
+};
+
+template<class V>
+void run_inline_case(const char* name){
+    const int CAP = 65536;
+    const size_t OPS = 4000000;
+    std::vector<int64_t> hitKeys(OPS), churnKeys(OPS);
+    std::mt19937_64 g(7);
+    for (auto& k : hitKeys)   k = (int64_t)(g() % (CAP / 2));    // 全命中
+    for (auto& k : churnKeys) k = (int64_t)(g() % (CAP * 4));    // 大量写入 + 淘汰
+
+    CacheSystem::LruCache<int64_t, V> cache(CAP);
+    V v{};
+    for (int64_t k = 0; k < CAP; ++k) cache.put(k, v);
+
+    size_t hit = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto k : hitKeys) hit += cache.get(k, v);
+    auto t1 = std::chrono::steady_clock::now();
+    for (auto k : churnKeys) cache.put(k, v);
+    auto t2 = std::chrono::steady_clock::now();
+
+    auto ns = [&](auto a, auto b){ return double(std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count()) / OPS; };
+    auto m = cache.memoryUsage();
+    std::cout << std::left << std::setw(16) << name << std::fixed << std::setprecision(1)
+              << " get=" << ns(t0, t1) << "ns put=" << ns(t1, t2) << "ns"
+              << " B/entry=" << m.bytesPerEntry()
+              << "  hit=" << std::setprecision(2) << 100.0 * hit / OPS << "%\n";
+}
+
+void run_inline_layout_demo(){
+    static_assert(CacheSystem::LruCache<int64_t, PodVal>::kInline, "PodVal 应走扁平布局");
+    static_assert(!CacheSystem::LruCache<int64_t, BoxedVal>::kInline, "BoxedVal 应走指针节点");
+    std::cout << "\n=== 扁平布局 vs 指针节点（LRU, int64 → 24B value, 单线程）===\n";
+    run_inline_case<PodVal>("flat (POD)");
+    run_inline_case<BoxedVal>("node (non-POD)");
+}
+
+// =============== 内存占用：同一段热点负载回放后，各策略的 bytes/entry 与明细 ===============
+void run_memory_usage(){
+    const int CAP = 50000;
+    auto ops = gen_hotspot(400000, /*hot*/20000, /*cold*/200000, 70, 30, 555);
+
+    struct Item { std::string name; std::function<std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>()> make; };
+    std::vector<Item> items = {
+        {"LRU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(CAP)); }},
+        {"LRU-K(K=2)", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruKDecorator<Key,Val>(CAP, CAP, 2)); }},
+        {"LFU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LfuCache<Key,Val>(CAP)); }},
+        {"ARC",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcCache<Key,Val>(CAP)); }},
+        {"ARC-Hybrid", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcHybridCache<Key,Val>(CAP)); }},
+        {"LIRS",       [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LirsCache<Key,Val>(CAP)); }},
+        {"S3-FIFO",    [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::S3FifoCache<Key,Val>(CAP)); }},
+        {"SetAssoc-16",[=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,16>(CAP)); }},
+        {"Hash LRU",   [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLruCache<Key,Val>(CAP, 8)); }},
+        {"Hash LFU",   [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLfuCache<Key,Val>(CAP, 8)); }},
+    };
+
+    std::cout << "\n=== 内存占用（容量 " << CAP << ", int→int）===\n";
+    for (auto& it : items){
+        auto cache = it.make();
+        Val out{};
+        for (const auto& op : ops){
+            if (op.isPut) cache->put(op.key, op.val);
+            else          cache->get(op.key, out);
+        }
+        auto m = cache->memoryUsage();
+        std::cout << std::left << std::setw(12) << it.name
+                  << " entries=" << std::setw(6) << m.entries
+                  << " total=" << std::setw(6) << m.total() / 1024 << "KB"
+                  << " B/entry=" << std::fixed << std::setprecision(1) << std::setw(6) << m.bytesPerEntry()
+                  << " [index=" << m.index / 1024 << "KB nodes=" << m.nodes / 1024
+                  << "KB values=" << m.values / 1024 << "KB meta=" << m.metadata / 1024 << "KB]\n";
+    }
+}
+
+// =============== Slab arena：变长 value 长时间 churn 后的各 class 占用 ===============
+void run_slab_arena_demo(){
+    using SVal = CacheSystem::SlabValue<std::string>;
+    const size_t CAP = 20000;
+    const int SHARDS = 4;
+    CacheSystem::ShardedSlabArena arenas(SHARDS, /*pageSize*/ 64 * 1024); // arena 必须比缓存活得久
+    CacheSystem::HashLruCache<Key, SVal> cache(CAP, SHARDS);
+
+    std::mt19937 g(2024);
+    std::uniform_int_distribution<int> keyDist(0, 100000);
+    std::uniform_int_distribution<int> lenDist(16, 2000);
+    for (int i = 0; i < 500000; ++i){
+        Key k = keyDist(g);
+        auto& arena = arenas.shard(cache.shardIndex(k));
+        cache.put(k, SVal(arena, std::string(lenDist(g), 'x')));
+    }
+
+    size_t live = 0;
+    std::cout << "\n=== Slab arena（" << SHARDS << " 分片, 16~2000B value）===\n";
+    for (const auto& c : arenas.stats()){
+        if (c.pages == 0) continue;
+        live += c.requestedBytes;
+        std::cout << "chunk=" << std::setw(7) << c.chunkSize
+                  << " pages=" << std::setw(4) << c.pages
+                  << " used=" << std::setw(6) << c.usedChunks << "/" << std::setw(6) << c.totalChunks
+                  << " occ=" << std::fixed << std::setprecision(1) << 100.0 * c.occupancy() << "%\n";
+    }
+    std::cout << "resident=" << arenas.residentBytes() / 1024 << "KB live=" << live / 1024 << "KB\n";
+
+    // 单实例：按 LRU 顺序驱逐，腾出某个 class 的一整页
+    CacheSystem::SlabArena arena;
+    CacheSystem::LruCache<Key, SVal> lru(2000);
+    for (int i = 0; i < 20000; ++i) lru.put(i, SVal(arena, std::string(lenDist(g), 'y')));
+    size_t cls = arena.classOf(1000);
+    auto countOthers = [&]{
+        size_t n = 0;
+        for (int i = 0; i < 20000; ++i){
+            SVal v;
+            if (lru.get(i, v) && v.slabClass() != cls) ++n;
+        }
+        return n;
+    };
+    size_t othersBefore = countOthers();
+    size_t evicted = CacheSystem::evictForSlabClass(lru, arena, cls, 2000);
+    std::cout << "reclaim class " << cls << " (chunk=" << arena.chunkSize(cls) << "): evicted "
+              << evicted << " entries, lru size=" << lru.size()
+              << (countOthers() == othersBefore ? "  other classes untouched" : "  [FAIL] other classes evicted") << "\n";
+    auto huge = arena.allocate(size_t(UINT32_MAX) + 1);
+    std::cout << "allocate(4GiB): " << (huge.ptr == nullptr && huge.cls == CacheSystem::SlabArena::kNoClass ? "rejected" : "[FAIL] accepted") << "\n";
+}
+
+// =============== 在线调整：读写不停的情况下缩容 / 改分片数 ===============
+void run_resize_demo(){
+    const size_t CAP = 40000;
+    CacheSystem::HashLruCache<Key, Val> cache(CAP, 4);
+    for (Key k = 0; k < (Key)CAP; ++k) cache.put(k, k);
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> ops{0}, wrong{0};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < 4; ++t){
+        ts.emplace_back([&, t]{
+            std::mt19937 g(t);
+            std::uniform_int_distribution<Key> d(0, (Key)CAP * 2);
+            Val out{};
+            while (!stop.load(std::memory_order_relaxed)){
+                Key k = d(g);
+                if (cache.getOrInsert(k, out, [k]{ return (Val)k; }) && out != k) wrong.fetch_add(1);
+                ops.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    auto step = [&](const char* what, auto fn){
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        auto ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+        auto m = cache.memoryUsage();
+        std::cout << std::left << std::setw(22) << what << " shards=" << cache.sliceNum()
+                  << " cap=" << cache.capacity() << " entries=" << m.entries
+                  << " took=" << std::fixed << std::setprecision(1) << ms << "ms\n";
+    };
+    std::cout << "\n=== 在线调整（4 线程持续读写）===\n";
+    step("reshard 4 -> 16",       [&]{ cache.reshard(16); });
+    step("setCapacity 40000->10000", [&]{ cache.setCapacity(10000); });
+    step("reshard 16 -> 8",       [&]{ cache.reshard(8); });
+    step("setCapacity ->30000",   [&]{ cache.setCapacity(30000); });
+    stop.store(true);
+    for (auto& t : ts) t.join();
+    std::cout << "ops=" << ops.load() << " wrong values=" << wrong.load() << "\n";
+
+    // 监听器回调缓存：reshard 迁移和 setCapacity 收紧时的驱逐通知要在释放 reshardMutex_ 之后投递，否则回调里的 remove 会自锁
+    CacheSystem::ShardedCache<CacheSystem::LruCache<Key,Val>, Key, Val> reentrant(1000, 8, 16);
+    std::atomic<int> callbacks{0};
+    reentrant.setRemovalListener([&](std::vector<CacheSystem::RemovalNotification<Key,Val>>& batch){
+        for (auto& n : batch)
+            if (n.cause == CacheSystem::RemovalCause::Capacity) { reentrant.remove(n.key + 1); ++callbacks; }
+    }, 1);
+    for (Key i = 0; i < 125; ++i) reentrant.put(8 + 16 * i, i);   //8 片时全在 0 号分片，16 片时全挤进 8 号分片
+    reentrant.reshard(16);
+    const int afterReshard = callbacks.load();
+    reentrant.setCapacity(400);
+    std::cout << "listener calling back into the cache: " << afterReshard << " callbacks during reshard, "
+              << callbacks.load() - afterReshard << " during setCapacity"
+              << (afterReshard > 0 ? "  no deadlock" : "  [FAIL] no evictions observed") << "\n";
+}
+
+// =============== 分片数自动调优：按锁争用与抽样命中率损失调整分片数 ===============
+template<class Cache, class Gen>
+void run_autotune_case(const char* title, Cache& cache, Gen gen, int threads, int windows){
+    cache.enableTuningStats();   //第一个窗口就要有命中率损失的数据
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t){
+        ts.emplace_back([&]{
+            auto g = gen();
+            Val out{};
+            while (!stop.load(std::memory_order_relaxed)){
+                Key k = g();
+                cache.getOrInsert(k, out, [k]{ return (Val)k; });
+            }
+        });
+    }
+    std::cout << title << "\n";
+    for (int w = 0; w < windows; ++w){
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        auto r = cache.tuningReport();
+        std::cout << std::right << "  shards=" << std::setw(3) << r.sliceNum
+                  << " contended=" << std::fixed << std::setprecision(2) << std::setw(6) << 100.0 * r.lock.contentionRate() << "%"
+                  << " wait/op=" << std::setprecision(0) << std::setw(5) << r.lock.waitNsPerAcquisition() << "ns"
+                  << " hit(sharded/global)=" << std::setprecision(1) << 100.0 * r.shardedHitRatio
+                  << "/" << 100.0 * r.globalHitRatio << "%"
+                  << " -> " << r.recommendedSliceNum << "\n";
+        cache.autoTune();
+    }
+    stop.store(true);
+    for (auto& t : ts) t.join();
+}
+
+void run_autotune_demo(){
+    const int T = std::max(4u, std::thread::hardware_concurrency());
+    std::cout << "\n=== 分片数自动调优（" << T << " 线程）===\n";
+    {
+        // 大缓存 + 单分片：锁争用高，应逐步加倍
+        CacheSystem::HashLruCache<Key, Val> cache(100000, 1);
+        run_autotune_case("大缓存，初始 1 分片：", cache, make_hot_keygen(200000, 0.2, 0.8), T, 6);
+    }
+    {
+        // 小缓存 + 大量分片：每片只有几十条，命中率损失明显，应逐步减半
+        CacheSystem::HashLruCache<Key, Val> cache(2048, 64);
+        run_autotune_case("小缓存，初始 64 分片：", cache, make_hot_keygen(20000, 0.1, 0.9), 2, 6);
+    }
+}
+
+// =============== 删除 / 失效：invalidateAll 只改代数，与条目数无关；之后的读全部 miss、旧条目随写入回收 ===============
+void run_invalidation_demo(){
+    const int CAP = 100000;
+    using Make = std::function<std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>()>;
+    struct Item { std::string name; Make make; };
+    std::vector<Item> items = {
+        {"LRU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(CAP)); }},
+        {"LFU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LfuCache<Key,Val>(CAP)); }},
+        {"ARC",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcCache<Key,Val>(CAP)); }},
+        {"LIRS",       [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LirsCache<Key,Val>(CAP)); }},
+        {"S3-FIFO",    [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::S3FifoCache<Key,Val>(CAP)); }},
+        {"SetAssoc-16",[=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,16>(CAP)); }},
+        {"Hash LRU",   [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLruCache<Key,Val>(CAP, 8)); }},
+    };
+
+    auto us = [](auto fn){
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+    };
+    std::cout << "\n=== 删除 / 失效（容量 " << CAP << ", 先填满）===\n";
+    for (auto& it : items){
+        auto cache = it.make();
+        for (Key k = 0; k < CAP; ++k) cache->put(k, k);
+        size_t removed = 0;
+        const double ifUs = us([&]{ removed = cache->invalidateIf([](const Key& k, const Val&){ return k % 10 == 0; }); });
+        const double allUs = us([&]{ cache->invalidateAll(); });
+        Val out{};
+        size_t hits = 0;
+        for (Key k = 0; k < CAP; ++k) hits += cache->get(k, out);
+        for (Key k = CAP; k < 2 * CAP; ++k) cache->put(k, k);   //写满一轮新数据，旧代条目应被全部挤掉
+        size_t fresh = 0;
+        for (Key k = CAP; k < 2 * CAP; ++k) fresh += cache->get(k, out);
+        std::cout << std::left << std::setw(12) << it.name
+                  << " invalidateIf(10%)=" << std::setw(6) << removed
+                  << std::fixed << std::setprecision(0) << std::setw(6) << ifUs << "us"
+                  << " invalidateAll=" << std::setprecision(1) << std::setw(6) << allUs << "us"
+                  << " hits after=" << std::setw(3) << hits
+                  << " refill hit=" << std::setprecision(1) << 100.0 * fresh / CAP << "%\n";
+    }
+}
+
+// =============== 删除通知：按原因计数；监听器在锁外分批执行，攒不满一批的由 flushRemovals 补投 ===============
+void run_removal_listener_demo(){
+    const int CAP = 50000;
+    using Make = std::function<std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>()>;
+    struct Item { std::string name; Make make; };
+    std::vector<Item> items = {
+        {"LRU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(CAP)); }},
+        {"LFU",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LfuCache<Key,Val>(CAP)); }},
+        {"ARC",        [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcCache<Key,Val>(CAP)); }},
+        {"LIRS",       [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LirsCache<Key,Val>(CAP)); }},
+        {"S3-FIFO",    [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::S3FifoCache<Key,Val>(CAP)); }},
+        {"SetAssoc-16",[=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::SetAssocCache<Key,Val,16>(CAP)); }},
+        {"Hash LRU",   [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLruCache<Key,Val>(CAP, 8)); }},
+    };
+
+    // 写满两轮（第一轮被挤掉）→ 覆盖 10% → 删除 10% → invalidateAll 后再写一轮（旧代惰性回收）
+    auto workload = [=](CacheSystem::CachePolicy<Key,Val>& cache){
+        for (Key k = 0; k < 2 * CAP; ++k) cache.put(k, k);
+        for (Key k = CAP; k < 2 * CAP; k += 10) cache.put(k, k + 1);
+        for (Key k = CAP + 5; k < 2 * CAP; k += 10) cache.remove(k);
+        cache.invalidateAll();
+        for (Key k = 2 * CAP; k < 3 * CAP; ++k) cache.put(k, k);
+    };
+    auto ms = [](auto fn){
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+    };
+    std::cout << "\n=== 删除通知（容量 " << CAP << ", 每批 64 条）===\n";
+    for (auto& it : items){
+        auto plain = it.make();
+        const double plainMs = ms([&]{ workload(*plain); });
+
+        auto cache = it.make();
+        size_t byCause[4] = {0, 0, 0, 0};
+        size_t batches = 0;
+        cache->setRemovalListener([&](std::vector<CacheSystem::RemovalNotification<Key,Val>>& batch){
+            ++batches;
+            for (auto& n : batch) ++byCause[static_cast<int>(n.cause)];
+        }, 64);
+        const double listenMs = ms([&]{ workload(*cache); cache->flushRemovals(); });
+
+        std::cout << std::left << std::setw(12) << it.name;
+        for (auto cause : {CacheSystem::RemovalCause::Capacity, CacheSystem::RemovalCause::Expired,
+                           CacheSystem::RemovalCause::Explicit, CacheSystem::RemovalCause::Replaced}) {
+            std::cout << " " << CacheSystem::toString(cause) << "=" << std::setw(6) << byCause[static_cast<int>(cause)];
+        }
+        std::cout << " batches=" << std::setw(5) << batches
+                  << std::fixed << std::setprecision(1)
+                  << " " << plainMs << "ms -> " << listenMs << "ms\n";
+    }
+}
+
+// =============== 写回：计数器场景，每次请求都是 +1；比较后端收到的写入条数（直写 = 请求数） ===============
+void run_write_back_demo(){
+    const int CAP = 2000;
+    const size_t OPS = 400000;
+    const int THREADS = 4;
+    const auto ops = gen_hotspot(OPS, 500, 20000, 90);
+    using Make = std::function<std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>()>;
+    struct Item { std::string name; Make make; };
+    std::vector<Item> items = {
+        {"LRU",      [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(CAP)); }},
+        {"LFU",      [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LfuCache<Key,Val>(CAP)); }},
+        {"Hash LRU", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLruCache<Key,Val>(CAP, 8)); }},
+    };
+    CacheSystem::WriteBackOptions options;
+    options.maxDirty  = 1024;
+    options.maxAge    = std::chrono::milliseconds(50);
+    options.batchSize = 256;
+
+    std::cout << "\n=== 写回（计数器 +1，容量 " << CAP << ", " << OPS << " 次写, " << THREADS << " 线程, 每批 50us）===\n";
+    for (auto& it : items){
+        CacheSystem::MemoryBackingStore<Key,Val> store(std::chrono::microseconds(50));
+        CacheSystem::WriteBackStats s;
+        auto begin = std::chrono::steady_clock::now();
+        {
+            CacheSystem::WriteBackCache<Key,Val> cache(it.make(), store, options);
+            std::vector<std::thread> ts;
+            for (int t = 0; t < THREADS; ++t) ts.emplace_back([&, t]{
+                for (size_t i = t; i < ops.size(); i += THREADS) {
+                    cache.compute(ops[i].key, [](const Val* cur) -> std::optional<Val> { return (cur ? *cur : 0) + 1; });
+                }
+            });
+            for (auto& th : ts) th.join();
+            cache.flush();
+            s = cache.stats();
+        }
+        const double ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+        long long sum = 0;
+        for (Key k = 0; k < 500 + 20000; ++k) { Val v = 0; if (store.load(k, v)) sum += v; }
+        const auto b = store.stats();
+        std::cout << std::left << std::setw(10) << it.name
+                  << " backend writes=" << std::setw(7) << b.writes
+                  << " batches=" << std::setw(5) << b.batches
+                  << " coalesced=" << std::setw(7) << s.coalesced
+                  << " dirty evictions=" << std::setw(6) << s.dirtyEvictions
+                  << std::fixed << std::setprecision(1)
+                  << " reduction=" << double(OPS) / std::max<uint64_t>(1, b.writes)
+                  << "x " << std::setw(6) << ms << "ms"
+                  << " sum " << (sum == (long long)OPS ? "ok" : "MISMATCH") << "\n";
+    }
+
+    // compute 返回 nullopt 是删除：墓碑同步写到后端；删除写失败时墓碑留在脏表里，不会从后端读回旧值；
+    // close 报告写不进去的 key
+    {
+        CacheSystem::MemoryBackingStore<Key,Val> store;
+        CacheSystem::WriteBackCache<Key,Val> cache(items[0].make(), store, options);
+        auto erase = [](const Val*) -> std::optional<Val> { return std::nullopt; };
+        auto incr  = [](const Val* cur) -> std::optional<Val> { return (cur ? *cur : 0) + 1; };
+        Val v = 0;
+        cache.put(1, 41);
+        cache.put(2, 7);
+        cache.flush();
+        cache.compute(1, erase);
+        const bool erased = !cache.get(1, v) && !store.load(1, v);
+        store.failNext(1);
+        cache.compute(2, erase);
+        const bool held = !cache.get(2, v) && store.load(2, v) && cache.compute(2, incr) == Val(1);
+        cache.put(3, 3);
+        store.failNext(1);
+        const auto failed = cache.close();
+        const bool reported = failed.size() == 2 && cache.flush().empty() && store.load(2, v) && v == 1 && store.load(3, v);
+        std::cout << "compute -> nullopt: backend " << (erased ? "erased" : "[FAIL] kept")
+                  << ", failed erase " << (held ? "not resurrected" : "[FAIL] resurrected")
+                  << "; close with a failing batch: " << failed.size() << " keys reported"
+                  << (reported ? ", retried ok" : " [FAIL]") << "\n";
+    }
+}
+
+// =============== 缺失率曲线：挂在线上缓存上的 SHARDS 估计 vs 各容量实际跑一遍 ===============
+void run_miss_ratio_curve_demo(){
+    const auto ops = gen_hotspot(1000000, 5000, 100000, 70, 0);
+    const std::vector<size_t> caps = {1000, 2500, 5000, 10000, 20000, 40000};
+
+    CacheSystem::ShardsOptions options;
+    options.sampleRate    = 0.05;
+    options.maxSampleKeys = 4096;
+    options.maxCapacity   = 50000;
+    options.bins          = 500;
+    CacheSystem::ProfiledCache<Key,Val> cache(
+        std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::HashLruCache<Key,Val>(5000, 8)), options);
+    auto& profiler = cache.profiler();
+    profiler.addSimulation("LFU", [](int c){ return std::unique_ptr<CacheSystem::CachePolicy<Key,bool>>(new CacheSystem::LfuCache<Key,bool>(c)); }, caps);
+    profiler.addSimulation("ARC", [](int c){ return std::unique_ptr<CacheSystem::CachePolicy<Key,bool>>(new CacheSystem::ArcCache<Key,bool>(c)); }, caps);
+
+    // 线上：未命中就回填
+    auto begin = std::chrono::steady_clock::now();
+    Val out{};
+    for (const auto& op : ops) if (!cache.get(op.key, out)) cache.put(op.key, op.val);
+    const double profiledMs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+    CacheSystem::HashLruCache<Key,Val> plain(5000, 8);
+    begin = std::chrono::steady_clock::now();
+    for (const auto& op : ops) if (!plain.get(op.key, out)) plain.put(op.key, op.val);
+    const double plainMs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+
+    auto actual = [&](CacheSystem::CachePolicy<Key,bool>&& c){
+        size_t miss = 0; bool b = false;
+        for (const auto& op : ops) if (!c.get(op.key, b)) { ++miss; c.put(op.key, true); }
+        return double(miss) / ops.size();
+    };
+    const auto lru = profiler.lruCurve(caps);
+    const auto lfu = profiler.simulatedCurve("LFU");
+    const auto arc = profiler.simulatedCurve("ARC");
+    const auto st = profiler.stats();
+    std::cout << "\n=== 缺失率曲线（SHARDS 采样率 " << std::setprecision(4) << st.sampleRate
+              << ", 跟踪 " << st.sampledKeys << " 个 key；profiler 含 12 个缩小模拟，回放 " << std::fixed << std::setprecision(1)
+              << plainMs << "ms -> " << profiledMs << "ms）===\n";
+    std::cout << std::setprecision(3);
+    for (size_t i = 0; i < caps.size(); ++i){
+        const int c = static_cast<int>(caps[i]);
+        std::cout << "capacity=" << std::setw(6) << caps[i]
+                  << "  LRU est " << lru[i].missRatio << " / act " << actual(CacheSystem::LruCache<Key,bool>(c))
+                  << "  LFU est " << lfu[i].missRatio << " / act " << actual(CacheSystem::LfuCache<Key,bool>(c))
+                  << "  ARC est " << arc[i].missRatio << " / act " << actual(CacheSystem::ArcCache<Key,bool>(c)) << "\n";
+    }
+}
+
+// =============== 热点 key：一个 key 突然爆热时，找出它和被压垮的分片，再把它复制进每线程 L1 ===============
+void run_hot_key_demo(){
+    const int CAP = 20000, SLICES = 8, THREADS = 4;
+    const size_t OPS = 400000;
+    const Key VIRAL = 123457;
+    // 70% 热点场景上叠加一个占 15% 请求的爆热 key
+    auto ops = gen_hotspot(OPS, 2000, 50000, 70, 10);
+    std::mt19937 g(3);
+    for (auto& op : ops) if (g() % 100 < 15) op.key = VIRAL;
+
+    using Sharded = CacheSystem::ShardedCache<CacheSystem::LruCache<Key,Val>, Key, Val>;
+    auto replay = [&](auto& cache){
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> ts;
+        for (int t = 0; t < THREADS; ++t) ts.emplace_back([&, t]{
+            Val out{};
+            for (size_t i = t; i < ops.size(); i += THREADS) {
+                if (ops[i].isPut) cache.put(ops[i].key, ops[i].val);
+                else if (!cache.get(ops[i].key, out)) cache.put(ops[i].key, ops[i].val);
+            }
+        });
+        for (auto& th : ts) th.join();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+    };
+
+    Sharded cache(CAP, SLICES);
+    cache.enableHotKeyTracking(32, 4);
+    const double ms = replay(cache);
+    const auto report = cache.hotKeys(5);
+    std::cout << "\n=== 热点 key（" << SLICES << " 分片, " << THREADS << " 线程, 抽样 1/16）===\n";
+    std::cout << std::fixed << std::setprecision(2)
+              << "shard skew=" << report.skew() << " hottest shard=" << report.hottestShard
+              << " top1 share=" << report.share(1) << " replay " << std::setprecision(1) << ms << "ms\n";
+    for (const auto& hk : report.keys) {
+        std::cout << "  key=" << std::setw(7) << hk.key << " est=" << std::setw(7) << hk.count
+                  << " ±" << std::setw(6) << hk.error << " shard=" << hk.shard << "\n";
+    }
+
+    // 缓解：NearCache 只把热点 key 复制进每线程 L1
+    CacheSystem::NearCache<Sharded> near(CAP, SLICES);
+    near.backing().enableHotKeyTracking(32, 4);
+    auto* tracker = near.backing().hotKeyTracker();
+    near.setL1Admission([tracker](const Key& k){ return tracker->isHot(k); });
+    replay(near);                        //第一轮只统计
+    tracker->refreshHotSet(4, 0.05);     //请求占比 ≥5% 的才算热点
+    const auto before = near.stats();
+    const double nearMs = replay(near);
+    const auto after = near.stats();
+    const double l1Hits = double(after.l1Hits - before.l1Hits);
+    const double l1Total = l1Hits + double(after.l1Misses - before.l1Misses);
+    std::cout << "near cache (hot keys only): L1 hit=" << std::setprecision(1)
+              << (l1Total ? 100.0 * l1Hits / l1Total : 0.0) << "% replay " << nearMs << "ms\n";
+}
+
+// =============== 代价感知淘汰：miss 代价 1ms~2s 不等时，比较省下的回源时间而不只是命中率 ===============
+void run_cost_aware_demo(){
+    const int CAP = 500;
+    // 读穿透：get 未命中就回源（模拟耗时，不真的睡）再写回缓存
+    auto ops = gen_hotspot(300000, /*hot*/2000, /*cold*/20000, 70, /*put*/0, 4242);
+    // 每个 key 的回源代价与热度无关，对数均匀分布在 1ms ~ 2000ms
+    auto missMs = [](Key k){
+        uint32_t h = uint32_t(k) * 2654435761u;
+        h ^= h >> 16;
+        return std::exp(std::log(2000.0) * double(h % 10000) / 10000.0);
+    };
+    double noCacheMs = 0;
+    for (const auto& op : ops) noCacheMs += missMs(op.key);
+
+    struct Item { std::string name; std::function<std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>()> make; };
+    std::vector<Item> algos = {
+        {"LRU",     [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LruCache<Key,Val>(CAP)); }},
+        {"LFU",     [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::LfuCache<Key,Val>(CAP)); }},
+        {"ARC",     [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::ArcCache<Key,Val>(CAP)); }},
+        {"S3-FIFO", [=]{ return std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>(new CacheSystem::S3FifoCache<Key,Val>(CAP)); }},
+    };
+    auto report = [&](const std::string& name, size_t hits, double backendMs){
+        std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+                  << " hit=" << std::setprecision(2) << std::setw(6) << 100.0 * hits / ops.size() << "%"
+                  << " backend=" << std::setprecision(1) << std::setw(8) << backendMs / 1000.0 << "s"
+                  << " saved=" << std::setw(8) << (noCacheMs - backendMs) / 1000.0 << "s ("
+                  << std::setprecision(1) << 100.0 * (noCacheMs - backendMs) / noCacheMs << "%)\n";
+    };
+
+    std::cout << "\n=== 代价感知淘汰（容量 " << CAP << "，miss 代价 1ms~2s，不缓存时回源共 "
+              << std::fixed << std::setprecision(1) << noCacheMs / 1000.0 << "s）===\n";
+    Val out{};
+    for (auto& a : algos){
+        auto cache = a.make();
+        size_t hits = 0; double backendMs = 0;
+        for (const auto& op : ops){
+            if (cache->get(op.key, out)) { ++hits; continue; }
+            backendMs += missMs(op.key);
+            cache->put(op.key, op.val);
+        }
+        report(a.name, hits, backendMs);
+    }
+    CacheSystem::GdsfCache<Key,Val> gdsf(CAP);
+    size_t hits = 0; double backendMs = 0;
+    for (const auto& op : ops){
+        if (gdsf.get(op.key, out)) { ++hits; continue; }
+        const double cost = missMs(op.key);
+        backendMs += cost;
+        gdsf.put(op.key, op.val, cost, 1);
+    }
+    report("GDSF", hits, backendMs);
+}
+
+// =============== 负缓存：30% 的查找是后端不存在的 key，记住“不存在”后不再回源 ===============
+void run_negative_cache_demo(){
+    const int CAP = 5000, EXIST = 50000, ABSENT = 20000;
+    const Key CREATED = 1000;                     // 回放到一半时后端新建的 key 数（原本不存在）
+    const size_t OPS = 400000;
+    const double LOAD_US = 200;                   // 每次回源的模拟代价，与 run_qps 的 missCost 一致
+    // 70% 查存在的 key，30% 查不存在的 key（EXIST 之后的一段），两部分都有热点
+    std::mt19937 g(44);
+    std::vector<Key> keys(OPS);
+    for (auto& k : keys) {
+        const bool absent = g() % 100 < 30;
+        const int n = absent ? ABSENT : EXIST;
+        const Key off = (g() % 100 < 70) ? Key(g() % (n / 10)) : Key(g() % n);
+        k = absent ? EXIST + off : off;
+    }
+    // 每次回放用一个新后端，保证面对同样的数据
+    auto replay = [&](CacheSystem::CachePolicy<Key,Val>& cache, auto lookup){
+        CacheSystem::MemoryBackingStore<Key,Val> store;
+        std::vector<std::pair<Key,Val>> rows;
+        for (Key k = 0; k < EXIST; ++k) rows.emplace_back(k, k);
+        store.writeBatch(rows);
+        size_t wrong = 0;
+        for (size_t i = 0; i < OPS; ++i) {
+            if (i == OPS / 2) {
+                for (Key k = EXIST; k < EXIST + CREATED; ++k) {
+                    store.writeBatch({{k, k}});
+                    cache.put(k, k);
+                }
+            }
+            const Key k = keys[i];
+            const bool exists = k < EXIST || (i >= OPS / 2 && k < EXIST + CREATED);
+            if (!lookup(store, k) && exists) ++wrong;
+        }
+        return std::make_pair(store.stats().loads, wrong);
+    };
+    auto report = [&](const char* name, std::pair<uint64_t, size_t> r, size_t filterBytes){
+        std::cout << std::left << std::setw(16) << name << std::right
+                  << " backend loads=" << std::setw(7) << r.first
+                  << " backend time=" << std::fixed << std::setprecision(1) << std::setw(6) << r.first * LOAD_US / 1e6 << "s"
+                  << " wrong absent=" << r.second
+                  << " filter=" << filterBytes / 1024 << "KB\n";
+    };
+
+    std::cout << "\n=== 负缓存（LRU 容量 " << CAP << "，30% 查找的 key 后端不存在，回源 "
+              << LOAD_US << "us/次）===\n";
+    {   // 只有正缓存：每次查不存在的 key 都回源
+        CacheSystem::LruCache<Key,Val> cache(CAP);
+        auto r = replay(cache, [&](CacheSystem::MemoryBackingStore<Key,Val>& store, Key k){
+            Val v{};
+            if (cache.get(k, v)) return true;
+            if (!store.load(k, v)) return false;
+            cache.put(k, v);
+            return true;
+        });
+        report("LRU", r, 0);
+    }
+    {
+        CacheSystem::NegativeCacheOptions opt;
+        opt.expectedKeys = ABSENT;
+        opt.ttl = std::chrono::seconds(60);
+        CacheSystem::NegativeCache<Key,Val> cache(std::make_unique<CacheSystem::LruCache<Key,Val>>(CAP), opt);
+        auto r = replay(cache, [&](CacheSystem::MemoryBackingStore<Key,Val>& store, Key k){
+            Val v{};
+            return cache.getOrLoad(k, v, [&]() -> std::optional<Val> {
+                Val out{};
+                if (store.load(k, out)) return out;
+                return std::nullopt;
+            });
+        });
+        const auto s = cache.stats();
+        report("LRU + negative", r, s.filterBytes);
+        std::cout << "  negative hits=" << s.negativeHits << " marked=" << s.marked
+                  << " cleared by put=" << s.cleared << "\n";
     }
 }
 
+// =============== 多进程共享：N 个 worker 进程各自一份缓存 vs 共用一段共享内存里的一份（总容量相同） ===============
+void run_shared_memory_demo(){
+    const int PROCS = 4, CAP = 8000, SHARDS = 8;
+    const size_t OPS = 200000;
+    // 子进程把各自的请求数 / 命中数写回这块匿名共享内存
+    auto* counters = static_cast<std::atomic<uint64_t>*>(::mmap(nullptr, sizeof(std::atomic<uint64_t>) * 2 * PROCS,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (counters == MAP_FAILED) return;
+    // shared 为空时每个子进程 fork 之后自己建一份私有缓存
+    auto run = [&](const char* name, CacheSystem::CachePolicy<Key,Val>* shared){
+        for (int i = 0; i < 2 * PROCS; ++i) new (&counters[i]) std::atomic<uint64_t>(0);
+        auto begin = std::chrono::steady_clock::now();
+        for (int p = 0; p < PROCS; ++p) {
+            if (::fork() != 0) continue;
+            std::unique_ptr<CacheSystem::CachePolicy<Key,Val>> mine;
+            if (!shared) mine.reset(new CacheSystem::HashLruCache<Key,Val>(CAP / PROCS, SHARDS));
+            auto& cache = shared ? *shared : *mine;
+            // 每个进程收到的请求分布相同（同一批热点 key），种子不同
+            auto ops = gen_hotspot(OPS, /*hot*/4000, /*cold*/40000, 80, 0, 100 + p);
+            Val v{};
+            uint64_t hits = 0;
+            for (const auto& op : ops) hits += cache.getOrInsert(op.key, v, [&]{ return op.val; });
+            counters[2 * p].store(ops.size());
+            counters[2 * p + 1].store(hits);
+            ::_exit(0);
+        }
+        for (int p = 0; p < PROCS; ++p) ::wait(nullptr);
+        const double ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+        uint64_t req = 0, hit = 0;
+        for (int p = 0; p < PROCS; ++p) { req += counters[2 * p].load(); hit += counters[2 * p + 1].load(); }
+        std::cout << std::left << std::setw(28) << name << std::right << " hit=" << std::fixed << std::setprecision(2)
+                  << 100.0 * hit / std::max<uint64_t>(1, req) << "% (" << hit << "/" << req << ") "
+                  << std::setprecision(1) << ms << "ms\n";
+    };
+
+    std::cout << "\n=== 多进程缓存（" << PROCS << " 个进程，总容量 " << CAP << "）===\n";
+    // 每个进程私有一份，容量均分：同一份热点数据被缓存 PROCS 次
+    run("private Hash LRU x4 (1/4 each)", nullptr);
+    // 共享一段匿名共享内存（fork 之前创建）
+    CacheSystem::SharedMemoryCache<Key,Val> shared(CAP, SHARDS);
+    if (!shared.valid()) {
+        std::cout << "shared memory unavailable, errno=" << shared.error() << "\n";
+    } else {
+        run("shared memory LRU", &shared);
+        const auto st = shared.stats();
+        std::cout << "  segment=" << shared.segmentBytes() / 1024 << "KB evictions=" << st.evictions
+                  << " lock recoveries=" << st.recoveries << "\n";
+    }
+    ::munmap(counters, sizeof(std::atomic<uint64_t>) * 2 * PROCS);
+
+    // 子进程在 compute 的回调里（持有分片锁）直接退出：下一个加锁的进程清空该分片并恢复锁，分片照常可用
+    {
+        CacheSystem::SharedMemoryCache<Key,Val> seg(1000, 4);
+        for (Key k = 0; k < 1000; ++k) seg.put(k, k);
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            seg.compute(7, [](const Val*) -> std::optional<Val> { ::_exit(0); });
+            ::_exit(1);
+        }
+        ::waitpid(pid, nullptr, 0);
+        Val v{};
+        const bool lost = !seg.get(7, v);   //分片已被清空
+        seg.put(7, 70);
+        const bool usable = seg.get(7, v) && v == 70;
+        const auto st = seg.stats();
+        std::cout << "  owner died holding a shard lock: recoveries=" << st.recoveries
+                  << (st.recoveries == 1 && lost && usable ? "  shard reset and usable" : "  [FAIL]") << "\n";
+    }
+
+    // 具名段：几何参数不一致的打开失败（EINVAL）；另一个进程挂上同一段，看到同一份数据，它写的父进程也看得到
+    {
+        const std::string name = "/cachesystem-bench-" + std::to_string(::getpid());
+        CacheSystem::SharedMemoryCache<Key,Val> seg(name, 1000, 4);
+        if (!seg.valid()) {
+            std::cout << "  named segment unavailable, errno=" << seg.error() << "\n";
+            return;
+        }
+        CacheSystem::SharedMemoryCache<Key,Val> mismatch(name, 2000, 4);
+        std::cout << "  mismatched geometry: valid=" << mismatch.valid() << " errno=" << mismatch.error()
+                  << (!mismatch.valid() && mismatch.error() == EINVAL ? "  rejected" : "  [FAIL]") << "\n";
+        for (Key k = 0; k < 100; ++k) seg.put(k, k * 3);
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            CacheSystem::SharedMemoryCache<Key,Val> other(name, 1000, 4);
+            bool same = other.valid();
+            Val v{};
+            for (Key k = 0; k < 100 && same; ++k) same = other.get(k, v) && v == k * 3;
+            other.put(1000, 42);
+            ::_exit(same ? 0 : 1);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        Val v{};
+        const bool childSaw = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        const bool parentSees = seg.get(1000, v) && v == 42;
+        std::cout << "  second process attached by name: "
+                  << (childSaw && parentSees ? "sees the same data both ways" : "[FAIL]") << "\n";
+        CacheSystem::SharedMemoryCache<Key,Val>::unlink(name);
+    }
+}
+
+// =============== memcached 协议服务：本机压测（TCP / Unix socket，不同 pipeline 深度） ===============
+// 读 n 个响应：VALUE 行跳过数据块，END / STORED 各算一个响应结束
+bool read_memcache_responses(int fd, std::string& buf, int n){
+    size_t pos = 0;
+    char tmp[65536];
+    while (n > 0) {
+        const size_t eol = buf.find("\r\n", pos);
+        if (eol == std::string::npos) {
+            buf.erase(0, pos);
+            pos = 0;
+            const ssize_t r = ::read(fd, tmp, sizeof(tmp));
+            if (r <= 0) return false;
+            buf.append(tmp, size_t(r));
+            continue;
+        }
+        if (buf.compare(pos, 6, "VALUE ") == 0) {
+            const size_t bytes = std::stoul(buf.substr(buf.rfind(' ', eol) + 1, eol));
+            if (buf.size() < eol + 2 + bytes + 2) {   //数据块还没收全
+                const ssize_t r = ::read(fd, tmp, sizeof(tmp));
+                if (r <= 0) return false;
+                buf.append(tmp, size_t(r));
+                continue;
+            }
+            pos = eol + 2 + bytes + 2;
+            continue;
+        }
+        pos = eol + 2;
+        --n;   //END / STORED
+    }
+    buf.erase(0, pos);
+    return true;
+}
+
+// 协议往返检查用：逐段写出（pieces 为每次 write 的字节数，0 表示一次写完），读回恰好 n 字节；超时或对端关闭时返回已读到的部分
+std::string memcache_exchange(int fd, const std::string& req, size_t n, size_t pieces = 0){
+    for (size_t off = 0; off < req.size();) {
+        const size_t len = pieces ? std::min(pieces, req.size() - off) : req.size() - off;
+        const ssize_t w = ::write(fd, req.data() + off, len);
+        if (w <= 0) return {};
+        off += size_t(w);
+        if (pieces) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::string out;
+    char tmp[65536];
+    while (out.size() < n) {
+        const ssize_t r = ::read(fd, tmp, std::min(sizeof(tmp), n - out.size()));
+        if (r <= 0) break;
+        out.append(tmp, size_t(r));
+    }
+    return out;
+}
+
+// 读到以 suffix 结尾为止（gets / stats 这类长度事先不知道的响应）
+std::string memcache_read_until(int fd, const std::string& suffix){
+    std::string out;
+    char ch;
+    while (out.size() < suffix.size() || out.compare(out.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        if (::read(fd, &ch, 1) != 1) break;
+        out += ch;
+    }
+    return out;
+}
+
+// 对端已关闭：read 返回 0（接收超时返回 -1，算没关）
+bool memcache_closed(int fd){
+    char ch;
+    return ::read(fd, &ch, 1) == 0;
+}
+
+// 每条命令的往返、拆包写入、100MB 流水线响应、坏命令行断开、quit；返回失败的检查数
+int run_memcache_protocol_checks(const std::function<int()>& connect){
+    int failed = 0, total = 0;
+    auto check = [&](const char* what, bool ok){
+        ++total;
+        if (!ok) { ++failed; std::cout << "  [FAIL] " << what << "\n"; }
+    };
+    auto open = [&]{
+        const int fd = connect();
+        timeval tv{5, 0};
+        if (fd >= 0) ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        return fd;
+    };
+    auto expect = [&](int fd, const std::string& req, const std::string& resp, size_t pieces = 0){
+        return memcache_exchange(fd, req, resp.size(), pieces) == resp;
+    };
+
+    int fd = open();
+    if (fd < 0) { check("connect", false); return failed; }
+    check("set/get", expect(fd, "set pc:a 5 0 3\r\nabc\r\n", "STORED\r\n")
+                  && expect(fd, "get pc:a pc:none\r\n", "VALUE pc:a 5 3\r\nabc\r\nEND\r\n"));
+    check("add", expect(fd, "add pc:a 0 0 1\r\nx\r\n", "NOT_STORED\r\n")
+              && expect(fd, "add pc:b 0 0 1\r\nb\r\n", "STORED\r\n"));
+    check("replace", expect(fd, "replace pc:none 0 0 1\r\nx\r\n", "NOT_STORED\r\n")
+                  && expect(fd, "replace pc:a 7 0 3\r\nabc\r\n", "STORED\r\n"));
+    check("append/prepend", expect(fd, "append pc:a 0 0 2\r\nde\r\nprepend pc:a 0 0 1\r\nx\r\n", "STORED\r\nSTORED\r\n")
+                         && expect(fd, "get pc:a\r\n", "VALUE pc:a 7 6\r\nxabcde\r\nEND\r\n"));
+    {
+        memcache_exchange(fd, "gets pc:a\r\n", 0);
+        const std::string resp = memcache_read_until(fd, "END\r\n");
+        const size_t eol = resp.find("\r\n");
+        const std::string cas = eol == std::string::npos ? "" : resp.substr(resp.rfind(' ', eol) + 1, eol - resp.rfind(' ', eol) - 1);
+        check("gets", resp.rfind("VALUE pc:a 7 6 ", 0) == 0 && !cas.empty());
+        check("cas", expect(fd, "cas pc:a 0 0 1 " + cas + "1\r\ny\r\n", "EXISTS\r\n")
+                  && expect(fd, "cas pc:a 0 0 1 " + cas + "\r\ny\r\n", "STORED\r\n")
+                  && expect(fd, "cas pc:none 0 0 1 1\r\ny\r\n", "NOT_FOUND\r\n"));
+    }
+    check("incr/decr", expect(fd, "set pc:n 0 0 2\r\n10\r\nincr pc:n 5\r\ndecr pc:n 20\r\nincr pc:none 1\r\n",
+                              "STORED\r\n15\r\n0\r\nNOT_FOUND\r\n"));
+    check("touch", expect(fd, "touch pc:a 100\r\ntouch pc:none 100\r\n", "TOUCHED\r\nNOT_FOUND\r\n"));
+    check("delete", expect(fd, "delete pc:a\r\ndelete pc:a\r\nget pc:a\r\n", "DELETED\r\nNOT_FOUND\r\nEND\r\n"));
+    check("noreply", expect(fd, "set pc:q 0 0 1 noreply\r\nq\r\ndelete pc:none noreply\r\nget pc:q\r\n",
+                            "VALUE pc:q 0 1\r\nq\r\nEND\r\n"));
+    check("expired", expect(fd, "set pc:e 0 -1 1\r\ne\r\nget pc:e\r\n", "STORED\r\nEND\r\n"));
+    check("version", memcache_exchange(fd, "version\r\n", 8) == "VERSION " && !memcache_read_until(fd, "\r\n").empty());
+    check("stats", memcache_exchange(fd, "stats\r\n", 5) == "STAT " && !memcache_read_until(fd, "END\r\n").empty());
+    check("verbosity/unknown", expect(fd, "verbosity 1\r\nbogus\r\n\r\n", "OK\r\nERROR\r\nERROR\r\n"));
+    check("flush_all", expect(fd, "flush_all\r\nget pc:b\r\n", "OK\r\nEND\r\n"));
+    // 命令行和数据块逐字节到达
+    check("split writes", expect(fd, "set pc:s 0 0 5\r\nhello\r\nget pc:s\r\n", "STORED\r\nVALUE pc:s 0 5\r\nhello\r\nEND\r\n", 1));
+    // 超过 maxItemBytes：只回 SERVER_ERROR，数据块被丢弃，连接继续可用
+    check("too large", expect(fd, "set pc:big 0 0 2000000\r\n" + std::string(2000000, 'z') + "\r\nget pc:big pc:s\r\n",
+                              "SERVER_ERROR object too large for cache\r\nVALUE pc:s 0 5\r\nhello\r\nEND\r\n"));
+    // 一条 get 带 40 个 key（超过命令的定长切分），命中的按顺序逐个返回
+    {
+        std::string sets, get = "get", resp;
+        for (int i = 0; i < 40; ++i) {
+            const std::string k = "pc:w" + std::to_string(i);
+            sets += "set " + k + " 0 0 1 noreply\r\n" + char('a' + i % 26) + "\r\n";
+            get += " " + k + (i % 2 ? " pc:none" : "");
+            resp += "VALUE " + k + " 0 1\r\n" + char('a' + i % 26) + "\r\n";
+        }
+        check("wide multi-get", expect(fd, sets + get + "\r\n", resp + "END\r\n"));
+    }
+    // 非法 key 排在命中的 key 后面：只回 CLIENT_ERROR，不夹带 VALUE，连接继续可用
+    check("multi-get bad key", expect(fd, "get pc:s " + std::string(300, 'k') + "\r\nget pc:s\r\n",
+                                      "CLIENT_ERROR bad command line format\r\nVALUE pc:s 0 5\r\nhello\r\nEND\r\n"));
+    // 100 个 1MB 的 get 一次发出：响应约 100MB，服务端输出积压时暂停读，客户端慢慢收
+    {
+        const std::string value(1000000, 'v');
+        const std::string one = "VALUE pc:v 0 1000000\r\n" + value + "\r\nEND\r\n";
+        expect(fd, "set pc:v 0 0 1000000\r\n" + value + "\r\n", "STORED\r\n");
+        std::string req;
+        for (int i = 0; i < 100; ++i) req += "get pc:v\r\n";
+        memcache_exchange(fd, req, 0);
+        bool same = true;
+        size_t got = 0;
+        char tmp[65536];
+        while (got < one.size() * 100) {
+            const ssize_t r = ::read(fd, tmp, std::min(sizeof(tmp), one.size() * 100 - got));
+            if (r <= 0) break;
+            for (ssize_t i = 0; i < r && same; ++i) same = tmp[i] == one[(got + size_t(i)) % one.size()];
+            got += size_t(r);
+        }
+        check("100MB pipelined response", same && got == one.size() * 100);
+    }
+    check("quit", expect(fd, "get pc:s\r\nquit\r\nget pc:s\r\n", "VALUE pc:s 0 5\r\nhello\r\nEND\r\n") && memcache_closed(fd));
+    ::close(fd);
+
+    fd = open();
+    check("bad command line disconnects", expect(fd, "set pc:x 0 0 abc\r\nget pc:s\r\n", "CLIENT_ERROR bad command line format\r\n")
+                                          && memcache_closed(fd));
+    ::close(fd);
+    fd = open();
+    check("line too long disconnects", expect(fd, std::string(4096, 'k'), "CLIENT_ERROR line too long\r\n") && memcache_closed(fd));
+    ::close(fd);
+
+    std::cout << "  protocol checks: " << total - failed << "/" << total << " passed\n";
+    return failed;
+}
+
+void run_memcache_demo(){
+    const int KEYS = 20000, CLIENTS = 4, VALUE_BYTES = 100;
+    const auto DURATION = std::chrono::seconds(2);
+    const std::string SOCK = "/tmp/cachesystem-bench.sock";
+    CacheSystem::HashLruCache<std::string, CacheSystem::MemcacheValue> cache(KEYS / 2, 8);
+    CacheSystem::MemcacheServerOptions opt;
+    opt.port = 0;
+    opt.unixPath = SOCK;
+    opt.reactors = 2;
+    CacheSystem::MemcacheServer server(cache, opt);
+    if (!server.start()) {
+        std::cout << "\nmemcache server failed to start, errno=" << server.error() << "\n";
+        return;
+    }
+    auto connectTo = [&](bool unixSocket) {
+        if (unixSocket) {
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un a{};
+            a.sun_family = AF_UNIX;
+            std::strncpy(a.sun_path, SOCK.c_str(), sizeof(a.sun_path) - 1);
+            return ::connect(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) == 0 ? fd : (::close(fd), -1);
+        }
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in a{};
+        a.sin_family = AF_INET;
+        a.sin_port = htons(uint16_t(server.port()));
+        ::inet_pton(AF_INET, "127.0.0.1", &a.sin_addr);
+        return ::connect(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) == 0 ? fd : (::close(fd), -1);
+    };
+    const std::string value(VALUE_BYTES, 'v');
+
+    // 每个客户端一条连接：一次发 depth 条（90% get / 10% set，key 热点分布），收齐 depth 个响应再发下一批
+    auto load = [&](const char* name, bool unixSocket, int depth){
+        const auto before = server.stats();
+        std::atomic<uint64_t> ops{0}, rttNs{0}, batches{0};
+        std::vector<std::thread> ts;
+        for (int c = 0; c < CLIENTS; ++c) ts.emplace_back([&, c]{
+            const int fd = connectTo(unixSocket);
+            if (fd < 0) return;
+            std::mt19937 g(7 + c);
+            std::string req, buf;
+            const auto end = std::chrono::steady_clock::now() + DURATION;
+            while (std::chrono::steady_clock::now() < end) {
+                req.clear();
+                for (int i = 0; i < depth; ++i) {
+                    const int k = (g() % 100 < 80) ? int(g() % (KEYS / 5)) : int(g() % KEYS);
+                    const std::string key = "key:" + std::to_string(k);
+                    if (g() % 10 == 0) req += "set " + key + " 0 0 " + std::to_string(VALUE_BYTES) + "\r\n" + value + "\r\n";
+                    else req += "get " + key + "\r\n";
+                }
+                const auto t0 = std::chrono::steady_clock::now();
+                if (::write(fd, req.data(), req.size()) != ssize_t(req.size())) break;
+                if (!read_memcache_responses(fd, buf, depth)) break;
+                rttNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+                ops += depth;
+                ++batches;
+            }
+            ::close(fd);
+        });
+        for (auto& t : ts) t.join();
+        const auto after = server.stats();
+        const uint64_t gets = after.cmdGet - before.cmdGet, hits = after.getHits - before.getHits;
+        std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0)
+                  << " ops/s=" << std::setw(8) << ops.load() / double(DURATION.count())
+                  << " batch rtt=" << std::setw(6) << rttNs.load() / 1000.0 / std::max<uint64_t>(1, batches.load()) << "us"
+                  << " hit=" << std::setprecision(1) << 100.0 * hits / std::max<uint64_t>(1, gets) << "%\n";
+    };
+
+    std::cout << "\n=== memcached 协议服务（" << opt.reactors << " 个 reactor，" << CLIENTS << " 个客户端，value "
+              << VALUE_BYTES << "B）===\n";
+    run_memcache_protocol_checks([&]{ return connectTo(false); });
+    load("tcp, pipeline 1", false, 1);
+    load("tcp, pipeline 32", false, 32);
+    load("unix, pipeline 32", true, 32);
+    const auto st = server.stats();
+    std::cout << "  total connections=" << st.totalConnections << " bytes in=" << st.bytesRead / 1024
+              << "KB out=" << st.bytesWritten / 1024 << "KB\n";
+    server.stop();
+}
+
+// =============== 多租户配额：在线租户的热数据 vs 批处理租户的大扫描（共享一个 LRU / 按租户分区） ===============
+void run_tenant_quota_demo(){
+    const int CAP = 10000, HOT = 8000;
+    const Key SCAN_BASE = 1000000;              // 批处理租户的 key 从这里开始，一路顺序扫下去
+    const size_t WARM = 40000, OPS = 400000;
+    // 在线租户：HOT 个 key，80% 的访问落在前 20%
+    std::mt19937 g(47);
+    auto webKey = [&]{ return (g() % 100 < 80) ? Key(g() % (HOT / 5)) : Key(g() % HOT); };
+    const std::vector<CacheSystem::TenantQuota> quotas = {
+        {"web",   6000, CAP},                   // 保底 6000，闲时也能占满
+        {"batch", 1000, CAP},                   // 保底 1000，闲时可以借满整个缓存
+    };
+    auto tenantOf = [=](const Key& k){ return k < SCAN_BASE ? 0 : 1; };
+
+    // 先只有批处理在跑（借满空闲容量），再两边 1:1 交替；只统计第二阶段
+    auto run = [&](const char* name, CacheSystem::CachePolicy<Key,Val>& cache){
+        g.seed(47);
+        Key scan = SCAN_BASE;
+        Val v{};
+        for (size_t i = 0; i < WARM; ++i) { const Key k = scan++; if (!cache.get(k, v)) cache.put(k, k); }
+        uint64_t hits[2] = {0, 0}, gets[2] = {0, 0};
+        for (size_t i = 0; i < OPS; ++i) {
+            const int t = int(i & 1);
+            const Key k = t ? scan++ : webKey();
+            ++gets[t];
+            if (cache.get(k, v)) ++hits[t];
+            else cache.put(k, k);
+        }
+        std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+                  << " web hit=" << std::setw(5) << 100.0 * hits[0] / gets[0] << "%"
+                  << " batch hit=" << std::setw(4) << 100.0 * hits[1] / gets[1] << "%";
+    };
+    auto perTenant = [](const std::vector<CacheSystem::TenantStats>& st){
+        for (const auto& s : st)
+            std::cout << "  " << s.name << ": size=" << s.size << " evictions=" << s.evictions
+                      << " reclaimed=" << s.reclaimed;
+        std::cout << "\n";
+    };
+
+    std::cout << "\n=== 多租户配额（总容量 " << CAP << "，web 热集 " << HOT << " 个 key，batch 顺序扫描）===\n";
+    {
+        CacheSystem::LruCache<Key,Val> cache(CAP);
+        run("shared LRU", cache);
+        std::cout << "\n";
+    }
+    {
+        CacheSystem::TenantCache<CacheSystem::LruCache<Key,Val>, Key, Val> cache(CAP, quotas, tenantOf);
+        run("tenant LRU", cache);
+        perTenant(cache.stats());
+    }
+    {
+        CacheSystem::TenantCache<CacheSystem::LfuCache<Key,Val>, Key, Val> cache(CAP, quotas, tenantOf);
+        run("tenant LFU", cache);
+        perTenant(cache.stats());
+    }
+    {
+        CacheSystem::TenantCache<CacheSystem::ArcCache<Key,Val>, Key, Val> cache(CAP, quotas, tenantOf);
+        run("tenant ARC", cache);
+        perTenant(cache.stats());
+    }
+}
+
+// =============== 负载库：Zipf 家族 / YCSB A–F / 多线程命中率（分片与并发交错的影响） ===============
+void run_workload_demo(){
+    using PolicyPtr = std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>;
+    struct Item { std::string name; std::function<PolicyPtr(int)> make; };
+    const std::vector<Item> algos = {
+        {"LRU",     [](int c){ return PolicyPtr(new CacheSystem::LruCache<Key,Val>(c)); }},
+        {"LFU",     [](int c){ return PolicyPtr(new CacheSystem::LfuCache<Key,Val>(c)); }},
+        {"ARC",     [](int c){ return PolicyPtr(new CacheSystem::ArcCache<Key,Val>(c)); }},
+        {"LIRS",    [](int c){ return PolicyPtr(new CacheSystem::LirsCache<Key,Val>(c)); }},
+        {"S3-FIFO", [](int c){ return PolicyPtr(new CacheSystem::S3FifoCache<Key,Val>(c)); }},
+    };
+
+    // 1) 同一个 key 空间、同样的容量，换不同的 Zipf 形状
+    {
+        const uint64_t N = 100000;
+        const int CAP = 1000;
+        const size_t OPS = 300000, WARM = 50000;
+        struct Shape { const char* name; std::function<std::function<uint64_t()>()> make; };
+        const std::vector<Shape> shapes = {
+            {"zipf .80",   [=]{ return std::function<uint64_t()>(Workloads::ScrambledZipf(N, 0.80, 5)); }},
+            {"zipf .99",   [=]{ return std::function<uint64_t()>(Workloads::ScrambledZipf(N, 0.99, 5)); }},
+            {"zipf 1.2",   [=]{ return std::function<uint64_t()>(Workloads::ScrambledZipf(N, 1.20, 5)); }},
+            {"latest",     [=]{ auto l = std::make_shared<Workloads::LatestGenerator>(N, 0.99, 5);
+                               std::mt19937 g(5);   // 5% 的请求是新插入的 key
+                               return std::function<uint64_t()>([l, g]() mutable { return g() % 20 == 0 ? l->insert() : l->next(); }); }},
+            {"drift",      [=]{ return std::function<uint64_t()>(Workloads::DriftingZipf(N, 0.99, 2000, 500, 5)); }},
+        };
+        std::cout << "\n=== Zipf 负载族（" << N << " 个 key，容量 " << CAP << "，命中率）===\n" << std::left << std::setw(10) << "";
+        for (const auto& sh : shapes) std::cout << std::right << std::setw(10) << sh.name;
+        std::cout << "\n";
+        for (const auto& a : algos) {
+            std::cout << std::left << std::setw(10) << a.name << std::right << std::fixed << std::setprecision(1);
+            for (const auto& sh : shapes) {
+                auto cache = a.make(CAP);
+                auto gen = sh.make();
+                size_t hits = 0; Val out{};
+                for (size_t i = 0; i < WARM + OPS; ++i) {
+                    const Key k = (Key)gen();
+                    const bool hit = cache->get(k, out);
+                    if (!hit) cache->put(k, k);
+                    if (i >= WARM) hits += hit;
+                }
+                std::cout << std::setw(9) << 100.0 * hits / OPS << "%";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    // 2) YCSB A–F（θ = 0.99，value 大小按 key 取对数正态），读路径 cache-aside，写路径直接写缓存
+    {
+        const uint64_t RECORDS = 100000;
+        const int CAP = 2000;
+        const size_t OPS = 100000;
+        const uint32_t MAX_SCAN = 20;   // E 的短扫描长度上限（YCSB 默认 100）
+        const auto sizes = Workloads::ValueSizeGenerator::logNormal(1024, 1.0, 64, 64 * 1024);
+        std::cout << "\n=== YCSB A–F（" << RECORDS << " 条记录，容量 " << CAP << "，θ=0.99，命中率 / 字节命中率）===\n"
+                  << std::left << std::setw(10) << "";
+        for (int w = 0; w < 6; ++w) std::cout << std::right << std::setw(15) << Workloads::YcsbWorkload::name(Workloads::Ycsb(w));
+        std::cout << "\n";
+        for (const auto& a : algos) {
+            std::cout << std::left << std::setw(10) << a.name << std::right << std::fixed << std::setprecision(1);
+            for (int w = 0; w < 6; ++w) {
+                auto cache = a.make(CAP);
+                Workloads::YcsbWorkload ycsb(Workloads::Ycsb(w), RECORDS, 0.99, sizes, 17, MAX_SCAN);
+                uint64_t gets = 0, hits = 0, bytes = 0, bytesHit = 0;
+                Val out{};
+                auto read = [&](Key k, uint32_t b){
+                    ++gets; bytes += b;
+                    if (cache->get(k, out)) { ++hits; bytesHit += b; }
+                    else cache->put(k, k);
+                };
+                for (size_t i = 0; i < OPS; ++i) {
+                    const auto op = ycsb.next();
+                    const Key k = (Key)op.key;
+                    switch (op.type) {
+                    case Workloads::OpType::Read:   read(k, op.valueBytes); break;
+                    case Workloads::OpType::Update:
+                    case Workloads::OpType::Insert: cache->put(k, k); break;
+                    case Workloads::OpType::Scan:
+                        for (uint32_t j = 0; j < op.scanLen; ++j) {
+                            const uint64_t id = (op.key + j) % RECORDS;
+                            read((Key)id, sizes.sizeOf(id));
+                        }
+                        break;
+                    case Workloads::OpType::ReadModifyWrite: read(k, op.valueBytes); cache->put(k, k); break;
+                    }
+                }
+                std::cout << std::setw(8) << 100.0 * hits / std::max<uint64_t>(1, gets) << "/"
+                          << std::setw(5) << 100.0 * bytesHit / std::max<uint64_t>(1, bytes) << "%";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    // 3) 多线程：同样的总容量，分片数和线程数变化时命中率怎么变（每个线程一个同分布、不同种子的 Zipf-0.99）
+    {
+        const uint64_t N = 1000000;
+        const size_t CAP = 10000, OPS = 400000, WARM = 100000;
+        auto toKey = [](uint64_t id){ return (Key)id; };
+        struct Config { std::string name; std::function<PolicyPtr()> make; };
+        const std::vector<Config> configs = {
+            {"LRU",            [=]{ return PolicyPtr(new CacheSystem::LruCache<Key,Val>(CAP)); }},
+            {"Hash LRU(4)",    [=]{ return PolicyPtr(new CacheSystem::HashLruCache<Key,Val>(CAP, 4)); }},
+            {"Hash LRU(16)",   [=]{ return PolicyPtr(new CacheSystem::HashLruCache<Key,Val>(CAP, 16)); }},
+            {"Hash LRU(64)",   [=]{ return PolicyPtr(new CacheSystem::HashLruCache<Key,Val>(CAP, 64)); }},
+            {"SetAssoc-16",    [=]{ return PolicyPtr(new CacheSystem::SetAssocCache<Key,Val,16>(CAP)); }},
+            {"Hash S3F(16)",   [=]{ return PolicyPtr(new CacheSystem::HashS3FifoCache<Key,Val>(CAP, 16)); }},
+        };
+        const std::vector<int> threads = {1, 4, 16};
+        std::cout << "\n=== 多线程命中率（Zipf-0.99，" << N << " 个 key，总容量 " << CAP << "，总请求 " << OPS << "）===\n"
+                  << std::left << std::setw(14) << "";
+        for (int t : threads) std::cout << std::right << std::setw(9) << t << "T";
+        std::cout << "\n";
+        for (const auto& c : configs) {
+            std::cout << std::left << std::setw(14) << c.name << std::right << std::fixed << std::setprecision(2);
+            for (int t : threads) {
+                auto cache = c.make();
+                const auto r = Workloads::run_concurrent_hitrate(*cache,
+                    [&](int i){ return Workloads::ScrambledZipf(N, 0.99, 1000 + i); }, toKey, t, OPS / t, WARM / t);
+                std::cout << std::setw(9) << r.hitRate() << "%";
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
+// =============== 硬件计数器：每次操作的 cycles / instructions / LLC miss / 分支预测失败 / 上下文切换，按策略和线程数 ===============
+void run_perf_counter_demo(){
+    const size_t TOTAL_CAP = 100000;
+    const int SHARDS = 8;
+    auto keygen = make_hot_keygen(200000, 0.2, 0.8);
+    using PolicyPtr = std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>;
+    struct Item { std::string name; std::function<PolicyPtr()> make; };
+    const std::vector<Item> items = {
+        {"Hash LRU",      [=]{ return PolicyPtr(new CacheSystem::HashLruCache<Key,Val>(TOTAL_CAP, SHARDS)); }},
+        {"Hash LFU",      [=]{ return PolicyPtr(new CacheSystem::HashLfuCache<Key,Val>(TOTAL_CAP, SHARDS)); }},
+        {"Hash LFU(buf)", [=]{ return PolicyPtr(new CacheSystem::HashBufferedLfuCache<Key,Val>(TOTAL_CAP, SHARDS)); }},
+        {"ARC",           [=]{ return PolicyPtr(new CacheSystem::ArcCache<Key,Val>(TOTAL_CAP)); }},
+        {"Shard ARC",     [=]{ return PolicyPtr(new Sharded<CacheSystem::ArcCache<Key,Val>>(TOTAL_CAP, SHARDS)); }},
+        {"Hash S3FIFO",   [=]{ return PolicyPtr(new CacheSystem::HashS3FifoCache<Key,Val>(TOTAL_CAP, SHARDS)); }},
+        {"SetAssoc16",    [=]{ return PolicyPtr(new CacheSystem::SetAssocCache<Key,Val,16>(TOTAL_CAP)); }},
+    };
+    const std::vector<int> threads = {1, 4};
+
+    std::cout << "\n=== 每次操作的性能计数器（热点负载，" << SHARDS << " 分片）===\n";
+    bool hardware = false, any = false;
+    for (const auto& it : items) {
+        for (int t : threads) {
+            const auto r = run_qps(it.make, keygen, t, std::chrono::seconds(1));
+            hardware = hardware || r.perf.hardware();
+            any = any || r.perf.any();
+            std::cout << std::left << std::setw(14) << it.name << std::right << " T=" << t
+                      << std::fixed << std::setprecision(0) << " QPS=" << std::setw(8) << r.qps;
+            print_perf(r.perf, r.ops);
+            std::cout << "\n";
+        }
+    }
+    if (!any) std::cout << "  perf_event_open 不可用（或 CACHE_BENCH_PERF=0），只有 QPS\n";
+    else if (!hardware) std::cout << "  硬件计数器不可用（虚拟机 / perf_event_paranoid），只有软件事件\n";
+}
+
+// =============== 后台维护：淘汰移出写路径，对比 put 延迟分布（写多读少，Zipf 未命中多） ===============
+void run_maintenance_demo(){
+    const int CAP = 50000;
+    const size_t OPS = 1000000;
+    const auto ops = gen_zipf(OPS, /*U*/2000000, 0.9, /*p_put*/0, 21);
+    using PolicyPtr = std::unique_ptr<CacheSystem::CachePolicy<Key,Val>>;
+    // 第二个函数取后台驱逐的条目数，普通缓存为空
+    struct Item { std::string name; std::function<PolicyPtr()> make; std::function<uint64_t(CacheSystem::CachePolicy<Key,Val>&)> trimmed; };
+    auto maintained = [](auto* tag){
+        using M = std::remove_pointer_t<decltype(tag)>;
+        return std::function<uint64_t(CacheSystem::CachePolicy<Key,Val>&)>(
+            [](CacheSystem::CachePolicy<Key,Val>& c){ return static_cast<M&>(c).stats().trimmed; });
+    };
+    using MLru = CacheSystem::MaintainedCache<CacheSystem::LruCache<Key,Val>, Key, Val>;
+    using MLfu = CacheSystem::MaintainedCache<CacheSystem::LfuCache<Key,Val>, Key, Val>;
+    using MArc = CacheSystem::MaintainedCache<CacheSystem::ArcCache<Key,Val>, Key, Val>;
+    const std::vector<Item> items = {
+        {"LRU",         [=]{ return PolicyPtr(new CacheSystem::LruCache<Key,Val>(CAP)); }, nullptr},
+        {"LRU + maint", [=]{ return PolicyPtr(new MLru(CAP)); }, maintained((MLru*)nullptr)},
+        {"LFU",         [=]{ return PolicyPtr(new CacheSystem::LfuCache<Key,Val>(CAP)); }, nullptr},
+        {"LFU + maint", [=]{ return PolicyPtr(new MLfu(CAP)); }, maintained((MLfu*)nullptr)},
+        {"ARC",         [=]{ return PolicyPtr(new CacheSystem::ArcCache<Key,Val>(CAP)); }, nullptr},
+        {"ARC + maint", [=]{ return PolicyPtr(new MArc(CAP)); }, maintained((MArc*)nullptr)},
+    };
+
+    std::cout << "\n=== 后台维护（容量 " << CAP << "，Zipf-0.9 / 2M key，未命中即 put；put 延迟分位数）===\n";
+    for (const auto& it : items) {
+        auto cache = it.make();
+        std::vector<uint32_t> putNs; putNs.reserve(OPS);
+        size_t hits = 0; Val out{};
+        const auto begin = std::chrono::steady_clock::now();
+        for (const auto& op : ops) {
+            if (cache->get(op.key, out)) { ++hits; continue; }
+            const auto t0 = std::chrono::steady_clock::now();
+            cache->put(op.key, op.val);
+            putNs.push_back(uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count()));
+        }
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::sort(putNs.begin(), putNs.end());
+        auto pct = [&](double q){ return putNs.empty() ? 0u : putNs[std::min(putNs.size() - 1, size_t(q * putNs.size()))]; };
+        const double avg = putNs.empty() ? 0.0 : std::accumulate(putNs.begin(), putNs.end(), 0.0) / putNs.size();
+        std::cout << std::left << std::setw(12) << it.name << std::right << std::fixed << std::setprecision(0)
+                  << " put avg=" << std::setw(4) << avg << "ns p50=" << std::setw(4) << pct(0.5)
+                  << " p99=" << std::setw(5) << pct(0.99) << " p99.9=" << std::setw(6) << pct(0.999)
+                  << " | ops/s=" << std::setw(8) << OPS / secs
+                  << " hit=" << std::setprecision(1) << 100.0 * hits / OPS << "%";
+        if (it.trimmed) std::cout << " bg evicted=" << it.trimmed(*cache);
+        std::cout << "\n";
+    }
+
+    // 只覆盖已有 key（不触发任何淘汰）：两者之差就是包装层在写路径上的固定开销
+    auto overwriteNs = [](CacheSystem::CachePolicy<Key,Val>& c){
+        const int KEYS = 1000, ROUNDS = 5000;
+        for (Key k = 0; k < KEYS; ++k) c.put(k, k);
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < ROUNDS; ++r) for (Key k = 0; k < KEYS; ++k) c.put(k, r);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / (double(KEYS) * ROUNDS);
+    };
+    CacheSystem::LruCache<Key,Val> bare(CAP);
+    MLru wrapped(CAP);
+    const double bareNs = overwriteNs(bare), wrappedNs = overwriteNs(wrapped);
+    std::cout << "overwrite-only put: LRU " << std::setprecision(1) << bareNs << "ns, LRU + maint " << wrappedNs
+              << "ns (write-path overhead " << wrappedNs - bareNs << "ns)\n";
+}
+
 int main(){
     // 1) 命中率对比（单实例，三场景）
     run_all_hitrate();
@@ -244,5 +1657,62 @@ int main(){
     // 2) 并发延迟/QPS（分片，热点场景）
     run_all_qps();
 
+    // 3) 单线程查找开销（组相联 vs 链表 LRU）
+    run_lookup_latency();
+
+    // 4) 平凡可拷贝 key/value 的扁平布局
+    run_inline_layout_demo();
+
+    // 5) 各策略内存占用（bytes/entry）
+    run_memory_usage();
+
+    // 6) Slab arena 占用
+    run_slab_arena_demo();
+
+    // 7) 在线缩容与重新分片
+    run_resize_demo();
+
+    // 8) 分片数自动调优
+    run_autotune_demo();
+
+    // 9) 删除与失效
+    run_invalidation_demo();
+
+    // 10) 删除通知
+    run_removal_listener_demo();
+
+    // 11) 写回模式
+    run_write_back_demo();
+
+    // 12) 缺失率曲线
+    run_miss_ratio_curve_demo();
+
+    // 13) 热点 key
+    run_hot_key_demo();
+
+    // 14) 代价感知淘汰
+    run_cost_aware_demo();
+
+    // 15) 负缓存
+    run_negative_cache_demo();
+
+    // 16) 多进程共享内存缓存
+    run_shared_memory_demo();
+
+    // 17) memcached 协议服务
+    run_memcache_demo();
+
+    // 18) 多租户配额
+    run_tenant_quota_demo();
+
+    // 19) 负载库：Zipf / YCSB / 多线程命中率
+    run_workload_demo();
+
+    // 20) 性能计数器
+    run_perf_counter_demo();
+
+    // 21) 后台维护
+    run_maintenance_demo();
+
     return 0;
 }
\ No newline at end of file